@@ -8,8 +8,17 @@
 #include "communication.h"
 #include "FreeRTOS.h"
 #include "task.h"
+#include "x_protocol/tpmesh_init.h"
+#include "x_protocol/tpmesh_mqtt_gw.h"
 #include <stdio.h>
 
+/* Mesh DDC 启用 MQTT 网关时经 Top Node 发布, 不再自行连接 Broker */
+#if (TPMESH_MODE == TPMESH_MODE_DDC) && TPMESH_MQTT_GW_ENABLE
+#define COMM_VIA_MESH_GW 1
+#else
+#define COMM_VIA_MESH_GW 0
+#endif
+
 /* ============================================================================
  * 状态机
  * ============================================================================ */
@@ -59,6 +68,12 @@ void communication_task(void *pvParameters) {
             at_passthrough_init();
             mqtt_client_init();
             
+#if COMM_VIA_MESH_GW
+            /* 不做 mDNS 发现, 不建立 Broker 连接 */
+            s_state = COMM_STATE_CONNECTED;
+            printf("COMM: Publishing via TPMesh MQTT gateway\n");
+            break;
+#endif
             s_state = COMM_STATE_WAITING;
             s_retry_count = 0;
             printf("COMM: Waiting for broker discovery...\n");
@@ -85,6 +100,10 @@ void communication_task(void *pvParameters) {
             break;
             
         case COMM_STATE_CONNECTING:
+#if COMM_VIA_MESH_GW
+            s_state = COMM_STATE_CONNECTED;
+            break;
+#endif
             printf("COMM: Connecting to broker...\n");
             ddc_mqtt_connect(broker.ip, broker.port);
             
@@ -122,6 +141,11 @@ void communication_task(void *pvParameters) {
             break;
             
         case COMM_STATE_CONNECTED:
+#if COMM_VIA_MESH_GW
+            /* 网关模式: 发布经 ddc_mqtt_publish() 转交网关, 无连接可检查 */
+            at_passthrough_process();
+            break;
+#endif
             /* 检查连接状态 */
             if (!ddc_mqtt_is_connected()) {
                 printf("COMM: Connection lost\n");
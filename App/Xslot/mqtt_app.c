@@ -13,6 +13,8 @@
 #include "lwip/err.h"
 #include "lwip/ip_addr.h"
 #include "lwip/tcpip.h"
+#include "x_protocol/tpmesh_init.h"
+#include "x_protocol/tpmesh_mqtt_gw.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -83,6 +85,12 @@ void ddc_mqtt_connect(const char *ip, uint16_t port) {
   ip_addr_t broker_ip;
   err_t err;
 
+#if (TPMESH_MODE == TPMESH_MODE_DDC) && TPMESH_MQTT_GW_ENABLE
+  /* Mesh DDC: 由 Top Node 网关保持唯一的 Broker 连接 */
+  printf("MQTT Client: Broker connection handled by TPMesh gateway\n");
+  return;
+#endif
+
   if (ip == NULL || strlen(ip) == 0) {
     printf("MQTT Client: Invalid broker IP\n");
     return;
@@ -158,6 +166,15 @@ bool ddc_mqtt_is_connected(void) {
 
 void ddc_mqtt_publish(const char *topic, const uint8_t *payload,
                       uint16_t len) {
+#if (TPMESH_MODE == TPMESH_MODE_DDC) && TPMESH_MQTT_GW_ENABLE
+  /* Mesh DDC: 经 Top Node 网关发布, 不经 Mesh 保持 Broker 连接 */
+  if (topic != NULL &&
+      tpmesh_mqtt_gw_publish(topic, payload, len, 0, false) != 0) {
+    printf("MQTT Client: Gateway publish failed\n");
+  }
+  return;
+#endif
+
   if (!ddc_mqtt_is_connected() || topic == NULL) {
     return;
   }
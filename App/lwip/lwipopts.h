@@ -108,6 +108,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /* ICMP options */
 #define LWIP_ICMP 1
 
+/* ARP options */
+#define ETHARP_SUPPORT_STATIC_ENTRIES                                          \
+  1 /* DDC installs Ethernet-side hosts pushed by the TPMesh Top Node          \
+       (tpmesh_arp_seed) as static ARP entries */
+
+/* Routing hook: a TPMesh DDC shares its MAC/IP between the Ethernet port and
+   the mesh netif (tpmesh_netif); hosts already resolved on the Ethernet port
+   are routed back out of it, everything else goes to the mesh */
+struct ip4_addr;
+struct netif;
+struct netif *tpmesh_netif_route_src(const struct ip4_addr *src,
+                                     const struct ip4_addr *dest);
+#define LWIP_HOOK_IP4_ROUTE_SRC(src, dest) tpmesh_netif_route_src(src, dest)
+
 /* DHCP options */
 #define LWIP_DHCP                                                              \
   1 /* define to 1 if you want DHCP configuration of interfaces,               \
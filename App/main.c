@@ -3,6 +3,7 @@
 #include "ethernetif.h"
 #include "x_protocol/tpmesh_debug.h"
 #include "x_protocol/tpmesh_init.h"
+#include "x_protocol/tpmesh_time.h"
 
 void start_task(void);
 TaskHandle_t LED_Handler;
@@ -330,7 +331,10 @@ int main(void) {
   // "test_w25q128_task", 0x400, NULL, tskIDLE_PRIORITY, NULL);
   // xTaskCreate(iperfClientTask, "iperfClientTask", 0x1000, NULL,
   // tskIDLE_PRIORITY, NULL);
+  /* DDC 由 Top Node 的时间信标校时, 不再经 Mesh 访问 NTP 服务器 */
+#if !(TPMESH_MODE == TPMESH_MODE_DDC && TPMESH_TIME_ENABLE)
   xTaskCreate(ntp_task, "ntp_task", 0x100, NULL, tskIDLE_PRIORITY + 1, NULL);
+#endif
   xTaskCreate(bacnet_ip_server_task, "bacnet_ip_server_task", 0x400, NULL,
               tskIDLE_PRIORITY + 1, NULL);
   xTaskCreate(bacnet_app_task, "bacnet_app_task", 0x800, NULL,
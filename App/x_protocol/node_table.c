@@ -2,25 +2,101 @@
  * @file node_table.c
  * @brief TPMesh 节点映射表模块实现
  * 
+ * 条目保存在紧凑数组中, MAC / IP / Mesh ID 各有一个开放寻址哈希索引,
+ * 逐帧查询为 O(1)。
+ *
+ * 并发: 写者持互斥锁并在修改前后递增 s_seq; 读者不加锁, 序列号为奇数
+ * 或前后不一致时重试。写入期间读者可能看到中间状态, 但桶内槽位号始终
+ * 有效且哈希表始终留有空桶, 探测必然结束, 中间结果被丢弃。
+ *
  * @version 0.6.2
  */
 
 #include "node_table.h"
 #include "tpmesh_debug.h"
+#include "tpmesh_timer.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include <string.h>
 
+/* ============================================================================
+ * 私有类型
+ * ============================================================================ */
+
+/** 哈希索引类型 */
+typedef enum {
+    NODE_INDEX_MESH = 0, /**< Mesh ID */
+    NODE_INDEX_MAC,      /**< MAC 地址 */
+    NODE_INDEX_IP,       /**< IPv4 地址 */
+    NODE_INDEX_COUNT
+} node_index_t;
+
+/** 哈希表大小 */
+#define NODE_HASH_SIZE (1u << NODE_TABLE_HASH_BITS)
+#define NODE_HASH_MASK (NODE_HASH_SIZE - 1u)
+
+/** 哈希桶空值 (桶内保存槽位号 + 1) */
+#define NODE_HASH_EMPTY 0
+
+#if (1u << NODE_TABLE_HASH_BITS) < 2 * NODE_TABLE_MAX_ENTRIES
+#error "NODE_TABLE_HASH_BITS too small: load factor must stay <= 0.5"
+#endif
+
+#if NODE_TABLE_PHI_SUSPECT < 1 || NODE_TABLE_PHI_OFFLINE > 16 || \
+    NODE_TABLE_PHI_OFFLINE < NODE_TABLE_PHI_SUSPECT
+#error "NODE_TABLE_PHI_SUSPECT/OFFLINE must satisfy 1 <= SUSPECT <= OFFLINE <= 16"
+#endif
+
+/** 读者状态 (seqlock) */
+typedef struct {
+    uint32_t seq;  /**< 开始时的写序列号 */
+    uint8_t tries; /**< 已重试次数 */
+    bool locked;   /**< 已回退为加锁读 */
+} node_read_t;
+
 /* ============================================================================
  * 私有变量
  * ============================================================================ */
 
-/** 节点表 */
+/** 节点表 (紧凑数组: [0, s_node_count) 均为有效条目) */
 static node_entry_t s_node_table[NODE_TABLE_MAX_ENTRIES];
 
-/** 访问互斥锁 */
+/** 有效条目数 */
+static uint16_t s_node_count = 0;
+
+/** 存活定时器 (与槽位一一对应, 静态节点不启动) */
+static tpmesh_timer_t s_live_timers[NODE_TABLE_MAX_ENTRIES];
+
+/**
+ * phi = 0..16 对应的标准正态分位数 x100: P(X > y) = 10^-phi
+ * (phi=0 取 y=0, 即 phi 约 0.3 以下按 0 计)
+ */
+static const uint16_t s_phi_quantile[17] = {
+    0,   128, 233, 309, 372, 426, 475, 520, 561,
+    600, 636, 671, 703, 735, 765, 794, 822,
+};
+
+/** 开放寻址哈希索引 (线性探测) */
+static uint16_t s_hash[NODE_INDEX_COUNT][NODE_HASH_SIZE];
+
+/** 设备实例索引: 有效槽位号, 按 device_instance 升序 (未知实例排在末尾) */
+static uint16_t s_inst_index[NODE_TABLE_MAX_ENTRIES];
+
+/** 设备实例索引长度 */
+static uint16_t s_inst_count = 0;
+
+/** 写者互斥锁 (写者之间串行; 读者仅在回退时使用) */
 static SemaphoreHandle_t s_table_mutex = NULL;
 
+/** 写序列号 (seqlock): 奇数=写入进行中 */
+static volatile uint32_t s_seq = 0;
+
+/** 读者回退加锁次数 (统计) */
+static volatile uint32_t s_read_fallbacks = 0;
+
+/** 持久化内容 (键/设备信息/组播组) 变更计数, 供快照合并写入 */
+static volatile uint32_t s_generation = 0;
+
 /** 初始化状态 */
 static bool s_initialized = false;
 
@@ -45,42 +121,251 @@ static inline uint32_t get_tick_ms(void)
 }
 
 /**
- * @brief 查找空闲槽位
+ * @brief 写入开始: 串行化写者并使序列号变为奇数
  */
-static int find_free_slot(void)
+static inline void write_begin(void)
 {
-    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
-        if (!s_node_table[i].valid) {
-            return i;
+    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    s_seq++;
+    portMEMORY_BARRIER();
+}
+
+/**
+ * @brief 写入结束: 序列号恢复为偶数
+ */
+static inline void write_end(void)
+{
+    portMEMORY_BARRIER();
+    s_seq++;
+    xSemaphoreGive(s_table_mutex);
+}
+
+/**
+ * @brief 读者开始一次尝试
+ *
+ * 多次重试仍失败说明写者被当前任务抢占 (单核), 此时改为加锁读,
+ * 互斥锁的优先级继承使写者尽快完成。
+ */
+static inline void read_begin(node_read_t *rd)
+{
+    if (rd->tries >= NODE_TABLE_READ_RETRY_MAX) {
+        xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+        rd->locked = true;
+        s_read_fallbacks++;
+        return;
+    }
+    rd->seq = s_seq;
+    portMEMORY_BARRIER();
+}
+
+/**
+ * @brief 读者结束一次尝试
+ * @return true=期间有写入, 需要重试
+ */
+static inline bool read_retry(node_read_t *rd)
+{
+    if (rd->locked) {
+        xSemaphoreGive(s_table_mutex);
+        return false;
+    }
+
+    portMEMORY_BARRIER();
+    if ((rd->seq & 1u) == 0 && s_seq == rd->seq) {
+        return false;
+    }
+    rd->tries++;
+    return true;
+}
+
+/**
+ * @brief 乘法哈希, 取高位作为桶号
+ */
+static inline uint32_t hash_u32(uint32_t key)
+{
+    return (key * 2654435761u) >> (32 - NODE_TABLE_HASH_BITS);
+}
+
+/**
+ * @brief 计算键的哈希桶
+ * @param key Mesh ID (uint16_t*) / MAC (uint8_t[6]) / IP (ip4_addr_t*)
+ */
+static uint32_t key_hash(node_index_t index, const void *key)
+{
+    switch (index) {
+    case NODE_INDEX_MESH:
+        return hash_u32(*(const uint16_t *)key);
+    case NODE_INDEX_MAC: {
+        /* 同一批 DDC 的 OUI 相同, 差异集中在低 3 字节 */
+        const uint8_t *m = (const uint8_t *)key;
+        uint32_t lo = ((uint32_t)m[2] << 24) | ((uint32_t)m[3] << 16) |
+                      ((uint32_t)m[4] << 8) | m[5];
+        uint32_t hi = ((uint32_t)m[0] << 8) | m[1];
+        return hash_u32(lo ^ (hi * 0x9E3779B1u));
+    }
+    default:
+        return hash_u32(ip4_addr_get_u32((const ip4_addr_t *)key));
+    }
+}
+
+/**
+ * @brief 条目在某个索引中的键
+ */
+static const void *entry_key(node_index_t index, const node_entry_t *e)
+{
+    switch (index) {
+    case NODE_INDEX_MESH:
+        return &e->mesh_id;
+    case NODE_INDEX_MAC:
+        return e->mac;
+    default:
+        return &e->ip;
+    }
+}
+
+/**
+ * @brief 条目是否匹配键
+ */
+static bool key_match(node_index_t index, const node_entry_t *e, const void *key)
+{
+    switch (index) {
+    case NODE_INDEX_MESH:
+        return e->mesh_id == *(const uint16_t *)key;
+    case NODE_INDEX_MAC:
+        return mac_equal(e->mac, (const uint8_t *)key);
+    default:
+        return ip4_addr_cmp(&e->ip, (const ip4_addr_t *)key);
+    }
+}
+
+/**
+ * @brief 在索引中查找键
+ * @return 槽位号, 未找到返回 -1
+ */
+static int hash_find(node_index_t index, const void *key)
+{
+    const uint16_t *tab = s_hash[index];
+    uint32_t pos = key_hash(index, key);
+
+    while (tab[pos] != NODE_HASH_EMPTY) {
+        int slot = tab[pos] - 1;
+        if (key_match(index, &s_node_table[slot], key)) {
+            return slot;
         }
+        pos = (pos + 1) & NODE_HASH_MASK;
     }
     return -1;
 }
 
 /**
- * @brief 通过 Mesh ID 查找槽位
+ * @brief 查找槽位在索引中的桶位置
+ * @return 桶位置, 未找到返回 -1
  */
-static int find_by_mesh_id(uint16_t mesh_id)
+static int hash_locate(node_index_t index, int slot)
 {
-    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
-        if (s_node_table[i].valid && s_node_table[i].mesh_id == mesh_id) {
-            return i;
+    const uint16_t *tab = s_hash[index];
+    uint32_t pos = key_hash(index, entry_key(index, &s_node_table[slot]));
+
+    while (tab[pos] != NODE_HASH_EMPTY) {
+        if (tab[pos] == slot + 1) {
+            return (int)pos;
         }
+        pos = (pos + 1) & NODE_HASH_MASK;
     }
     return -1;
 }
 
 /**
- * @brief 通过 MAC 查找槽位
+ * @brief 将槽位加入索引
  */
-static int find_by_mac(const uint8_t *mac)
+static void hash_insert(node_index_t index, int slot)
 {
-    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
-        if (s_node_table[i].valid && mac_equal(s_node_table[i].mac, mac)) {
-            return i;
+    uint16_t *tab = s_hash[index];
+    uint32_t pos = key_hash(index, entry_key(index, &s_node_table[slot]));
+
+    while (tab[pos] != NODE_HASH_EMPTY) {
+        pos = (pos + 1) & NODE_HASH_MASK;
+    }
+    tab[pos] = (uint16_t)(slot + 1);
+}
+
+/**
+ * @brief 从索引中删除槽位 (后移删除, 不留墓碑)
+ */
+static void hash_delete(node_index_t index, int slot)
+{
+    uint16_t *tab = s_hash[index];
+    int found = hash_locate(index, slot);
+    if (found < 0) {
+        return;
+    }
+
+    uint32_t hole = (uint32_t)found;
+    uint32_t pos = hole;
+    tab[hole] = NODE_HASH_EMPTY;
+
+    for (;;) {
+        pos = (pos + 1) & NODE_HASH_MASK;
+        if (tab[pos] == NODE_HASH_EMPTY) {
+            break;
+        }
+
+        /* 理想桶位于 (hole, pos] 循环区间内的元素保持不动 */
+        uint32_t home = key_hash(index, entry_key(index, &s_node_table[tab[pos] - 1]));
+        bool stay = (hole < pos) ? (home > hole && home <= pos)
+                                 : (home > hole || home <= pos);
+        if (!stay) {
+            tab[hole] = tab[pos];
+            tab[pos] = NODE_HASH_EMPTY;
+            hole = pos;
         }
     }
-    return -1;
+}
+
+/**
+ * @brief 槽位加入全部哈希索引
+ */
+static void index_link(int slot)
+{
+    for (int i = 0; i < NODE_INDEX_COUNT; i++) {
+        hash_insert((node_index_t)i, slot);
+    }
+}
+
+/**
+ * @brief 槽位移出全部哈希索引 (须在修改键之前调用)
+ */
+static void index_unlink(int slot)
+{
+    for (int i = 0; i < NODE_INDEX_COUNT; i++) {
+        hash_delete((node_index_t)i, slot);
+    }
+}
+
+/**
+ * @brief 分配新槽位 (紧凑数组末尾)
+ */
+static int alloc_slot(void)
+{
+    if (s_node_count >= NODE_TABLE_MAX_ENTRIES) {
+        return -1;
+    }
+    return s_node_count++;
+}
+
+/**
+ * @brief 通过 Mesh ID 查找槽位
+ */
+static int find_by_mesh_id(uint16_t mesh_id)
+{
+    return hash_find(NODE_INDEX_MESH, &mesh_id);
+}
+
+/**
+ * @brief 通过 MAC 查找槽位
+ */
+static int find_by_mac(const uint8_t *mac)
+{
+    return hash_find(NODE_INDEX_MAC, mac);
 }
 
 /**
@@ -88,13 +373,252 @@ static int find_by_mac(const uint8_t *mac)
  */
 static int find_by_ip(const ip4_addr_t *ip)
 {
-    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
-        if (s_node_table[i].valid && 
-            ip4_addr_cmp(&s_node_table[i].ip, ip)) {
-            return i;
+    return hash_find(NODE_INDEX_IP, ip);
+}
+
+/**
+ * @brief 从设备实例索引中移除槽位
+ */
+static void inst_index_remove(int slot)
+{
+    for (uint16_t i = 0; i < s_inst_count; i++) {
+        if (s_inst_index[i] == slot) {
+            memmove(&s_inst_index[i], &s_inst_index[i + 1],
+                    (s_inst_count - i - 1) * sizeof(s_inst_index[0]));
+            s_inst_count--;
+            return;
         }
     }
-    return -1;
+}
+
+/**
+ * @brief 查找第一个 device_instance >= instance 的索引位置
+ */
+static uint16_t inst_index_lower_bound(uint32_t instance)
+{
+    uint16_t lo = 0;
+    uint16_t hi = s_inst_count;
+
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+        if (s_node_table[s_inst_index[mid]].device_instance < instance) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief 槽位内容变化后更新设备实例索引 (注册/删除时调用, 非热路径)
+ */
+static void inst_index_update(int slot)
+{
+    inst_index_remove(slot);
+
+    if (!s_node_table[slot].valid) {
+        return;
+    }
+
+    uint16_t pos = inst_index_lower_bound(s_node_table[slot].device_instance);
+    memmove(&s_inst_index[pos + 1], &s_inst_index[pos],
+            (s_inst_count - pos) * sizeof(s_inst_index[0]));
+    s_inst_index[pos] = (uint16_t)slot;
+    s_inst_count++;
+}
+
+/**
+ * @brief 到达间隔标准差估计 (正态分布平均偏差约为 0.8 sigma)
+ */
+static uint32_t arrival_sigma(const node_arrival_t *a)
+{
+    uint32_t sigma = a->dev + a->dev / 4;
+    return (sigma < NODE_TABLE_PHI_MIN_STD_MS) ? NODE_TABLE_PHI_MIN_STD_MS
+                                               : sigma;
+}
+
+/**
+ * @brief 怀疑度达到 phi 所需的静默时间
+ * @param min_ms 下限
+ * @return ms, 样本不足时为 NODE_TABLE_TIMEOUT_MS
+ */
+static uint32_t phi_timeout(const node_entry_t *e, uint8_t phi, uint32_t min_ms)
+{
+    const node_arrival_t *a = &e->arrival;
+
+    if (e->stale || a->samples < NODE_TABLE_PHI_MIN_SAMPLES) {
+        return NODE_TABLE_TIMEOUT_MS;
+    }
+
+    uint32_t t = a->mean + arrival_sigma(a) * s_phi_quantile[phi] / 100;
+    if (t < min_ms) t = min_ms;
+    if (t > NODE_TABLE_TIMEOUT_MS) t = NODE_TABLE_TIMEOUT_MS;
+    return t;
+}
+
+/**
+ * @brief 当前怀疑度 (调试用)
+ * @return phi x 10, 样本不足时返回 -1
+ */
+static int phi_now(const node_entry_t *e, uint32_t now)
+{
+    const node_arrival_t *a = &e->arrival;
+
+    if (e->stale || a->samples < NODE_TABLE_PHI_MIN_SAMPLES) {
+        return -1;
+    }
+
+    uint32_t elapsed = now - e->last_seen;
+    if (elapsed <= a->mean) {
+        return 0;
+    }
+
+    /* 在分位数表中线性插值 */
+    uint32_t y = (elapsed - a->mean) * 100u / arrival_sigma(a);
+    for (int phi = 1; phi <= 16; phi++) {
+        if (y < s_phi_quantile[phi]) {
+            uint32_t lo = s_phi_quantile[phi - 1];
+            uint32_t span = s_phi_quantile[phi] - lo;
+            return (phi - 1) * 10 + (int)((y - lo) * 10u / span);
+        }
+    }
+    return 160;
+}
+
+/**
+ * @brief 启动槽位的存活定时器 (已启动则保持, 到期时按 last_seen 重新判断)
+ */
+static void liveness_arm(int slot)
+{
+    const node_entry_t *e = &s_node_table[slot];
+
+    if (e->source == NODE_SOURCE_STATIC) {
+        /* 静态节点不超时 */
+        tpmesh_timer_stop(&s_live_timers[slot]);
+        return;
+    }
+    if (!tpmesh_timer_active(&s_live_timers[slot])) {
+        tpmesh_timer_start_at(&s_live_timers[slot],
+                              e->last_seen +
+                              phi_timeout(e, NODE_TABLE_PHI_SUSPECT,
+                                          NODE_TABLE_PHI_SUSPECT_MIN_MS) + 1);
+    }
+}
+
+/**
+ * @brief 存活定时器到期: 按怀疑度标记可疑/离线, 期间有活动则顺延
+ */
+static void liveness_expired(tpmesh_timer_t *timer, void *arg)
+{
+    int slot = (int)(uintptr_t)arg;
+
+    write_begin();
+
+    node_entry_t *e = &s_node_table[slot];
+    if (slot < s_node_count && e->valid && e->online &&
+        e->source != NODE_SOURCE_STATIC) {
+        uint32_t elapsed = get_tick_ms() - e->last_seen;
+        uint32_t suspect_ms = phi_timeout(e, NODE_TABLE_PHI_SUSPECT,
+                                          NODE_TABLE_PHI_SUSPECT_MIN_MS);
+        uint32_t offline_ms = phi_timeout(e, NODE_TABLE_PHI_OFFLINE,
+                                          NODE_TABLE_PHI_OFFLINE_MIN_MS);
+
+        if (elapsed > offline_ms) {
+            tpmesh_debug_printf("NodeTable: Node 0x%04X offline (silent %lu ms)\n",
+                   e->mesh_id, (unsigned long)elapsed);
+            e->online = 0;
+            e->suspect = 0;
+        } else if (elapsed > suspect_ms) {
+            if (!e->suspect) {
+                tpmesh_debug_printf("NodeTable: Node 0x%04X suspect (silent %lu ms)\n",
+                       e->mesh_id, (unsigned long)elapsed);
+                e->suspect = 1;
+            }
+            tpmesh_timer_start_at(timer, e->last_seen + offline_ms + 1);
+        } else {
+            tpmesh_timer_start_at(timer, e->last_seen + suspect_ms + 1);
+        }
+    }
+
+    write_end();
+}
+
+/**
+ * @brief 收到节点流量: 记录到达间隔并刷新存活状态 (调用方持写锁)
+ */
+static void node_heard(int slot)
+{
+    node_entry_t *e = &s_node_table[slot];
+    node_arrival_t *a = &e->arrival;
+    uint32_t now = get_tick_ms();
+    uint32_t gap = now - e->last_seen;
+
+    /* 离线或快照恢复期间的间隔不代表正常到达分布; 突发内的后续帧
+     * 不作为样本 */
+    if (e->online && !e->stale && gap >= NODE_TABLE_PHI_MIN_GAP_MS) {
+        if (a->samples == 0) {
+            a->mean = gap;
+            a->dev = gap / 2;
+        } else {
+            uint32_t err = (gap > a->mean) ? gap - a->mean : a->mean - gap;
+            a->dev = (3u * a->dev + err) / 4;
+            a->mean = (7u * a->mean + gap) / 8;
+        }
+        if (a->samples < 0xFF) a->samples++;
+    }
+
+    e->last_seen = now;
+    e->online = 1;
+    e->stale = 0;
+    if (e->suspect) {
+        /* 定时器停在离线判定点, 按新的间隔起点重新计时 */
+        e->suspect = 0;
+        tpmesh_timer_stop(&s_live_timers[slot]);
+    }
+    liveness_arm(slot);
+}
+
+/**
+ * @brief 删除槽位: 末尾条目移入空位, 保持数组紧凑
+ */
+static void free_slot(int slot)
+{
+    int last = s_node_count - 1;
+
+    s_generation++;
+
+    index_unlink(slot);
+    s_node_table[slot].valid = 0;
+    inst_index_update(slot);
+    tpmesh_timer_stop(&s_live_timers[slot]);
+
+    if (slot != last) {
+        /* 键不变, 只需把索引中的槽位号由 last 改为 slot */
+        for (int i = 0; i < NODE_INDEX_COUNT; i++) {
+            int pos = hash_locate((node_index_t)i, last);
+            if (pos >= 0) {
+                s_hash[i][pos] = (uint16_t)(slot + 1);
+            }
+        }
+        for (uint16_t i = 0; i < s_inst_count; i++) {
+            if (s_inst_index[i] == last) {
+                s_inst_index[i] = (uint16_t)slot;
+                break;
+            }
+        }
+        s_node_table[slot] = s_node_table[last];
+
+        /* 存活定时器随条目迁移 */
+        if (tpmesh_timer_active(&s_live_timers[last])) {
+            tpmesh_timer_start_at(&s_live_timers[slot],
+                                  s_live_timers[last].deadline);
+            tpmesh_timer_stop(&s_live_timers[last]);
+        }
+    }
+
+    memset(&s_node_table[last], 0, sizeof(s_node_table[last]));
+    s_node_count--;
 }
 
 /* ============================================================================
@@ -108,6 +632,14 @@ void node_table_init(void)
     }
 
     memset(s_node_table, 0, sizeof(s_node_table));
+    memset(s_hash, 0, sizeof(s_hash));
+    s_node_count = 0;
+    s_inst_count = 0;
+
+    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
+        tpmesh_timer_setup(&s_live_timers[i], liveness_expired,
+                           (void *)(uintptr_t)i);
+    }
     
     s_table_mutex = xSemaphoreCreateMutex();
     s_initialized = true;
@@ -118,13 +650,20 @@ void node_table_init(void)
 void node_table_clear(void)
 {
     if (s_table_mutex) {
-        xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+        write_begin();
     }
 
+    for (int i = 0; i < s_node_count; i++) {
+        tpmesh_timer_stop(&s_live_timers[i]);
+    }
     memset(s_node_table, 0, sizeof(s_node_table));
+    memset(s_hash, 0, sizeof(s_hash));
+    s_node_count = 0;
+    s_inst_count = 0;
+    s_generation++;
 
     if (s_table_mutex) {
-        xSemaphoreGive(s_table_mutex);
+        write_end();
     }
 }
 
@@ -132,30 +671,47 @@ int node_table_add_static(const uint8_t *mac, const ip4_addr_t *ip, uint16_t mes
 {
     if (!s_initialized) return -1;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    write_begin();
 
     /* 检查是否已存在 */
     int idx = find_by_mesh_id(mesh_id);
     if (idx < 0) {
-        idx = find_free_slot();
+        idx = alloc_slot();
     }
 
     if (idx < 0) {
-        xSemaphoreGive(s_table_mutex);
+        write_end();
         tpmesh_debug_printf("NodeTable: Table full\n");
         return -1;
     }
 
     node_entry_t *entry = &s_node_table[idx];
+    if (entry->valid) {
+        index_unlink(idx);
+    }
+    if (!entry->valid || entry->mesh_id != mesh_id) {
+        entry->device_instance = NODE_DEVICE_INSTANCE_NONE;
+        entry->caps = 0;
+        entry->group = NODE_GROUP_NONE;
+        memset(&entry->rtt, 0, sizeof(entry->rtt));
+        memset(&entry->arrival, 0, sizeof(entry->arrival));
+    }
     entry->valid = 1;
     memcpy(entry->mac, mac, 6);
     ip4_addr_copy(entry->ip, *ip);
     entry->mesh_id = mesh_id;
     entry->last_seen = get_tick_ms();
     entry->source = NODE_SOURCE_STATIC;
+    entry->owner = 0;
     entry->online = 0;
+    entry->suspect = 0;
+    entry->stale = 0;
+    index_link(idx);
+    inst_index_update(idx);
+    liveness_arm(idx);
+    s_generation++;
 
-    xSemaphoreGive(s_table_mutex);
+    write_end();
 
     tpmesh_debug_printf("NodeTable: Added static 0x%04X -> %d.%d.%d.%d\n",
            mesh_id, ip4_addr1(ip), ip4_addr2(ip), ip4_addr3(ip), ip4_addr4(ip));
@@ -166,7 +722,7 @@ int node_table_register(const uint8_t *mac, const ip4_addr_t *ip, uint16_t mesh_
 {
     if (!s_initialized) return -1;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    write_begin();
 
     /* 查找已有条目或空闲槽位 */
     int idx = find_by_mesh_id(mesh_id);
@@ -174,14 +730,14 @@ int node_table_register(const uint8_t *mac, const ip4_addr_t *ip, uint16_t mesh_
         idx = find_by_mac(mac);
     }
     if (idx < 0) {
-        idx = find_free_slot();
+        idx = alloc_slot();
     }
 
     if (idx < 0) {
         /* 表满,覆盖最老的动态条目 */
         uint32_t oldest_time = 0xFFFFFFFF;
         int oldest_idx = -1;
-        for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
+        for (int i = 0; i < s_node_count; i++) {
             if (s_node_table[i].valid && 
                 s_node_table[i].source != NODE_SOURCE_STATIC &&
                 s_node_table[i].last_seen < oldest_time) {
@@ -193,20 +749,38 @@ int node_table_register(const uint8_t *mac, const ip4_addr_t *ip, uint16_t mesh_
     }
 
     if (idx < 0) {
-        xSemaphoreGive(s_table_mutex);
+        write_end();
         return -1;
     }
 
     node_entry_t *entry = &s_node_table[idx];
+    if (entry->valid) {
+        index_unlink(idx);
+    }
+    if (!entry->valid || entry->mesh_id != mesh_id) {
+        /* 新节点或覆盖其他节点: 设备信息等待注册 TLV 重新上报 */
+        entry->device_instance = NODE_DEVICE_INSTANCE_NONE;
+        entry->caps = 0;
+        entry->group = NODE_GROUP_NONE;
+        memset(&entry->rtt, 0, sizeof(entry->rtt));
+        memset(&entry->arrival, 0, sizeof(entry->arrival));
+    }
     entry->valid = 1;
     memcpy(entry->mac, mac, 6);
     ip4_addr_copy(entry->ip, *ip);
     entry->mesh_id = mesh_id;
     entry->last_seen = get_tick_ms();
+    entry->suspect = 0;
     entry->source = NODE_SOURCE_REGISTER;
+    entry->owner = 0;
     entry->online = 1;
+    entry->stale = 0;
+    index_link(idx);
+    inst_index_update(idx);
+    liveness_arm(idx);
+    s_generation++;
 
-    xSemaphoreGive(s_table_mutex);
+    write_end();
 
     tpmesh_debug_printf("NodeTable: Registered 0x%04X MAC=%02X:%02X:%02X:%02X:%02X:%02X IP=%d.%d.%d.%d\n",
            mesh_id,
@@ -219,22 +793,21 @@ int node_table_learn(const uint8_t *mac, const ip4_addr_t *ip, uint16_t mesh_id)
 {
     if (!s_initialized) return -1;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    write_begin();
 
     /* 检查是否已存在 */
     int idx = find_by_mesh_id(mesh_id);
     if (idx >= 0) {
         /* 已存在,更新时间 */
-        s_node_table[idx].last_seen = get_tick_ms();
-        s_node_table[idx].online = 1;
-        xSemaphoreGive(s_table_mutex);
+        node_heard(idx);
+        write_end();
         return 0;
     }
 
     /* 新条目 */
-    idx = find_free_slot();
+    idx = alloc_slot();
     if (idx < 0) {
-        xSemaphoreGive(s_table_mutex);
+        write_end();
         return -1;
     }
 
@@ -245,9 +818,18 @@ int node_table_learn(const uint8_t *mac, const ip4_addr_t *ip, uint16_t mesh_id)
     entry->mesh_id = mesh_id;
     entry->last_seen = get_tick_ms();
     entry->source = NODE_SOURCE_LEARNED;
+    entry->owner = 0;
     entry->online = 1;
+    entry->stale = 0;
+    entry->caps = 0;
+    entry->device_instance = NODE_DEVICE_INSTANCE_NONE;
+    entry->group = NODE_GROUP_NONE;
+    index_link(idx);
+    inst_index_update(idx);
+    liveness_arm(idx);
+    s_generation++;
 
-    xSemaphoreGive(s_table_mutex);
+    write_end();
 
     tpmesh_debug_printf("NodeTable: Learned 0x%04X\n", mesh_id);
     return 0;
@@ -257,17 +839,21 @@ int node_table_learn_by_mesh(uint16_t mesh_id, const uint8_t *mac)
 {
     if (!s_initialized) return -1;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    write_begin();
 
     int idx = find_by_mesh_id(mesh_id);
     if (idx >= 0) {
-        /* 更新 MAC */
-        memcpy(s_node_table[idx].mac, mac, 6);
-        s_node_table[idx].last_seen = get_tick_ms();
-        s_node_table[idx].online = 1;
+        /* 更新 MAC (键变化须重建 MAC 索引) */
+        if (!mac_equal(s_node_table[idx].mac, mac)) {
+            hash_delete(NODE_INDEX_MAC, idx);
+            memcpy(s_node_table[idx].mac, mac, 6);
+            hash_insert(NODE_INDEX_MAC, idx);
+            s_generation++;
+        }
+        node_heard(idx);
     }
 
-    xSemaphoreGive(s_table_mutex);
+    write_end();
     return (idx >= 0) ? 0 : -1;
 }
 
@@ -275,29 +861,201 @@ void node_table_touch(uint16_t mesh_id)
 {
     if (!s_initialized) return;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    write_begin();
 
     int idx = find_by_mesh_id(mesh_id);
     if (idx >= 0) {
-        s_node_table[idx].last_seen = get_tick_ms();
-        s_node_table[idx].online = 1;
+        node_heard(idx);
     }
 
-    xSemaphoreGive(s_table_mutex);
+    write_end();
+}
+
+int node_table_restore(const node_entry_t *entry)
+{
+    if (!s_initialized || entry == NULL) return -1;
+
+    write_begin();
+
+    /* 已有条目 (静态配置或已注册) 优先 */
+    if (find_by_mesh_id(entry->mesh_id) >= 0 || find_by_mac(entry->mac) >= 0 ||
+        find_by_ip(&entry->ip) >= 0) {
+        write_end();
+        return -2;
+    }
+
+    int idx = alloc_slot();
+    if (idx < 0) {
+        write_end();
+        return -1;
+    }
+
+    node_entry_t *e = &s_node_table[idx];
+    e->valid = 1;
+    memcpy(e->mac, entry->mac, 6);
+    ip4_addr_copy(e->ip, entry->ip);
+    e->mesh_id = entry->mesh_id;
+    e->last_seen = get_tick_ms();
+    e->source = entry->source;
+    e->owner = 0;
+    e->online = 1;
+    e->stale = 1;
+    e->caps = entry->caps;
+    e->device_instance = entry->device_instance;
+    e->group = entry->group;
+    index_link(idx);
+    inst_index_update(idx);
+    liveness_arm(idx);
+
+    write_end();
+    return 0;
+}
+
+int node_table_sync(const node_entry_t *entry, uint16_t owner, uint32_t idle_ms)
+{
+    if (!s_initialized || entry == NULL) return -1;
+
+    write_begin();
+
+    uint32_t heard = get_tick_ms() - idle_ms;
+
+    /* MAC/IP 已属于其他节点: 不覆盖 */
+    int idx = find_by_mesh_id(entry->mesh_id);
+    int other = find_by_mac(entry->mac);
+    if (other < 0 || other == idx) {
+        other = find_by_ip(&entry->ip);
+    }
+    if (other >= 0 && other != idx) {
+        write_end();
+        return -2;
+    }
+
+    if (idx >= 0) {
+        const node_entry_t *e = &s_node_table[idx];
+        /* 静态配置优先; 本机或其他 Top Node 更近期收到过该节点时保留 */
+        if (e->source == NODE_SOURCE_STATIC ||
+            (e->online &&
+             (e->source != NODE_SOURCE_SYNC || e->owner != owner) &&
+             (int32_t)(e->last_seen - heard) >= 0)) {
+            write_end();
+            return 1;
+        }
+    } else {
+        idx = alloc_slot();
+        if (idx < 0) {
+            write_end();
+            return -1;
+        }
+    }
+
+    node_entry_t *e = &s_node_table[idx];
+    /* 同步条目不写入快照, 只有覆盖本机注册的条目才需要重新保存 */
+    bool persisted = e->valid && e->source != NODE_SOURCE_SYNC;
+
+    if (e->valid) {
+        index_unlink(idx);
+    }
+    if (!e->valid || e->source != NODE_SOURCE_SYNC) {
+        /* 时延与到达间隔由所属 Top Node 维护 */
+        memset(&e->rtt, 0, sizeof(e->rtt));
+        memset(&e->arrival, 0, sizeof(e->arrival));
+    }
+    e->valid = 1;
+    memcpy(e->mac, entry->mac, 6);
+    ip4_addr_copy(e->ip, entry->ip);
+    e->mesh_id = entry->mesh_id;
+    e->last_seen = heard;
+    e->source = NODE_SOURCE_SYNC;
+    e->owner = owner;
+    e->online = 1;
+    e->suspect = 0;
+    e->stale = 0;
+    e->caps = entry->caps;
+    e->device_instance = entry->device_instance;
+    e->group = entry->group;
+    index_link(idx);
+    inst_index_update(idx);
+    liveness_arm(idx);
+    if (persisted) {
+        s_generation++;
+    }
+
+    write_end();
+    return 0;
+}
+
+uint32_t node_table_generation(void)
+{
+    return s_generation;
 }
 
 void node_table_remove(uint16_t mesh_id)
 {
     if (!s_initialized) return;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    write_begin();
 
     int idx = find_by_mesh_id(mesh_id);
     if (idx >= 0) {
-        s_node_table[idx].valid = 0;
+        free_slot(idx);
     }
 
-    xSemaphoreGive(s_table_mutex);
+    write_end();
+}
+
+int node_table_set_device(uint16_t mesh_id, uint32_t device_instance, uint8_t caps)
+{
+    if (!s_initialized) return -1;
+
+    write_begin();
+
+    int idx = find_by_mesh_id(mesh_id);
+    if (idx >= 0) {
+        if (s_node_table[idx].caps != caps) {
+            s_node_table[idx].caps = caps;
+            s_generation++;
+        }
+        if (s_node_table[idx].device_instance != device_instance) {
+            s_generation++;
+            s_node_table[idx].device_instance = device_instance;
+            inst_index_update(idx);
+        }
+    }
+
+    write_end();
+    return (idx >= 0) ? 0 : -1;
+}
+
+int node_table_set_group(uint16_t mesh_id, uint16_t group)
+{
+    if (!s_initialized) return -1;
+
+    write_begin();
+
+    int idx = find_by_mesh_id(mesh_id);
+    if (idx >= 0 && s_node_table[idx].group != group) {
+        s_node_table[idx].group = group;
+        s_generation++;
+    }
+
+    write_end();
+    return (idx >= 0) ? 0 : -1;
+}
+
+int node_table_rtt_sample(uint16_t mesh_id, uint32_t sample_ms)
+{
+    if (!s_initialized) return -1;
+
+    write_begin();
+
+    /* 仅运行时状态, 不计入 s_generation (不触发快照) */
+    int idx = find_by_mesh_id(mesh_id);
+    if (idx >= 0) {
+        tpmesh_rtt_update(&s_node_table[idx].rtt, sample_ms);
+    }
+
+    write_end();
+    return (idx >= 0) ? 0 : -1;
 }
 
 /* ============================================================================
@@ -308,12 +1066,15 @@ uint16_t node_table_get_mesh_by_mac(const uint8_t *mac)
 {
     if (!s_initialized) return 0xFFFF;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    uint16_t mesh_id;
+    node_read_t rd = {0};
 
-    int idx = find_by_mac(mac);
-    uint16_t mesh_id = (idx >= 0) ? s_node_table[idx].mesh_id : 0xFFFF;
+    do {
+        read_begin(&rd);
+        int idx = find_by_mac(mac);
+        mesh_id = (idx >= 0) ? s_node_table[idx].mesh_id : 0xFFFF;
+    } while (read_retry(&rd));
 
-    xSemaphoreGive(s_table_mutex);
     return mesh_id;
 }
 
@@ -321,12 +1082,15 @@ uint16_t node_table_get_mesh_by_ip(const ip4_addr_t *ip)
 {
     if (!s_initialized) return 0xFFFF;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    uint16_t mesh_id;
+    node_read_t rd = {0};
 
-    int idx = find_by_ip(ip);
-    uint16_t mesh_id = (idx >= 0) ? s_node_table[idx].mesh_id : 0xFFFF;
+    do {
+        read_begin(&rd);
+        int idx = find_by_ip(ip);
+        mesh_id = (idx >= 0) ? s_node_table[idx].mesh_id : 0xFFFF;
+    } while (read_retry(&rd));
 
-    xSemaphoreGive(s_table_mutex);
     return mesh_id;
 }
 
@@ -334,14 +1098,17 @@ int node_table_get_mac_by_mesh(uint16_t mesh_id, uint8_t *mac)
 {
     if (!s_initialized) return -1;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    int idx;
+    node_read_t rd = {0};
 
-    int idx = find_by_mesh_id(mesh_id);
-    if (idx >= 0) {
-        memcpy(mac, s_node_table[idx].mac, 6);
-    }
+    do {
+        read_begin(&rd);
+        idx = find_by_mesh_id(mesh_id);
+        if (idx >= 0) {
+            memcpy(mac, s_node_table[idx].mac, 6);
+        }
+    } while (read_retry(&rd));
 
-    xSemaphoreGive(s_table_mutex);
     return (idx >= 0) ? 0 : -1;
 }
 
@@ -349,14 +1116,17 @@ int node_table_get_mac_by_ip(const ip4_addr_t *ip, uint8_t *mac)
 {
     if (!s_initialized) return -1;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    int idx;
+    node_read_t rd = {0};
 
-    int idx = find_by_ip(ip);
-    if (idx >= 0) {
-        memcpy(mac, s_node_table[idx].mac, 6);
-    }
+    do {
+        read_begin(&rd);
+        idx = find_by_ip(ip);
+        if (idx >= 0) {
+            memcpy(mac, s_node_table[idx].mac, 6);
+        }
+    } while (read_retry(&rd));
 
-    xSemaphoreGive(s_table_mutex);
     return (idx >= 0) ? 0 : -1;
 }
 
@@ -364,14 +1134,35 @@ int node_table_get_ip_by_mesh(uint16_t mesh_id, ip4_addr_t *ip)
 {
     if (!s_initialized) return -1;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    int idx;
+    node_read_t rd = {0};
 
-    int idx = find_by_mesh_id(mesh_id);
-    if (idx >= 0) {
-        ip4_addr_copy(*ip, s_node_table[idx].ip);
-    }
+    do {
+        read_begin(&rd);
+        idx = find_by_mesh_id(mesh_id);
+        if (idx >= 0) {
+            ip4_addr_copy(*ip, s_node_table[idx].ip);
+        }
+    } while (read_retry(&rd));
+
+    return (idx >= 0) ? 0 : -1;
+}
+
+int node_table_get_rtt(uint16_t mesh_id, tpmesh_rtt_t *rtt)
+{
+    if (!s_initialized) return -1;
+
+    int idx;
+    node_read_t rd = {0};
+
+    do {
+        read_begin(&rd);
+        idx = find_by_mesh_id(mesh_id);
+        if (idx >= 0) {
+            *rtt = s_node_table[idx].rtt;
+        }
+    } while (read_retry(&rd));
 
-    xSemaphoreGive(s_table_mutex);
     return (idx >= 0) ? 0 : -1;
 }
 
@@ -384,6 +1175,54 @@ const node_entry_t* node_table_get_entry(uint16_t mesh_id)
     return (idx >= 0) ? &s_node_table[idx] : NULL;
 }
 
+int node_table_find_by_instance(uint32_t low, uint32_t high,
+                                uint16_t *mesh_ids, int max, int *unknown)
+{
+    int total;
+    int unknown_count;
+    node_read_t rd = {0};
+
+    if (unknown) *unknown = 0;
+    if (!s_initialized) return 0;
+
+    do {
+        read_begin(&rd);
+        total = 0;
+        unknown_count = 0;
+
+        /* 1. 范围内的已知实例: 二分定位下界后顺序扫描 */
+        for (uint16_t i = inst_index_lower_bound(low); i < s_inst_count; i++) {
+            const node_entry_t *e = &s_node_table[s_inst_index[i]];
+            if (e->device_instance > high ||
+                e->device_instance == NODE_DEVICE_INSTANCE_NONE) {
+                break;
+            }
+            if (!e->online || e->source == NODE_SOURCE_SYNC) continue;
+            if (mesh_ids && total < max) {
+                mesh_ids[total] = e->mesh_id;
+            }
+            total++;
+        }
+
+        /* 2. 未知实例排在索引末尾, 无法排除, 一并作为候选 */
+        for (int i = (int)s_inst_count - 1; i >= 0; i--) {
+            const node_entry_t *e = &s_node_table[s_inst_index[i]];
+            if (e->device_instance != NODE_DEVICE_INSTANCE_NONE) {
+                break;
+            }
+            if (!e->online || e->source == NODE_SOURCE_SYNC) continue;
+            if (mesh_ids && total < max) {
+                mesh_ids[total] = e->mesh_id;
+            }
+            total++;
+            unknown_count++;
+        }
+    } while (read_retry(&rd));
+
+    if (unknown) *unknown = unknown_count;
+    return total;
+}
+
 bool node_table_is_ddc_ip(const ip4_addr_t *ip)
 {
     return node_table_get_mesh_by_ip(ip) != 0xFFFF;
@@ -394,65 +1233,99 @@ bool node_table_is_ddc_mac(const uint8_t *mac)
     return node_table_get_mesh_by_mac(mac) != 0xFFFF;
 }
 
+bool node_table_is_remote(uint16_t mesh_id)
+{
+    if (!s_initialized) return false;
+
+    bool remote;
+    node_read_t rd = {0};
+
+    do {
+        read_begin(&rd);
+        int idx = find_by_mesh_id(mesh_id);
+        remote = (idx >= 0) &&
+                 (s_node_table[idx].source == NODE_SOURCE_SYNC);
+    } while (read_retry(&rd));
+
+    return remote;
+}
+
 bool node_table_is_registered(uint16_t mesh_id)
 {
     if (!s_initialized) return false;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    bool registered;
+    node_read_t rd = {0};
 
-    int idx = find_by_mesh_id(mesh_id);
-    bool registered = (idx >= 0) && 
-                      (s_node_table[idx].source == NODE_SOURCE_REGISTER);
+    do {
+        read_begin(&rd);
+        int idx = find_by_mesh_id(mesh_id);
+        registered = (idx >= 0) &&
+                     (s_node_table[idx].source == NODE_SOURCE_REGISTER);
+    } while (read_retry(&rd));
 
-    xSemaphoreGive(s_table_mutex);
     return registered;
 }
 
-bool node_table_is_online(uint16_t mesh_id)
+bool node_table_is_suspect(uint16_t mesh_id)
 {
     if (!s_initialized) return false;
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+    bool suspect;
+    node_read_t rd = {0};
 
-    int idx = find_by_mesh_id(mesh_id);
-    bool online = (idx >= 0) && s_node_table[idx].online;
+    do {
+        read_begin(&rd);
+        int idx = find_by_mesh_id(mesh_id);
+        suspect = (idx >= 0) &&
+                  (s_node_table[idx].source != NODE_SOURCE_STATIC) &&
+                  (s_node_table[idx].suspect || !s_node_table[idx].online);
+    } while (read_retry(&rd));
 
-    xSemaphoreGive(s_table_mutex);
-    return online;
+    return suspect;
 }
 
-/* ============================================================================
- * 维护函数
- * ============================================================================ */
-
-void node_table_check_timeout(void)
+uint32_t node_table_healthy_idle(uint16_t mesh_id)
 {
-    if (!s_initialized) return;
+    if (!s_initialized) return UINT32_MAX;
+
+    uint32_t idle;
+    node_read_t rd = {0};
+
+    do {
+        read_begin(&rd);
+        int idx = find_by_mesh_id(mesh_id);
+        if (idx >= 0 && s_node_table[idx].online &&
+            !s_node_table[idx].suspect && !s_node_table[idx].stale) {
+            idle = get_tick_ms() - s_node_table[idx].last_seen;
+        } else {
+            idle = UINT32_MAX;
+        }
+    } while (read_retry(&rd));
 
-    uint32_t now = get_tick_ms();
+    return idle;
+}
 
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
+bool node_table_is_online(uint16_t mesh_id)
+{
+    if (!s_initialized) return false;
 
-    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
-        if (!s_node_table[i].valid) continue;
-        
-        /* 静态节点不超时 */
-        if (s_node_table[i].source == NODE_SOURCE_STATIC) continue;
-
-        uint32_t elapsed = now - s_node_table[i].last_seen;
-        if (elapsed > NODE_TABLE_TIMEOUT_MS) {
-            tpmesh_debug_printf("NodeTable: Node 0x%04X offline (timeout)\n", 
-                   s_node_table[i].mesh_id);
-            s_node_table[i].online = 0;
-            
-            /* 可选: 完全删除 */
-            /* s_node_table[i].valid = 0; */
-        }
-    }
+    bool online;
+    node_read_t rd = {0};
 
-    xSemaphoreGive(s_table_mutex);
+    do {
+        read_begin(&rd);
+        int idx = find_by_mesh_id(mesh_id);
+        online = (idx >= 0) && s_node_table[idx].online;
+    } while (read_retry(&rd));
+
+    return online;
 }
 
+/* ============================================================================
+ * 维护函数
+ * ============================================================================ */
+
 void node_table_dump(void)
 {
     if (!s_initialized) {
@@ -463,23 +1336,49 @@ void node_table_dump(void)
     xSemaphoreTake(s_table_mutex, portMAX_DELAY);
 
     tpmesh_debug_printf("\n--- Node Table ---\n");
-    tpmesh_debug_printf("%-6s %-18s %-16s %-8s %-8s\n", 
-           "Mesh", "MAC", "IP", "Source", "Online");
+    uint32_t now = get_tick_ms();
 
-    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
+    tpmesh_debug_printf("%-6s %-18s %-16s %-8s %-8s %-11s %-5s %-10s\n", 
+           "Mesh", "MAC", "IP", "Source", "Online", "RTT/Var", "Phi", "Device");
+
+    for (int i = 0; i < s_node_count; i++) {
         if (!s_node_table[i].valid) continue;
 
         const node_entry_t *e = &s_node_table[i];
-        const char *src_str[] = {"Static", "Learned", "Register"};
+        const char *src_str[] = {"Static", "Learned", "Register", "Sync"};
 
-        tpmesh_debug_printf("0x%04X %02X:%02X:%02X:%02X:%02X:%02X %3d.%3d.%3d.%3d %-8s %s\n",
+        tpmesh_debug_printf("0x%04X %02X:%02X:%02X:%02X:%02X:%02X %3d.%3d.%3d.%3d %-8s %-8s ",
                e->mesh_id,
                e->mac[0], e->mac[1], e->mac[2], e->mac[3], e->mac[4], e->mac[5],
                ip4_addr1(&e->ip), ip4_addr2(&e->ip), 
                ip4_addr3(&e->ip), ip4_addr4(&e->ip),
                src_str[e->source],
-               e->online ? "Yes" : "No");
+               e->online ? (e->stale ? "Stale" : (e->suspect ? "Suspect" : "Yes"))
+                         : "No");
+        if (e->rtt.srtt != 0) {
+            tpmesh_debug_printf("%5u/%-5u ", e->rtt.srtt, e->rtt.rttvar);
+        } else {
+            tpmesh_debug_printf("%-11s ", "-");
+        }
+        int phi = e->online ? phi_now(e, now) : -1;
+        if (phi >= 0) {
+            tpmesh_debug_printf("%2d.%d  ", phi / 10, phi % 10);
+        } else {
+            tpmesh_debug_printf("%-5s ", "-");
+        }
+        if (e->device_instance != NODE_DEVICE_INSTANCE_NONE) {
+            tpmesh_debug_printf("%-10lu", (unsigned long)e->device_instance);
+        } else {
+            tpmesh_debug_printf("%-10s", "-");
+        }
+        if (e->source == NODE_SOURCE_SYNC) {
+            tpmesh_debug_printf(" via 0x%04X\n", e->owner);
+        } else {
+            tpmesh_debug_printf("\n");
+        }
     }
+    tpmesh_debug_printf("Lock-free read fallbacks: %lu\n",
+                        (unsigned long)s_read_fallbacks);
     tpmesh_debug_printf("------------------\n\n");
 
     xSemaphoreGive(s_table_mutex);
@@ -489,18 +1388,8 @@ uint16_t node_table_count(void)
 {
     if (!s_initialized) return 0;
 
-    uint16_t count = 0;
-
-    xSemaphoreTake(s_table_mutex, portMAX_DELAY);
-
-    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
-        if (s_node_table[i].valid) {
-            count++;
-        }
-    }
-
-    xSemaphoreGive(s_table_mutex);
-    return count;
+    /* 单次对齐读取, 无需加锁 */
+    return s_node_count;
 }
 
 void node_table_foreach(bool (*callback)(const node_entry_t *entry, void *arg), void *arg)
@@ -509,7 +1398,7 @@ void node_table_foreach(bool (*callback)(const node_entry_t *entry, void *arg),
 
     xSemaphoreTake(s_table_mutex, portMAX_DELAY);
 
-    for (int i = 0; i < NODE_TABLE_MAX_ENTRIES; i++) {
+    for (int i = 0; i < s_node_count; i++) {
         if (s_node_table[i].valid) {
             if (!callback(&s_node_table[i], arg)) {
                 break;
@@ -4,6 +4,17 @@
  *
  * 管理 DDC 节点的 MAC/IP/MeshID 映射关系
  *
+ * 查询不加锁 (seqlock): 读者在写入前后序列号不变时直接返回,
+ * 否则重试; 写者 (注册/学习/超时) 通过互斥锁串行。
+ *
+ * 存活判断为累积式故障检测 (phi accrual): 每个节点按收到任意流量的
+ * 间隔维护均值与平均偏差, 静默时间对应的怀疑度 phi = -log10(P(间隔 > t))
+ * (正态近似) 达到 NODE_TABLE_PHI_SUSPECT 时标记可疑, 达到
+ * NODE_TABLE_PHI_OFFLINE 时离线。两者分别不短于
+ * NODE_TABLE_PHI_SUSPECT_MIN_MS / NODE_TABLE_PHI_OFFLINE_MIN_MS, 不长于
+ * NODE_TABLE_TIMEOUT_MS: 规律的节点更快被判定, 流量不规律的节点获得
+ * 更长容忍, 不因偶发静默抖动。样本不足时仍按 NODE_TABLE_TIMEOUT_MS。
+ *
  * @version 0.6.2
  */
 
@@ -11,6 +22,7 @@
 #define NODE_TABLE_H
 
 #include "lwip/ip4_addr.h"
+#include "tpmesh_rtt.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -25,14 +37,68 @@ extern "C" {
 
 /** 最大节点数量 */
 #ifndef NODE_TABLE_MAX_ENTRIES
-#define NODE_TABLE_MAX_ENTRIES 16
+#define NODE_TABLE_MAX_ENTRIES 256
+#endif
+
+/** 哈希索引位数 (桶数 = 2^bits, 须 >= 2 * NODE_TABLE_MAX_ENTRIES) */
+#ifndef NODE_TABLE_HASH_BITS
+#define NODE_TABLE_HASH_BITS 9
+#endif
+
+/** 读者因并发写入连续重试的上限, 超过后回退为加锁读 */
+#ifndef NODE_TABLE_READ_RETRY_MAX
+#define NODE_TABLE_READ_RETRY_MAX 4
 #endif
 
-/** 节点超时时间 (ms) */
+/** 节点超时时间 (ms): 样本不足时的固定超时, 也是离线判定的上限 */
 #ifndef NODE_TABLE_TIMEOUT_MS
 #define NODE_TABLE_TIMEOUT_MS 90000
 #endif
 
+/** 标记可疑的 phi 阈值 (1~16) */
+#ifndef NODE_TABLE_PHI_SUSPECT
+#define NODE_TABLE_PHI_SUSPECT 8
+#endif
+
+/** 标记离线的 phi 阈值 (1~16, 不小于 NODE_TABLE_PHI_SUSPECT) */
+#ifndef NODE_TABLE_PHI_OFFLINE
+#define NODE_TABLE_PHI_OFFLINE 12
+#endif
+
+/**
+ * 可疑判定的最短静默时间 (ms)。DDC 保证的最大上行间隔为 1.5 个心跳周期
+ * (时隙前半个周期内有数据帧时省略心跳), 即 45 s; 超过即至少缺失一次
+ */
+#ifndef NODE_TABLE_PHI_SUSPECT_MIN_MS
+#define NODE_TABLE_PHI_SUSPECT_MIN_MS 50000
+#endif
+
+/** 离线判定的最短静默时间 (ms): 再缺失一个心跳周期, 单个心跳丢失不离线 */
+#ifndef NODE_TABLE_PHI_OFFLINE_MIN_MS
+#define NODE_TABLE_PHI_OFFLINE_MIN_MS 80000
+#endif
+
+/** 间隔标准差下限 (ms), 吸收心跳抖动和 Mesh 时延 */
+#ifndef NODE_TABLE_PHI_MIN_STD_MS
+#define NODE_TABLE_PHI_MIN_STD_MS 2000
+#endif
+
+/** 短于该值的到达间隔合并 (突发数据帧不拉低均值) */
+#ifndef NODE_TABLE_PHI_MIN_GAP_MS
+#define NODE_TABLE_PHI_MIN_GAP_MS 1000
+#endif
+
+/** 启用 phi 判定所需的最少间隔样本数 */
+#ifndef NODE_TABLE_PHI_MIN_SAMPLES
+#define NODE_TABLE_PHI_MIN_SAMPLES 3
+#endif
+
+/** 未知 BACnet 设备实例号 (DDC 未上报) */
+#define NODE_DEVICE_INSTANCE_NONE 0xFFFFFFFFUL
+
+/** 未加入组播组 */
+#define NODE_GROUP_NONE 0xFFFF
+
 /* ============================================================================
  * 节点来源类型
  * ============================================================================
@@ -42,6 +108,7 @@ typedef enum {
   NODE_SOURCE_STATIC = 0,   /**< 静态配置 */
   NODE_SOURCE_LEARNED = 1,  /**< 动态学习 (从数据帧) */
   NODE_SOURCE_REGISTER = 2, /**< 注册 (DDC主动注册) */
+  NODE_SOURCE_SYNC = 3,     /**< 其他 Top Node 同步 (DDC 注册在该 Top Node) */
 } node_source_t;
 
 /* ============================================================================
@@ -49,14 +116,30 @@ typedef enum {
  * ============================================================================
  */
 
+/** 到达间隔统计 (phi 故障检测) */
+typedef struct {
+  uint32_t mean;   /**< 平均间隔 (ms) */
+  uint32_t dev;    /**< 平均偏差 (ms) */
+  uint8_t samples; /**< 样本数 (饱和) */
+} node_arrival_t;
+
 typedef struct {
-  uint8_t valid;      /**< 条目有效 */
-  uint8_t mac[6];     /**< MAC 地址 */
-  ip4_addr_t ip;      /**< IP 地址 */
-  uint16_t mesh_id;   /**< Mesh ID */
-  uint32_t last_seen; /**< 最后活跃时间 (tick) */
-  uint8_t source;     /**< 来源类型 (node_source_t) */
-  uint8_t online;     /**< 在线状态 */
+  uint8_t valid;            /**< 条目有效 */
+  uint8_t mac[6];           /**< MAC 地址 */
+  ip4_addr_t ip;            /**< IP 地址 */
+  uint16_t mesh_id;         /**< Mesh ID */
+  uint32_t last_seen;       /**< 最后活跃时间 (tick) */
+  uint8_t source;           /**< 来源类型 (node_source_t) */
+  uint8_t online;           /**< 在线状态 */
+  uint8_t caps;             /**< DDC 能力位 (REG_CAP_xxx) */
+  uint32_t device_instance; /**< BACnet 设备实例号 */
+  uint16_t group;           /**< 已加入的组播地址 (NODE_GROUP_NONE=未加入) */
+  uint8_t stale;            /**< 由快照恢复, 尚未被数据/心跳确认 */
+  tpmesh_rtt_t rtt;         /**< 到该节点的 RTT 估计 (不保存到快照) */
+  node_arrival_t arrival;   /**< 到达间隔统计 (不保存到快照) */
+  uint8_t suspect;          /**< 静默已达可疑阈值, 尚未离线 */
+  uint16_t owner;           /**< 所属 Top Node 的 Mesh ID (NODE_SOURCE_SYNC,
+                                 其余来源为 0) */
 } node_entry_t;
 
 /* ============================================================================
@@ -124,6 +207,68 @@ void node_table_touch(uint16_t mesh_id);
  */
 void node_table_remove(uint16_t mesh_id);
 
+/**
+ * @brief 从快照恢复节点 (Top Node 重启)
+ *
+ * 恢复的条目标记为 stale 但保持在线可路由, 收到该节点的数据或心跳后
+ * 转为正常; NODE_TABLE_TIMEOUT_MS 内未确认则按超时离线。
+ *
+ * @param entry 快照条目 (使用 mac/ip/mesh_id/source/caps/device_instance/group)
+ * @return 0=成功, -1=表满, -2=与已有条目冲突
+ */
+int node_table_restore(const node_entry_t *entry);
+
+/**
+ * @brief 同步其他 Top Node 的注册 (多 Top Node)
+ *
+ * 条目以 NODE_SOURCE_SYNC 保存, 最后活跃时间为 owner 最后收到该 DDC 的
+ * 时刻; owner 周期刷新, 超过 NODE_TABLE_TIMEOUT_MS 未刷新则离线。本机
+ * (或其他 Top Node) 更近期收到过该 DDC 时保留原条目, 由活跃时间决定
+ * 归属: DDC 转向新的 Top Node 注册后, 旧 Top Node 收到同步即让出。
+ *
+ * @param entry 同步条目 (使用 mac/ip/mesh_id/caps/device_instance/group)
+ * @param owner 所属 Top Node 的 Mesh ID
+ * @param idle_ms owner 最后收到该 DDC 距今的时间 (ms)
+ * @return 0=已更新, 1=本机条目更新 (保留), -1=表满, -2=与其他节点冲突
+ */
+int node_table_sync(const node_entry_t *entry, uint16_t owner,
+                    uint32_t idle_ms);
+
+/**
+ * @brief 持久化内容变更计数
+ *
+ * 注册/删除/MAC 变化/设备信息/组播组变化时递增, 活跃时间刷新不计。
+ *
+ * @return 变更计数
+ */
+uint32_t node_table_generation(void);
+
+/**
+ * @brief 设置节点的 BACnet 设备信息 (来自注册帧 TLV)
+ * @param mesh_id Mesh ID
+ * @param device_instance 设备实例号, NODE_DEVICE_INSTANCE_NONE=未知
+ * @param caps 能力位
+ * @return 0=成功, -1=节点不存在
+ */
+int node_table_set_device(uint16_t mesh_id, uint32_t device_instance,
+                          uint8_t caps);
+
+/**
+ * @brief 设置节点已加入的组播组 (来自注册/心跳帧 TLV)
+ * @param mesh_id Mesh ID
+ * @param group 组播地址, NODE_GROUP_NONE=未加入
+ * @return 0=成功, -1=节点不存在
+ */
+int node_table_set_group(uint16_t mesh_id, uint16_t group);
+
+/**
+ * @brief 用一个 RTT 样本更新节点的估计
+ * @param mesh_id Mesh ID
+ * @param sample_ms 样本 (ms)
+ * @return 0=成功, -1=节点不存在
+ */
+int node_table_rtt_sample(uint16_t mesh_id, uint32_t sample_ms);
+
 /* ============================================================================
  * 查询 API
  * ============================================================================
@@ -167,13 +312,42 @@ int node_table_get_mac_by_ip(const ip4_addr_t *ip, uint8_t *mac);
  */
 int node_table_get_ip_by_mesh(uint16_t mesh_id, ip4_addr_t *ip);
 
+/**
+ * @brief 通过 Mesh ID 获取 RTT 估计
+ * @param mesh_id Mesh ID
+ * @param rtt [out] 估计
+ * @return 0=成功, -1=节点不存在
+ */
+int node_table_get_rtt(uint16_t mesh_id, tpmesh_rtt_t *rtt);
+
 /**
  * @brief 获取节点条目
+ *
+ * 删除节点时末尾条目会移入空位, 返回的指针仅在下一次删除前有效。
+ *
  * @param mesh_id Mesh ID
  * @return 节点条目指针, NULL=未找到
  */
 const node_entry_t *node_table_get_entry(uint16_t mesh_id);
 
+/**
+ * @brief 按设备实例号范围查找在线节点 (设备实例索引, 二分查找)
+ *
+ * 用于 Who-Is / Who-Has 定向转发。未上报设备实例的在线节点无法排除,
+ * 同样作为候选返回 (排在匹配节点之后), 其数量通过 unknown 返回。
+ * 注册在其他 Top Node 的节点 (NODE_SOURCE_SYNC) 由其所属 Top Node 转发,
+ * 不作为候选。
+ *
+ * @param low 范围下限 (含)
+ * @param high 范围上限 (含)
+ * @param mesh_ids [out] 候选节点的 Mesh ID, 可为 NULL
+ * @param max mesh_ids 容量
+ * @param unknown [out] 设备实例未知的在线节点数, 可为 NULL
+ * @return 候选节点总数 (匹配 + 未知, 可能大于 max)
+ */
+int node_table_find_by_instance(uint32_t low, uint32_t high,
+                                uint16_t *mesh_ids, int max, int *unknown);
+
 /**
  * @brief 检查 IP 是否为 DDC
  * @param ip IP 地址
@@ -195,6 +369,16 @@ bool node_table_is_ddc_mac(const uint8_t *mac);
  */
 bool node_table_is_registered(uint16_t mesh_id);
 
+/**
+ * @brief 检查节点是否注册在其他 Top Node (NODE_SOURCE_SYNC)
+ *
+ * 其他 Top Node 的 DDC 由其所属 Top Node 代理 ARP 和接收单播。
+ *
+ * @param mesh_id Mesh ID
+ * @return true=属于其他 Top Node
+ */
+bool node_table_is_remote(uint16_t mesh_id);
+
 /**
  * @brief 检查节点是否在线
  * @param mesh_id Mesh ID
@@ -202,16 +386,31 @@ bool node_table_is_registered(uint16_t mesh_id);
  */
 bool node_table_is_online(uint16_t mesh_id);
 
-/* ============================================================================
- * 维护 API
- * ============================================================================
+/**
+ * @brief 检查节点是否可疑或已离线 (静态节点始终为否)
+ *
+ * 用于快速失败: 发往可疑节点的确认请求由 Top Node 本地拒绝。
+ *
+ * @param mesh_id Mesh ID
+ * @return true=可疑或离线
  */
+bool node_table_is_suspect(uint16_t mesh_id);
 
 /**
- * @brief 超时检查 (清理过期节点)
- * 应该周期性调用
+ * @brief 节点健康时返回距最后活跃的时间
+ *
+ * 健康: 在线、未可疑、不是未经确认的快照条目。Top Node 据此以存活数据
+ * 代答 (ICMP 回显代理)。
+ *
+ * @param mesh_id Mesh ID
+ * @return 空闲时间 (ms), UINT32_MAX=不存在或不健康
+ */
+uint32_t node_table_healthy_idle(uint16_t mesh_id);
+
+/* ============================================================================
+ * 维护 API
+ * ============================================================================
  */
-void node_table_check_timeout(void);
 
 /**
  * @brief 打印节点表 (调试用)
@@ -0,0 +1,529 @@
+/**
+ * @file tpmesh_arp_seed.c
+ * @brief TPMesh 下行 ARP 预置实现
+ *
+ * @version 0.8.0
+ */
+
+#include "tpmesh_arp_seed.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_netif.h"
+#include "tpmesh_timer.h"
+#include "tpmesh_top_sync.h"
+
+/* node_table.h 已通过 tpmesh_bridge.h 包含 */
+#include "FreeRTOS.h"
+#include "lwip/etharp.h"
+#include "lwip/tcpip.h"
+#include "task.h"
+#include <string.h>
+
+#if TPMESH_ARP_SEED_ENABLE && TPMESH_ARP_SEED_MAX >= ARP_TABLE_SIZE
+#error "TPMESH_ARP_SEED_MAX must be smaller than ARP_TABLE_SIZE"
+#endif
+
+/* ============================================================================
+ * 类型定义
+ * ============================================================================
+ */
+
+/** 预置条目 */
+typedef struct {
+  ip4_addr_t ip;
+  uint8_t mac[6];
+  bool used;
+  bool pinned;   /**< Top: 网关, 不老化不替换 */
+  bool dirty;    /**< Top: 待广播增量 */
+  uint32_t seen; /**< Top: 最后学习时间 */
+} seed_entry_t;
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static struct netif *s_eth_netif = NULL;
+static ip4_addr_t s_local_ip;
+static bool s_initialized = false;
+
+/** Top: 以太网侧主机; DDC: Top Node 下发的期望表 (临界区保护) */
+static seed_entry_t s_entries[TPMESH_ARP_SEED_MAX];
+
+/** Top: 待广播的删除; 溢出时改发全量表 */
+static ip4_addr_t s_removed[TPMESH_ARP_SEED_MAX];
+static uint8_t s_removed_count = 0;
+static bool s_full_pending = false;
+
+/** Top: 检查/老化与增量广播定时器 */
+static tpmesh_timer_t s_scan_timer;
+static tpmesh_timer_t s_delta_timer;
+static uint32_t s_last_full = 0;
+
+/** DDC: 已装入 lwIP 的条目 (tcpip 线程) */
+static seed_entry_t s_installed[TPMESH_ARP_SEED_MAX];
+static volatile bool s_sync_queued = false;
+static tpmesh_timer_t s_sync_timer;
+
+static const uint8_t s_zero_mac[6] = {0};
+
+/* ============================================================================
+ * 私有函数 - 工具
+ * ============================================================================
+ */
+
+static seed_entry_t *entry_find(seed_entry_t *table, const ip4_addr_t *ip) {
+  for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+    if (table[i].used && ip4_addr_cmp(&table[i].ip, ip)) {
+      return &table[i];
+    }
+  }
+  return NULL;
+}
+
+static uint8_t put_entry(uint8_t *v, uint8_t off, const ip4_addr_t *ip,
+                         const uint8_t *mac) {
+  SMEMCPY(&v[off], ip, sizeof(ip4_addr_t));
+  memcpy(&v[off + 4], mac, 6);
+  return off + REG_TLV_ARP_ENTRY_LEN;
+}
+
+/* ============================================================================
+ * 私有函数 - Top Node
+ * ============================================================================
+ */
+
+/**
+ * @brief 记录待广播的删除 (调用方持有临界区)
+ */
+static void top_mark_removed(const ip4_addr_t *ip) {
+  if (s_removed_count < TPMESH_ARP_SEED_MAX) {
+    ip4_addr_copy(s_removed[s_removed_count], *ip);
+    s_removed_count++;
+  } else {
+    s_full_pending = true;
+  }
+}
+
+/**
+ * @brief 学习一个主机
+ * @return true=表已变更
+ */
+static bool top_learn(const uint8_t *mac, const ip4_addr_t *ip, bool pinned) {
+  const ip4_addr_t *own = netif_ip4_addr(s_eth_netif);
+  const ip4_addr_t *mask = netif_ip4_netmask(s_eth_netif);
+
+  if (ip4_addr_isany(ip) || ip4_addr_isbroadcast(ip, s_eth_netif) ||
+      ip4_addr_ismulticast(ip) || ip4_addr_cmp(ip, own) ||
+      !ip4_addr_netcmp(ip, own, mask) || (mac[0] & 0x01) != 0 ||
+      memcmp(mac, s_zero_mac, 6) == 0 ||
+      node_table_get_mesh_by_ip(ip) != MESH_ADDR_INVALID) {
+    return false;
+  }
+
+  uint32_t now = tpmesh_get_tick_ms();
+  bool changed = false;
+
+  taskENTER_CRITICAL();
+  seed_entry_t *e = entry_find(s_entries, ip);
+  if (e == NULL) {
+    /* 空位, 否则替换最久未学习到的非固定条目 */
+    for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+      seed_entry_t *c = &s_entries[i];
+      if (!c->used) {
+        e = c;
+        break;
+      }
+      if (!c->pinned && (e == NULL || (int32_t)(c->seen - e->seen) < 0)) {
+        e = c;
+      }
+    }
+    if (e != NULL) {
+      if (e->used) {
+        top_mark_removed(&e->ip);
+      }
+      ip4_addr_copy(e->ip, *ip);
+      e->used = true;
+      e->pinned = false;
+      memset(e->mac, 0, 6);
+    }
+  }
+  if (e != NULL) {
+    if (memcmp(e->mac, mac, 6) != 0) {
+      memcpy(e->mac, mac, 6);
+      e->dirty = true;
+      changed = true;
+    }
+    e->pinned = e->pinned || pinned;
+    e->seen = now;
+  }
+  taskEXIT_CRITICAL();
+
+  return changed;
+}
+
+static void top_schedule_delta(void) {
+  if (!tpmesh_timer_active(&s_delta_timer)) {
+    tpmesh_timer_start(&s_delta_timer, TPMESH_ARP_SEED_DELTA_DELAY_MS);
+  }
+}
+
+/**
+ * @brief 合并本机 lwIP ARP 缓存 (tcpip 线程)
+ *
+ * 网关固定保留; 尚未解析时发一次 ARP 请求, 下一周期即可学到。
+ */
+static void top_scan_lwip(void *arg) {
+  (void)arg;
+  bool changed = false;
+
+  for (size_t i = 0; i < ARP_TABLE_SIZE; i++) {
+    ip4_addr_t *ip;
+    struct netif *netif;
+    struct eth_addr *eth;
+    if (etharp_get_entry(i, &ip, &netif, &eth) && netif == s_eth_netif) {
+      changed |= top_learn(eth->addr, ip, false);
+    }
+  }
+
+  const ip4_addr_t *gw = netif_ip4_gw(s_eth_netif);
+  if (!ip4_addr_isany(gw)) {
+    struct eth_addr *eth;
+    const ip4_addr_t *ip;
+    if (etharp_find_addr(s_eth_netif, gw, &eth, &ip) >= 0) {
+      changed |= top_learn(eth->addr, gw, true);
+    } else {
+      etharp_request(s_eth_netif, gw);
+    }
+  }
+
+  if (changed) {
+    top_schedule_delta();
+  }
+}
+
+/**
+ * @brief 老化、合并本机 ARP 缓存、到期时广播全量表 (桥接任务)
+ */
+static void top_scan_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)arg;
+  uint32_t now = tpmesh_get_tick_ms();
+  bool changed = false;
+
+  taskENTER_CRITICAL();
+  for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+    seed_entry_t *e = &s_entries[i];
+    if (e->used && !e->pinned && now - e->seen > TPMESH_ARP_SEED_AGE_MS) {
+      top_mark_removed(&e->ip);
+      e->used = false;
+      e->dirty = false;
+      changed = true;
+    }
+  }
+  if (now - s_last_full >= TPMESH_ARP_SEED_REFRESH_MS) {
+    s_full_pending = true;
+    changed = true;
+  }
+  taskEXIT_CRITICAL();
+
+  tcpip_try_callback(top_scan_lwip, NULL);
+  if (changed) {
+    top_schedule_delta();
+  }
+  tpmesh_timer_start(timer, TPMESH_ARP_SEED_SCAN_MS);
+}
+
+/**
+ * @brief 广播增量 (删除 + 变更) 或全量表 (桥接任务)
+ */
+static void top_delta_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)timer;
+  (void)arg;
+  uint8_t tlv[2 + TPMESH_ARP_SEED_MAX * REG_TLV_ARP_ENTRY_LEN];
+  uint8_t *v = tlv + 2;
+  uint8_t n = 0;
+  bool full;
+
+  taskENTER_CRITICAL();
+  /* 增量放不下 (删除 + 变更超过表容量) 时改发全量表 */
+  uint8_t count = s_removed_count;
+  for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+    count += (s_entries[i].used && s_entries[i].dirty) ? 1 : 0;
+  }
+  full = s_full_pending || count > TPMESH_ARP_SEED_MAX;
+  if (full) {
+    for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+      s_entries[i].dirty = false;
+    }
+    n = 0;
+  } else {
+    for (uint8_t i = 0; i < s_removed_count; i++) {
+      /* 删除后又重新学习到的, 由变更条目覆盖 */
+      if (entry_find(s_entries, &s_removed[i]) == NULL) {
+        n = put_entry(v, n, &s_removed[i], s_zero_mac);
+      }
+    }
+    for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+      seed_entry_t *e = &s_entries[i];
+      if (e->used && e->dirty) {
+        n = put_entry(v, n, &e->ip, e->mac);
+        e->dirty = false;
+      }
+    }
+  }
+  s_removed_count = 0;
+  s_full_pending = false;
+  taskEXIT_CRITICAL();
+
+  if (full) {
+    s_last_full = tpmesh_get_tick_ms();
+    /* 表空时也广播, DDC 据此清除全部条目 */
+    uint16_t len = tpmesh_arp_seed_put_tlv(tlv, 0);
+    n = (len > 0) ? (uint8_t)(len - 2) : 0;
+    tlv[0] = REG_TLV_ARP;
+    tlv[1] = n;
+  } else {
+    if (n == 0) {
+      return;
+    }
+    tlv[0] = REG_TLV_ARP_UPDATE;
+    tlv[1] = n;
+  }
+
+  /* 多 Top Node: 同一以太网段, 只由指定转发者广播 */
+  if (!tpmesh_top_sync_is_designated()) {
+    return;
+  }
+  if (tpmesh_top_send_reg(MESH_ADDR_BROADCAST, REG_FRAME_ARP_MAP, tlv,
+                          (uint16_t)(2 + n)) != 0) {
+    tpmesh_debug_printf("TPMesh Top: ARP seed broadcast failed\n");
+    return;
+  }
+  tpmesh_debug_printf("TPMesh Top: ARP seed %s, %u entries\n",
+                      full ? "refresh" : "update",
+                      (unsigned)(n / REG_TLV_ARP_ENTRY_LEN));
+}
+
+/* ============================================================================
+ * 私有函数 - DDC
+ * ============================================================================
+ */
+
+/**
+ * @brief 把期望表同步到 lwIP ARP 表 (tcpip 线程)
+ */
+static void ddc_sync_lwip(void *arg) {
+  (void)arg;
+  seed_entry_t want[TPMESH_ARP_SEED_MAX];
+
+  s_sync_queued = false;
+  taskENTER_CRITICAL();
+  memcpy(want, s_entries, sizeof(want));
+  taskEXIT_CRITICAL();
+
+  /* 先删除: 不再下发或 MAC 已变 */
+  for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+    seed_entry_t *e = &s_installed[i];
+    if (!e->used) {
+      continue;
+    }
+    seed_entry_t *w = entry_find(want, &e->ip);
+    if (w == NULL || memcmp(w->mac, e->mac, 6) != 0) {
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+      etharp_remove_static_entry(&e->ip);
+#endif
+      e->used = false;
+    }
+  }
+
+  for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+    seed_entry_t *w = &want[i];
+    if (!w->used || entry_find(s_installed, &w->ip) != NULL) {
+      continue;
+    }
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+    struct eth_addr eth;
+    memcpy(eth.addr, w->mac, 6);
+    if (etharp_add_static_entry(&w->ip, &eth) != ERR_OK) {
+      tpmesh_debug_printf("TPMesh DDC: ARP seed %s install failed\n",
+                          ip4addr_ntoa(&w->ip));
+      continue;
+    }
+#else
+    /* 不支持静态条目: 以应答装入动态条目, 由周期全量表刷新 */
+    if (tpmesh_netif_peer_resolved(w->mac, &w->ip) != 0) {
+      continue;
+    }
+#endif
+    for (int j = 0; j < TPMESH_ARP_SEED_MAX; j++) {
+      if (!s_installed[j].used) {
+        s_installed[j] = *w;
+        break;
+      }
+    }
+  }
+}
+
+static void ddc_schedule_sync(void) {
+  if (s_sync_queued) {
+    return;
+  }
+  s_sync_queued = true;
+  if (tcpip_try_callback(ddc_sync_lwip, NULL) != ERR_OK) {
+    s_sync_queued = false;
+    tpmesh_timer_start(&s_sync_timer, TPMESH_ARP_SEED_DELTA_DELAY_MS);
+  }
+}
+
+static void ddc_sync_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)timer;
+  (void)arg;
+  ddc_schedule_sync();
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_arp_seed_init(struct netif *eth_netif, const ip4_addr_t *local_ip) {
+  if (!TPMESH_ARP_SEED_ENABLE || s_initialized) {
+    return 0;
+  }
+
+  memset(s_entries, 0, sizeof(s_entries));
+  memset(s_installed, 0, sizeof(s_installed));
+  s_removed_count = 0;
+  s_full_pending = false;
+  s_eth_netif = eth_netif;
+  if (local_ip != NULL) {
+    ip4_addr_copy(s_local_ip, *local_ip);
+  }
+
+  if (eth_netif != NULL) {
+    tpmesh_timer_setup(&s_scan_timer, top_scan_expired, NULL);
+    tpmesh_timer_setup(&s_delta_timer, top_delta_expired, NULL);
+    s_last_full = tpmesh_get_tick_ms();
+    /* 先检查一次本机 ARP 缓存, 网关尽早解析 */
+    tpmesh_timer_start(&s_scan_timer, TPMESH_ARP_SEED_DELTA_DELAY_MS);
+  } else {
+    tpmesh_timer_setup(&s_sync_timer, ddc_sync_expired, NULL);
+  }
+
+  s_initialized = true;
+  return 0;
+}
+
+void tpmesh_arp_seed_learn(const uint8_t *mac, const ip4_addr_t *ip) {
+  if (!s_initialized || s_eth_netif == NULL) {
+    return;
+  }
+  if (top_learn(mac, ip, false)) {
+    top_schedule_delta();
+  }
+}
+
+uint16_t tpmesh_arp_seed_put_tlv(uint8_t *tlv, uint16_t off) {
+  if (!s_initialized || s_eth_netif == NULL) {
+    return off;
+  }
+
+  uint8_t *v = tlv + off + 2;
+  uint8_t n = 0;
+
+  taskENTER_CRITICAL();
+  for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+    const seed_entry_t *e = &s_entries[i];
+    if (e->used) {
+      n = put_entry(v, n, &e->ip, e->mac);
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  if (n == 0) {
+    return off;
+  }
+  tlv[off] = REG_TLV_ARP;
+  tlv[off + 1] = n;
+  return off + 2 + n;
+}
+
+void tpmesh_arp_seed_apply(const uint8_t *v, uint8_t len, bool full) {
+  if (!s_initialized || s_eth_netif != NULL) {
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  if (full) {
+    for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+      s_entries[i].used = false;
+    }
+  }
+
+  for (uint8_t off = 0; off + REG_TLV_ARP_ENTRY_LEN <= len;
+       off += REG_TLV_ARP_ENTRY_LEN) {
+    ip4_addr_t ip;
+    SMEMCPY(&ip, &v[off], sizeof(ip4_addr_t));
+    const uint8_t *mac = &v[off + 4];
+
+    /* 本机与对端 DDC (节点表静态映射) 不由预置覆盖 */
+    if (ip4_addr_isany(&ip) || ip4_addr_cmp(&ip, &s_local_ip) ||
+        node_table_get_mesh_by_ip(&ip) != MESH_ADDR_INVALID) {
+      continue;
+    }
+
+    seed_entry_t *e = entry_find(s_entries, &ip);
+    if (memcmp(mac, s_zero_mac, 6) == 0) {
+      if (e != NULL) {
+        e->used = false;
+      }
+      continue;
+    }
+    for (int i = 0; e == NULL && i < TPMESH_ARP_SEED_MAX; i++) {
+      if (!s_entries[i].used) {
+        e = &s_entries[i];
+      }
+    }
+    if (e == NULL) {
+      continue; /* 表满: 等下一次全量表 */
+    }
+    ip4_addr_copy(e->ip, ip);
+    memcpy(e->mac, mac, 6);
+    e->used = true;
+  }
+  taskEXIT_CRITICAL();
+
+  ddc_schedule_sync();
+}
+
+void tpmesh_arp_seed_dump(void) {
+  if (!s_initialized) {
+    return;
+  }
+
+  seed_entry_t table[TPMESH_ARP_SEED_MAX];
+  taskENTER_CRITICAL();
+  memcpy(table, s_entries, sizeof(table));
+  taskEXIT_CRITICAL();
+
+  uint32_t now = tpmesh_get_tick_ms();
+  tpmesh_debug_printf("ARP seed (%s):\n",
+                      s_eth_netif != NULL ? "learned" : "from Top Node");
+  for (int i = 0; i < TPMESH_ARP_SEED_MAX; i++) {
+    const seed_entry_t *e = &table[i];
+    if (!e->used) {
+      continue;
+    }
+    tpmesh_debug_printf("  %-15s %02X:%02X:%02X:%02X:%02X:%02X",
+                        ip4addr_ntoa(&e->ip), e->mac[0], e->mac[1], e->mac[2],
+                        e->mac[3], e->mac[4], e->mac[5]);
+    if (s_eth_netif != NULL) {
+      tpmesh_debug_printf(" %s%lus\n", e->pinned ? "gw " : "",
+                          (unsigned long)((now - e->seen) / 1000));
+    } else {
+      tpmesh_debug_printf("%s\n", entry_find(s_installed, &e->ip) != NULL
+                                      ? " installed"
+                                      : " pending");
+    }
+  }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file tpmesh_arp_seed.h
+ * @brief TPMesh 下行 ARP 预置 (Top Node 以太网侧 ARP 表 → DDC 静态 ARP)
+ *
+ * DDC 回复 BMS 或访问网关前需解析对方 MAC, ARP 请求和应答都以不压缩帧
+ * 往返 Mesh, 首包时延数秒。Top Node 与 DDC 在同一以太网段, 以太网侧
+ * 主机的 MAC 由 Top Node 下发:
+ * - Top Node 学习以太网侧主机: 非 DDC 发出的 ARP (BMS 解析 DDC 时的
+ *   请求、主机应答), 以及本机 lwIP ARP 缓存 (网关固定保留, NTP 等)
+ * - 注册 ACK 携带全量表 (REG_TLV_ARP); 变更合并后广播增量
+ *   (REG_FRAME_ARP_MAP + REG_TLV_ARP_UPDATE), 并周期广播全量表,
+ *   补偿丢失的增量
+ * - DDC 把条目装为 lwIP 静态 ARP 条目 (不老化、不发 ARP 请求), 全量表
+ *   替换原有条目, 增量中 MAC 全 0 表示删除
+ *
+ * 条目: [IP:4][MAC:6] (REG_TLV_ARP_ENTRY_LEN)
+ *
+ * 多 Top Node: 各 Top Node 的注册 ACK 携带本机的表, 增量与周期全量只由
+ * 指定转发者广播。
+ *
+ * @version 0.8.0
+ */
+
+#ifndef TPMESH_ARP_SEED_H
+#define TPMESH_ARP_SEED_H
+
+#include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 启用 ARP 预置 */
+#ifndef TPMESH_ARP_SEED_ENABLE
+#define TPMESH_ARP_SEED_ENABLE 1
+#endif
+
+/** 下发的主机数 (DDC 占用同样数量的 lwIP ARP 表项, 须小于 ARP_TABLE_SIZE) */
+#ifndef TPMESH_ARP_SEED_MAX
+#define TPMESH_ARP_SEED_MAX 6
+#endif
+
+/** 主机老化时间 (ms): 期间未再学习到则删除 (网关除外) */
+#ifndef TPMESH_ARP_SEED_AGE_MS
+#define TPMESH_ARP_SEED_AGE_MS 1800000UL
+#endif
+
+/** Top Node 检查本机 ARP 缓存与老化的周期 (ms) */
+#ifndef TPMESH_ARP_SEED_SCAN_MS
+#define TPMESH_ARP_SEED_SCAN_MS 30000
+#endif
+
+/** 全量表广播周期 (ms) */
+#ifndef TPMESH_ARP_SEED_REFRESH_MS
+#define TPMESH_ARP_SEED_REFRESH_MS 600000UL
+#endif
+
+/** 变更合并延时 (ms) */
+#ifndef TPMESH_ARP_SEED_DELTA_DELAY_MS
+#define TPMESH_ARP_SEED_DELTA_DELAY_MS 1000
+#endif
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化 (桥接任务中, 定时轮初始化之后调用)
+ *
+ * Top Node 传入以太网 netif; DDC 传入 NULL 和本机 IP。
+ *
+ * @param eth_netif Top Node 以太网 netif, DDC 为 NULL
+ * @param local_ip DDC 本机 IP (Top Node 忽略)
+ * @return 0=成功
+ */
+int tpmesh_arp_seed_init(struct netif *eth_netif, const ip4_addr_t *local_ip);
+
+/**
+ * @brief Top Node: 学习以太网侧主机 (以太网输入线程, 调用方已排除 DDC MAC)
+ * @param mac 主机 MAC
+ * @param ip 主机 IP
+ */
+void tpmesh_arp_seed_learn(const uint8_t *mac, const ip4_addr_t *ip);
+
+/**
+ * @brief Top Node: 追加全量表 REG_TLV_ARP (注册 ACK)
+ * @param tlv TLV 缓冲区, 须能容纳 2 + TPMESH_ARP_SEED_MAX 个条目
+ * @param off 当前 TLV 长度
+ * @return 追加后的 TLV 长度 (表空时不追加)
+ */
+uint16_t tpmesh_arp_seed_put_tlv(uint8_t *tlv, uint16_t off);
+
+/**
+ * @brief DDC: 安装 Top Node 下发的条目
+ * @param v 条目 (REG_TLV_ARP / REG_TLV_ARP_UPDATE 的值)
+ * @param len 长度
+ * @param full true=全量表 (替换), false=增量
+ */
+void tpmesh_arp_seed_apply(const uint8_t *v, uint8_t len, bool full);
+
+/**
+ * @brief 打印预置表
+ */
+void tpmesh_arp_seed_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_ARP_SEED_H */
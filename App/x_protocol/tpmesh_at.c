@@ -70,6 +70,7 @@ static uint16_t s_line_idx = 0;
 
 static tpmesh_data_cb_t s_data_cb = NULL;
 static tpmesh_route_cb_t s_route_cb = NULL;
+static tpmesh_line_cb_t s_line_cb = NULL;
 static bool s_initialized = false;
 
 /* ============================================================================
@@ -131,6 +132,7 @@ int tpmesh_at_init(void) {
   s_line_buf[0] = '\0';
   s_data_cb = NULL;
   s_route_cb = NULL;
+  s_line_cb = NULL;
 
   s_initialized = true;
   tpmesh_debug_printf("AT: Initialized (queue + mutex)\n");
@@ -292,6 +294,8 @@ void tpmesh_at_set_data_cb(tpmesh_data_cb_t cb) { s_data_cb = cb; }
 
 void tpmesh_at_set_route_cb(tpmesh_route_cb_t cb) { s_route_cb = cb; }
 
+void tpmesh_at_set_line_cb(tpmesh_line_cb_t cb) { s_line_cb = cb; }
+
 /* ============================================================================
  * 公共函数 - 模组初始化
  * ============================================================================
@@ -341,6 +345,22 @@ int tpmesh_module_init(uint16_t mesh_id, bool is_top_node) {
   return 0;
 }
 
+int tpmesh_module_set_group(uint16_t mesh_id, uint16_t group_addr) {
+  char cmd[32];
+
+  if (group_addr == 0xFFFF) {
+    snprintf(cmd, sizeof(cmd), "AT+ADDR=%04X", mesh_id);
+  } else {
+    snprintf(cmd, sizeof(cmd), "AT+ADDR=%04X,%04X", mesh_id, group_addr);
+  }
+
+  if (tpmesh_at_cmd(cmd, TPMESH_AT_TIMEOUT_MS) != AT_RESP_OK) {
+    tpmesh_debug_printf("Module: GROUP 0x%04X failed\n", group_addr);
+    return -1;
+  }
+  return 0;
+}
+
 void tpmesh_module_reset(void) {
   tpmesh_at_cmd_no_wait("AT+REBOOT");
   /* 等待模组重启 - 调用者需自行延时 */
@@ -448,7 +468,7 @@ int tpmesh_at_parse_nnmi(const char *urc, uint16_t *src_mesh_id, uint8_t *data,
  * - "OK" / "+CMD:OK" / "ERROR" / "+CMD:ERROR" → xQueueOverwrite(s_resp_queue)
  * - "+NNMI:<data>" → s_data_cb()
  * - "+ROUTE:<event>" → s_route_cb()
- * - 其他 → 忽略 (命令回显等)
+ * - 其他 → s_line_cb() (AT+DUMP 输出、命令回显等)
  *
  * 注: TPMesh 模组回复格式为 "+CMD:OK\r\n" (如 +AT:OK, +ADDR:OK)
  */
@@ -557,7 +577,10 @@ static void dispatch_line(const char *line) {
     return;
   }
 
-  /* 其他行: 忽略 (命令回显等) */
+  /* 其他行: AT+DUMP 等多行应答的内容, 命令回显由回调方忽略 */
+  if (s_line_cb) {
+    s_line_cb(line);
+  }
 }
 
 /* ============================================================================
@@ -102,6 +102,13 @@ typedef void (*tpmesh_data_cb_t)(uint16_t src_mesh_id, const uint8_t *data,
  */
 typedef void (*tpmesh_route_cb_t)(const char *event, uint16_t addr);
 
+/**
+ * @brief 命令输出行回调 (AT+DUMP 等多行应答的内容行)
+ * @param line 一行 (不含 \r\n)
+ * @note 在 RX Task 上下文中执行, 应尽快返回
+ */
+typedef void (*tpmesh_line_cb_t)(const char *line);
+
 /* ============================================================================
  * API - 初始化
  * ============================================================================
@@ -176,6 +183,7 @@ at_resp_t tpmesh_at_send_data(uint16_t dest_mesh_id, const uint8_t *data,
  * - OK/ERROR → xQueueOverwrite(resp_queue) 通知发送者
  * - +NNMI → data callback
  * - +ROUTE → route callback
+ * - 其他行 → line callback
  *
  * @return 处理的字节数
  */
@@ -191,6 +199,11 @@ void tpmesh_at_set_data_cb(tpmesh_data_cb_t cb);
  */
 void tpmesh_at_set_route_cb(tpmesh_route_cb_t cb);
 
+/**
+ * @brief 设置命令输出行回调 (AT+DUMP 等)
+ */
+void tpmesh_at_set_line_cb(tpmesh_line_cb_t cb);
+
 /* ============================================================================
  * API - 模组初始化 (必须在 Task 中调用)
  * ============================================================================
@@ -207,6 +220,17 @@ void tpmesh_at_set_route_cb(tpmesh_route_cb_t cb);
  */
 int tpmesh_module_init(uint16_t mesh_id, bool is_top_node);
 
+/**
+ * @brief 设置模组组播地址 (AT+ADDR=<addr>,<group_addr>)
+ *
+ * 模组配置完成后自动重启, 重启期间发送会失败。
+ *
+ * @param mesh_id 本机 Mesh ID
+ * @param group_addr 组播地址 [0xFF7D, 0xFFBD], 0xFFFF=退出组播
+ * @return 0=成功, -1=失败
+ */
+int tpmesh_module_set_group(uint16_t mesh_id, uint16_t group_addr);
+
 /**
  * @brief 重置模组
  */
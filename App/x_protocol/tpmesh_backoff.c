@@ -0,0 +1,38 @@
+/**
+ * @file tpmesh_backoff.c
+ * @brief TPMesh 注册退避与准入控制实现
+ *
+ * @version 0.7.1
+ */
+
+#include "tpmesh_backoff.h"
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+uint32_t tpmesh_backoff_delay(uint8_t attempt, uint32_t base_ms,
+                              uint32_t max_ms, uint32_t rnd) {
+  uint32_t d = base_ms;
+
+  while (attempt-- > 0 && d < max_ms) {
+    d <<= 1;
+  }
+  if (d > max_ms) {
+    d = max_ms;
+  }
+
+  uint32_t half = d / 2;
+  return half + rnd % (d - half + 1);
+}
+
+uint32_t tpmesh_admit_check(uint16_t backlog) {
+  if (backlog < TPMESH_REG_BUSY_BACKLOG) {
+    return 0;
+  }
+
+  /* 等积压处理完再来 */
+  uint32_t wait = (uint32_t)backlog * TPMESH_REG_ADMIT_INTERVAL_MS;
+  return (wait < TPMESH_REG_BUSY_MAX_MS) ? wait : TPMESH_REG_BUSY_MAX_MS;
+}
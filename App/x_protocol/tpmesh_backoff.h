@@ -0,0 +1,73 @@
+/**
+ * @file tpmesh_backoff.h
+ * @brief TPMesh 注册退避与准入控制 (纯函数, 无 RTOS 依赖)
+ *
+ * 整层楼同时上电时, 所有 DDC 在同一秒注册并按固定间隔重试, 形成同步的
+ * 碰撞波。这里提供两侧的节奏控制:
+ * - DDC: 指数退避 + 抖动 (等分抖动: 区间 [d/2, d], d = min(上限, 基数 x 2^n))
+ * - Top Node: 消息队列接近溢出时回复 "忙, N ms 后重试" (N 按积压估算),
+ *   代替队列满后静默丢弃 (同一队列也承载 BACnet 数据帧)。应答本身也占用
+ *   信道, 因此只在接近溢出时使用
+ *
+ * 不依赖 FreeRTOS/lwIP, 主机仿真 (tools/register_storm_sim) 直接链接本文件。
+ *
+ * @version 0.7.1
+ */
+
+#ifndef TPMESH_BACKOFF_H
+#define TPMESH_BACKOFF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** Top Node: 处理一条积压消息的估计耗时 (ms), 用于估算重试等待 */
+#ifndef TPMESH_REG_ADMIT_INTERVAL_MS
+#define TPMESH_REG_ADMIT_INTERVAL_MS 300
+#endif
+
+/** Top Node: 消息队列积压达到该深度时暂缓新注册 (队列深度 20) */
+#ifndef TPMESH_REG_BUSY_BACKLOG
+#define TPMESH_REG_BUSY_BACKLOG 16
+#endif
+
+/** Top Node: "忙" 应答的最长重试等待 (ms) */
+#ifndef TPMESH_REG_BUSY_MAX_MS
+#define TPMESH_REG_BUSY_MAX_MS 60000
+#endif
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 指数退避延时 (等分抖动)
+ * @param attempt 已发送次数 (0=首次发送后)
+ * @param base_ms 基数 (ms)
+ * @param max_ms 上限 (ms)
+ * @param rnd 随机数
+ * @return 延时 (ms), 位于 [d/2, d]
+ */
+uint32_t tpmesh_backoff_delay(uint8_t attempt, uint32_t base_ms,
+                              uint32_t max_ms, uint32_t rnd);
+
+/**
+ * @brief 注册准入判断 (Top Node)
+ * @param backlog 当前消息队列积压
+ * @return 0=准入, 否则为建议的重试等待 (ms)
+ */
+uint32_t tpmesh_admit_check(uint16_t backlog);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_BACKOFF_H */
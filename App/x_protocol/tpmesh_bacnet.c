@@ -0,0 +1,450 @@
+/**
+ * @file tpmesh_bacnet.c
+ * @brief TPMesh BACnet/IP 报文解析模块实现
+ *
+ * @version 0.7.1
+ */
+
+#include "tpmesh_bacnet.h"
+#include "tpmesh_schc.h"
+#include <string.h>
+
+/* ============================================================================
+ * 私有函数
+ * ============================================================================
+ */
+
+/**
+ * @brief 读取 16 位大端值
+ */
+static inline uint16_t read_be16(const uint8_t *p) {
+  return ((uint16_t)p[0] << 8) | p[1];
+}
+
+/**
+ * @brief 写入 16 位大端值
+ */
+static inline void write_be16(uint8_t *p, uint16_t val) {
+  p[0] = (val >> 8) & 0xFF;
+  p[1] = val & 0xFF;
+}
+
+/**
+ * @brief 解码上下文标签的无符号数
+ * @param buf APDU 参数区
+ * @param len 剩余长度
+ * @param tag_num 期望的上下文标签号
+ * @param value [out] 解码值
+ * @return 消耗字节数, 0=标签不匹配, -1=格式错误
+ */
+static int decode_context_unsigned(const uint8_t *buf, uint16_t len,
+                                   uint8_t tag_num, uint32_t *value) {
+  if (len < 1) {
+    return 0;
+  }
+
+  uint8_t tag = buf[0];
+
+  /* 上下文标签: bit3=1, 高 4 位为标签号 */
+  if ((tag & 0x08) == 0 || (tag >> 4) != tag_num) {
+    return 0;
+  }
+
+  uint8_t vlen = tag & 0x07;
+  if (vlen < 1 || vlen > 4 || len < 1 + vlen) {
+    return -1;
+  }
+
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < vlen; i++) {
+    v = (v << 8) | buf[1 + i];
+  }
+  *value = v;
+
+  return 1 + vlen;
+}
+
+/**
+ * @brief 编码标签 + 无符号数 (最短编码)
+ * @param context true=上下文标签, false=应用标签
+ * @return 写入字节数
+ */
+static uint16_t encode_unsigned(uint8_t *buf, uint8_t tag_num, bool context,
+                                uint32_t value) {
+  uint8_t n = 1;
+  if (value > 0xFFFFFF) {
+    n = 4;
+  } else if (value > 0xFFFF) {
+    n = 3;
+  } else if (value > 0xFF) {
+    n = 2;
+  }
+
+  buf[0] = (uint8_t)((tag_num << 4) | (context ? 0x08 : 0x00) | n);
+  for (uint8_t i = 0; i < n; i++) {
+    buf[1 + i] = (uint8_t)(value >> (8 * (n - 1 - i)));
+  }
+  return 1 + n;
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_bac_parse(const uint8_t *eth_frame, uint16_t len,
+                     tpmesh_bac_pkt_t *pkt) {
+  if (eth_frame == NULL || pkt == NULL ||
+      len < ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN + 4) {
+    return -1;
+  }
+
+  /* 以太网 + IP + UDP */
+  if (read_be16(eth_frame + 12) != ETHERTYPE_IP) {
+    return -1;
+  }
+
+  const uint8_t *ip = eth_frame + ETH_HDR_LEN;
+  uint16_t ihl = (uint16_t)(ip[0] & 0x0F) * 4;
+  if (ip[9] != 17 || ihl < IP_HDR_LEN ||
+      len < ETH_HDR_LEN + ihl + UDP_HDR_LEN + 4) {
+    return -1;
+  }
+
+  const uint8_t *udp = ip + ihl;
+  if (read_be16(udp + 2) != PORT_BACNET_IP) {
+    return -1;
+  }
+
+  pkt->ip = ip;
+  pkt->udp = udp;
+
+  /* BVLC */
+  const uint8_t *bvlc = udp + UDP_HDR_LEN;
+  const uint8_t *end = eth_frame + len;
+  if (bvlc[0] != TPMESH_BAC_BVLC_TYPE) {
+    return -1;
+  }
+
+  uint16_t bvlc_len = read_be16(bvlc + 2);
+  if (bvlc_len < 4 || bvlc + bvlc_len > end) {
+    return -2;
+  }
+  end = bvlc + bvlc_len;
+
+  pkt->bvlc_func = bvlc[1];
+  const uint8_t *npdu;
+
+  switch (pkt->bvlc_func) {
+  case TPMESH_BAC_BVLC_ORIGINAL_UNICAST:
+  case TPMESH_BAC_BVLC_ORIGINAL_BCAST:
+  case TPMESH_BAC_BVLC_DISTRIBUTE_BCAST:
+    npdu = bvlc + 4;
+    break;
+  case TPMESH_BAC_BVLC_FORWARDED_NPDU:
+    npdu = bvlc + 10; /* 原始源 B/IP 地址 6 字节 */
+    break;
+  default:
+    return -1; /* BVLL 管理报文 */
+  }
+
+  /* NPDU */
+  if (npdu + 2 > end || npdu[0] != 0x01) {
+    return -2;
+  }
+
+  pkt->npdu_ctrl = npdu[1];
+  pkt->dnet = 0;
+
+  const uint8_t *q = npdu + 2;
+
+  if (pkt->npdu_ctrl & TPMESH_BAC_NPDU_DNET) {
+    if (q + 3 > end) {
+      return -2;
+    }
+    pkt->dnet = read_be16(q);
+    q += 3 + q[2];
+  }
+
+  if (pkt->npdu_ctrl & TPMESH_BAC_NPDU_SNET) {
+    if (q + 3 > end) {
+      return -2;
+    }
+    q += 3 + q[2];
+  }
+
+  if (pkt->npdu_ctrl & TPMESH_BAC_NPDU_DNET) {
+    q += 1; /* Hop Count */
+  }
+
+  if (q > end) {
+    return -2;
+  }
+
+  if (pkt->npdu_ctrl & TPMESH_BAC_NPDU_NET_MSG) {
+    return -3;
+  }
+
+  pkt->apdu = q;
+  pkt->apdu_len = (uint16_t)(end - q);
+
+  return 0;
+}
+
+int tpmesh_bac_get_discovery_range(const tpmesh_bac_pkt_t *pkt, uint32_t *low,
+                                   uint32_t *high) {
+  if (pkt == NULL || pkt->apdu_len < 2 ||
+      (pkt->apdu[0] & 0xF0) != TPMESH_BAC_PDU_UNCONFIRMED) {
+    return -1;
+  }
+
+  uint8_t service = pkt->apdu[1];
+  if (service != TPMESH_BAC_SERVICE_WHO_IS &&
+      service != TPMESH_BAC_SERVICE_WHO_HAS) {
+    return -1;
+  }
+
+  *low = 0;
+  *high = TPMESH_BAC_MAX_INSTANCE;
+
+  /* 两种服务的范围均为可选的 [0] low / [1] high, 且必须成对出现 */
+  const uint8_t *args = pkt->apdu + 2;
+  uint16_t args_len = pkt->apdu_len - 2;
+  uint32_t lo, hi;
+
+  int n0 = decode_context_unsigned(args, args_len, 0, &lo);
+  if (n0 < 0) {
+    return -1;
+  }
+  if (n0 == 0) {
+    return 0;
+  }
+
+  int n1 = decode_context_unsigned(args + n0, args_len - n0, 1, &hi);
+  if (n1 <= 0 || lo > hi) {
+    return -1;
+  }
+
+  *low = lo;
+  *high = hi;
+  return 1;
+}
+
+int tpmesh_bac_decode_tag(const uint8_t *buf, uint16_t len,
+                          tpmesh_bac_tag_t *tag) {
+  if (len < 1) {
+    return -1;
+  }
+
+  uint8_t b = buf[0];
+  uint8_t lvt = b & 0x07;
+  uint16_t pos = 1;
+
+  tag->number = b >> 4;
+  tag->context = (b & 0x08) != 0;
+  tag->opening = false;
+  tag->closing = false;
+  tag->data_len = 0;
+
+  /* 扩展标签号 */
+  if (tag->number == 0x0F) {
+    if (len < 2) {
+      return -1;
+    }
+    tag->number = buf[pos++];
+  }
+
+  if (tag->context && lvt == 6) {
+    tag->opening = true;
+  } else if (tag->context && lvt == 7) {
+    tag->closing = true;
+  } else if (!tag->context && tag->number == 1) {
+    /* 布尔应用标签: 值在 LVT 中, 无内容 */
+  } else if (lvt == 5) {
+    /* 扩展长度 */
+    if (pos + 1 > len) {
+      return -1;
+    }
+    uint8_t ext = buf[pos++];
+    if (ext == 254) {
+      if (pos + 2 > len) {
+        return -1;
+      }
+      tag->data_len = read_be16(buf + pos);
+      pos += 2;
+    } else if (ext == 255) {
+      if (pos + 4 > len) {
+        return -1;
+      }
+      tag->data_len = tpmesh_bac_decode_unsigned(buf + pos, 4);
+      pos += 4;
+    } else {
+      tag->data_len = ext;
+    }
+  } else {
+    tag->data_len = lvt;
+  }
+
+  if (pos + tag->data_len > len) {
+    return -1;
+  }
+
+  tag->hdr_len = (uint8_t)pos;
+  return pos;
+}
+
+uint32_t tpmesh_bac_decode_unsigned(const uint8_t *buf, uint32_t len) {
+  uint32_t v = 0;
+  for (uint32_t i = 0; i < len && i < 4; i++) {
+    v = (v << 8) | buf[i];
+  }
+  return v;
+}
+
+int tpmesh_bac_find_closing(const uint8_t *buf, uint16_t len, uint8_t tag_num) {
+  uint16_t off = 0;
+  int depth = 0;
+
+  while (off < len) {
+    tpmesh_bac_tag_t tag;
+    int n = tpmesh_bac_decode_tag(buf + off, len - off, &tag);
+    if (n < 0) {
+      return -1;
+    }
+
+    if (tag.opening) {
+      depth++;
+    } else if (tag.closing) {
+      if (depth == 0) {
+        return (tag.number == tag_num) ? off : -1;
+      }
+      depth--;
+    }
+
+    off += n + tag.data_len;
+  }
+
+  return -1;
+}
+
+uint16_t tpmesh_bac_encode_context_unsigned(uint8_t *buf, uint8_t tag_num,
+                                            uint32_t value) {
+  return encode_unsigned(buf, tag_num, true, value);
+}
+
+uint16_t tpmesh_bac_max_apdu_accepted(uint8_t max_apdu_code) {
+  static const uint16_t sizes[] = {50, 128, 206, 480, 1024, 1476};
+  uint8_t code = max_apdu_code & 0x0F;
+  return (code < sizeof(sizes) / sizeof(sizes[0])) ? sizes[code] : 50;
+}
+
+/**
+ * @brief 构建 以太网/IP/UDP/BVLC/NPDU 头 + APDU
+ * @param eth_dst 目标 MAC
+ * @param eth_src 源 MAC
+ * @param ip_src 源 IP (网络序字节)
+ * @param ip_dst 目标 IP (网络序字节)
+ * @param src_port 源端口 (网络序字节)
+ * @param dst_port 目标端口 (网络序字节)
+ * @return 帧长度, -1=缓冲区不足
+ */
+static int build_frame(const uint8_t *eth_dst, const uint8_t *eth_src,
+                       const uint8_t *ip_src, const uint8_t *ip_dst,
+                       const uint8_t *src_port, const uint8_t *dst_port,
+                       uint8_t bvlc_func, const uint8_t *apdu,
+                       uint16_t apdu_len, uint8_t *out, uint16_t out_max) {
+  const uint16_t bvlc_len = 4 + 2 + apdu_len; /* BVLC + NPDU + APDU */
+  const uint16_t frame_len = ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN + bvlc_len;
+
+  if (frame_len > out_max) {
+    return -1;
+  }
+
+  /* 以太网头 */
+  memcpy(out, eth_dst, 6);
+  memcpy(out + 6, eth_src, 6);
+  write_be16(out + 12, ETHERTYPE_IP);
+
+  /* IP 头 */
+  uint8_t *ip = out + ETH_HDR_LEN;
+  ip[0] = 0x45;
+  ip[1] = 0x00;
+  write_be16(ip + 2, IP_HDR_LEN + UDP_HDR_LEN + bvlc_len);
+  write_be16(ip + 4, 0);
+  write_be16(ip + 6, 0);
+  ip[8] = 64;
+  ip[9] = 17; /* UDP */
+  write_be16(ip + 10, 0);
+  memcpy(ip + 12, ip_src, 4);
+  memcpy(ip + 16, ip_dst, 4);
+  write_be16(ip + 10, schc_ip_checksum(ip, IP_HDR_LEN));
+
+  /* UDP 头 (校验和可选, 置 0) */
+  uint8_t *udp = ip + IP_HDR_LEN;
+  memcpy(udp, src_port, 2);
+  memcpy(udp + 2, dst_port, 2);
+  write_be16(udp + 4, UDP_HDR_LEN + bvlc_len);
+  write_be16(udp + 6, 0);
+
+  /* BVLC + NPDU + APDU */
+  uint8_t *bvlc = udp + UDP_HDR_LEN;
+  bvlc[0] = TPMESH_BAC_BVLC_TYPE;
+  bvlc[1] = bvlc_func;
+  write_be16(bvlc + 2, bvlc_len);
+  bvlc[4] = 0x01; /* NPDU Version */
+  bvlc[5] = 0x00; /* NPDU Control: 本地, 无需应答 */
+  memcpy(bvlc + 6, apdu, apdu_len);
+
+  return frame_len;
+}
+
+int tpmesh_bac_build_reply(const tpmesh_bac_pkt_t *req,
+                           const uint8_t *req_frame, const uint8_t *apdu,
+                           uint16_t apdu_len, uint8_t *out, uint16_t out_max) {
+  /* 地址/端口取请求的镜像 */
+  return build_frame(req_frame + 6, req_frame, req->ip + 16, req->ip + 12,
+                     req->udp + 2, req->udp, TPMESH_BAC_BVLC_ORIGINAL_UNICAST,
+                     apdu, apdu_len, out, out_max);
+}
+
+int tpmesh_bac_build_broadcast(const uint8_t *src_mac, uint32_t src_ip,
+                               const uint8_t *apdu, uint16_t apdu_len,
+                               uint8_t *out, uint16_t out_max) {
+  static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  const uint8_t port[2] = {PORT_BACNET_IP >> 8, PORT_BACNET_IP & 0xFF};
+
+  return build_frame(bcast, src_mac, (const uint8_t *)&src_ip, bcast, port,
+                     port, TPMESH_BAC_BVLC_ORIGINAL_BCAST, apdu, apdu_len, out,
+                     out_max);
+}
+
+uint16_t tpmesh_bac_encode_i_am(uint8_t *apdu, uint32_t device_instance,
+                                uint16_t max_apdu, uint8_t segmentation,
+                                uint16_t vendor_id) {
+  uint32_t object_id =
+      ((uint32_t)TPMESH_BAC_OBJECT_DEVICE << 22) |
+      (device_instance & TPMESH_BAC_MAX_INSTANCE);
+  uint16_t n = 0;
+
+  apdu[n++] = TPMESH_BAC_PDU_UNCONFIRMED;
+  apdu[n++] = TPMESH_BAC_SERVICE_I_AM;
+
+  /* BACnetObjectIdentifier (应用标签 12) */
+  apdu[n++] = 0xC4;
+  apdu[n++] = (uint8_t)(object_id >> 24);
+  apdu[n++] = (uint8_t)(object_id >> 16);
+  apdu[n++] = (uint8_t)(object_id >> 8);
+  apdu[n++] = (uint8_t)object_id;
+
+  /* Unsigned (应用标签 2) */
+  n += encode_unsigned(apdu + n, 2, false, max_apdu);
+
+  /* Enumerated (应用标签 9) */
+  apdu[n++] = 0x91;
+  apdu[n++] = segmentation;
+
+  /* Unsigned (应用标签 2) */
+  n += encode_unsigned(apdu + n, 2, false, vendor_id);
+
+  return n;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file tpmesh_bacnet.h
+ * @brief TPMesh BACnet/IP 报文解析模块
+ *
+ * 桥接层只需识别少量 BACnet 报文 (Who-Is / Who-Has 等),
+ * 此处实现轻量解析, 不依赖 BACnet 协议栈库:
+ * - BVLC: 0x81 + Function + Length (Forwarded-NPDU 额外 6 字节源地址)
+ * - NPDU: Version + Control [+ DNET/DLEN/DADR] [+ SNET/SLEN/SADR] [+ Hop]
+ * - APDU: PDU Type + Service Choice + 参数
+ *
+ * @version 0.7.1
+ */
+
+#ifndef TPMESH_BACNET_H
+#define TPMESH_BACNET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 常量定义
+ * ============================================================================
+ */
+
+/** BVLC 类型 (BACnet/IP) */
+#define TPMESH_BAC_BVLC_TYPE 0x81
+
+/** BVLC Function */
+#define TPMESH_BAC_BVLC_FORWARDED_NPDU 0x04
+#define TPMESH_BAC_BVLC_DISTRIBUTE_BCAST 0x09
+#define TPMESH_BAC_BVLC_ORIGINAL_UNICAST 0x0A
+#define TPMESH_BAC_BVLC_ORIGINAL_BCAST 0x0B
+
+/** NPDU Control 位 */
+#define TPMESH_BAC_NPDU_NET_MSG 0x80
+#define TPMESH_BAC_NPDU_DNET 0x20
+#define TPMESH_BAC_NPDU_SNET 0x08
+
+/** APDU 类型 (高 4 位) */
+#define TPMESH_BAC_PDU_CONFIRMED 0x00
+#define TPMESH_BAC_PDU_UNCONFIRMED 0x10
+#define TPMESH_BAC_PDU_COMPLEX_ACK 0x30
+#define TPMESH_BAC_PDU_REJECT 0x60
+
+/** Reject 原因: 其他 */
+#define TPMESH_BAC_REJECT_OTHER 0
+
+/** APDU 首字节标志位 */
+#define TPMESH_BAC_PDU_SEG 0x08
+
+/** 确认服务 */
+#define TPMESH_BAC_SERVICE_CONF_COV_NOTIFY 0x01
+#define TPMESH_BAC_SERVICE_READ_PROP 0x0C
+#define TPMESH_BAC_SERVICE_READ_PROP_MULTI 0x0E
+#define TPMESH_BAC_SERVICE_WRITE_PROP 0x0F
+#define TPMESH_BAC_SERVICE_WRITE_PROP_MULTI 0x10
+
+/** 非确认服务 */
+#define TPMESH_BAC_SERVICE_I_AM 0x00
+#define TPMESH_BAC_SERVICE_UNCONF_COV_NOTIFY 0x02
+#define TPMESH_BAC_SERVICE_WHO_HAS 0x07
+#define TPMESH_BAC_SERVICE_WHO_IS 0x08
+
+/** 特殊属性 (RPM 中需由设备展开) */
+#define TPMESH_BAC_PROP_ALL 8
+#define TPMESH_BAC_PROP_OPTIONAL 80
+#define TPMESH_BAC_PROP_REQUIRED 105
+
+/** 无数组下标 */
+#define TPMESH_BAC_ARRAY_ALL 0xFFFFFFFFUL
+
+/** 设备对象类型 */
+#define TPMESH_BAC_OBJECT_DEVICE 8
+
+/** 设备实例号最大值 (22 bit) */
+#define TPMESH_BAC_MAX_INSTANCE 0x3FFFFFUL
+
+/* ============================================================================
+ * 数据结构定义
+ * ============================================================================
+ */
+
+/**
+ * @brief BACnet/IP 报文解析结果 (指针指向原始帧, 不复制数据)
+ */
+typedef struct {
+  const uint8_t *ip;   /**< IP 头起始位置 */
+  const uint8_t *udp;  /**< UDP 头起始位置 */
+  uint8_t bvlc_func;   /**< BVLC Function */
+  uint8_t npdu_ctrl;   /**< NPDU Control */
+  uint16_t dnet;       /**< 目标网络号 (0=本地网络) */
+  const uint8_t *apdu; /**< APDU 起始位置 */
+  uint16_t apdu_len;   /**< APDU 长度 */
+} tpmesh_bac_pkt_t;
+
+/**
+ * @brief 标签解码结果
+ */
+typedef struct {
+  uint8_t number;    /**< 标签号 */
+  bool context;      /**< 上下文标签 */
+  bool opening;      /**< 开标签 */
+  bool closing;      /**< 闭标签 */
+  uint8_t hdr_len;   /**< 标签头长度 */
+  uint32_t data_len; /**< 内容长度 (布尔应用标签为 0) */
+} tpmesh_bac_tag_t;
+
+/* ============================================================================
+ * 解析 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 从以太网帧中解析 BACnet/IP APDU
+ * @param eth_frame 以太网帧
+ * @param len 帧长度 (仅使用连续内存部分)
+ * @param pkt [out] 解析结果
+ * @return 0=成功, -1=非 BACnet/IP 报文, -2=格式错误, -3=网络层报文 (无 APDU)
+ */
+int tpmesh_bac_parse(const uint8_t *eth_frame, uint16_t len,
+                     tpmesh_bac_pkt_t *pkt);
+
+/**
+ * @brief 获取 Who-Is / Who-Has 的设备实例范围
+ *
+ * 未携带范围的请求视为全范围 [0, TPMESH_BAC_MAX_INSTANCE]。
+ *
+ * @param pkt 解析结果
+ * @param low [out] 范围下限
+ * @param high [out] 范围上限
+ * @return 1=带范围, 0=不带范围, -1=非 Who-Is/Who-Has 或格式错误
+ */
+int tpmesh_bac_get_discovery_range(const tpmesh_bac_pkt_t *pkt, uint32_t *low,
+                                   uint32_t *high);
+
+/**
+ * @brief 解码标签头
+ * @param buf 数据
+ * @param len 剩余长度
+ * @param tag [out] 标签
+ * @return 标签头长度, -1=格式错误
+ */
+int tpmesh_bac_decode_tag(const uint8_t *buf, uint16_t len,
+                          tpmesh_bac_tag_t *tag);
+
+/**
+ * @brief 解码大端无符号数 (1~4 字节)
+ */
+uint32_t tpmesh_bac_decode_unsigned(const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief 查找与开标签配对的闭标签
+ * @param buf 开标签之后的数据
+ * @param len 剩余长度
+ * @param tag_num 开标签的标签号
+ * @return 闭标签相对 buf 的偏移 (即构造值长度), -1=未找到
+ */
+int tpmesh_bac_find_closing(const uint8_t *buf, uint16_t len, uint8_t tag_num);
+
+/**
+ * @brief 编码上下文标签 + 无符号数 (最短编码)
+ * @return 写入字节数
+ */
+uint16_t tpmesh_bac_encode_context_unsigned(uint8_t *buf, uint8_t tag_num,
+                                            uint32_t value);
+
+/**
+ * @brief 确认请求中 "最大可接受 APDU" 编码转换为字节数
+ * @param max_apdu_code 确认请求第 2 字节
+ * @return 字节数
+ */
+uint16_t tpmesh_bac_max_apdu_accepted(uint8_t max_apdu_code);
+
+/**
+ * @brief 构建对请求报文的 BACnet/IP 单播应答帧
+ *
+ * 以太网/IP/UDP 地址与端口取请求的镜像 (应答方 = 请求的目标),
+ * NPDU 为本地网络无路由格式。
+ *
+ * @param req 请求解析结果 (须来自 tpmesh_bac_parse)
+ * @param req_frame 请求以太网帧
+ * @param apdu 应答 APDU
+ * @param apdu_len APDU 长度
+ * @param out [out] 应答以太网帧
+ * @param out_max 输出缓冲区大小
+ * @return 帧长度, -1=缓冲区不足
+ */
+int tpmesh_bac_build_reply(const tpmesh_bac_pkt_t *req,
+                           const uint8_t *req_frame, const uint8_t *apdu,
+                           uint16_t apdu_len, uint8_t *out, uint16_t out_max);
+
+/**
+ * @brief 编码 I-Am APDU
+ * @param apdu [out] 输出缓冲区 (至少 20 字节)
+ * @param device_instance 设备实例号
+ * @param max_apdu 最大可接受 APDU
+ * @param segmentation 分段支持 (BACNET_SEGMENTATION)
+ * @param vendor_id 厂商 ID
+ * @return APDU 长度
+ */
+uint16_t tpmesh_bac_encode_i_am(uint8_t *apdu, uint32_t device_instance,
+                                uint16_t max_apdu, uint8_t segmentation,
+                                uint16_t vendor_id);
+
+/**
+ * @brief 构建 BACnet/IP 本地广播帧 (Original-Broadcast-NPDU)
+ * @param src_mac 源 MAC
+ * @param src_ip 源 IP (网络序)
+ * @param apdu APDU
+ * @param apdu_len APDU 长度
+ * @param out [out] 以太网帧
+ * @param out_max 输出缓冲区大小
+ * @return 帧长度, -1=缓冲区不足
+ */
+int tpmesh_bac_build_broadcast(const uint8_t *src_mac, uint32_t src_ip,
+                               const uint8_t *apdu, uint16_t apdu_len,
+                               uint8_t *out, uint16_t out_max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_BACNET_H */
@@ -10,9 +10,24 @@
  */
 
 #include "tpmesh_bridge.h"
+#include "tpmesh_arp_seed.h"
 #include "tpmesh_at.h"
+#include "tpmesh_backoff.h"
+#include "tpmesh_bacnet.h"
+#include "tpmesh_bulk.h"
 #include "tpmesh_debug.h"
+#include "tpmesh_icmp_proxy.h"
+#include "tpmesh_inflight.h"
+#include "tpmesh_mqtt_gw.h"
+#include "tpmesh_node_store.h"
+#include "tpmesh_route.h"
+#include "tpmesh_rp_cache.h"
+#include "tpmesh_netif.h"
+#include "tpmesh_rtt.h"
 #include "tpmesh_schc.h"
+#include "tpmesh_tcp_proxy.h"
+#include "tpmesh_time.h"
+#include "tpmesh_top_sync.h"
 
 /* node_table.h 已通过 tpmesh_bridge.h 包含 */
 #include "FreeRTOS.h"
@@ -37,6 +52,21 @@
  * ============================================================================
  */
 
+/** 注册帧发送缓冲区长度 (隧道头 + reg_frame_t + TLV) */
+#define REG_FRAME_BUF_LEN 128
+
+/** 注册 ACK 的 TLV 长度 (基本 TLV + ARP 预置全量表 + 时间信标) */
+#define REG_ACK_TLV_LEN                                                        \
+  (32 + 2 + TPMESH_ARP_SEED_MAX * REG_TLV_ARP_ENTRY_LEN + 2 + REG_TLV_TIME_LEN)
+
+/** 对端 DDC 的本地 MAC: 02:'T':'M':00:<Mesh ID BE> (本地管理地址) */
+#define PEER_MAC_OUI0 0x02
+#define PEER_MAC_OUI1 'T'
+#define PEER_MAC_OUI2 'M'
+
+/** 读缓存本地应答的最大 APDU 长度 */
+#define CACHE_REPLY_APDU_MAX 480
+
 /** 分片发送上下文 */
 typedef struct {
   uint16_t dest_mesh_id;
@@ -50,9 +80,25 @@ typedef struct {
 typedef struct {
   uint16_t src_mesh_id;
   uint16_t len;
+  uint32_t rx_tick; /**< 接收时间 (时间戳回显扣除排队时间) */
   uint8_t data[TPMESH_MTU];
 } mesh_msg_t;
 
+/** 组播组映射 (Top Node) */
+typedef struct {
+  uint16_t group_addr; /**< 组播地址 */
+  ip4_addr_t subnet;   /**< 子网 */
+  ip4_addr_t mask;     /**< 子网掩码 */
+  uint16_t bacnet_net; /**< BACnet 网络号 (0=不映射) */
+} mesh_group_t;
+
+/** 组成员检查上下文 */
+typedef struct {
+  const mesh_group_t *group;
+  uint16_t members; /**< 已加入的在线成员 */
+  uint16_t strays;  /**< 子网内尚未加入的在线节点 */
+} group_check_t;
+
 /* ============================================================================
  * 私有变量
  * ============================================================================
@@ -73,14 +119,53 @@ static bool s_is_top_node = false;
 /** DDC 状态 */
 static volatile ddc_state_t s_ddc_state = DDC_STATE_INIT;
 
+/** DDC: 当前注册所在的 Top Node (注册 ACK 的来源) */
+static volatile uint16_t s_ddc_top = MESH_ADDR_TOP_NODE;
+
 /** 注册重试计数 */
 static volatile uint8_t s_register_retry_count = 0;
 
-/** 注册最后时间 */
-static volatile uint32_t s_last_register_tick = 0;
+/** 下次注册 (或快速重新上线确认心跳) 时间 */
+static volatile uint32_t s_next_register_tick = 0;
+
+/** DDC: 下一个心跳时隙 */
+static volatile uint32_t s_next_heartbeat_tick = 0;
+
+/** DDC: 最近一次向 Top Node 发出数据帧的时间 (隐式心跳) */
+static volatile uint32_t s_last_uplink_tick = 0;
+
+/** DDC: 最近一次收到注册/心跳 ACK 的时间 */
+static volatile uint32_t s_last_ack_tick = 0;
+
+/** DDC: 待回显的 Top Node 时间戳及其接收时间 (0=无) */
+static uint32_t s_peer_tsval = 0;
+static uint32_t s_peer_ts_rx = 0;
+
+/** 当前处理的 Mesh 消息的接收时间 (0=未知) */
+static uint32_t s_msg_rx_tick = 0;
+
+/** DDC: Top Node 通告的网络规模 (节点数), 用于 I-Am 时隙 */
+static volatile uint16_t s_net_size = 1;
+
+/** Top Node: 注册纪元 (节点表丢失后更换, 随节点表快照保存) */
+static uint32_t s_top_epoch = 0;
 
-/** 心跳最后时间 */
-static volatile uint32_t s_last_heartbeat_tick = 0;
+/** DDC: 最近一次注册获得的纪元 (0=无, 须完整注册) */
+static volatile uint32_t s_ddc_epoch = 0;
+
+/** DDC: 快速重新上线等待确认心跳的 ACK */
+static volatile bool s_rejoin_pending = false;
+static volatile uint8_t s_rejoin_tries = 0;
+
+/** DDC: 错开时隙的 I-Am 定时器 */
+static tpmesh_timer_t s_iam_timer;
+
+/** DDC: 模组已加入的组播地址 */
+static volatile uint16_t s_ddc_group = MESH_ADDR_INVALID;
+
+/** Top Node: 组播组映射表 */
+static mesh_group_t s_groups[TPMESH_GROUP_MAX];
+static uint8_t s_group_count = 0;
 
 /** 广播限速器 */
 static rate_limiter_t s_rate_limiter = {0, 0};
@@ -98,9 +183,6 @@ static QueueHandle_t s_mesh_msg_queue = NULL;
 /** 初始化状态 */
 static bool s_initialized = false;
 
-/* DDC 注入本地协议栈使用的默认网卡 */
-extern struct netif *netif_default;
-
 /* ============================================================================
  * 私有函数声明
  * ============================================================================
@@ -111,14 +193,63 @@ static void mesh_data_callback(uint16_t src_mesh_id, const uint8_t *data,
 static void route_event_callback(const char *event, uint16_t addr);
 static int fragment_and_send(uint16_t dest_mesh_id, const uint8_t *data,
                              uint16_t len);
+static int mesh_send(uint16_t dest_mesh_id, const uint8_t *data, uint16_t len);
 static int reassemble_packet(uint16_t src_mesh_id, const uint8_t *data,
                              uint16_t len, uint8_t **out_data,
                              uint16_t *out_len);
+static void reassembly_setup(reassembly_session_t *sessions, int count);
+static void reassembly_close(reassembly_session_t *session);
 static void process_register_frame(uint16_t src_mesh_id, const uint8_t *data,
                                    uint16_t len);
 static void process_data_frame(uint16_t src_mesh_id, const uint8_t *data,
                                uint16_t len);
+static int send_reg_frame(uint16_t dest_mesh_id, uint8_t frame_type,
+                          const uint8_t *mac, const ip4_addr_t *ip,
+                          uint16_t mesh_id, const uint8_t *tlv,
+                          uint16_t tlv_len);
+static uint16_t reg_tlv_put(uint8_t *tlv, uint16_t off, uint8_t type,
+                            const uint8_t *value, uint8_t len);
+static const uint8_t *reg_tlv_find(const uint8_t *tlv, uint16_t len,
+                                   uint8_t type, uint8_t *value_len);
+static int select_discovery_targets(const tpmesh_bac_pkt_t *pkt,
+                                    uint16_t *mesh_ids);
+static bool answer_from_cache(struct pbuf *p, const tpmesh_bac_pkt_t *req,
+                              uint16_t mesh_id);
+static bool reject_suspect(struct pbuf *p, const tpmesh_bac_pkt_t *req,
+                           uint16_t mesh_id);
+static void eth_output(const uint8_t *frame, uint16_t len);
+static uint16_t top_build_ack_tlv(uint8_t *tlv, uint16_t mesh_id,
+                                  const ip4_addr_t *ddc_ip, uint32_t epoch,
+                                  uint32_t tsecr);
+static uint16_t top_hb_slot_delay(uint16_t mesh_id);
+static void ddc_apply_ack_tlv(const uint8_t *tlv, uint16_t len);
+static uint16_t reg_tlv_get_group(const uint8_t *tlv, uint16_t len);
+static uint32_t reg_tlv_get_epoch(const uint8_t *tlv, uint16_t len);
+static uint16_t reg_tlv_put_ts(uint8_t *tlv, uint16_t off, uint32_t tsecr);
+static bool reg_tlv_get_ts(const uint8_t *tlv, uint16_t len, uint32_t *tsval,
+                           uint32_t *tsecr);
+static uint32_t ts_echo(uint32_t peer_tsval, uint32_t rx_tick);
+static void ddc_start_rejoin(void);
+static void ddc_enter_registering(void);
+static void ddc_restart_register(const char *reason);
+static void ddc_save_epoch(uint32_t epoch);
+static void ddc_uplink_sent(uint16_t dest_mesh_id);
+static bool ddc_ack_due(void);
+static uint32_t ddc_retry_base(void);
+static const mesh_group_t *group_by_ip(const ip4_addr_t *ip);
+static uint16_t select_broadcast_group(const uint8_t *frame, uint16_t len,
+                                       const tpmesh_bac_pkt_t *bac);
+static bool ddc_intercept_who_is(const uint8_t *frame, uint16_t len);
+static int ddc_send_i_am(void);
+static void ddc_iam_expired(tpmesh_timer_t *timer, void *arg);
 static void send_garp(const uint8_t *mac, const ip4_addr_t *ip);
+static bool top_intercept_peer_arp(uint16_t src_mesh_id, const uint8_t *frame,
+                                   uint16_t len);
+static void top_peer_changed(uint16_t mesh_id, const ip4_addr_t *ip);
+static void ddc_apply_peer_map(const uint8_t *tlv, uint16_t len);
+static void ddc_apply_arp_map(const uint8_t *tlv, uint16_t len);
+static void ddc_apply_time(uint16_t src, const uint8_t *tlv, uint16_t len);
+static void top_learn_arp_sender(struct pbuf *p);
 static bridge_action_t check_arp_request(struct pbuf *p,
                                          const uint8_t **target_ip);
 static int send_proxy_arp_reply_internal(struct pbuf *arp_request,
@@ -140,6 +271,11 @@ int tpmesh_top_init(struct netif *eth_netif, const top_config_t *config) {
   s_is_top_node = true;
 
   /* ---- 仅硬件/内存初始化 (调度器前安全) ---- */
+  if (tpmesh_timer_init() != 0) {
+    tpmesh_debug_printf("TPMesh: timer init failed\n");
+    return -4;
+  }
+
   node_table_init();
 
   if (tpmesh_at_init() != 0) {
@@ -155,7 +291,34 @@ int tpmesh_top_init(struct netif *eth_netif, const top_config_t *config) {
   }
 
   /* 初始化重组会话 */
-  memset(s_reassembly_sessions, 0, sizeof(s_reassembly_sessions));
+  reassembly_setup(s_reassembly_sessions, MAX_REASSEMBLY_SESSIONS);
+
+  /* RP/RPM 应答缓存 */
+  if (tpmesh_rp_cache_init() != 0) {
+    tpmesh_debug_printf("TPMesh: RP cache init failed\n");
+    return -3;
+  }
+
+  /* 在途确认请求表 */
+  if (tpmesh_inflight_init() != 0) {
+    tpmesh_debug_printf("TPMesh: inflight table init failed\n");
+    return -3;
+  }
+
+  /* 恢复重启前的节点表 (stale, 数据/心跳到达后确认);
+   * 恢复成功时沿用快照中的注册纪元, DDC 可快速重新上线 */
+  s_top_epoch = LWIP_RAND();
+  if (s_top_epoch == 0) {
+    s_top_epoch = 1;
+  }
+  tpmesh_node_store_init(&s_top_epoch);
+
+  /* 多 Top Node: 以太网侧节点表同步 (单 Top Node 时只周期发送空通告) */
+  if (tpmesh_top_sync_init(eth_netif, config->mesh_id, config->cell_id) != 0) {
+    tpmesh_debug_printf("TPMesh: Top sync init failed (Mesh ID 0x%04X)\n",
+                        config->mesh_id);
+    return -3;
+  }
 
   s_initialized = true;
   tpmesh_debug_printf("TPMesh Top: HW init done (Mesh ID: 0x%04X)\n",
@@ -177,8 +340,16 @@ int tpmesh_ddc_init(const ddc_config_t *config) {
   s_ddc_state = DDC_STATE_INIT;
 
   /* ---- 仅硬件/内存初始化 (调度器前安全) ---- */
+  if (tpmesh_timer_init() != 0) {
+    tpmesh_debug_printf("TPMesh: timer init failed\n");
+    return -4;
+  }
+
   node_table_init();
 
+  /* 本机条目: 对端 DDC 直发的帧按目的 Mesh ID 恢复本机 MAC/IP */
+  node_table_add_static(config->mac_addr, &config->ip_addr, config->mesh_id);
+
   if (tpmesh_at_init() != 0) {
     tpmesh_debug_printf("TPMesh: AT init failed\n");
     return -1;
@@ -191,7 +362,22 @@ int tpmesh_ddc_init(const ddc_config_t *config) {
     return -2;
   }
 
-  memset(&s_ddc_reassembly, 0, sizeof(s_ddc_reassembly));
+  reassembly_setup(&s_ddc_reassembly, 1);
+  tpmesh_timer_setup(&s_iam_timer, ddc_iam_expired, NULL);
+  s_ddc_group = MESH_ADDR_INVALID;
+
+  /* 快速重新上线: MAC/IP/Mesh ID 未变时沿用上次注册的纪元 */
+  tpmesh_rejoin_t rec;
+  s_ddc_epoch = 0;
+  if (tpmesh_node_store_load_rejoin(&rec) == 0 &&
+      rec.mesh_id == config->mesh_id &&
+      memcmp(rec.mac, config->mac_addr, 6) == 0 &&
+      ip4_addr_cmp(&rec.ip, &config->ip_addr)) {
+    s_ddc_epoch = rec.epoch;
+    if (MESH_ADDR_IS_TOP(rec.top_id)) {
+      s_ddc_top = rec.top_id;
+    }
+  }
 
   s_initialized = true;
   tpmesh_debug_printf("DDC: HW init done (Mesh ID: 0x%04X)\n", config->mesh_id);
@@ -200,6 +386,39 @@ int tpmesh_ddc_init(const ddc_config_t *config) {
   return 0;
 }
 
+int tpmesh_top_add_group(uint16_t group_addr, const ip4_addr_t *subnet,
+                         uint8_t prefix_len, uint16_t bacnet_net) {
+  if (group_addr < MESH_ADDR_GROUP_FIRST || group_addr > MESH_ADDR_GROUP_LAST ||
+      subnet == NULL || prefix_len == 0 || prefix_len > 32) {
+    return -1;
+  }
+  if (s_group_count >= TPMESH_GROUP_MAX) {
+    return -2;
+  }
+
+  mesh_group_t *g = &s_groups[s_group_count];
+  uint32_t mask = 0xFFFFFFFFUL << (32 - prefix_len);
+  ip4_addr_set_u32(&g->mask, lwip_htonl(mask));
+  ip4_addr_set_u32(&g->subnet, ip4_addr_get_u32(subnet) & lwip_htonl(mask));
+  g->group_addr = group_addr;
+  g->bacnet_net = bacnet_net;
+  s_group_count++;
+
+  tpmesh_debug_printf("TPMesh Top: Group 0x%04X -> %s/%u net %u\n", group_addr,
+                      ip4addr_ntoa(&g->subnet), prefix_len, bacnet_net);
+  return 0;
+}
+
+int tpmesh_top_send_reg(uint16_t dest_mesh_id, uint8_t frame_type,
+                        const uint8_t *tlv, uint16_t tlv_len) {
+  if (!s_initialized || !s_is_top_node) {
+    return -1;
+  }
+  return send_reg_frame(dest_mesh_id, frame_type, s_top_config.mac_addr,
+                        &s_top_config.ip_addr, s_top_config.mesh_id, tlv,
+                        tlv_len);
+}
+
 /* ============================================================================
  * 公共函数 - 桥接
  * ============================================================================
@@ -213,11 +432,28 @@ bridge_action_t tpmesh_bridge_check(struct pbuf *p) {
   struct eth_hdr *eth = (struct eth_hdr *)p->payload;
   uint16_t ethertype = lwip_ntohs(eth->type);
 
+  /* 其他 Top Node 的节点表同步 */
+  if (ethertype == TPMESH_TOP_SYNC_ETHTYPE) {
+    return BRIDGE_TOP_SYNC;
+  }
+
+  /* 以太网侧主机的 ARP: 学习发送方, 预置到 DDC */
+  if (ethertype == ETHTYPE_ARP &&
+      !node_table_is_ddc_mac((uint8_t *)&eth->src)) {
+    top_learn_arp_sender(p);
+  }
+
   /* 检查目标 MAC */
   bool is_broadcast = schc_is_broadcast_mac((uint8_t *)&eth->dest);
 
   if (is_broadcast) {
     /* 广播帧处理 */
+
+    /* 源为 DDC: 其他 Top Node 已从 Mesh 转出, 不再转回 Mesh */
+    if (node_table_is_ddc_mac((uint8_t *)&eth->src)) {
+      return BRIDGE_DROP;
+    }
+
     if (ethertype == ETHTYPE_ARP) {
       /* ARP 广播 - 检查是否需要代理应答 */
       const uint8_t *target_ip;
@@ -250,9 +486,16 @@ bridge_action_t tpmesh_bridge_check(struct pbuf *p) {
   /* 单播帧 */
   uint8_t *dst_mac = (uint8_t *)&eth->dest;
 
-  /* 检查是否发给 DDC */
-  if (node_table_is_ddc_mac(dst_mac)) {
-    return BRIDGE_TO_MESH;
+  /* 检查是否发给 DDC (注册在其他 Top Node 的由其所属 Top Node 转发) */
+  uint16_t dst_mesh_id = node_table_get_mesh_by_mac(dst_mac);
+  if (dst_mesh_id != MESH_ADDR_INVALID) {
+    if (node_table_is_remote(dst_mesh_id)) {
+      return BRIDGE_DROP;
+    }
+    if (tpmesh_tcp_proxy_match(p)) {
+      return BRIDGE_TCP_PROXY;
+    }
+    return tpmesh_icmp_proxy_match(p) ? BRIDGE_ICMP_PROXY : BRIDGE_TO_MESH;
   }
 
   /* 发给本机 */
@@ -267,34 +510,129 @@ int tpmesh_bridge_forward_to_mesh(struct pbuf *p) {
   struct eth_hdr *eth = (struct eth_hdr *)p->payload;
   bool is_broadcast = schc_is_broadcast_mac((uint8_t *)&eth->dest);
 
+  /* BACnet/IP 报文检查 (读缓存/重传去重/发现请求定向) */
+  tpmesh_bac_pkt_t bac;
+  bool is_bacnet =
+      (tpmesh_bac_parse((const uint8_t *)p->payload, p->len, &bac) == 0);
+
+  /* 确定目标 Mesh ID */
+  uint16_t dest_mesh_id = MESH_ADDR_BROADCAST;
+  if (!is_broadcast) {
+    dest_mesh_id = node_table_get_mesh_by_mac((uint8_t *)&eth->dest);
+    if (dest_mesh_id == MESH_ADDR_INVALID) {
+      tpmesh_debug_printf("TPMesh: Unknown destination MAC\n");
+      return -4;
+    }
+
+    if (is_bacnet) {
+      /* 读缓存命中: 本地应答, 不进入 Mesh */
+      if (answer_from_cache(p, &bac, dest_mesh_id)) {
+        return 0;
+      }
+
+      /* 目标 DDC 可疑/离线: 本地拒绝, 不占用信道 */
+      if (reject_suspect(p, &bac, dest_mesh_id)) {
+        return 0;
+      }
+
+      /* BMS 重传: 原请求仍在途, 应答到达后只送达一次 */
+      if (tpmesh_inflight_on_request(dest_mesh_id, &bac) == 1) {
+        return 0;
+      }
+    }
+  }
+
   /* SCHC 压缩 */
   uint8_t tunnel_buf[1600];
   uint16_t tunnel_len;
 
   if (schc_compress((uint8_t *)p->payload, p->tot_len, tunnel_buf, &tunnel_len,
                     is_broadcast) != 0) {
+    if (is_bacnet && !is_broadcast) {
+      tpmesh_inflight_cancel(dest_mesh_id, &bac);
+    }
     return -2;
   }
 
-  /* 确定目标 Mesh ID */
-  uint16_t dest_mesh_id;
   if (is_broadcast) {
+    /* 带范围的 Who-Is/Who-Has: 按设备实例号定向单播 (保留 L2 广播位) */
+    uint16_t targets[TPMESH_WHOIS_UNICAST_MAX];
+    int n = is_bacnet ? select_discovery_targets(&bac, targets) : -1;
+    if (n == 0) {
+      tpmesh_debug_printf("TPMesh: Discovery matches no DDC, dropped\n");
+      return 0;
+    }
+    if (n > 0) {
+      int ret = 0;
+      for (int i = 0; i < n; i++) {
+        if (fragment_and_send(targets[i], tunnel_buf, tunnel_len) != 0) {
+          ret = -5;
+        }
+      }
+      return ret;
+    }
+
+    /* 多 Top Node: 泛洪/组播到达整个 Mesh, 只由指定转发者发送 */
+    if (!tpmesh_top_sync_is_designated()) {
+      return 0;
+    }
+
+    /* 子网定向广播 / 指定 DNET 的广播: 只发往对应组播组 */
+    dest_mesh_id = select_broadcast_group((const uint8_t *)p->payload, p->len,
+                                          is_bacnet ? &bac : NULL);
+    if (dest_mesh_id == MESH_ADDR_INVALID) {
+      tpmesh_debug_printf("TPMesh: Group broadcast has no member, dropped\n");
+      return 0;
+    }
+
     /* 广播限速检查 */
     if (!broadcast_rate_check()) {
       tpmesh_debug_printf("TPMesh: Broadcast rate limited\n");
       return -3;
     }
-    dest_mesh_id = MESH_ADDR_BROADCAST;
-  } else {
-    dest_mesh_id = node_table_get_mesh_by_mac((uint8_t *)&eth->dest);
-    if (dest_mesh_id == MESH_ADDR_INVALID) {
-      tpmesh_debug_printf("TPMesh: Unknown destination MAC\n");
-      return -4;
-    }
   }
 
   /* 分片发送 */
-  return fragment_and_send(dest_mesh_id, tunnel_buf, tunnel_len);
+  int ret = fragment_and_send(dest_mesh_id, tunnel_buf, tunnel_len);
+  if (ret == 0) {
+    ddc_uplink_sent(dest_mesh_id);
+  }
+  if (ret != 0 && is_bacnet && !is_broadcast) {
+    /* 未送出, 允许 BMS 重传再次转发 */
+    tpmesh_inflight_cancel(dest_mesh_id, &bac);
+  }
+  return ret;
+}
+
+int tpmesh_bridge_send_tunnel(uint16_t dest_mesh_id, const uint8_t *data,
+                              uint16_t len) {
+  if (!s_initialized || s_is_top_node) {
+    return -1;
+  }
+
+  /* 注册前 Top Node 无法还原本机地址 */
+  if (s_ddc_state != DDC_STATE_ONLINE) {
+    return -2;
+  }
+
+  if (fragment_and_send(dest_mesh_id, data, len) != 0) {
+    return -3;
+  }
+  ddc_uplink_sent(dest_mesh_id);
+  return 0;
+}
+
+int tpmesh_bridge_send_frame(uint16_t dest_mesh_id, const uint8_t *frame,
+                             uint16_t len) {
+  if (!s_initialized || len > TPMESH_MTU) {
+    return -1;
+  }
+
+  if (mesh_send(dest_mesh_id, frame, len) != 0) {
+    return -3;
+  }
+  ddc_uplink_sent(dest_mesh_id);
+  return 0;
 }
 
 int tpmesh_bridge_send_proxy_arp(struct pbuf *p) {
@@ -328,6 +666,7 @@ void tpmesh_bridge_handle_mesh_data(uint16_t src_mesh_id, const uint8_t *data,
     tpmesh_debug_printf("TPMesh: Drop short mesh frame len=%u\n", len);
     return;
   }
+  tpmesh_route_account(src_mesh_id, false);
 
   /* 检查是否为注册帧 */
   if (data[2] == SCHC_RULE_REGISTER) {
@@ -336,6 +675,27 @@ void tpmesh_bridge_handle_mesh_data(uint16_t src_mesh_id, const uint8_t *data,
     return;
   }
 
+  /* TCP 代理流帧 */
+  if (data[2] == SCHC_RULE_STREAM) {
+    tpmesh_tcp_proxy_mesh_input(src_mesh_id, data + TPMESH_TUNNEL_HDR_LEN,
+                                len - TPMESH_TUNNEL_HDR_LEN);
+    return;
+  }
+
+  /* MQTT 网关报文 */
+  if (data[2] == SCHC_RULE_MQTT_SN) {
+    tpmesh_mqtt_gw_mesh_input(src_mesh_id, data + TPMESH_TUNNEL_HDR_LEN,
+                              len - TPMESH_TUNNEL_HDR_LEN);
+    return;
+  }
+
+  /* 批量传输报文 */
+  if (data[2] == SCHC_RULE_BULK) {
+    tpmesh_bulk_mesh_input(src_mesh_id, data + TPMESH_TUNNEL_HDR_LEN,
+                           len - TPMESH_TUNNEL_HDR_LEN);
+    return;
+  }
+
   /* 数据帧处理 */
   process_data_frame(src_mesh_id, data, len);
 }
@@ -374,6 +734,31 @@ void tpmesh_bridge_task(void *arg) {
     }
   }
 
+  /* 路由表: 模组就绪后开始查询 */
+  tpmesh_route_init();
+
+  /* TCP 代理、ARP 预置、授时、MQTT 网关与批量传输 (未启用时无操作; 依赖
+   * tcpip 线程, 放在任务中) */
+  if (s_is_top_node) {
+    tpmesh_tcp_proxy_init(s_eth_netif, NULL);
+    tpmesh_arp_seed_init(s_eth_netif, NULL);
+    tpmesh_icmp_proxy_init(s_eth_netif);
+    tpmesh_time_init(true);
+    tpmesh_mqtt_gw_init(true);
+    tpmesh_bulk_init(true);
+  } else {
+    tpmesh_tcp_proxy_init(NULL, &s_ddc_config.ip_addr);
+    tpmesh_arp_seed_init(NULL, &s_ddc_config.ip_addr);
+    tpmesh_time_init(false);
+    tpmesh_mqtt_gw_init(false);
+    tpmesh_bulk_init(false);
+  }
+
+  /* DDC 持有有效纪元: 直接上线, 由确认心跳代替注册 */
+  if (!s_is_top_node && s_ddc_epoch != 0) {
+    ddc_start_rejoin();
+  }
+
   tpmesh_debug_printf(
       "Bridge Task: business init complete, entering main loop\n");
 
@@ -386,11 +771,13 @@ void tpmesh_bridge_task(void *arg) {
   while (1) {
     /* 从队列获取消息 */
     if (xQueueReceive(s_mesh_msg_queue, &msg, pdMS_TO_TICKS(100)) == pdTRUE) {
+      s_msg_rx_tick = msg.rx_tick;
       tpmesh_bridge_handle_mesh_data(msg.src_mesh_id, msg.data, msg.len);
+      s_msg_rx_tick = 0;
     }
 
-    /* 节点表维护 */
-    node_table_check_timeout();
+    /* 节点存活 / 分片重组 / 在途请求 / I-Am 定时器 */
+    tpmesh_timer_poll();
   }
 }
 
@@ -400,39 +787,77 @@ void tpmesh_bridge_task(void *arg) {
  */
 
 int ddc_send_register(const ddc_config_t *config) {
-  reg_frame_t frame;
-  frame.frame_type = REG_FRAME_REGISTER;
-  memcpy(frame.mac, config->mac_addr, 6);
-  frame.ip = ip4_addr_get_u32(&config->ip_addr);
-  frame.mesh_id = config->mesh_id;
-  frame.checksum = tpmesh_calc_crc16(&frame, sizeof(frame) - 2);
+  uint8_t tlv[2 + REG_TLV_DEVICE_LEN + 4 + 10];
+  uint16_t tlv_len = 0;
+
+  /* 设备信息 TLV: Top Node 据此定向转发 Who-Is/Who-Has */
+  if (config->device_instance != NODE_DEVICE_INSTANCE_NONE) {
+    uint8_t dev[REG_TLV_DEVICE_LEN];
+    dev[0] = (uint8_t)(config->device_instance >> 24);
+    dev[1] = (uint8_t)(config->device_instance >> 16);
+    dev[2] = (uint8_t)(config->device_instance >> 8);
+    dev[3] = (uint8_t)config->device_instance;
+    dev[4] = config->caps;
+    tlv_len = reg_tlv_put(tlv, tlv_len, REG_TLV_DEVICE, dev, sizeof(dev));
+  }
 
-  /* 封装为隧道帧 */
-  uint8_t tunnel_buf[32];
-  tunnel_buf[0] = 0x00; /* L2 HDR: 单播 */
-  tunnel_buf[1] = 0x80; /* FRAG HDR: 单片 */
-  tunnel_buf[2] = SCHC_RULE_REGISTER;
-  memcpy(tunnel_buf + 3, &frame, sizeof(frame));
+  if (s_ddc_group != MESH_ADDR_INVALID) {
+    uint8_t v[2] = {(uint8_t)(s_ddc_group >> 8), (uint8_t)s_ddc_group};
+    tlv_len = reg_tlv_put(tlv, tlv_len, REG_TLV_GROUP, v, sizeof(v));
+  }
 
+  /* 时间戳: 双方据此估计 RTT */
+  tlv_len = reg_tlv_put_ts(tlv, tlv_len, ts_echo(s_peer_tsval, s_peer_ts_rx));
+  s_peer_tsval = 0;
+
+  /* 发往任意中心节点: 模组选择跳数最少的 Top Node, 由其 ACK 确定归属 */
   tpmesh_debug_printf("TPMesh DDC: Sending register to Top Node\n");
-  return tpmesh_at_send(MESH_ADDR_TOP_NODE, tunnel_buf, 3 + sizeof(frame));
+  return send_reg_frame(MESH_ADDR_TOP_ANY, REG_FRAME_REGISTER,
+                        config->mac_addr, &config->ip_addr, config->mesh_id,
+                        tlv, tlv_len);
 }
 
 int ddc_send_heartbeat(const ddc_config_t *config) {
-  reg_frame_t frame;
-  frame.frame_type = REG_FRAME_HEARTBEAT;
-  memcpy(frame.mac, config->mac_addr, 6);
-  frame.ip = ip4_addr_get_u32(&config->ip_addr);
-  frame.mesh_id = config->mesh_id;
-  frame.checksum = tpmesh_calc_crc16(&frame, sizeof(frame) - 2);
+  uint8_t tlv[4 + 6 + 2 + 10];
+  uint16_t tlv_len = 0;
+
+  /* 注册纪元: Top Node 据此确认注册仍有效 */
+  if (s_ddc_epoch != 0) {
+    uint32_t epoch = s_ddc_epoch;
+    uint8_t v[4] = {(uint8_t)(epoch >> 24), (uint8_t)(epoch >> 16),
+                    (uint8_t)(epoch >> 8), (uint8_t)epoch};
+    tlv_len = reg_tlv_put(tlv, tlv_len, REG_TLV_EPOCH, v, sizeof(v));
+  }
+
+  /* 已加入的组播组: Top Node 确认后才向该组定向广播 */
+  if (s_ddc_group != MESH_ADDR_INVALID) {
+    uint8_t v[2] = {(uint8_t)(s_ddc_group >> 8), (uint8_t)s_ddc_group};
+    tlv_len = reg_tlv_put(tlv, tlv_len, REG_TLV_GROUP, v, sizeof(v));
+  }
+
+  /* Top Node 只在请求时 (或注册失效/组播组待更新时) 应答心跳 */
+  if (ddc_ack_due()) {
+    tlv_len = reg_tlv_put(tlv, tlv_len, REG_TLV_ACK_REQ, NULL, 0);
+  }
+
+  tlv_len = reg_tlv_put_ts(tlv, tlv_len, ts_echo(s_peer_tsval, s_peer_ts_rx));
+  s_peer_tsval = 0;
+
+  return send_reg_frame(s_ddc_top, REG_FRAME_HEARTBEAT,
+                        config->mac_addr, &config->ip_addr, config->mesh_id,
+                        tlv, tlv_len);
+}
 
-  uint8_t tunnel_buf[32];
-  tunnel_buf[0] = 0x00;
-  tunnel_buf[1] = 0x80;
-  tunnel_buf[2] = SCHC_RULE_REGISTER;
-  memcpy(tunnel_buf + 3, &frame, sizeof(frame));
+void tpmesh_ddc_set_device(uint32_t device_instance, uint8_t caps) {
+  s_ddc_config.device_instance = device_instance;
+  s_ddc_config.caps = caps;
+}
 
-  return tpmesh_at_send(MESH_ADDR_TOP_NODE, tunnel_buf, 3 + sizeof(frame));
+void tpmesh_ddc_set_iam_params(uint16_t max_apdu, uint8_t segmentation,
+                               uint16_t vendor_id) {
+  s_ddc_config.max_apdu = max_apdu;
+  s_ddc_config.segmentation = segmentation;
+  s_ddc_config.vendor_id = vendor_id;
 }
 
 void ddc_heartbeat_task(void *arg) {
@@ -448,12 +873,15 @@ void ddc_heartbeat_task(void *arg) {
       break;
 
     case DDC_STATE_REGISTERING:
-      /* 注册重试 */
-      if (s_last_register_tick == 0 ||
-          (now - s_last_register_tick > TPMESH_REGISTER_RETRY_MS)) {
+      /* 注册重试: 指数退避 + 抖动, Top Node 忙时按其指定时间 */
+      if ((int32_t)(now - s_next_register_tick) >= 0) {
         if (s_register_retry_count < TPMESH_REGISTER_MAX_RETRIES) {
           ddc_send_register(&s_ddc_config);
-          s_last_register_tick = now;
+          s_next_register_tick =
+              now + tpmesh_backoff_delay(s_register_retry_count,
+                                         ddc_retry_base(),
+                                         TPMESH_REGISTER_BACKOFF_MAX_MS,
+                                         LWIP_RAND());
           s_register_retry_count++;
         } else {
           tpmesh_debug_printf("TPMesh DDC: Register timeout, reset module\n");
@@ -465,10 +893,30 @@ void ddc_heartbeat_task(void *arg) {
       break;
 
     case DDC_STATE_ONLINE:
-      /* 心跳 */
-      if (now - s_last_heartbeat_tick > TPMESH_HEARTBEAT_MS) {
-        ddc_send_heartbeat(&s_ddc_config);
-        s_last_heartbeat_tick = now;
+      if (s_rejoin_pending) {
+        /* 快速重新上线: 发送确认心跳, 未获确认则回退为完整注册 */
+        if ((int32_t)(now - s_next_register_tick) >= 0) {
+          if (s_rejoin_tries < TPMESH_REJOIN_MAX_TRIES) {
+            ddc_send_heartbeat(&s_ddc_config);
+            s_next_register_tick = now + ddc_retry_base();
+            s_rejoin_tries++;
+          } else {
+            ddc_restart_register("rejoin not confirmed");
+          }
+        }
+        break;
+      }
+
+      /* 心跳时隙: 前半个间隔内已有上行数据帧 (Top Node 已据此刷新活跃
+       * 时间) 则省略, 需要 ACK 时照常发送。两次存活证明最多相隔 1.5 个间隔 */
+      if ((int32_t)(now - s_next_heartbeat_tick) >= 0) {
+        if (ddc_ack_due() ||
+            now - s_last_uplink_tick > TPMESH_HEARTBEAT_MS / 2) {
+          ddc_send_heartbeat(&s_ddc_config);
+        }
+        do {
+          s_next_heartbeat_tick += TPMESH_HEARTBEAT_MS;
+        } while ((int32_t)(now - s_next_heartbeat_tick) >= 0);
       }
       break;
     }
@@ -532,6 +980,10 @@ bool tpmesh_is_broadcast_mac(const uint8_t *mac) {
   return schc_is_broadcast_mac(mac);
 }
 
+uint16_t tpmesh_ddc_top_node(void) { return s_ddc_top; }
+
+uint32_t tpmesh_ddc_epoch(void) { return s_ddc_epoch; }
+
 void tpmesh_get_local_mac(uint8_t *mac) {
   if (s_is_top_node) {
     memcpy(mac, s_top_config.mac_addr, 6);
@@ -555,6 +1007,7 @@ static void mesh_data_callback(uint16_t src_mesh_id, const uint8_t *data,
   if (s_mesh_msg_queue) {
     mesh_msg_t msg;
     msg.src_mesh_id = src_mesh_id;
+    msg.rx_tick = tpmesh_get_tick_ms();
     msg.len = (len > TPMESH_MTU) ? TPMESH_MTU : len;
     memcpy(msg.data, data, msg.len);
     if (xQueueSend(s_mesh_msg_queue, &msg, 0) != pdTRUE) {
@@ -573,14 +1026,27 @@ static void route_event_callback(const char *event, uint16_t addr) {
   while (*ev == ' ') ev++;
 
   tpmesh_debug_printf("TPMesh Route: %s 0x%04X\n", ev, addr);
+  tpmesh_route_on_event(ev, addr);
 
   if (!s_is_top_node && strncmp(ev, "CREATE", 6) == 0 &&
-      addr == MESH_ADDR_TOP_NODE) {
+      MESH_ADDR_IS_TOP(addr)) {
+    /* 多 Top Node: 到其他 Top Node 的路由不影响当前注册 */
+    if (s_ddc_state == DDC_STATE_ONLINE && addr != s_ddc_top) {
+      return;
+    }
+    if (s_ddc_state == DDC_STATE_ONLINE && s_ddc_epoch != 0) {
+      /* 已持有注册纪元: 路由 (重新) 建立后发送确认心跳即可 */
+      ddc_start_rejoin();
+      return;
+    }
     /* DDC 发现 Top Node,开始注册 */
     tpmesh_debug_printf("TPMesh DDC: Top Node discovered, start registering\n");
-    s_ddc_state = DDC_STATE_REGISTERING;
-    s_register_retry_count = 0;
-    s_last_register_tick = 0;
+    ddc_enter_registering();
+  }
+  /* DDC: 到对端 DDC 的路由失效, 丢弃其映射, 之后经 Top Node 重新解析 */
+  if (!s_is_top_node && strncmp(ev, "DELETE", 6) == 0 &&
+      !MESH_ADDR_IS_TOP(addr) && addr != s_ddc_config.mesh_id) {
+    node_table_remove(addr);
   }
 }
 
@@ -593,10 +1059,12 @@ static int fragment_and_send(uint16_t dest_mesh_id, const uint8_t *data,
                              uint16_t len) {
   if (len <= TPMESH_MTU) {
     /* 无需分片 */
-    return tpmesh_at_send(dest_mesh_id, data, len);
+    return mesh_send(dest_mesh_id, data, len);
   }
 
-  /* 分片发送 */
+  /* 分片发送: 长路径上相邻分片在中继处互相干扰, 拉开间隔 */
+  bool pace = TPMESH_ROUTE_PACE_HOPS > 0 &&
+              tpmesh_route_hops(dest_mesh_id) > TPMESH_ROUTE_PACE_HOPS;
   uint8_t seq = 0;
   uint16_t offset = 0;
 
@@ -626,7 +1094,10 @@ static int fragment_and_send(uint16_t dest_mesh_id, const uint8_t *data,
       chunk_len += 1;
     }
 
-    if (tpmesh_at_send(dest_mesh_id, packet, chunk_len) != 0) {
+    if (pace && seq > 0) {
+      vTaskDelay(pdMS_TO_TICKS(TPMESH_FRAG_DELAY_MS));
+    }
+    if (mesh_send(dest_mesh_id, packet, chunk_len) != 0) {
       return -1;
     }
 
@@ -641,6 +1112,14 @@ static int fragment_and_send(uint16_t dest_mesh_id, const uint8_t *data,
   return 0;
 }
 
+/**
+ * @brief 发送一个 Mesh 帧并按目的节点计数
+ */
+static int mesh_send(uint16_t dest_mesh_id, const uint8_t *data, uint16_t len) {
+  tpmesh_route_account(dest_mesh_id, true);
+  return tpmesh_at_send(dest_mesh_id, data, len);
+}
+
 /* ============================================================================
  * 私有函数 - 分片重组
  * ============================================================================
@@ -699,28 +1178,24 @@ static int reassemble_packet(uint16_t src_mesh_id, const uint8_t *data,
     session->src_mesh_id = src_mesh_id;
     session->total_len = 0;
     session->expected_seq = 0;
-    session->last_tick = tpmesh_get_tick_ms();
+  } else if (!session->active || session->src_mesh_id != src_mesh_id) {
+    /* 会话已超时关闭, 或不属于该源 */
+    return -3;
   }
 
   /* 序号检查 */
   if (seq != session->expected_seq) {
     tpmesh_debug_printf("TPMesh: Fragment seq mismatch (got %d, expect %d)\n",
                         seq, session->expected_seq);
-    session->active = false;
+    reassembly_close(session);
     return -2;
   }
 
-  /* 超时检查 */
-  if (tpmesh_get_tick_ms() - session->last_tick > 5000) {
-    session->active = false;
-    return -3;
-  }
-
   /* 复制数据 */
   if (seq == 0) {
     /* 第一片: 完整数据 */
     if (session->total_len + len > sizeof(session->buffer)) {
-      session->active = false;
+      reassembly_close(session);
       return -4;
     }
     memcpy(session->buffer + session->total_len, data, len);
@@ -728,7 +1203,7 @@ static int reassemble_packet(uint16_t src_mesh_id, const uint8_t *data,
   } else {
     /* 后续片: 跳过 FRAG_HDR */
     if (session->total_len + len - 1 > sizeof(session->buffer)) {
-      session->active = false;
+      reassembly_close(session);
       return -4;
     }
     memcpy(session->buffer + session->total_len, data + 1, len - 1);
@@ -742,13 +1217,45 @@ static int reassemble_packet(uint16_t src_mesh_id, const uint8_t *data,
     /* 重组完成 */
     *out_data = session->buffer;
     *out_len = session->total_len;
-    session->active = false;
+    reassembly_close(session);
     return 1; /* 完成 */
   }
 
+  /* 每收到一片重新计时, 间隔按到该源的 RTT 估计 */
+  tpmesh_timer_start(&session->timer,
+                     tpmesh_rtt_timeout(src_mesh_id, 2,
+                                        TPMESH_REASSEMBLY_TIMEOUT_MS,
+                                        TPMESH_REASSEMBLY_MIN_MS,
+                                        TPMESH_REASSEMBLY_MAX_MS));
   return 0; /* 继续等待 */
 }
 
+/**
+ * @brief 重组超时: 关闭会话, 后续分片 (seq != 0) 丢弃
+ */
+static void reassembly_expired(tpmesh_timer_t *timer, void *arg) {
+  reassembly_session_t *session = (reassembly_session_t *)arg;
+  (void)timer;
+
+  if (session->active) {
+    tpmesh_debug_printf("TPMesh: Reassembly timeout src=0x%04X\n",
+                        session->src_mesh_id);
+    session->active = false;
+  }
+}
+
+static void reassembly_setup(reassembly_session_t *sessions, int count) {
+  memset(sessions, 0, sizeof(*sessions) * count);
+  for (int i = 0; i < count; i++) {
+    tpmesh_timer_setup(&sessions[i].timer, reassembly_expired, &sessions[i]);
+  }
+}
+
+static void reassembly_close(reassembly_session_t *session) {
+  session->active = false;
+  tpmesh_timer_stop(&session->timer);
+}
+
 /* ============================================================================
  * 私有函数 - 注册帧处理
  * ============================================================================
@@ -778,6 +1285,31 @@ static void process_register_frame(uint16_t src_mesh_id, const uint8_t *data,
       ip4_addr_set_u32(&ip, frame->ip);
 
       if (frame->frame_type == REG_FRAME_REGISTER) {
+        /* 准入控制: 消息队列接近溢出时让 DDC 等积压处理完再注册 */
+        uint32_t retry_after = tpmesh_admit_check(
+            (uint16_t)uxQueueMessagesWaiting(s_mesh_msg_queue));
+        if (retry_after != 0) {
+          uint8_t tlv[4];
+          uint8_t v[2] = {(uint8_t)(retry_after >> 8), (uint8_t)retry_after};
+          uint16_t tlv_len =
+              reg_tlv_put(tlv, 0, REG_TLV_RETRY_AFTER, v, sizeof(v));
+          send_reg_frame(src_mesh_id, REG_FRAME_REGISTER_BUSY,
+                         s_top_config.mac_addr, &s_top_config.ip_addr,
+                         s_top_config.mesh_id, tlv, tlv_len);
+          tpmesh_debug_printf("TPMesh Top: DDC 0x%04X register deferred %lu ms\n",
+                              src_mesh_id, (unsigned long)retry_after);
+          break;
+        }
+
+        /* 地址变更 (IP 改到其他 Mesh ID 或本 Mesh ID 换了 IP) 时
+         * 须通知已缓存旧映射的 DDC */
+        ip4_addr_t old_ip;
+        uint16_t old_mesh = node_table_get_mesh_by_ip(&ip);
+        bool remapped =
+            (old_mesh != MESH_ADDR_INVALID && old_mesh != src_mesh_id) ||
+            (node_table_get_ip_by_mesh(src_mesh_id, &old_ip) == 0 &&
+             !ip4_addr_cmp(&old_ip, &ip));
+
         /* 注册: 添加到节点表 */
         if (node_table_register(frame->mac, &ip, src_mesh_id) != 0) {
           tpmesh_debug_printf("TPMesh Top: register table update failed src=0x%04X\n",
@@ -785,47 +1317,115 @@ static void process_register_frame(uint16_t src_mesh_id, const uint8_t *data,
           break;
         }
 
+        if (remapped) {
+          top_peer_changed(src_mesh_id, &ip);
+        }
+
+        /* DDC 重新注册 (可能已重启), 旧的属性缓存不再可信 */
+        tpmesh_rp_cache_invalidate_node(src_mesh_id);
+
+        /* 时间戳: 回显本机上次 ACK 的样本, 并在 ACK 中回显 DDC 的 */
+        uint32_t tsval = 0, tsecr = 0;
+        if (reg_tlv_get_ts(data + sizeof(reg_frame_t),
+                           len - sizeof(reg_frame_t), &tsval, &tsecr) &&
+            tsecr != 0) {
+          tpmesh_rtt_sample(src_mesh_id, tpmesh_get_tick_ms() - tsecr);
+        }
+
+        /* 设备信息 TLV (旧版本 DDC 不携带, 保持未知实例) */
+        uint8_t dev_len;
+        const uint8_t *dev =
+            reg_tlv_find(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t),
+                         REG_TLV_DEVICE, &dev_len);
+        if (dev && dev_len >= REG_TLV_DEVICE_LEN) {
+          uint32_t instance = ((uint32_t)dev[0] << 24) |
+                              ((uint32_t)dev[1] << 16) |
+                              ((uint32_t)dev[2] << 8) | dev[3];
+          node_table_set_device(src_mesh_id, instance, dev[4]);
+        }
+
+        /* 已加入的组播组 (模组重启后需重新加入) */
+        node_table_set_group(src_mesh_id,
+                             reg_tlv_get_group(data + sizeof(reg_frame_t),
+                                               len - sizeof(reg_frame_t)));
+
         /* 发送 GARP */
         send_garp(frame->mac, &ip);
 
-        /* 发送 ACK */
-        reg_frame_t ack;
-        ack.frame_type = REG_FRAME_REGISTER_ACK;
-        memcpy(ack.mac, s_top_config.mac_addr, 6);
-        ack.ip = ip4_addr_get_u32(&s_top_config.ip_addr);
-        ack.mesh_id = s_top_config.mesh_id;
-        ack.checksum = tpmesh_calc_crc16(&ack, sizeof(ack) - 2);
-
-        uint8_t buf[32];
-        buf[0] = 0x00;
-        buf[1] = 0x80;
-        buf[2] = SCHC_RULE_REGISTER;
-        memcpy(buf + 3, &ack, sizeof(ack));
-        if (tpmesh_at_send(src_mesh_id, buf, 3 + sizeof(ack)) != 0) {
+        /* 发送 ACK (附以太网侧 ARP 预置表与时间信标) */
+        uint8_t tlv[REG_ACK_TLV_LEN];
+        uint16_t tlv_len =
+            top_build_ack_tlv(tlv, src_mesh_id, &ip, s_top_epoch,
+                              ts_echo(tsval, s_msg_rx_tick));
+        tlv_len = tpmesh_arp_seed_put_tlv(tlv, tlv_len);
+        tlv_len = tpmesh_time_put_tlv(tlv, tlv_len);
+        if (send_reg_frame(src_mesh_id, REG_FRAME_REGISTER_ACK,
+                           s_top_config.mac_addr, &s_top_config.ip_addr,
+                           s_top_config.mesh_id, tlv, tlv_len) != 0) {
           tpmesh_debug_printf("TPMesh Top: register ACK send failed dst=0x%04X\n",
                               src_mesh_id);
           break;
         }
 
+        /* 其他 Top Node 立即停止代理该 DDC */
+        tpmesh_top_sync_announce(src_mesh_id);
+
         tpmesh_debug_printf("TPMesh Top: DDC 0x%04X registered\n", src_mesh_id);
       } else {
-        /* 心跳: 更新活跃时间 */
-        node_table_touch(src_mesh_id);
+        /* 心跳: 节点须在表中且地址一致, 携带纪元时须与本机纪元一致;
+         * 否则 ACK 纪元为 0, DDC 重新注册 */
+        uint32_t epoch = reg_tlv_get_epoch(data + sizeof(reg_frame_t),
+                                           len - sizeof(reg_frame_t));
+        bool valid = node_table_get_mesh_by_mac(frame->mac) == src_mesh_id &&
+                     node_table_get_mesh_by_ip(&ip) == src_mesh_id &&
+                     !node_table_is_remote(src_mesh_id) &&
+                     (epoch == 0 || epoch == s_top_epoch);
+
+        uint32_t tsval = 0, tsecr = 0;
+        reg_tlv_get_ts(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t),
+                       &tsval, &tsecr);
+
+        if (valid) {
+          /* 更新活跃时间及已加入的组播组 */
+          node_table_touch(src_mesh_id);
+          if (tsecr != 0) {
+            tpmesh_rtt_sample(src_mesh_id, tpmesh_get_tick_ms() - tsecr);
+          }
+          node_table_set_group(src_mesh_id,
+                               reg_tlv_get_group(data + sizeof(reg_frame_t),
+                                                 len - sizeof(reg_frame_t)));
+        } else {
+          tpmesh_debug_printf("TPMesh Top: DDC 0x%04X not registered, "
+                              "request re-register\n",
+                              src_mesh_id);
+        }
+
+        /* 仅在 DDC 请求、注册失效、组播组待更新或旧版本 DDC (不带纪元)
+         * 时应答, 其余心跳只刷新活跃时间 */
+        const uint8_t *hb_tlv = data + sizeof(reg_frame_t);
+        uint16_t hb_tlv_len = len - sizeof(reg_frame_t);
+        uint8_t vlen;
+        bool ack =
+            !valid ||
+            reg_tlv_find(hb_tlv, hb_tlv_len, REG_TLV_ACK_REQ, &vlen) != NULL ||
+            reg_tlv_find(hb_tlv, hb_tlv_len, REG_TLV_EPOCH, &vlen) == NULL;
+        if (!ack && s_group_count > 0) {
+          const mesh_group_t *g = group_by_ip(&ip);
+          ack = (g ? g->group_addr : MESH_ADDR_INVALID) !=
+                reg_tlv_get_group(hb_tlv, hb_tlv_len);
+        }
+        if (!ack) {
+          break;
+        }
 
         /* 发送 ACK */
-        reg_frame_t ack;
-        ack.frame_type = REG_FRAME_HEARTBEAT_ACK;
-        memcpy(ack.mac, s_top_config.mac_addr, 6);
-        ack.ip = ip4_addr_get_u32(&s_top_config.ip_addr);
-        ack.mesh_id = s_top_config.mesh_id;
-        ack.checksum = tpmesh_calc_crc16(&ack, sizeof(ack) - 2);
-
-        uint8_t buf[32];
-        buf[0] = 0x00;
-        buf[1] = 0x80;
-        buf[2] = SCHC_RULE_REGISTER;
-        memcpy(buf + 3, &ack, sizeof(ack));
-        if (tpmesh_at_send(src_mesh_id, buf, 3 + sizeof(ack)) != 0) {
+        uint8_t tlv[32];
+        uint16_t tlv_len =
+            top_build_ack_tlv(tlv, src_mesh_id, &ip, valid ? s_top_epoch : 0,
+                              ts_echo(tsval, s_msg_rx_tick));
+        if (send_reg_frame(src_mesh_id, REG_FRAME_HEARTBEAT_ACK,
+                           s_top_config.mac_addr, &s_top_config.ip_addr,
+                           s_top_config.mesh_id, tlv, tlv_len) != 0) {
           tpmesh_debug_printf("TPMesh Top: heartbeat ACK send failed dst=0x%04X\n",
                               src_mesh_id);
         }
@@ -839,22 +1439,105 @@ static void process_register_frame(uint16_t src_mesh_id, const uint8_t *data,
     /* DDC 处理 ACK */
     switch (frame->frame_type) {
     case REG_FRAME_REGISTER_ACK:
-      if (src_mesh_id != MESH_ADDR_TOP_NODE) {
+      if (!MESH_ADDR_IS_TOP(src_mesh_id)) {
         tpmesh_debug_printf("TPMesh DDC: Ignore register ACK from 0x%04X\n",
                             src_mesh_id);
         break;
       }
-      tpmesh_debug_printf("TPMesh DDC: Register ACK received\n");
+      /* 注册发往任意中心节点, 应答的 Top Node 即所属 Top Node */
+      tpmesh_debug_printf("TPMesh DDC: Register ACK received from 0x%04X\n",
+                          src_mesh_id);
+      s_ddc_top = src_mesh_id;
+      s_last_ack_tick = tpmesh_get_tick_ms();
+      s_next_heartbeat_tick = s_last_ack_tick + TPMESH_HEARTBEAT_MS;
+      ddc_apply_ack_tlv(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t));
+      ddc_apply_arp_map(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t));
+      ddc_apply_time(src_mesh_id, data + sizeof(reg_frame_t),
+                     len - sizeof(reg_frame_t));
+      ddc_save_epoch(reg_tlv_get_epoch(data + sizeof(reg_frame_t),
+                                       len - sizeof(reg_frame_t)));
+      s_rejoin_pending = false;
       s_ddc_state = DDC_STATE_ONLINE;
-      s_last_heartbeat_tick = tpmesh_get_tick_ms();
+      break;
+
+    case REG_FRAME_REGISTER_BUSY: {
+      if (!MESH_ADDR_IS_TOP(src_mesh_id) ||
+          s_ddc_state != DDC_STATE_REGISTERING) {
+        break;
+      }
+      /* Top Node 在线但忙: 本次不计入重试次数, 至少等待建议时间 (加抖动) */
+      uint8_t vlen;
+      const uint8_t *v =
+          reg_tlv_find(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t),
+                       REG_TLV_RETRY_AFTER, &vlen);
+      uint32_t wait = (v && vlen >= 2) ? (((uint32_t)v[0] << 8) | v[1])
+                                       : TPMESH_REGISTER_RETRY_MS;
+      if (s_register_retry_count > 0) {
+        s_register_retry_count--;
+      }
+      wait += LWIP_RAND() % (wait + 1);
+      uint32_t backoff = tpmesh_backoff_delay(
+          s_register_retry_count, ddc_retry_base(),
+          TPMESH_REGISTER_BACKOFF_MAX_MS, LWIP_RAND());
+      if (backoff > wait) {
+        wait = backoff;
+      }
+      s_next_register_tick = tpmesh_get_tick_ms() + wait;
+      tpmesh_debug_printf("TPMesh DDC: Top Node busy, retry in %lu ms\n",
+                          (unsigned long)wait);
+      break;
+    }
+
+    case REG_FRAME_PEER_MAP:
+      /* 多 Top Node: 对端可能由其他 Top Node 介绍 */
+      if (!MESH_ADDR_IS_TOP(src_mesh_id)) {
+        break;
+      }
+      ddc_apply_peer_map(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t));
+      break;
+
+    case REG_FRAME_ARP_MAP:
+      /* 同一以太网段, 接受任一 Top Node 的广播 */
+      if (!MESH_ADDR_IS_TOP(src_mesh_id)) {
+        break;
+      }
+      ddc_apply_arp_map(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t));
+      break;
+
+    case REG_FRAME_TIME:
+      /* 各 Top Node 均经以太网 NTP 校准, 接受任一 Top Node 的信标 */
+      if (!MESH_ADDR_IS_TOP(src_mesh_id)) {
+        break;
+      }
+      ddc_apply_time(src_mesh_id, data + sizeof(reg_frame_t),
+                     len - sizeof(reg_frame_t));
       break;
 
     case REG_FRAME_HEARTBEAT_ACK:
-      if (src_mesh_id != MESH_ADDR_TOP_NODE) {
+      if (src_mesh_id != s_ddc_top) {
         tpmesh_debug_printf("TPMesh DDC: Ignore heartbeat ACK from 0x%04X\n",
                             src_mesh_id);
+        break;
       }
-      /* 心跳确认,无需特殊处理 */
+      /* Top Node 不再认可本节点 (重启丢失节点表或纪元已变) */
+      {
+        uint8_t vlen;
+        if (reg_tlv_find(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t),
+                         REG_TLV_EPOCH, &vlen) != NULL &&
+            reg_tlv_get_epoch(data + sizeof(reg_frame_t),
+                              len - sizeof(reg_frame_t)) != s_ddc_epoch) {
+          ddc_restart_register("registration lost on Top Node");
+          break;
+        }
+      }
+      if (s_rejoin_pending) {
+        tpmesh_debug_printf("TPMesh DDC: Rejoin confirmed\n");
+        s_rejoin_pending = false;
+      }
+      s_last_ack_tick = tpmesh_get_tick_ms();
+
+      /* 心跳确认: 更新网络规模/组播组/心跳时隙 */
+      ddc_apply_ack_tlv(data + sizeof(reg_frame_t), len - sizeof(reg_frame_t));
       break;
 
     default:
@@ -863,28 +1546,697 @@ static void process_register_frame(uint16_t src_mesh_id, const uint8_t *data,
   }
 }
 
-/* ============================================================================
- * 私有函数 - 数据帧处理
- * ============================================================================
+/**
+ * @brief 构建并发送注册类帧 (reg_frame_t + 可选 TLV)
+ * @return 0=成功, <0=失败
  */
+static int send_reg_frame(uint16_t dest_mesh_id, uint8_t frame_type,
+                          const uint8_t *mac, const ip4_addr_t *ip,
+                          uint16_t mesh_id, const uint8_t *tlv,
+                          uint16_t tlv_len) {
+  uint8_t buf[REG_FRAME_BUF_LEN];
 
-static void process_data_frame(uint16_t src_mesh_id, const uint8_t *data,
-                               uint16_t len) {
-  /* 分片重组 */
-  uint8_t *complete_data;
-  uint16_t complete_len;
-
-  int ret =
-      reassemble_packet(src_mesh_id, data, len, &complete_data, &complete_len);
-  if (ret != 1) {
-    return; /* 未完成 */
+  if (TPMESH_TUNNEL_HDR_LEN + sizeof(reg_frame_t) + tlv_len > sizeof(buf)) {
+    return -1;
   }
 
-  /* 更新节点活跃时间 */
-  node_table_touch(src_mesh_id);
+  reg_frame_t frame;
+  frame.frame_type = frame_type;
+  memcpy(frame.mac, mac, 6);
+  frame.ip = ip4_addr_get_u32(ip);
+  frame.mesh_id = mesh_id;
+  frame.checksum = tpmesh_calc_crc16(&frame, sizeof(frame) - 2);
 
-  /* SCHC 解压 */
-  uint8_t eth_frame[1600];
+  /* 封装为隧道帧 */
+  buf[0] = 0x00; /* L2 HDR: 单播 */
+  buf[1] = 0x80; /* FRAG HDR: 单片 */
+  buf[2] = SCHC_RULE_REGISTER;
+  memcpy(buf + TPMESH_TUNNEL_HDR_LEN, &frame, sizeof(frame));
+  if (tlv_len > 0) {
+    memcpy(buf + TPMESH_TUNNEL_HDR_LEN + sizeof(frame), tlv, tlv_len);
+  }
+
+  return mesh_send(dest_mesh_id, buf,
+                   TPMESH_TUNNEL_HDR_LEN + sizeof(frame) + tlv_len);
+}
+
+/**
+ * @brief 追加一个 TLV
+ * @return 追加后的 TLV 总长度
+ */
+static uint16_t reg_tlv_put(uint8_t *tlv, uint16_t off, uint8_t type,
+                            const uint8_t *value, uint8_t len) {
+  tlv[off] = type;
+  tlv[off + 1] = len;
+  if (len > 0) {
+    memcpy(tlv + off + 2, value, len);
+  }
+  return off + 2 + len;
+}
+
+/**
+ * @brief 查找 TLV
+ * @param tlv TLV 区起始 (reg_frame_t 之后)
+ * @param len TLV 区长度
+ * @param type TLV 类型
+ * @param value_len [out] 值长度
+ * @return 值指针, 未找到或格式错误返回 NULL
+ */
+static const uint8_t *reg_tlv_find(const uint8_t *tlv, uint16_t len,
+                                   uint8_t type, uint8_t *value_len) {
+  uint16_t off = 0;
+
+  while (off + 2 <= len) {
+    uint8_t t = tlv[off];
+    uint8_t l = tlv[off + 1];
+    if (off + 2 + l > len) {
+      return NULL;
+    }
+    if (t == type) {
+      *value_len = l;
+      return tlv + off + 2;
+    }
+    off += 2 + l;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Top Node: 构建注册/心跳 ACK 的 TLV (网络规模, 组播组分配)
+ * @return TLV 长度
+ */
+static uint16_t top_build_ack_tlv(uint8_t *tlv, uint16_t mesh_id,
+                                  const ip4_addr_t *ddc_ip, uint32_t epoch,
+                                  uint32_t tsecr) {
+  uint16_t nodes = node_table_count();
+  uint8_t v[2] = {(uint8_t)(nodes >> 8), (uint8_t)nodes};
+  uint16_t off = reg_tlv_put(tlv, 0, REG_TLV_NET_SIZE, v, sizeof(v));
+
+  if (s_group_count > 0) {
+    const mesh_group_t *g = group_by_ip(ddc_ip);
+    uint16_t group = g ? g->group_addr : MESH_ADDR_INVALID;
+    v[0] = (uint8_t)(group >> 8);
+    v[1] = (uint8_t)group;
+    off = reg_tlv_put(tlv, off, REG_TLV_GROUP, v, sizeof(v));
+  }
+
+  uint8_t e[4] = {(uint8_t)(epoch >> 24), (uint8_t)(epoch >> 16),
+                  (uint8_t)(epoch >> 8), (uint8_t)epoch};
+  off = reg_tlv_put(tlv, off, REG_TLV_EPOCH, e, sizeof(e));
+
+  uint16_t delay = top_hb_slot_delay(mesh_id);
+  v[0] = (uint8_t)(delay >> 8);
+  v[1] = (uint8_t)delay;
+  off = reg_tlv_put(tlv, off, REG_TLV_HB_SLOT, v, sizeof(v));
+
+  return reg_tlv_put_ts(tlv, off, tsecr);
+}
+
+/**
+ * @brief 追加 REG_TLV_TIMESTAMP (TSval 为本机当前时间)
+ * @param tsecr 回显值, 0=无
+ */
+static uint16_t reg_tlv_put_ts(uint8_t *tlv, uint16_t off, uint32_t tsecr) {
+  uint32_t now = tpmesh_get_tick_ms();
+  uint8_t v[8] = {(uint8_t)(now >> 24),   (uint8_t)(now >> 16),
+                  (uint8_t)(now >> 8),    (uint8_t)now,
+                  (uint8_t)(tsecr >> 24), (uint8_t)(tsecr >> 16),
+                  (uint8_t)(tsecr >> 8),  (uint8_t)tsecr};
+  return reg_tlv_put(tlv, off, REG_TLV_TIMESTAMP, v, sizeof(v));
+}
+
+/**
+ * @brief 读取 REG_TLV_TIMESTAMP
+ * @return true=携带
+ */
+static bool reg_tlv_get_ts(const uint8_t *tlv, uint16_t len, uint32_t *tsval,
+                           uint32_t *tsecr) {
+  uint8_t vlen;
+  const uint8_t *v = reg_tlv_find(tlv, len, REG_TLV_TIMESTAMP, &vlen);
+
+  if (v == NULL || vlen < 8) {
+    return false;
+  }
+  *tsval = ((uint32_t)v[0] << 24) | ((uint32_t)v[1] << 16) |
+           ((uint32_t)v[2] << 8) | v[3];
+  *tsecr = ((uint32_t)v[4] << 24) | ((uint32_t)v[5] << 16) |
+           ((uint32_t)v[6] << 8) | v[7];
+  return true;
+}
+
+/**
+ * @brief 计算回显值: 对端 TSval 加上本端持有时间, 对端据此得到
+ *        不含持有时间的 RTT
+ * @param peer_tsval 对端时间戳, 0=无
+ * @param rx_tick 收到该时间戳的本机时间, 0=未知 (按当前时间)
+ * @return 回显值, 0=无
+ */
+static uint32_t ts_echo(uint32_t peer_tsval, uint32_t rx_tick) {
+  if (peer_tsval == 0) {
+    return 0;
+  }
+
+  uint32_t now = tpmesh_get_tick_ms();
+  uint32_t echo = peer_tsval + (rx_tick != 0 ? now - rx_tick : 0);
+  return (echo != 0) ? echo : 1;
+}
+
+/** 心跳时隙排序: 统计 Mesh ID 小于目标的节点数 */
+typedef struct {
+  uint16_t mesh_id;
+  uint16_t rank;
+} hb_rank_ctx_t;
+
+static bool hb_rank_cb(const node_entry_t *entry, void *arg) {
+  hb_rank_ctx_t *ctx = (hb_rank_ctx_t *)arg;
+  if (entry->mesh_id < ctx->mesh_id) {
+    ctx->rank++;
+  }
+  return true;
+}
+
+/**
+ * @brief Top Node: 计算 DDC 距下一个心跳时隙的时间
+ *
+ * 按 Mesh ID 排序后的序号把节点均匀分布在心跳间隔内, 时隙以 Top Node
+ * 时钟为基准, 各 DDC 收到 ACK 后按该延时对齐。
+ *
+ * @return 延时 (ms), 小于 TPMESH_HEARTBEAT_MS
+ */
+static uint16_t top_hb_slot_delay(uint16_t mesh_id) {
+  hb_rank_ctx_t ctx = {mesh_id, 0};
+  uint16_t nodes = node_table_count();
+
+  node_table_foreach(hb_rank_cb, &ctx);
+  if (nodes == 0 || ctx.rank >= nodes) {
+    nodes = ctx.rank + 1;
+  }
+
+  uint32_t slot = (uint32_t)ctx.rank * TPMESH_HEARTBEAT_MS / nodes;
+  uint32_t phase = tpmesh_get_tick_ms() % TPMESH_HEARTBEAT_MS;
+  return (uint16_t)((slot + TPMESH_HEARTBEAT_MS - phase) % TPMESH_HEARTBEAT_MS);
+}
+
+/**
+ * @brief 读取 REG_TLV_EPOCH
+ * @return 纪元, 未携带返回 0
+ */
+static uint32_t reg_tlv_get_epoch(const uint8_t *tlv, uint16_t len) {
+  uint8_t vlen;
+  const uint8_t *v = reg_tlv_find(tlv, len, REG_TLV_EPOCH, &vlen);
+
+  if (v == NULL || vlen < 4) {
+    return 0;
+  }
+  return ((uint32_t)v[0] << 24) | ((uint32_t)v[1] << 16) |
+         ((uint32_t)v[2] << 8) | v[3];
+}
+
+/**
+ * @brief 读取 REG_TLV_GROUP
+ * @return 组播地址, 未携带返回 MESH_ADDR_INVALID
+ */
+static uint16_t reg_tlv_get_group(const uint8_t *tlv, uint16_t len) {
+  uint8_t vlen;
+  const uint8_t *v = reg_tlv_find(tlv, len, REG_TLV_GROUP, &vlen);
+
+  if (v == NULL || vlen < 2) {
+    return MESH_ADDR_INVALID;
+  }
+  return ((uint16_t)v[0] << 8) | v[1];
+}
+
+/**
+ * @brief DDC: 处理 ACK 携带的 TLV
+ */
+static void ddc_apply_ack_tlv(const uint8_t *tlv, uint16_t len) {
+  uint8_t vlen;
+  const uint8_t *v = reg_tlv_find(tlv, len, REG_TLV_NET_SIZE, &vlen);
+
+  /* 时间戳: 回显的是本机发出的时间, 得到 RTT 样本; 保存 Top Node 的
+   * 时间戳, 在下一个注册/心跳中回显 */
+  uint32_t tsval, tsecr;
+  if (reg_tlv_get_ts(tlv, len, &tsval, &tsecr)) {
+    uint32_t now = tpmesh_get_tick_ms();
+    if (tsecr != 0) {
+      tpmesh_rtt_sample(s_ddc_top, now - tsecr);
+    }
+    s_peer_tsval = tsval;
+    s_peer_ts_rx = (s_msg_rx_tick != 0) ? s_msg_rx_tick : now;
+  }
+
+  if (v && vlen >= 2) {
+    uint16_t nodes = ((uint16_t)v[0] << 8) | v[1];
+    s_net_size = (nodes > 0) ? nodes : 1;
+  }
+
+  /* 心跳时隙: 按 Top Node 分配的延时重新对齐 */
+  v = reg_tlv_find(tlv, len, REG_TLV_HB_SLOT, &vlen);
+  if (v && vlen >= 2) {
+    s_next_heartbeat_tick =
+        tpmesh_get_tick_ms() + (((uint32_t)v[0] << 8) | v[1]);
+  }
+
+  /* 组播组分配: 与模组当前配置不同时重新配置 (模组会自动重启) */
+  if (reg_tlv_find(tlv, len, REG_TLV_GROUP, &vlen) != NULL) {
+    uint16_t group = reg_tlv_get_group(tlv, len);
+    if (group != s_ddc_group) {
+      tpmesh_debug_printf("TPMesh DDC: Join group 0x%04X\n", group);
+      if (tpmesh_module_set_group(s_ddc_config.mesh_id, group) == 0) {
+        s_ddc_group = group;
+      }
+    }
+  }
+}
+
+/* ============================================================================
+ * 私有函数 - DDC 快速重新上线
+ * ============================================================================
+ */
+
+/**
+ * @brief DDC: 直接进入在线状态, 由确认心跳验证注册纪元
+ */
+static void ddc_start_rejoin(void) {
+  tpmesh_debug_printf("TPMesh DDC: Fast rejoin (epoch %08lX)\n",
+                      (unsigned long)s_ddc_epoch);
+  s_rejoin_tries = 0;
+  s_next_register_tick = tpmesh_get_tick_ms();
+  s_rejoin_pending = true;
+  s_ddc_state = DDC_STATE_ONLINE;
+}
+
+/**
+ * @brief DDC: 放弃缓存的纪元, 回到完整注册流程
+ */
+static void ddc_restart_register(const char *reason) {
+  tpmesh_debug_printf("TPMesh DDC: Re-register (%s)\n", reason);
+  s_ddc_epoch = 0;
+  s_rejoin_pending = false;
+  ddc_enter_registering();
+}
+
+/**
+ * @brief DDC: 进入注册状态, 首次发送前随机延时
+ */
+static void ddc_enter_registering(void) {
+  s_register_retry_count = 0;
+  s_next_register_tick =
+      tpmesh_get_tick_ms() + LWIP_RAND() % TPMESH_REGISTER_START_JITTER_MS;
+  s_ddc_state = DDC_STATE_REGISTERING;
+}
+
+/**
+ * @brief DDC: 记录注册 ACK 下发的纪元 (旧版 Top Node 不下发)
+ */
+static void ddc_save_epoch(uint32_t epoch) {
+  s_ddc_epoch = epoch;
+  if (epoch == 0) {
+    return;
+  }
+
+  tpmesh_rejoin_t rec;
+  rec.epoch = epoch;
+  memcpy(rec.mac, s_ddc_config.mac_addr, 6);
+  ip4_addr_copy(rec.ip, s_ddc_config.ip_addr);
+  rec.mesh_id = s_ddc_config.mesh_id;
+  rec.top_id = s_ddc_top;
+  tpmesh_node_store_save_rejoin(&rec);
+}
+
+/**
+ * @brief DDC: 记录发往 Top Node 的数据帧 (Top Node 收到即刷新活跃时间)
+ */
+static void ddc_uplink_sent(uint16_t dest_mesh_id) {
+  if (!s_is_top_node && dest_mesh_id == s_ddc_top) {
+    s_last_uplink_tick = tpmesh_get_tick_ms();
+  }
+}
+
+/**
+ * @brief DDC: 注册/确认心跳重试间隔 (指数退避基数)
+ *
+ * 有到 Top Node 的 RTT 估计时取 2 x RTO; 上电后尚无估计 (整层楼同时
+ * 注册) 时保持 TPMESH_REGISTER_RETRY_MS, 不加重注册风暴。
+ */
+static uint32_t ddc_retry_base(void) {
+  return tpmesh_rtt_timeout(s_ddc_top, 2, TPMESH_REGISTER_RETRY_MS,
+                            TPMESH_REGISTER_RETRY_MIN_MS,
+                            TPMESH_REGISTER_RETRY_MS);
+}
+
+/**
+ * @brief DDC: 下一个心跳是否需要 Top Node 应答
+ */
+static bool ddc_ack_due(void) {
+  return s_rejoin_pending ||
+         tpmesh_get_tick_ms() - s_last_ack_tick >= TPMESH_HEARTBEAT_ACK_MS;
+}
+
+/* ============================================================================
+ * 私有函数 - DDC I-Am 错峰
+ * ============================================================================
+ */
+
+/**
+ * @brief DDC: 拦截来自 Mesh 的 Who-Is, 按时隙安排 I-Am
+ *
+ * 时隙 = Mesh ID 对网络规模取模, 时隙内再加随机抖动;
+ * 多个 Who-Is 在应答前到达时合并为一次 I-Am。
+ *
+ * @return true=已处理 (不交给本地协议栈)
+ */
+static bool ddc_intercept_who_is(const uint8_t *frame, uint16_t len) {
+  tpmesh_bac_pkt_t pkt;
+  uint32_t low, high;
+
+  if (s_ddc_config.device_instance == NODE_DEVICE_INSTANCE_NONE ||
+      tpmesh_bac_parse(frame, len, &pkt) != 0 || pkt.apdu_len < 2 ||
+      pkt.apdu[1] != TPMESH_BAC_SERVICE_WHO_IS ||
+      tpmesh_bac_get_discovery_range(&pkt, &low, &high) < 0) {
+    return false;
+  }
+
+  /* 指向其他 BACnet 网络的 Who-Is 交给协议栈 (路由) 处理 */
+  if (pkt.dnet != 0 && pkt.dnet != 0xFFFF) {
+    return false;
+  }
+
+  if (s_ddc_config.device_instance < low ||
+      s_ddc_config.device_instance > high) {
+    return true; /* 不在范围内, 协议栈同样不会应答 */
+  }
+
+  /* 注册中: Top Node 无法还原本机地址, 丢弃 (BMS 会重发 Who-Is) */
+  if (s_ddc_state != DDC_STATE_ONLINE) {
+    return true;
+  }
+
+  if (!tpmesh_timer_active(&s_iam_timer)) {
+    uint16_t slots = s_net_size;
+    if (slots > TPMESH_IAM_MAX_SLOTS) {
+      slots = TPMESH_IAM_MAX_SLOTS;
+    }
+    uint32_t delay = (uint32_t)(s_ddc_config.mesh_id % slots) *
+                         TPMESH_IAM_SLOT_MS +
+                     LWIP_RAND() % TPMESH_IAM_SLOT_MS;
+
+    tpmesh_timer_start(&s_iam_timer, delay);
+    tpmesh_debug_printf("TPMesh DDC: Who-Is, I-Am in %lu ms\n",
+                        (unsigned long)delay);
+  }
+
+  return true;
+}
+
+/**
+ * @brief DDC: 发送 I-Am (单播到 Top Node, 隧道头保留 L2 广播位)
+ *
+ * Top Node 解压后以以太网广播重新发出。
+ */
+static void ddc_iam_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)timer;
+  (void)arg;
+
+  /* 安排后已掉线重新注册: s_ddc_top 不再有效 */
+  if (s_ddc_state != DDC_STATE_ONLINE) {
+    return;
+  }
+  if (ddc_send_i_am() != 0) {
+    tpmesh_debug_printf("TPMesh DDC: I-Am send failed\n");
+  }
+}
+
+static int ddc_send_i_am(void) {
+  uint8_t apdu[24];
+  uint8_t frame[96];
+  uint8_t tunnel[96];
+  uint16_t tunnel_len;
+
+  uint16_t apdu_len = tpmesh_bac_encode_i_am(
+      apdu, s_ddc_config.device_instance, s_ddc_config.max_apdu,
+      s_ddc_config.segmentation, s_ddc_config.vendor_id);
+
+  int len = tpmesh_bac_build_broadcast(s_ddc_config.mac_addr,
+                                       ip4_addr_get_u32(&s_ddc_config.ip_addr),
+                                       apdu, apdu_len, frame, sizeof(frame));
+  if (len < 0) {
+    return -1;
+  }
+
+  if (schc_compress(frame, (uint16_t)len, tunnel, &tunnel_len, true) != 0) {
+    return -2;
+  }
+
+  if (mesh_send(s_ddc_top, tunnel, tunnel_len) != 0) {
+    return -3;
+  }
+  ddc_uplink_sent(s_ddc_top);
+  return 0;
+}
+
+/* ============================================================================
+ * 私有函数 - 广播定向
+ * ============================================================================
+ */
+
+/**
+ * @brief 查找 IP 所属的组播组
+ */
+static const mesh_group_t *group_by_ip(const ip4_addr_t *ip) {
+  for (uint8_t i = 0; i < s_group_count; i++) {
+    if (ip4_addr_netcmp(ip, &s_groups[i].subnet, &s_groups[i].mask)) {
+      return &s_groups[i];
+    }
+  }
+  return NULL;
+}
+
+static bool group_check_cb(const node_entry_t *entry, void *arg) {
+  group_check_t *ctx = (group_check_t *)arg;
+
+  if (entry->online &&
+      ip4_addr_netcmp(&entry->ip, &ctx->group->subnet, &ctx->group->mask)) {
+    if (entry->group == ctx->group->group_addr) {
+      ctx->members++;
+    } else {
+      ctx->strays++;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 广播帧选择组播组
+ *
+ * - 目的 IP 为某组子网的定向广播地址 (含 BBMD 转发的 Forwarded-NPDU)
+ * - BACnet NPDU 的 DNET 对应某组的网络号
+ *
+ * 子网内仍有在线节点未确认加入该组时按全网广播发送。
+ *
+ * @return 组播地址; MESH_ADDR_BROADCAST=全网广播;
+ *         MESH_ADDR_INVALID=该组无在线成员 (丢弃)
+ */
+static uint16_t select_broadcast_group(const uint8_t *frame, uint16_t len,
+                                       const tpmesh_bac_pkt_t *bac) {
+  if (s_group_count == 0) {
+    return MESH_ADDR_BROADCAST;
+  }
+
+  const mesh_group_t *g = NULL;
+  const struct eth_hdr *eth = (const struct eth_hdr *)frame;
+
+  if (len >= ETH_HDR_LEN + IP_HDR_LEN && eth->type == PP_HTONS(ETHTYPE_IP)) {
+    ip4_addr_t dst;
+    SMEMCPY(&dst, frame + ETH_HDR_LEN + 16, sizeof(dst));
+    for (uint8_t i = 0; i < s_group_count && g == NULL; i++) {
+      uint32_t host_bits = ~ip4_addr_get_u32(&s_groups[i].mask);
+      if (host_bits != 0 &&
+          ip4_addr_netcmp(&dst, &s_groups[i].subnet, &s_groups[i].mask) &&
+          (ip4_addr_get_u32(&dst) & host_bits) == host_bits) {
+        g = &s_groups[i];
+      }
+    }
+  }
+
+  if (g == NULL && bac != NULL && bac->dnet != 0 && bac->dnet != 0xFFFF) {
+    for (uint8_t i = 0; i < s_group_count; i++) {
+      if (s_groups[i].bacnet_net == bac->dnet) {
+        g = &s_groups[i];
+        break;
+      }
+    }
+  }
+
+  if (g == NULL) {
+    return MESH_ADDR_BROADCAST;
+  }
+
+  group_check_t ctx = {g, 0, 0};
+  node_table_foreach(group_check_cb, &ctx);
+  if (ctx.strays > 0) {
+    return MESH_ADDR_BROADCAST;
+  }
+  return (ctx.members > 0) ? g->group_addr : MESH_ADDR_INVALID;
+}
+
+/**
+ * @brief 为带范围的 Who-Is/Who-Has 选择目标 DDC
+ *
+ * 通过节点表的设备实例索引查找范围内的在线 DDC;
+ * 未上报实例号的 DDC 无法排除, 同样作为目标。
+ *
+ * @param pkt 以太网广播帧的 BACnet/IP 解析结果
+ * @param mesh_ids [out] 目标列表 (TPMESH_WHOIS_UNICAST_MAX 个)
+ * @return 目标数量, 0=无匹配 (可丢弃), -1=需按广播泛洪
+ */
+static int select_discovery_targets(const tpmesh_bac_pkt_t *pkt,
+                                    uint16_t *mesh_ids) {
+  uint32_t low, high;
+
+  /* 不带范围的发现请求面向全部设备 */
+  if (tpmesh_bac_get_discovery_range(pkt, &low, &high) != 1) {
+    return -1;
+  }
+
+  /* 指向远端 BACnet 网络的请求由路由器处理, 不按本地实例过滤 */
+  if (pkt->dnet != 0) {
+    return -1;
+  }
+
+  int unknown;
+  int n = node_table_find_by_instance(low, high, mesh_ids,
+                                      TPMESH_WHOIS_UNICAST_MAX, &unknown);
+  if (n > TPMESH_WHOIS_UNICAST_MAX) {
+    return -1;
+  }
+
+  tpmesh_debug_printf("TPMesh: Discovery [%lu-%lu] -> %d DDC (%d unknown)\n",
+                      (unsigned long)low, (unsigned long)high, n, unknown);
+  return n;
+}
+
+/* ============================================================================
+ * 私有函数 - 读缓存
+ * ============================================================================
+ */
+
+/**
+ * @brief 尝试用 RP/RPM 缓存直接应答 BMS
+ * @param p 发往 DDC 的以太网单播帧
+ * @param req BACnet/IP 解析结果
+ * @param mesh_id 目标 DDC Mesh ID
+ * @return true=已应答 (帧不再转发)
+ */
+static bool answer_from_cache(struct pbuf *p, const tpmesh_bac_pkt_t *req,
+                              uint16_t mesh_id) {
+  /* 仅在以太网输入线程调用, 缓冲区静态分配以节省栈 */
+  static uint8_t apdu[CACHE_REPLY_APDU_MAX];
+  static uint8_t reply[ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN + 6 +
+                       CACHE_REPLY_APDU_MAX];
+
+  if (req->bvlc_func != TPMESH_BAC_BVLC_ORIGINAL_UNICAST) {
+    return false;
+  }
+
+  uint16_t apdu_len;
+  if (tpmesh_rp_cache_on_request(mesh_id, req, apdu, sizeof(apdu),
+                                 &apdu_len) != 1) {
+    return false;
+  }
+
+  int len = tpmesh_bac_build_reply(req, (const uint8_t *)p->payload, apdu,
+                                   apdu_len, reply, sizeof(reply));
+  if (len < 0) {
+    return false;
+  }
+
+  eth_output(reply, (uint16_t)len);
+  return true;
+}
+
+/**
+ * @brief 目标 DDC 可疑或离线时以 Reject 快速应答确认请求
+ *
+ * 发往静默 DDC 的请求只会在 Mesh 上重传直至 BMS 超时; 本地拒绝让 BMS
+ * 立即结束事务。DDC 恢复发送后 (任何流量) 自动解除。
+ *
+ * @return true=已拒绝 (帧不再转发)
+ */
+static bool reject_suspect(struct pbuf *p, const tpmesh_bac_pkt_t *req,
+                           uint16_t mesh_id) {
+  static uint8_t reply[ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN + 6 + 3];
+
+  if (req->bvlc_func != TPMESH_BAC_BVLC_ORIGINAL_UNICAST ||
+      req->apdu_len < 3 ||
+      (req->apdu[0] & 0xF0) != TPMESH_BAC_PDU_CONFIRMED ||
+      (req->apdu[0] & TPMESH_BAC_PDU_SEG)) {
+    return false;
+  }
+  if (!node_table_is_suspect(mesh_id)) {
+    return false;
+  }
+
+  uint8_t apdu[3] = {TPMESH_BAC_PDU_REJECT, req->apdu[2],
+                     TPMESH_BAC_REJECT_OTHER};
+  int len = tpmesh_bac_build_reply(req, (const uint8_t *)p->payload, apdu,
+                                   sizeof(apdu), reply, sizeof(reply));
+  if (len < 0) {
+    return false;
+  }
+
+  eth_output(reply, (uint16_t)len);
+  tpmesh_debug_printf("TPMesh: Reject invoke=%u, DDC 0x%04X suspect\n",
+                      req->apdu[2], mesh_id);
+  return true;
+}
+
+/**
+ * @brief 发送完整以太网帧到 Top Node 以太网口
+ */
+static void eth_output(const uint8_t *frame, uint16_t len) {
+  if (s_eth_netif == NULL || s_eth_netif->linkoutput == NULL) {
+    return;
+  }
+
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+  if (p) {
+    memcpy(p->payload, frame, len);
+    s_eth_netif->linkoutput(s_eth_netif, p);
+    pbuf_free(p);
+  }
+}
+
+/* ============================================================================
+ * 私有函数 - 数据帧处理
+ * ============================================================================
+ */
+
+static void process_data_frame(uint16_t src_mesh_id, const uint8_t *data,
+                               uint16_t len) {
+  /* 分片重组 */
+  uint8_t *complete_data;
+  uint16_t complete_len;
+
+  int ret =
+      reassemble_packet(src_mesh_id, data, len, &complete_data, &complete_len);
+  if (ret != 1) {
+    return; /* 未完成 */
+  }
+
+  /* 更新节点活跃时间 */
+  node_table_touch(src_mesh_id);
+
+  /* SCHC 直接解压到 pbuf (连续), 交给以太网口或 Mesh 网卡, 不经中间缓冲 */
+  struct pbuf *p = pbuf_alloc(
+      PBUF_RAW, (uint16_t)(complete_len + SCHC_DECOMPRESS_GROWTH), PBUF_RAM);
+  if (p == NULL) {
+    tpmesh_debug_printf("TPMesh: pbuf alloc failed len=%u\n", complete_len);
+    return;
+  }
+
+  uint8_t *eth_frame = (uint8_t *)p->payload;
   uint16_t eth_len;
 
   uint16_t dst_mesh_id =
@@ -893,36 +2245,232 @@ static void process_data_frame(uint16_t src_mesh_id, const uint8_t *data,
   if (schc_decompress(complete_data, complete_len, eth_frame, &eth_len,
                       src_mesh_id, dst_mesh_id) != 0) {
     tpmesh_debug_printf("TPMesh: Decompress failed\n");
+    pbuf_free(p);
     return;
   }
+  pbuf_realloc(p, eth_len);
 
   if (s_is_top_node) {
-    /* Top Node: 转发到以太网 */
-    if (s_eth_netif && s_eth_netif->linkoutput) {
-      struct pbuf *p = pbuf_alloc(PBUF_RAW, eth_len, PBUF_RAM);
-      if (p) {
-        memcpy(p->payload, eth_frame, eth_len);
-        s_eth_netif->linkoutput(s_eth_netif, p);
-        pbuf_free(p);
-      }
+    /* Top Node: DDC 解析另一 DDC 的地址时介绍双方直连, 不发往以太网 */
+    if (top_intercept_peer_arp(src_mesh_id, eth_frame, eth_len)) {
+      pbuf_free(p);
+      return;
+    }
+
+    /* Top Node: 结束在途请求, 学习 RP/RPM 应答, COV 通知使缓存失效 */
+    tpmesh_bac_pkt_t pkt;
+    if (tpmesh_bac_parse(eth_frame, eth_len, &pkt) == 0) {
+      /* 仅不压缩的帧保留原始目的地址 */
+      tpmesh_inflight_on_response(
+          src_mesh_id, &pkt, complete_data[2] == SCHC_RULE_NO_COMPRESS);
+      tpmesh_rp_cache_on_response(src_mesh_id, &pkt);
     }
+
+    /* 转发到以太网 */
+    if (s_eth_netif != NULL && s_eth_netif->linkoutput != NULL) {
+      s_eth_netif->linkoutput(s_eth_netif, p);
+    }
+    pbuf_free(p);
   } else {
-    /* DDC: 交给本地协议栈处理 */
-    struct netif *ddc_netif = netif_default;
-    if (ddc_netif && ddc_netif->input) {
-      struct pbuf *p = pbuf_alloc(PBUF_RAW, eth_len, PBUF_RAM);
-      if (p) {
-        memcpy(p->payload, eth_frame, eth_len);
-        if (ddc_netif->input(p, ddc_netif) != ERR_OK) {
-          tpmesh_debug_printf("TPMesh DDC: netif input failed len=%u src=0x%04X\n",
-                              eth_len, src_mesh_id);
-          pbuf_free(p);
-        }
-      }
+    /* DDC: Who-Is 由桥接层错开时隙代答 */
+    if (ddc_intercept_who_is(eth_frame, eth_len)) {
+      pbuf_free(p);
+      return;
+    }
+
+    /* DDC: 经 Mesh 网卡交给本地协议栈 (失败时已释放) */
+    if (tpmesh_netif_input(p) != 0) {
+      tpmesh_debug_printf("TPMesh DDC: netif input failed len=%u src=0x%04X\n",
+                          eth_len, src_mesh_id);
     }
   }
 }
 
+/* ============================================================================
+ * 私有函数 - 对端 DDC 直连
+ *
+ * Top Node 不主动下发全量映射 (每次注册都广播会占满信道), 而是按需介绍:
+ * DDC 解析另一 DDC 的 IP 时 ARP 请求经 Mesh 到达 Top Node, Top Node 以
+ * REG_FRAME_PEER_MAP 单播把双方的 [Mesh ID, IP] 分别告知对方。DDC 把对端
+ * 以本地 MAC 存入节点表 (静态, 不超时), 之后 Mesh 网卡按 MAC 直接发往
+ * 对端 Mesh ID。映射变更时 Top Node 广播 REG_TLV_PEER_UPDATE, 仅已缓存
+ * 该映射的 DDC 更新; 到对端的路由删除时 DDC 丢弃映射。
+ * ============================================================================
+ */
+
+/**
+ * @brief 对端 DDC 的本地 MAC (由 Mesh ID 推出, 映射条目无需携带 MAC)
+ */
+static void peer_mac(uint16_t mesh_id, uint8_t *mac) {
+  mac[0] = PEER_MAC_OUI0;
+  mac[1] = PEER_MAC_OUI1;
+  mac[2] = PEER_MAC_OUI2;
+  mac[3] = 0x00;
+  mac[4] = (uint8_t)(mesh_id >> 8);
+  mac[5] = (uint8_t)mesh_id;
+}
+
+static uint16_t reg_tlv_put_peer(uint8_t *tlv, uint16_t off, uint8_t type,
+                                 uint16_t mesh_id, const ip4_addr_t *ip) {
+  uint8_t v[REG_TLV_PEER_ENTRY_LEN];
+  v[0] = (uint8_t)(mesh_id >> 8);
+  v[1] = (uint8_t)mesh_id;
+  SMEMCPY(&v[2], ip, sizeof(ip4_addr_t));
+  return reg_tlv_put(tlv, off, type, v, sizeof(v));
+}
+
+/**
+ * @brief 把 peer 的映射单播给 dest_mesh_id
+ */
+static int top_send_peer(uint16_t dest_mesh_id, uint16_t peer) {
+  ip4_addr_t ip;
+  if (node_table_get_ip_by_mesh(peer, &ip) != 0) {
+    return -1;
+  }
+
+  uint8_t tlv[2 + REG_TLV_PEER_ENTRY_LEN];
+  uint16_t tlv_len = reg_tlv_put_peer(tlv, 0, REG_TLV_PEER, peer, &ip);
+  return send_reg_frame(dest_mesh_id, REG_FRAME_PEER_MAP,
+                        s_top_config.mac_addr, &s_top_config.ip_addr,
+                        s_top_config.mesh_id, tlv, tlv_len);
+}
+
+/**
+ * @brief Top Node: 拦截 DDC 对另一 DDC 的 ARP 请求, 介绍双方直连
+ * @return true=已处理 (不转发到以太网)
+ */
+static bool top_intercept_peer_arp(uint16_t src_mesh_id, const uint8_t *frame,
+                                   uint16_t len) {
+  if (len < SIZEOF_ETH_HDR + SIZEOF_ETHARP_HDR) {
+    return false;
+  }
+
+  const struct eth_hdr *eth = (const struct eth_hdr *)frame;
+  const struct etharp_hdr *arp =
+      (const struct etharp_hdr *)(frame + SIZEOF_ETH_HDR);
+  if (eth->type != PP_HTONS(ETHTYPE_ARP) ||
+      arp->opcode != PP_HTONS(ARP_REQUEST)) {
+    return false;
+  }
+
+  ip4_addr_t target;
+  SMEMCPY(&target, &arp->dipaddr, sizeof(ip4_addr_t));
+  uint16_t peer = node_table_get_mesh_by_ip(&target);
+  if (peer == MESH_ADDR_INVALID || peer == src_mesh_id ||
+      !node_table_is_registered(src_mesh_id)) {
+    return false;
+  }
+
+  /* 该 IP 只在 Mesh 侧, 以太网上无人应答; 对端可疑时不介绍, 由请求方重试 */
+  if (node_table_is_suspect(peer)) {
+    return true;
+  }
+
+  if (top_send_peer(src_mesh_id, peer) != 0 ||
+      top_send_peer(peer, src_mesh_id) != 0) {
+    tpmesh_debug_printf("TPMesh Top: Peer map send failed 0x%04X <-> 0x%04X\n",
+                        src_mesh_id, peer);
+    return true;
+  }
+
+  tpmesh_debug_printf("TPMesh Top: Peer 0x%04X <-> 0x%04X\n", src_mesh_id,
+                      peer);
+  return true;
+}
+
+/**
+ * @brief Top Node: 映射变更, 广播给已缓存旧映射的 DDC
+ */
+static void top_peer_changed(uint16_t mesh_id, const ip4_addr_t *ip) {
+  uint8_t tlv[2 + REG_TLV_PEER_ENTRY_LEN];
+  uint16_t tlv_len =
+      reg_tlv_put_peer(tlv, 0, REG_TLV_PEER_UPDATE, mesh_id, ip);
+  if (send_reg_frame(MESH_ADDR_BROADCAST, REG_FRAME_PEER_MAP,
+                     s_top_config.mac_addr, &s_top_config.ip_addr,
+                     s_top_config.mesh_id, tlv, tlv_len) != 0) {
+    tpmesh_debug_printf("TPMesh Top: Peer update send failed 0x%04X\n",
+                        mesh_id);
+    return;
+  }
+
+  tpmesh_debug_printf("TPMesh Top: Peer update 0x%04X -> %s\n", mesh_id,
+                      ip4addr_ntoa(ip));
+}
+
+/**
+ * @brief DDC: 安装/更新对端映射, 并让协议栈的 ARP 表立即生效
+ */
+static void ddc_apply_peer_map(const uint8_t *tlv, uint16_t len) {
+  uint8_t vlen;
+  bool install = true;
+  const uint8_t *v = reg_tlv_find(tlv, len, REG_TLV_PEER, &vlen);
+  if (v == NULL) {
+    v = reg_tlv_find(tlv, len, REG_TLV_PEER_UPDATE, &vlen);
+    install = false;
+  }
+  if (v == NULL) {
+    return;
+  }
+
+  for (uint8_t off = 0; off + REG_TLV_PEER_ENTRY_LEN <= vlen;
+       off += REG_TLV_PEER_ENTRY_LEN) {
+    uint16_t mesh_id = ((uint16_t)v[off] << 8) | v[off + 1];
+    ip4_addr_t ip;
+    SMEMCPY(&ip, &v[off + 2], sizeof(ip4_addr_t));
+
+    if (mesh_id == s_ddc_config.mesh_id || MESH_ADDR_IS_TOP(mesh_id) ||
+        mesh_id == MESH_ADDR_BROADCAST || mesh_id >= MESH_ADDR_GROUP_FIRST ||
+        ip4_addr_cmp(&ip, &s_ddc_config.ip_addr)) {
+      continue;
+    }
+
+    /* 变更只更新已缓存的映射 (按 Mesh ID 或 IP) */
+    ip4_addr_t old_ip;
+    uint16_t old_mesh = node_table_get_mesh_by_ip(&ip);
+    if (!install && old_mesh == MESH_ADDR_INVALID &&
+        node_table_get_ip_by_mesh(mesh_id, &old_ip) != 0) {
+      continue;
+    }
+
+    /* IP 已转到其他 Mesh ID: 先移除旧条目 */
+    if (old_mesh != MESH_ADDR_INVALID && old_mesh != mesh_id) {
+      node_table_remove(old_mesh);
+    }
+
+    uint8_t mac[6];
+    peer_mac(mesh_id, mac);
+    if (node_table_add_static(mac, &ip, mesh_id) == 0) {
+      tpmesh_netif_peer_resolved(mac, &ip);
+    }
+  }
+}
+
+/**
+ * @brief DDC: 安装 Top Node 下发的以太网侧 ARP 预置 (全量表或增量)
+ */
+static void ddc_apply_arp_map(const uint8_t *tlv, uint16_t len) {
+  uint8_t vlen;
+  const uint8_t *v = reg_tlv_find(tlv, len, REG_TLV_ARP, &vlen);
+  if (v != NULL) {
+    tpmesh_arp_seed_apply(v, vlen, true);
+  }
+  v = reg_tlv_find(tlv, len, REG_TLV_ARP_UPDATE, &vlen);
+  if (v != NULL) {
+    tpmesh_arp_seed_apply(v, vlen, false);
+  }
+}
+
+/**
+ * @brief DDC: 按 Top Node 的时间信标校时
+ */
+static void ddc_apply_time(uint16_t src, const uint8_t *tlv, uint16_t len) {
+  uint8_t vlen;
+  const uint8_t *v = reg_tlv_find(tlv, len, REG_TLV_TIME, &vlen);
+  if (v != NULL) {
+    tpmesh_time_apply(src, v, vlen);
+  }
+}
+
 /* ============================================================================
  * 私有函数 - ARP 处理
  * ============================================================================
@@ -946,7 +2494,12 @@ static bridge_action_t check_arp_request(struct pbuf *p,
   ip4_addr_t target;
   SMEMCPY(&target, &arp->dipaddr, sizeof(ip4_addr_t));
 
-  if (node_table_is_ddc_ip(&target)) {
+  uint16_t mesh_id = node_table_get_mesh_by_ip(&target);
+  if (mesh_id != MESH_ADDR_INVALID) {
+    /* 注册在其他 Top Node 的 DDC 由其所属 Top Node 应答 */
+    if (node_table_is_remote(mesh_id)) {
+      return BRIDGE_DROP;
+    }
     *target_ip = (const uint8_t *)&arp->dipaddr;
     return BRIDGE_PROXY_ARP;
   }
@@ -954,6 +2507,26 @@ static bridge_action_t check_arp_request(struct pbuf *p,
   return BRIDGE_LOCAL;
 }
 
+/**
+ * @brief Top Node: 学习与 DDC 通信的以太网侧主机 (解析 DDC 的请求方,
+ *        应答 DDC 的主机), 其余主机的 ARP 不占用预置表
+ */
+static void top_learn_arp_sender(struct pbuf *p) {
+  if (p->len < SIZEOF_ETH_HDR + SIZEOF_ETHARP_HDR) {
+    return;
+  }
+
+  const struct etharp_hdr *arp =
+      (const struct etharp_hdr *)((const uint8_t *)p->payload + SIZEOF_ETH_HDR);
+  ip4_addr_t sender, target;
+  SMEMCPY(&sender, &arp->sipaddr, sizeof(ip4_addr_t));
+  SMEMCPY(&target, &arp->dipaddr, sizeof(ip4_addr_t));
+
+  if (node_table_get_mesh_by_ip(&target) != MESH_ADDR_INVALID) {
+    tpmesh_arp_seed_learn(arp->shwaddr.addr, &sender);
+  }
+}
+
 static int send_proxy_arp_reply_internal(struct pbuf *arp_request,
                                          const uint8_t *target_mac,
                                          const ip4_addr_t *target_ip) {
@@ -20,6 +20,7 @@
 
 /* 包含节点表定义 (避免重复定义 node_entry_t) */
 #include "node_table.h"
+#include "tpmesh_timer.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,20 +32,41 @@ extern "C" {
  */
 
 /** 最大节点数量 */
-#define TPMESH_MAX_NODE_ENTRIES 16
+#define TPMESH_MAX_NODE_ENTRIES NODE_TABLE_MAX_ENTRIES
 
 /** 节点超时时间 (ms) */
 #define TPMESH_NODE_TIMEOUT_MS 90000
 
-/** 心跳间隔 (ms) */
+/** 心跳间隔 (ms): 各 DDC 按 Top Node 分配的时隙错开;
+ *  时隙前半个间隔内已向 Top Node 发出数据帧则省略该次心跳 */
 #define TPMESH_HEARTBEAT_MS 30000
 
-/** 注册重试间隔 (ms) */
+/** DDC 请求心跳 ACK 的最长间隔 (ms): 确认注册有效并刷新网络规模/组播组 */
+#define TPMESH_HEARTBEAT_ACK_MS 300000
+
+/** 注册重试间隔 (ms, 指数退避基数) */
 #define TPMESH_REGISTER_RETRY_MS 5000
 
+/** 注册重试间隔上限 (ms) */
+#define TPMESH_REGISTER_BACKOFF_MAX_MS 60000
+
+/** 开始注册前的随机延时窗口 (ms), 打散同时上电的 DDC */
+#define TPMESH_REGISTER_START_JITTER_MS 5000
+
 /** 注册最大重试次数 */
 #define TPMESH_REGISTER_MAX_RETRIES 10
 
+/** 注册/快速重新上线重试间隔下限 (ms, 已有到 Top Node 的 RTT 估计时) */
+#define TPMESH_REGISTER_RETRY_MIN_MS 1000
+
+/** 快速重新上线确认心跳最大次数 (间隔 TPMESH_REGISTER_RETRY_MS) */
+#define TPMESH_REJOIN_MAX_TRIES 3
+
+/** 分片重组超时 (ms): 无 RTT 估计时使用, 否则为 2 x RTO 限定在 MIN~MAX */
+#define TPMESH_REASSEMBLY_TIMEOUT_MS 5000
+#define TPMESH_REASSEMBLY_MIN_MS 1000
+#define TPMESH_REASSEMBLY_MAX_MS 15000
+
 /** 分片发送延时 (ms) */
 #define TPMESH_FRAG_DELAY_MS 50
 
@@ -78,20 +100,48 @@ extern "C" {
 /** BACnet/IP 端口 */
 #define TPMESH_PORT_BACNET 47808
 
+/** 带范围 Who-Is/Who-Has 转为单播的最大目标数 (超过则仍按广播泛洪) */
+#define TPMESH_WHOIS_UNICAST_MAX 4
+
+/** DDC I-Am 应答时隙 (ms, 约为单帧 I-Am 的空口时间) */
+#define TPMESH_IAM_SLOT_MS 150
+
+/** DDC I-Am 应答最大时隙数 (限制最长延迟) */
+#define TPMESH_IAM_MAX_SLOTS 64
+
+/** 组播组映射最大数量 */
+#define TPMESH_GROUP_MAX 8
+
 /* ============================================================================
  * Mesh 地址定义
  * ============================================================================
  */
 
-/** Top Node Mesh 地址 */
+/** Top Node Mesh 地址 (单 Top Node 部署; 多 Top Node 时为默认/首选) */
 #define MESH_ADDR_TOP_NODE 0xFFFE
 
+/** 中心节点 (Top Node) 地址范围 */
+#define MESH_ADDR_TOP_FIRST 0xFFBE
+#define MESH_ADDR_TOP_LAST 0xFFFE
+
+/** 任意中心节点 (仅作发送目的: 模组选择跳数最少的 Top Node,
+ *  与 MESH_ADDR_INVALID 同值) */
+#define MESH_ADDR_TOP_ANY 0xFFFF
+
+/** 是否为中心节点 (Top Node) 地址 */
+#define MESH_ADDR_IS_TOP(addr)                                                 \
+  ((addr) >= MESH_ADDR_TOP_FIRST && (addr) <= MESH_ADDR_TOP_LAST)
+
 /** 广播 Mesh 地址 */
 #define MESH_ADDR_BROADCAST 0x0000
 
 /** 无效 Mesh 地址 */
 #define MESH_ADDR_INVALID 0xFFFF
 
+/** 组播 Mesh 地址范围 */
+#define MESH_ADDR_GROUP_FIRST 0xFF7D
+#define MESH_ADDR_GROUP_LAST 0xFFBD
+
 /* ============================================================================
  * 帧类型定义
  * ============================================================================
@@ -103,14 +153,67 @@ typedef enum {
   REG_FRAME_REGISTER_ACK = 0x02,  /**< 注册确认 */
   REG_FRAME_HEARTBEAT = 0x03,     /**< 心跳 */
   REG_FRAME_HEARTBEAT_ACK = 0x04, /**< 心跳响应 */
+  REG_FRAME_REGISTER_BUSY = 0x05, /**< 注册暂缓 (Top Node 忙, 按 RETRY_AFTER 重试) */
+  REG_FRAME_PEER_MAP = 0x06,      /**< 对端 DDC 映射 (Top → DDC) */
+  REG_FRAME_ARP_MAP = 0x07,       /**< 以太网侧 ARP 预置 (Top → 广播) */
+  REG_FRAME_TIME = 0x08,          /**< 时间信标 (Top → 广播) */
 } reg_frame_type_t;
 
+/**
+ * 注册帧 TLV 扩展类型
+ *
+ * TLV 追加在 reg_frame_t 之后: [Type:1][Len:1][Value:Len],
+ * 不计入 reg_frame_t 的 CRC, 旧版本接收方按长度忽略。
+ */
+typedef enum {
+  REG_TLV_DEVICE = 0x01,   /**< 设备信息: [Instance:4 BE][Caps:1] */
+  REG_TLV_NET_SIZE = 0x02, /**< 网络规模: [Nodes:2 BE] (Top → DDC) */
+  REG_TLV_GROUP = 0x03,    /**< 组播组: [Group:2 BE] (Top → DDC 分配,
+                                DDC → Top 已加入; 0xFFFF=无) */
+  REG_TLV_EPOCH = 0x04,    /**< 注册纪元: [Epoch:4 BE] (Top → DDC ACK,
+                                0=未注册须重新注册; DDC → Top 心跳) */
+  REG_TLV_RETRY_AFTER = 0x05, /**< 重试等待: [ms:2 BE] (Top → DDC 注册暂缓) */
+  REG_TLV_ACK_REQ = 0x06,  /**< 请求 ACK: 无值 (DDC → Top 心跳) */
+  REG_TLV_HB_SLOT = 0x07,  /**< 心跳时隙: [Delay:2 BE] 距下一个时隙的 ms
+                                (Top → DDC ACK) */
+  REG_TLV_TIMESTAMP = 0x08, /**< 时间戳: [TSval:4 BE][TSecr:4 BE] (双向;
+                                 TSecr=对端 TSval + 本端持有时间, 0=无) */
+  REG_TLV_PEER = 0x09,     /**< 对端映射: n×[Mesh:2 BE][IP:4] (Top → DDC
+                                单播, 接收方安装) */
+  REG_TLV_PEER_UPDATE = 0x0A, /**< 对端映射变更: 格式同上 (Top → 广播,
+                                   接收方仅更新已缓存的条目) */
+  REG_TLV_ARP = 0x0B,      /**< ARP 预置全量表: n×[IP:4][MAC:6] (Top → DDC
+                                注册 ACK / 周期广播, 接收方替换) */
+  REG_TLV_ARP_UPDATE = 0x0C, /**< ARP 预置增量: 格式同上, MAC 全 0=删除 */
+  REG_TLV_TIME = 0x0D,     /**< 时间信标: [Secs:4 BE][Ms:2 BE] 2000 年起
+                                (Top → DDC 注册 ACK / 周期广播) */
+} reg_tlv_type_t;
+
+/** REG_TLV_PEER / REG_TLV_PEER_UPDATE 单个条目长度 */
+#define REG_TLV_PEER_ENTRY_LEN 6
+
+/** REG_TLV_ARP / REG_TLV_ARP_UPDATE 单个条目长度 */
+#define REG_TLV_ARP_ENTRY_LEN 10
+
+/** REG_TLV_TIME 值长度 */
+#define REG_TLV_TIME_LEN 6
+
+/** REG_TLV_DEVICE 值长度 */
+#define REG_TLV_DEVICE_LEN 5
+
+/** DDC 能力位 (REG_TLV_DEVICE.Caps) */
+#define REG_CAP_BACNET_IP 0x01  /**< BACnet/IP 设备 */
+#define REG_CAP_MODBUS_TCP 0x02 /**< Modbus TCP 服务 */
+
 /** SCHC 规则 ID */
 typedef enum {
   SCHC_RULE_NO_COMPRESS = 0x00, /**< 不压缩 */
   SCHC_RULE_BACNET_IP = 0x01,   /**< BACnet/IP 压缩 (IP+UDP头) */
   SCHC_RULE_IP_ONLY = 0x02,     /**< 仅压缩 IP 头 */
   SCHC_RULE_REGISTER = 0x10,    /**< 注册/心跳帧 */
+  SCHC_RULE_STREAM = 0x11,      /**< TCP 代理流帧 (tpmesh_tcp_proxy) */
+  SCHC_RULE_MQTT_SN = 0x12,     /**< MQTT 网关报文 (tpmesh_mqtt_gw) */
+  SCHC_RULE_BULK = 0x13,        /**< 批量传输报文 (tpmesh_bulk) */
 } schc_rule_t;
 
 /** 桥接动作 */
@@ -119,6 +222,9 @@ typedef enum {
   BRIDGE_TO_MESH,   /**< 转发到 Mesh 网络 */
   BRIDGE_PROXY_ARP, /**< 代理 ARP 回复 */
   BRIDGE_DROP,      /**< 丢弃 */
+  BRIDGE_TOP_SYNC,  /**< 其他 Top Node 的节点表同步帧 */
+  BRIDGE_TCP_PROXY, /**< 代理端口的 TCP, 交给 TCP 代理 */
+  BRIDGE_ICMP_PROXY, /**< 发往 DDC 的 ping, 交给 ICMP 回显代理 */
 } bridge_action_t;
 
 /** 过滤动作 */
@@ -159,7 +265,7 @@ typedef struct __attribute__((packed)) {
 typedef struct {
   uint8_t mac_addr[6]; /**< MAC 地址 */
   ip4_addr_t ip_addr;  /**< IP 地址 */
-  uint16_t mesh_id;    /**< Mesh ID (通常 0xFFFE) */
+  uint16_t mesh_id;    /**< Mesh ID (0xFFBE~0xFFFE, 多 Top Node 时各不相同) */
   uint8_t cell_id;     /**< Cell ID */
 } top_config_t;
 
@@ -167,10 +273,15 @@ typedef struct {
  * @brief DDC 配置
  */
 typedef struct {
-  uint8_t mac_addr[6]; /**< MAC 地址 */
-  ip4_addr_t ip_addr;  /**< IP 地址 */
-  uint16_t mesh_id;    /**< Mesh ID */
-  uint8_t cell_id;     /**< Cell ID */
+  uint8_t mac_addr[6];      /**< MAC 地址 */
+  ip4_addr_t ip_addr;       /**< IP 地址 */
+  uint16_t mesh_id;         /**< Mesh ID */
+  uint8_t cell_id;          /**< Cell ID */
+  uint8_t caps;             /**< 能力位 (REG_CAP_xxx) */
+  uint32_t device_instance; /**< BACnet 设备实例号 */
+  uint16_t max_apdu;        /**< I-Am: 最大可接受 APDU */
+  uint8_t segmentation;     /**< I-Am: 分段支持 */
+  uint16_t vendor_id;       /**< I-Am: 厂商 ID */
 } ddc_config_t;
 
 /**
@@ -200,6 +311,7 @@ typedef struct {
   uint8_t expected_seq; /**< 期望的下一个序号 */
   uint32_t last_tick;   /**< 最后接收时间 */
   bool active;          /**< 会话活跃 */
+  tpmesh_timer_t timer; /**< 超时定时器 */
 } reassembly_session_t;
 
 /* ============================================================================
@@ -222,6 +334,32 @@ int tpmesh_top_init(struct netif *eth_netif, const top_config_t *config);
  */
 int tpmesh_ddc_init(const ddc_config_t *config);
 
+/**
+ * @brief 配置组播组 (Top Node, 须在桥接任务启动前调用)
+ *
+ * IP 位于该子网的 DDC 注册后被分配到此组播地址; 目的为该子网定向广播
+ * 地址或 DNET 为 bacnet_net 的广播只发往该组。
+ *
+ * @param group_addr 组播地址 [MESH_ADDR_GROUP_FIRST, MESH_ADDR_GROUP_LAST]
+ * @param subnet 子网地址
+ * @param prefix_len 子网前缀长度 (1~32)
+ * @param bacnet_net 子网对应的 BACnet 网络号, 0=不按网络号映射
+ * @return 0=成功, -1=参数错误, -2=表满
+ */
+int tpmesh_top_add_group(uint16_t group_addr, const ip4_addr_t *subnet,
+                         uint8_t prefix_len, uint16_t bacnet_net);
+
+/**
+ * @brief Top Node 以本机身份发送注册类帧 (reg_frame_t + TLV)
+ * @param dest_mesh_id 目标 Mesh ID (可为 MESH_ADDR_BROADCAST)
+ * @param frame_type 帧类型 (REG_FRAME_xxx)
+ * @param tlv TLV
+ * @param tlv_len TLV 长度
+ * @return 0=成功, -1=非 Top Node 或超长, <0=发送失败
+ */
+int tpmesh_top_send_reg(uint16_t dest_mesh_id, uint8_t frame_type,
+                        const uint8_t *tlv, uint16_t tlv_len);
+
 /* ============================================================================
  * 公共 API - AT 命令
  * ============================================================================
@@ -398,6 +536,38 @@ int tpmesh_bridge_forward_to_mesh(struct pbuf *p);
  */
 int tpmesh_bridge_send_proxy_arp(struct pbuf *p);
 
+/**
+ * @brief DDC 发送已压缩的隧道帧 (Mesh 网卡 linkoutput 使用)
+ * @param dest_mesh_id 目标 Mesh ID
+ * @param data 隧道帧 (schc_compress 输出)
+ * @param len 长度
+ * @return 0=成功, -1=非 DDC, -2=尚未上线, -3=发送失败
+ */
+int tpmesh_bridge_send_tunnel(uint16_t dest_mesh_id, const uint8_t *data,
+                              uint16_t len);
+
+/**
+ * @brief 发送单片隧道帧 (Top Node / DDC 均可, 不经 SCHC)
+ * @param dest_mesh_id 目标 Mesh ID
+ * @param frame 隧道帧 (含隧道头)
+ * @param len 长度 (不超过 TPMESH_MTU)
+ * @return 0=成功, -1=未初始化或超长, -3=发送失败
+ */
+int tpmesh_bridge_send_frame(uint16_t dest_mesh_id, const uint8_t *frame,
+                             uint16_t len);
+
+/**
+ * @brief DDC 当前注册所在的 Top Node
+ * @return Top Node Mesh ID (尚未注册时为 MESH_ADDR_TOP_NODE)
+ */
+uint16_t tpmesh_ddc_top_node(void);
+
+/**
+ * @brief DDC 当前注册纪元
+ * @return 纪元 (0=尚未注册)
+ */
+uint32_t tpmesh_ddc_epoch(void);
+
 /**
  * @brief 处理来自 Mesh 的数据帧
  * @param src_mesh_id 源 Mesh ID
@@ -432,6 +602,30 @@ int ddc_send_register(const ddc_config_t *config);
  */
 int ddc_send_heartbeat(const ddc_config_t *config);
 
+/**
+ * @brief DDC 设置注册上报的设备信息
+ *
+ * BACnet 设备对象在 tpmesh_ddc_init() 之后才初始化,
+ * 由初始化模块在创建任务前补充。
+ *
+ * @param device_instance BACnet 设备实例号
+ * @param caps 能力位 (REG_CAP_xxx)
+ */
+void tpmesh_ddc_set_device(uint32_t device_instance, uint8_t caps);
+
+/**
+ * @brief DDC 设置桥接层代发 I-Am 使用的设备参数
+ *
+ * Mesh 上收到的 Who-Is 由桥接层按时隙错开后代为应答,
+ * 不再交给本地协议栈立即广播 I-Am。
+ *
+ * @param max_apdu 最大可接受 APDU
+ * @param segmentation 分段支持
+ * @param vendor_id 厂商 ID
+ */
+void tpmesh_ddc_set_iam_params(uint16_t max_apdu, uint8_t segmentation,
+                               uint16_t vendor_id);
+
 /**
  * @brief DDC 心跳任务
  * @param arg 任务参数
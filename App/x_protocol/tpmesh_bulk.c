@@ -0,0 +1,1097 @@
+/**
+ * @file tpmesh_bulk.c
+ * @brief TPMesh 批量传输实现
+ *
+ * @version 0.8.0
+ */
+
+#include "tpmesh_bulk.h"
+#include "AppConfig.h"
+#include "eepromEmul.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_node_store.h"
+#include "tpmesh_rtt.h"
+#include "tpmesh_timer.h"
+
+/* node_table.h 已通过 tpmesh_bridge.h 包含 */
+#include "FreeRTOS.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+#include "task.h"
+#include <string.h>
+
+/* ============================================================================
+ * 私有常量
+ * ============================================================================
+ */
+
+/** 报文类型 */
+#define MSG_START 0x01
+#define MSG_DATA 0x02
+#define MSG_COMMIT 0x03
+#define MSG_STATUS 0x04
+#define MSG_ACK_REQ 0x80 /**< DATA: 请求立即回 STATUS */
+
+#define START_LEN 31
+#define DATA_HDR_LEN 4
+#define COMMIT_LEN 2
+#define STATUS_LEN 13
+#define STATUS_MAP_CHUNKS 64
+
+/** DDC 接受的最大块 */
+#define CHUNK_MAX (TPMESH_MTU - TPMESH_TUNNEL_HDR_LEN - DATA_HDR_LEN)
+#define CHUNK_MIN 16
+
+/** 上传头 */
+#define UPLOAD_MAGIC 0x5450424BUL /* "TPBK" */
+#define UPLOAD_HDR_LEN 32
+
+/** 口令字段 (上传头与 START 末尾) */
+#define TOKEN_LEN 16
+
+/** 暂存区: [Magic:4][Addr:4][Len:4][CRC32:4][Chunk:1][Rsv:3][Map] + 数据 */
+#define STAGE_MAGIC 0x54424C4BUL /* "TBLK" */
+#define MAX_CHUNKS 256
+#define MAP_BYTES (MAX_CHUNKS / 8)
+#define STAGE_HDR_LEN (20 + MAP_BYTES)
+#define STAGE_DATA_OFF 64
+#define STAGE_DATA_SADDR (TPMESH_BULK_STAGE_SADDR + STAGE_DATA_OFF)
+#define STAGE_DATA_LEN (TPMESH_BULK_STAGE_LEN - STAGE_DATA_OFF)
+
+/* 重新上线记录之后预留 256 字节 */
+#if TPMESH_BULK_STAGE_SADDR < (TPMESH_REJOIN_SADDR + 0x100)
+#error "bulk staging area overlaps the DDC rejoin record"
+#endif
+
+#if (TPMESH_BULK_STAGE_SADDR + TPMESH_BULK_STAGE_LEN) > BACNETOBJ_SADDR
+#error "bulk staging area overlaps BACnet object storage"
+#endif
+
+#if TPMESH_BULK_CHUNK < CHUNK_MIN || TPMESH_BULK_CHUNK > CHUNK_MAX
+#error "TPMESH_BULK_CHUNK does not fit a single mesh frame"
+#endif
+
+#if TPMESH_BULK_ENABLE
+/* TPMESH_BULK_TOKEN 须为 1..TOKEN_LEN 字节 (C99 无 _Static_assert) */
+typedef char bulk_token_len_check[(sizeof(TPMESH_BULK_TOKEN) >= 2 &&
+                                   sizeof(TPMESH_BULK_TOKEN) <= TOKEN_LEN + 1)
+                                      ? 1
+                                      : -1];
+#endif
+
+#if TPMESH_BULK_WINDOW < 1 || TPMESH_BULK_WINDOW > STATUS_MAP_CHUNKS
+#error "TPMESH_BULK_WINDOW must be 1..64"
+#endif
+
+/** Top Node 发送阶段 */
+typedef enum {
+  TX_IDLE = 0,
+  TX_UPLOAD, /**< 接收以太网侧上传 */
+  TX_START,  /**< 等待 DDC 接受会话 */
+  TX_SEND,   /**< 窗口发送 */
+  TX_COMMIT, /**< 等待 DDC 校验提交 */
+} tx_phase_t;
+
+/* ============================================================================
+ * 私有类型
+ * ============================================================================
+ */
+
+/** 允许写入的目标区域 */
+typedef struct {
+  uint32_t addr;
+  uint32_t len;
+} bulk_region_t;
+
+/** Top Node 发送状态 (桥接任务) */
+typedef struct {
+  volatile uint8_t phase;
+  uint16_t dest;
+  uint8_t sess;
+  uint32_t addr;
+  uint32_t len;
+  uint32_t crc;
+  uint16_t nchunks;
+  uint16_t base;                 /**< 第一个未确认块 */
+  uint8_t acked[MAP_BYTES];
+  uint16_t slot_idx[TPMESH_BULK_WINDOW];  /**< 窗口槽: 块号 */
+  uint32_t slot_tick[TPMESH_BULK_WINDOW]; /**< 窗口槽: 发送时刻 */
+  uint32_t last_rx;              /**< 最近一次 STATUS */
+  uint32_t due;                  /**< START / COMMIT 重发时刻 */
+  uint32_t gen;                  /**< 正在处理的上传连接 */
+  uint8_t hdr[UPLOAD_HDR_LEN];
+  uint8_t hdr_len;
+  uint32_t off;                  /**< 已写入暂存区的字节数 */
+} bulk_tx_t;
+
+/** DDC 接收状态 (桥接任务) */
+typedef struct {
+  uint8_t state; /**< tpmesh_bulk_state_t */
+  uint8_t sess;  /**< 0=启动时从暂存区恢复, 尚未有 START */
+  uint8_t chunk;
+  uint32_t addr;
+  uint32_t len;
+  uint32_t crc;
+  uint16_t nchunks;
+  uint16_t received;
+  uint16_t next; /**< 第一个缺失块 */
+  uint16_t since_ack;
+  uint16_t unsaved;
+  uint8_t map[MAP_BYTES];
+} bulk_rx_t;
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static const bulk_region_t s_regions[] = {TPMESH_BULK_REGIONS};
+
+static bool s_initialized = false;
+static bool s_is_top = false;
+static uint8_t s_frame[TPMESH_MTU];
+
+/* Top Node */
+static bulk_tx_t s_tx;
+static tpmesh_timer_t s_poll_timer;
+static bool s_finish_pending = false;
+
+/* Top Node 上传连接 (tcpip 线程与桥接任务共享) */
+static struct tcp_pcb *s_up_pcb = NULL;  /**< 仅 tcpip 线程 */
+static struct pbuf *s_up_q = NULL;       /**< 待写入暂存区 (临界区) */
+static uint32_t s_up_credit = 0;         /**< 待 tcp_recved (临界区) */
+static volatile bool s_up_active = false;
+static volatile bool s_up_eof = false;
+static volatile uint32_t s_up_gen = 0;
+static const char *volatile s_up_result = "";
+
+/* DDC */
+static bulk_rx_t s_rx;
+static tpmesh_bulk_commit_cb_t s_commit_cb = NULL;
+
+/** 共享口令 (补 0 到 TOKEN_LEN) */
+static const char s_token[TOKEN_LEN + 1] = TPMESH_BULK_TOKEN;
+
+/** 统计 */
+static uint32_t s_ok = 0;         /**< Top: 成功; DDC: 提交 */
+static uint32_t s_failed = 0;     /**< Top: 失败; DDC: CRC / 写入错误 */
+static uint32_t s_chunks = 0;     /**< Top: 发出; DDC: 收到新块 */
+static uint32_t s_retrans = 0;    /**< Top: 重传; DDC: 重复块 */
+static uint32_t s_resumed = 0;    /**< 续传 (DDC 已有部分块) */
+static uint32_t s_auth_fail = 0;  /**< Top: 上传口令不符; DDC: START 口令不符 */
+
+/* ============================================================================
+ * 私有函数 - 工具
+ * ============================================================================
+ */
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static bool map_test(const uint8_t *map, uint16_t idx) {
+  return (map[idx >> 3] & (1u << (idx & 7))) != 0;
+}
+
+static void map_set(uint8_t *map, uint16_t idx) {
+  map[idx >> 3] |= (uint8_t)(1u << (idx & 7));
+}
+
+static uint8_t *msg_begin(uint8_t *buf) {
+  buf[0] = 0x00; /* L2 HDR: 单播 */
+  buf[1] = 0x80; /* FRAG HDR: 单片 */
+  buf[2] = SCHC_RULE_BULK;
+  return buf + TPMESH_TUNNEL_HDR_LEN;
+}
+
+/**
+ * @brief CRC-32 (IEEE 802.3, 与 zlib crc32() 相同, 可分段累加)
+ * @param crc 上一段的结果 (首段为 0)
+ */
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+/**
+ * @brief 口令比较 (与 TPMESH_BULK_TOKEN 补 0 后逐字节比较, 耗时与内容无关)
+ */
+static bool token_match(const uint8_t *p) {
+  uint8_t diff = 0;
+  for (int i = 0; i < TOKEN_LEN; i++) {
+    diff |= (uint8_t)(p[i] ^ (uint8_t)s_token[i]);
+  }
+  return diff == 0;
+}
+
+static void token_put(uint8_t *p) { memcpy(p, s_token, TOKEN_LEN); }
+
+/**
+ * @brief 目标 [addr, addr+len) 是否落在某个允许区域内
+ */
+static bool region_allowed(uint32_t addr, uint32_t len) {
+  for (unsigned i = 0; i < sizeof(s_regions) / sizeof(s_regions[0]); i++) {
+    const bulk_region_t *r = &s_regions[i];
+    if (len > 0 && addr >= r->addr && len <= r->len &&
+        addr - r->addr <= r->len - len) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint16_t chunk_count(uint32_t len, uint8_t chunk) {
+  return (uint16_t)((len + chunk - 1) / chunk);
+}
+
+static uint16_t chunk_len(uint32_t len, uint8_t chunk, uint16_t idx) {
+  uint32_t off = (uint32_t)idx * chunk;
+  return (uint16_t)((len - off) < chunk ? (len - off) : chunk);
+}
+
+/* ============================================================================
+ * 私有函数 - Top Node 上传端点 (tcpip 线程)
+ * ============================================================================
+ */
+
+static err_t up_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                     err_t err) {
+  (void)arg;
+  (void)pcb;
+  if (p == NULL || err != ERR_OK) {
+    if (p != NULL) {
+      pbuf_free(p);
+    }
+    s_up_eof = true; /* 连接在回复结果后关闭 */
+    return ERR_OK;
+  }
+
+  /* 写入暂存区后才 tcp_recved(), 窗口随写入进度开合 */
+  taskENTER_CRITICAL();
+  if (s_up_q == NULL) {
+    s_up_q = p;
+  } else {
+    pbuf_cat(s_up_q, p);
+  }
+  taskEXIT_CRITICAL();
+  return ERR_OK;
+}
+
+static void up_err(void *arg, err_t err) {
+  (void)arg;
+  (void)err;
+  s_up_pcb = NULL; /* pcb 已释放 */
+  s_up_eof = true;
+}
+
+static err_t up_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
+  (void)arg;
+  if (err != ERR_OK || newpcb == NULL) {
+    return ERR_VAL;
+  }
+
+  if (s_up_active) {
+    tcp_write(newpcb, "BUSY\n", 5, TCP_WRITE_FLAG_COPY);
+    if (tcp_close(newpcb) != ERR_OK) {
+      tcp_abort(newpcb);
+      return ERR_ABRT;
+    }
+    return ERR_OK;
+  }
+
+  s_up_pcb = newpcb;
+  tcp_arg(newpcb, NULL);
+  tcp_recv(newpcb, up_recv);
+  tcp_err(newpcb, up_err);
+  s_up_eof = false;
+  s_up_gen++;
+  s_up_active = true;
+  return ERR_OK;
+}
+
+/**
+ * @brief 打开已写入暂存区的数据所占窗口
+ */
+static void up_recved(void *arg) {
+  (void)arg;
+  taskENTER_CRITICAL();
+  uint32_t n = s_up_credit;
+  s_up_credit = 0;
+  taskEXIT_CRITICAL();
+
+  while (s_up_pcb != NULL && n > 0) {
+    u16_t k = (n > 0xFFFF) ? 0xFFFF : (u16_t)n;
+    tcp_recved(s_up_pcb, k);
+    n -= k;
+  }
+}
+
+/**
+ * @brief 回复结果并关闭上传连接, 之后可接受新的上传
+ */
+static void up_finish(void *arg) {
+  (void)arg;
+  struct tcp_pcb *pcb = s_up_pcb;
+  if (pcb != NULL) {
+    s_up_pcb = NULL;
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_err(pcb, NULL);
+    const char *msg = s_up_result;
+    tcp_write(pcb, msg, (u16_t)strlen(msg), TCP_WRITE_FLAG_COPY);
+    if (tcp_close(pcb) != ERR_OK) {
+      tcp_abort(pcb);
+    }
+  }
+
+  taskENTER_CRITICAL();
+  struct pbuf *q = s_up_q;
+  s_up_q = NULL;
+  s_up_credit = 0;
+  taskEXIT_CRITICAL();
+  if (q != NULL) {
+    pbuf_free(q);
+  }
+  s_up_active = false;
+}
+
+static void up_start(void *arg) {
+  (void)arg;
+  struct tcp_pcb *pcb = tcp_new();
+  if (pcb == NULL ||
+      tcp_bind(pcb, IP_ADDR_ANY, TPMESH_BULK_PORT) != ERR_OK) {
+    tpmesh_debug_printf("Bulk: listen %u failed\n",
+                        (unsigned)TPMESH_BULK_PORT);
+    if (pcb != NULL) {
+      tcp_abort(pcb);
+    }
+    return;
+  }
+  struct tcp_pcb *lpcb = tcp_listen(pcb);
+  if (lpcb == NULL) {
+    tcp_abort(pcb);
+    return;
+  }
+  tcp_accept(lpcb, up_accept);
+}
+
+/* ============================================================================
+ * 私有函数 - Top Node 发送 (桥接任务)
+ * ============================================================================
+ */
+
+static uint32_t tx_rto(void) {
+  return tpmesh_rtt_timeout(s_tx.dest, 3, TPMESH_BULK_RTO_MS, 1000, 30000);
+}
+
+static void tx_post_finish(void) {
+  if (s_finish_pending && tcpip_try_callback(up_finish, NULL) == ERR_OK) {
+    s_finish_pending = false;
+  }
+}
+
+/**
+ * @brief 结束本次传输并回复上传方 (DDC 保留进度, 重新上传同一数据即续传)
+ */
+static void tx_finish(bool ok, const char *result) {
+  if (ok) {
+    s_ok++;
+  } else {
+    s_failed++;
+  }
+  tpmesh_debug_printf("Bulk: 0x%04X addr 0x%05lX len %lu: %s",
+                      s_tx.dest, (unsigned long)s_tx.addr,
+                      (unsigned long)s_tx.len, result);
+  s_tx.phase = TX_IDLE;
+  s_up_result = result;
+  s_finish_pending = true;
+  tx_post_finish();
+}
+
+static void tx_send_start(void) {
+  uint8_t *m = msg_begin(s_frame);
+  m[0] = MSG_START;
+  m[1] = s_tx.sess;
+  put_u32(m + 2, s_tx.addr);
+  put_u32(m + 6, s_tx.len);
+  put_u32(m + 10, s_tx.crc);
+  m[14] = TPMESH_BULK_CHUNK;
+  token_put(m + 15);
+  tpmesh_bridge_send_frame(s_tx.dest, s_frame,
+                           TPMESH_TUNNEL_HDR_LEN + START_LEN);
+}
+
+static void tx_send_commit(void) {
+  uint8_t *m = msg_begin(s_frame);
+  m[0] = MSG_COMMIT;
+  m[1] = s_tx.sess;
+  tpmesh_bridge_send_frame(s_tx.dest, s_frame,
+                           TPMESH_TUNNEL_HDR_LEN + COMMIT_LEN);
+}
+
+static void tx_send_data(uint16_t idx, bool ack_req) {
+  uint16_t dlen = chunk_len(s_tx.len, TPMESH_BULK_CHUNK, idx);
+  uint8_t *m = msg_begin(s_frame);
+  m[0] = (uint8_t)(MSG_DATA | (ack_req ? MSG_ACK_REQ : 0));
+  m[1] = s_tx.sess;
+  put_u16(m + 2, idx);
+  if (!EEPROMRead(STAGE_DATA_SADDR + (uint32_t)idx * TPMESH_BULK_CHUNK,
+                  m + DATA_HDR_LEN, dlen)) {
+    return; /* 按超时重试 */
+  }
+  tpmesh_bridge_send_frame(s_tx.dest, s_frame,
+                           (uint16_t)(TPMESH_TUNNEL_HDR_LEN + DATA_HDR_LEN +
+                                      dlen));
+}
+
+/**
+ * @brief 发送窗口内未发送或已超时的块, 最后一块请求 STATUS
+ */
+static void tx_pump(uint32_t now) {
+  uint16_t list[TPMESH_BULK_WINDOW];
+  uint16_t n = 0;
+  uint32_t rto = tx_rto();
+  uint32_t end = (uint32_t)s_tx.base + TPMESH_BULK_WINDOW;
+  if (end > s_tx.nchunks) {
+    end = s_tx.nchunks;
+  }
+
+  for (uint16_t idx = s_tx.base; idx < end; idx++) {
+    if (map_test(s_tx.acked, idx)) {
+      continue;
+    }
+    uint16_t slot = idx % TPMESH_BULK_WINDOW;
+    if (s_tx.slot_idx[slot] == idx) {
+      if (now - s_tx.slot_tick[slot] < rto) {
+        continue;
+      }
+      s_retrans++;
+    }
+    list[n++] = idx;
+  }
+
+  for (uint16_t k = 0; k < n; k++) {
+    uint16_t slot = list[k] % TPMESH_BULK_WINDOW;
+    s_tx.slot_idx[slot] = list[k];
+    s_tx.slot_tick[slot] = now;
+    tx_send_data(list[k], k == n - 1);
+    s_chunks++;
+  }
+}
+
+static void tx_restart(uint32_t now) {
+  memset(s_tx.acked, 0, sizeof(s_tx.acked));
+  memset(s_tx.slot_idx, 0xFF, sizeof(s_tx.slot_idx));
+  s_tx.base = 0;
+  s_tx.phase = TX_START;
+  tx_send_start();
+  s_tx.due = now + tx_rto();
+}
+
+/**
+ * @brief 上传完成: 开始向 DDC 发送
+ */
+static void tx_begin(uint32_t now) {
+  uint8_t sess;
+  do {
+    sess = (uint8_t)LWIP_RAND();
+  } while (sess == 0 || sess == s_tx.sess);
+  s_tx.sess = sess;
+  s_tx.nchunks = chunk_count(s_tx.len, TPMESH_BULK_CHUNK);
+  s_tx.last_rx = now;
+  tx_restart(now);
+}
+
+/**
+ * @brief 解析上传头
+ * @return NULL=有效, 否则为回复上传方的错误
+ */
+static const char *tx_parse_header(void) {
+  if (get_u32(s_tx.hdr) != UPLOAD_MAGIC) {
+    return "ERR header\n";
+  }
+  if (!token_match(s_tx.hdr + 16)) {
+    s_auth_fail++;
+    return "ERR auth\n";
+  }
+
+  ip4_addr_t ip;
+  IP4_ADDR(&ip, s_tx.hdr[4], s_tx.hdr[5], s_tx.hdr[6], s_tx.hdr[7]);
+  s_tx.dest = node_table_get_mesh_by_ip(&ip);
+  s_tx.addr = get_u32(s_tx.hdr + 8);
+  s_tx.len = get_u32(s_tx.hdr + 12);
+
+  if (s_tx.dest == MESH_ADDR_INVALID ||
+      !node_table_is_registered(s_tx.dest)) {
+    return "ERR unknown ddc\n";
+  }
+  if (node_table_is_remote(s_tx.dest)) {
+    return "ERR ddc on another top node\n";
+  }
+  if (s_tx.len > STAGE_DATA_LEN ||
+      chunk_count(s_tx.len, TPMESH_BULK_CHUNK) > MAX_CHUNKS ||
+      !region_allowed(s_tx.addr, s_tx.len)) {
+    return "ERR range\n";
+  }
+  return NULL;
+}
+
+/**
+ * @brief 处理一段上传数据 (头 + 写入暂存区)
+ */
+static void tx_upload_feed(const uint8_t *p, uint16_t n) {
+  while (n > 0 && s_tx.phase == TX_UPLOAD) {
+    if (s_tx.hdr_len < UPLOAD_HDR_LEN) {
+      uint16_t take = UPLOAD_HDR_LEN - s_tx.hdr_len;
+      take = (take < n) ? take : n;
+      memcpy(s_tx.hdr + s_tx.hdr_len, p, take);
+      s_tx.hdr_len = (uint8_t)(s_tx.hdr_len + take);
+      p += take;
+      n -= take;
+      if (s_tx.hdr_len == UPLOAD_HDR_LEN) {
+        const char *err = tx_parse_header();
+        if (err != NULL) {
+          tx_finish(false, err);
+        }
+      }
+      continue;
+    }
+
+    uint32_t left = s_tx.len - s_tx.off;
+    uint16_t take = (left < n) ? (uint16_t)left : n;
+    if (take == 0) {
+      return; /* 多余数据忽略 */
+    }
+    if (!EEPROMWrite(STAGE_DATA_SADDR + s_tx.off, (void *)p, take)) {
+      tx_finish(false, "ERR eeprom\n");
+      return;
+    }
+    s_tx.crc = crc32_update(s_tx.crc, p, take);
+    s_tx.off += take;
+    p += take;
+    n -= take;
+  }
+}
+
+/**
+ * @brief 取出 tcpip 线程收到的数据写入暂存区, 收齐后开始发送
+ */
+static void tx_upload_poll(uint32_t now) {
+  bool eof = s_up_eof; /* 先读: 之后取出的队列已包含 EOF 前全部数据 */
+
+  taskENTER_CRITICAL();
+  struct pbuf *q = s_up_q;
+  s_up_q = NULL;
+  taskEXIT_CRITICAL();
+
+  if (q != NULL) {
+    for (struct pbuf *b = q; b != NULL; b = b->next) {
+      tx_upload_feed((const uint8_t *)b->payload, b->len);
+    }
+    if (s_tx.phase != TX_IDLE) { /* 已结束: 连接即将关闭 */
+      taskENTER_CRITICAL();
+      s_up_credit += q->tot_len;
+      taskEXIT_CRITICAL();
+    }
+    pbuf_free(q);
+  }
+
+  if (s_tx.phase != TX_UPLOAD) {
+    return;
+  }
+  if (s_tx.hdr_len == UPLOAD_HDR_LEN && s_tx.off == s_tx.len) {
+    tx_begin(now);
+  } else if (eof) {
+    tx_finish(false, "ERR short upload\n");
+  }
+}
+
+static void tx_handle_status(uint16_t src, const uint8_t *m, uint16_t len) {
+  if (len < STATUS_LEN || src != s_tx.dest || m[1] != s_tx.sess ||
+      s_tx.phase < TX_START) {
+    return;
+  }
+
+  uint32_t now = tpmesh_get_tick_ms();
+  s_tx.last_rx = now;
+
+  switch (m[2]) {
+  case TPMESH_BULK_ST_RECEIVING: {
+    uint16_t next = get_u16(m + 3);
+    if (next > s_tx.nchunks) {
+      return;
+    }
+    for (uint16_t i = 0; i < next; i++) {
+      map_set(s_tx.acked, i);
+    }
+    for (uint16_t i = 0; i < STATUS_MAP_CHUNKS && next + i < s_tx.nchunks;
+         i++) {
+      uint16_t idx = (uint16_t)(next + i);
+      if (map_test(m + 5, i)) {
+        map_set(s_tx.acked, idx);
+      } else {
+        s_tx.acked[idx >> 3] &= (uint8_t)~(1u << (idx & 7));
+      }
+    }
+    s_tx.base = next;
+    while (s_tx.base < s_tx.nchunks && map_test(s_tx.acked, s_tx.base)) {
+      s_tx.base++;
+    }
+
+    if (s_tx.phase == TX_START && next > 0) {
+      s_resumed++;
+      tpmesh_debug_printf("Bulk: 0x%04X resume at chunk %u/%u\n", s_tx.dest,
+                          next, s_tx.nchunks);
+    }
+    if (s_tx.base >= s_tx.nchunks) {
+      if (s_tx.phase != TX_COMMIT) {
+        s_tx.phase = TX_COMMIT;
+        tx_send_commit();
+        s_tx.due = now + tx_rto();
+      }
+    } else {
+      s_tx.phase = TX_SEND;
+      tx_pump(now);
+    }
+    break;
+  }
+  case TPMESH_BULK_ST_DONE:
+    if (s_tx.phase == TX_COMMIT) {
+      tx_finish(true, "OK\n");
+    }
+    break;
+  case TPMESH_BULK_ST_ERR_SESSION:
+    /* DDC 丢失会话 (如重启): 重新 START, 已保存的块仍可续传 */
+    if (s_tx.phase != TX_START) {
+      tx_restart(now);
+    }
+    break;
+  case TPMESH_BULK_ST_ERR_RANGE:
+    tx_finish(false, "ERR range\n");
+    break;
+  case TPMESH_BULK_ST_ERR_CRC:
+    tx_finish(false, "ERR crc\n");
+    break;
+  case TPMESH_BULK_ST_ERR_AUTH:
+    tx_finish(false, "ERR ddc auth\n");
+    break;
+  default:
+    tx_finish(false, "ERR write\n");
+    break;
+  }
+}
+
+static void tx_poll_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)arg;
+  uint32_t now = tpmesh_get_tick_ms();
+
+  tx_post_finish();
+  if (s_up_credit > 0) {
+    tcpip_try_callback(up_recved, NULL); /* 失败则下次轮询重试 */
+  }
+
+  if (s_tx.phase == TX_IDLE && !s_finish_pending && s_up_active &&
+      s_up_gen != s_tx.gen) {
+    s_tx.gen = s_up_gen;
+    s_tx.hdr_len = 0;
+    s_tx.off = 0;
+    s_tx.crc = 0;
+    s_tx.dest = MESH_ADDR_INVALID;
+    s_tx.addr = 0;
+    s_tx.len = 0;
+    s_tx.phase = TX_UPLOAD;
+  }
+
+  switch (s_tx.phase) {
+  case TX_UPLOAD:
+    tx_upload_poll(now);
+    break;
+  case TX_START:
+  case TX_SEND:
+  case TX_COMMIT:
+    if (now - s_tx.last_rx >= TPMESH_BULK_TIMEOUT_MS) {
+      tx_finish(false, "ERR timeout\n");
+    } else if (s_tx.phase == TX_SEND) {
+      tx_pump(now);
+    } else if ((int32_t)(now - s_tx.due) >= 0) {
+      if (s_tx.phase == TX_START) {
+        tx_send_start();
+      } else {
+        tx_send_commit();
+      }
+      s_tx.due = now + tx_rto();
+    }
+    break;
+  default:
+    break;
+  }
+
+  tpmesh_timer_start(timer, TPMESH_BULK_POLL_MS);
+}
+
+/* ============================================================================
+ * 私有函数 - DDC 接收 (桥接任务)
+ * ============================================================================
+ */
+
+/**
+ * @brief 保存暂存区头与位图 (位图只包含已写入的块)
+ */
+static bool rx_save(void) {
+  uint8_t buf[STAGE_HDR_LEN];
+  put_u32(buf, STAGE_MAGIC);
+  put_u32(buf + 4, s_rx.addr);
+  put_u32(buf + 8, s_rx.len);
+  put_u32(buf + 12, s_rx.crc);
+  buf[16] = s_rx.chunk;
+  buf[17] = buf[18] = buf[19] = 0;
+  memcpy(buf + 20, s_rx.map, MAP_BYTES);
+  s_rx.unsaved = 0;
+  return EEPROMWrite(TPMESH_BULK_STAGE_SADDR, buf, sizeof(buf)) ? true : false;
+}
+
+static void rx_invalidate(void) {
+  uint8_t zero[4] = {0};
+  EEPROMWrite(TPMESH_BULK_STAGE_SADDR, zero, sizeof(zero));
+}
+
+static void rx_advance_next(void) {
+  while (s_rx.next < s_rx.nchunks && map_test(s_rx.map, s_rx.next)) {
+    s_rx.next++;
+  }
+}
+
+/**
+ * @brief 启动时恢复未完成的传输 (等待同一数据块的 START 续传)
+ */
+static void rx_load(void) {
+  uint8_t buf[STAGE_HDR_LEN];
+  if (GetEEPROMStatus() != EEPROM_OK ||
+      !EEPROMRead(TPMESH_BULK_STAGE_SADDR, buf, sizeof(buf)) ||
+      get_u32(buf) != STAGE_MAGIC) {
+    return;
+  }
+
+  uint32_t addr = get_u32(buf + 4);
+  uint32_t len = get_u32(buf + 8);
+  uint8_t chunk = buf[16];
+  if (chunk < CHUNK_MIN || chunk > CHUNK_MAX || len == 0 ||
+      len > STAGE_DATA_LEN || chunk_count(len, chunk) > MAX_CHUNKS ||
+      !region_allowed(addr, len)) {
+    return;
+  }
+
+  s_rx.addr = addr;
+  s_rx.len = len;
+  s_rx.crc = get_u32(buf + 12);
+  s_rx.chunk = chunk;
+  s_rx.nchunks = chunk_count(len, chunk);
+  memcpy(s_rx.map, buf + 20, MAP_BYTES);
+  for (uint16_t i = 0; i < s_rx.nchunks; i++) {
+    s_rx.received += map_test(s_rx.map, i) ? 1 : 0;
+  }
+  rx_advance_next();
+  s_rx.state = TPMESH_BULK_ST_RECEIVING;
+  tpmesh_debug_printf("Bulk: resumable transfer addr 0x%05lX, %u/%u chunks\n",
+                      (unsigned long)addr, s_rx.received, s_rx.nchunks);
+}
+
+static void rx_send_status(uint16_t dest, uint8_t sess, uint8_t state) {
+  uint8_t *m = msg_begin(s_frame);
+  memset(m, 0, STATUS_LEN);
+  m[0] = MSG_STATUS;
+  m[1] = sess;
+  m[2] = state;
+  if (state == TPMESH_BULK_ST_RECEIVING) {
+    put_u16(m + 3, s_rx.next);
+    for (uint16_t i = 0;
+         i < STATUS_MAP_CHUNKS && s_rx.next + i < s_rx.nchunks; i++) {
+      if (map_test(s_rx.map, (uint16_t)(s_rx.next + i))) {
+        map_set(m + 5, i);
+      }
+    }
+  }
+  s_rx.since_ack = 0;
+  tpmesh_bridge_send_frame(dest, s_frame, TPMESH_TUNNEL_HDR_LEN + STATUS_LEN);
+}
+
+static void rx_handle_start(uint16_t src, const uint8_t *m, uint16_t len) {
+  if (len < START_LEN) {
+    return;
+  }
+
+  uint8_t sess = m[1];
+  uint32_t addr = get_u32(m + 2);
+  uint32_t blen = get_u32(m + 6);
+  uint32_t crc = get_u32(m + 10);
+  uint8_t chunk = m[14];
+
+  /* 口令不符: 不改动现有会话与暂存区 */
+  if (!token_match(m + 15)) {
+    s_auth_fail++;
+    rx_send_status(src, sess, TPMESH_BULK_ST_ERR_AUTH);
+    return;
+  }
+
+  if (chunk < CHUNK_MIN || chunk > CHUNK_MAX || blen == 0 ||
+      blen > STAGE_DATA_LEN || chunk_count(blen, chunk) > MAX_CHUNKS ||
+      !region_allowed(addr, blen)) {
+    rx_send_status(src, sess, TPMESH_BULK_ST_ERR_RANGE);
+    return;
+  }
+
+  if (s_rx.state == TPMESH_BULK_ST_RECEIVING && s_rx.addr == addr &&
+      s_rx.len == blen && s_rx.crc == crc && s_rx.chunk == chunk) {
+    /* 同一数据块: 沿用已收到的块 */
+    if (s_rx.sess != sess && s_rx.received > 0) {
+      s_resumed++;
+    }
+    s_rx.sess = sess;
+  } else if (s_rx.sess != sess || s_rx.state == TPMESH_BULK_ST_IDLE) {
+    memset(&s_rx, 0, sizeof(s_rx));
+    s_rx.sess = sess;
+    s_rx.addr = addr;
+    s_rx.len = blen;
+    s_rx.crc = crc;
+    s_rx.chunk = chunk;
+    s_rx.nchunks = chunk_count(blen, chunk);
+    s_rx.state = rx_save() ? TPMESH_BULK_ST_RECEIVING
+                           : TPMESH_BULK_ST_ERR_WRITE;
+  }
+  rx_send_status(src, sess, s_rx.state);
+}
+
+static void rx_handle_data(uint16_t src, const uint8_t *m, uint16_t len) {
+  if (len < DATA_HDR_LEN) {
+    return;
+  }
+
+  uint8_t sess = m[1];
+  if (sess != s_rx.sess || s_rx.state != TPMESH_BULK_ST_RECEIVING) {
+    rx_send_status(src, sess,
+                   (sess == s_rx.sess) ? s_rx.state
+                                       : TPMESH_BULK_ST_ERR_SESSION);
+    return;
+  }
+
+  uint16_t idx = get_u16(m + 2);
+  uint16_t dlen = (uint16_t)(len - DATA_HDR_LEN);
+  if (idx >= s_rx.nchunks || dlen != chunk_len(s_rx.len, s_rx.chunk, idx)) {
+    return;
+  }
+
+  if (map_test(s_rx.map, idx)) {
+    s_retrans++; /* 发送方未收到确认: 立即回复 */
+    rx_send_status(src, sess, s_rx.state);
+    return;
+  }
+
+  if (!EEPROMWrite(STAGE_DATA_SADDR + (uint32_t)idx * s_rx.chunk,
+                   (void *)(m + DATA_HDR_LEN), dlen)) {
+    return; /* 未置位, 发送方超时重传 */
+  }
+  map_set(s_rx.map, idx);
+  s_rx.received++;
+  s_chunks++;
+
+  bool gap = (idx != s_rx.next); /* 前面有缺失块, 尽早告知 */
+  rx_advance_next();
+  s_rx.since_ack++;
+  s_rx.unsaved++;
+
+  bool complete = (s_rx.received == s_rx.nchunks);
+  if (complete || s_rx.unsaved >= TPMESH_BULK_SAVE_EVERY) {
+    rx_save();
+  }
+  if ((m[0] & MSG_ACK_REQ) || gap || complete ||
+      s_rx.since_ack >= TPMESH_BULK_ACK_EVERY) {
+    rx_send_status(src, sess, s_rx.state);
+  }
+}
+
+/**
+ * @brief 校验暂存区 CRC32 并复制到目标地址
+ * @return 最终状态
+ */
+static uint8_t rx_commit(void) {
+  uint8_t buf[CHUNK_MAX];
+  uint32_t crc = 0;
+
+  for (uint32_t off = 0; off < s_rx.len; off += sizeof(buf)) {
+    uint32_t n = s_rx.len - off;
+    n = (n < sizeof(buf)) ? n : sizeof(buf);
+    if (!EEPROMRead(STAGE_DATA_SADDR + off, buf, n)) {
+      return TPMESH_BULK_ST_ERR_WRITE;
+    }
+    crc = crc32_update(crc, buf, n);
+  }
+  if (crc != s_rx.crc) {
+    return TPMESH_BULK_ST_ERR_CRC;
+  }
+
+  for (uint32_t off = 0; off < s_rx.len; off += sizeof(buf)) {
+    uint32_t n = s_rx.len - off;
+    n = (n < sizeof(buf)) ? n : sizeof(buf);
+    if (!EEPROMRead(STAGE_DATA_SADDR + off, buf, n) ||
+        !EEPROMWrite(s_rx.addr + off, buf, n)) {
+      return TPMESH_BULK_ST_ERR_WRITE;
+    }
+  }
+  return TPMESH_BULK_ST_DONE;
+}
+
+static void rx_handle_commit(uint16_t src, const uint8_t *m, uint16_t len) {
+  if (len < COMMIT_LEN) {
+    return;
+  }
+
+  uint8_t sess = m[1];
+  if (sess != s_rx.sess || s_rx.state == TPMESH_BULK_ST_IDLE) {
+    rx_send_status(src, sess, TPMESH_BULK_ST_ERR_SESSION);
+    return;
+  }
+  if (s_rx.state != TPMESH_BULK_ST_RECEIVING ||
+      s_rx.received < s_rx.nchunks) {
+    rx_send_status(src, sess, s_rx.state); /* 重复 COMMIT 或尚未收齐 */
+    return;
+  }
+
+  /* 无论成败都丢弃暂存区: 重新上传从头开始 */
+  s_rx.state = rx_commit();
+  rx_invalidate();
+  if (s_rx.state == TPMESH_BULK_ST_DONE) {
+    s_ok++;
+  } else {
+    s_failed++;
+  }
+  tpmesh_debug_printf("Bulk: commit addr 0x%05lX len %lu: state 0x%02X\n",
+                      (unsigned long)s_rx.addr, (unsigned long)s_rx.len,
+                      s_rx.state);
+  rx_send_status(src, sess, s_rx.state);
+
+  if (s_rx.state == TPMESH_BULK_ST_DONE) {
+    if (s_commit_cb != NULL) {
+      s_commit_cb(s_rx.addr, s_rx.len);
+    } else {
+      tpmesh_debug_printf("Bulk: takes effect after restart\n");
+    }
+  }
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_bulk_init(bool is_top) {
+  if (!TPMESH_BULK_ENABLE || s_initialized) {
+    return 0;
+  }
+  s_is_top = is_top;
+  if (is_top) {
+    memset(&s_tx, 0, sizeof(s_tx));
+    if (tcpip_callback(up_start, NULL) != ERR_OK) {
+      return -1;
+    }
+    tpmesh_timer_setup(&s_poll_timer, tx_poll_expired, NULL);
+    tpmesh_timer_start(&s_poll_timer, TPMESH_BULK_POLL_MS);
+  } else {
+    memset(&s_rx, 0, sizeof(s_rx));
+    rx_load();
+  }
+
+  s_initialized = true;
+  return 0;
+}
+
+void tpmesh_bulk_set_commit_cb(tpmesh_bulk_commit_cb_t cb) {
+  s_commit_cb = cb;
+}
+
+void tpmesh_bulk_mesh_input(uint16_t src_mesh_id, const uint8_t *data,
+                            uint16_t len) {
+  if (!s_initialized || data == NULL || len < 2) {
+    return;
+  }
+
+  if (s_is_top) {
+    if (data[0] == MSG_STATUS) {
+      tx_handle_status(src_mesh_id, data, len);
+    }
+    return;
+  }
+
+  if (!MESH_ADDR_IS_TOP(src_mesh_id)) {
+    return;
+  }
+  switch (data[0] & (uint8_t)~MSG_ACK_REQ) {
+  case MSG_START:
+    rx_handle_start(src_mesh_id, data, len);
+    break;
+  case MSG_DATA:
+    rx_handle_data(src_mesh_id, data, len);
+    break;
+  case MSG_COMMIT:
+    rx_handle_commit(src_mesh_id, data, len);
+    break;
+  default:
+    break;
+  }
+}
+
+void tpmesh_bulk_dump(void) {
+  if (!s_initialized) {
+    return;
+  }
+
+  if (s_is_top) {
+    static const char *const phases[] = {"idle", "upload", "start", "send",
+                                         "commit"};
+    tpmesh_debug_printf("Bulk: %s", phases[s_tx.phase]);
+    if (s_tx.phase >= TX_START) {
+      tpmesh_debug_printf(" 0x%04X %u/%u chunks", s_tx.dest, s_tx.base,
+                          s_tx.nchunks);
+    } else if (s_tx.phase == TX_UPLOAD) {
+      tpmesh_debug_printf(" %lu/%lu bytes", (unsigned long)s_tx.off,
+                          (unsigned long)s_tx.len);
+    }
+    tpmesh_debug_printf(", ok %lu, failed %lu, chunks %lu, retrans %lu, "
+                        "resumed %lu, auth fail %lu\n",
+                        (unsigned long)s_ok, (unsigned long)s_failed,
+                        (unsigned long)s_chunks, (unsigned long)s_retrans,
+                        (unsigned long)s_resumed, (unsigned long)s_auth_fail);
+  } else {
+    tpmesh_debug_printf("Bulk rx: state 0x%02X %u/%u chunks, committed %lu, "
+                        "failed %lu, chunks %lu, dup %lu, resumed %lu, "
+                        "auth fail %lu\n",
+                        s_rx.state, s_rx.received, s_rx.nchunks,
+                        (unsigned long)s_ok, (unsigned long)s_failed,
+                        (unsigned long)s_chunks, (unsigned long)s_retrans,
+                        (unsigned long)s_resumed, (unsigned long)s_auth_fail);
+  }
+}
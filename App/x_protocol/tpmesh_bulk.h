@@ -0,0 +1,179 @@
+/**
+ * @file tpmesh_bulk.h
+ * @brief TPMesh 批量传输 (功能块程序 / 配置块经 Mesh 下载到 DDC)
+ *
+ * 经 BMS / Modbus 下载功能块程序或整块配置时, 每个请求只有数百字节且
+ * 一问一答, 经 Mesh 下载数十 KB 需要数分钟。启用后:
+ * - Top Node 在以太网侧监听 TPMESH_BULK_PORT, 上位机以一条 TCP 连接上传
+ *   整块数据, Top Node 先写入本机暂存区并计算 CRC32
+ * - Top Node 以 SCHC_RULE_BULK 报文按块 (TPMESH_BULK_CHUNK) 发给 DDC,
+ *   滑动窗口 (TPMESH_BULK_WINDOW 块) 内连续发送, DDC 以块位图确认,
+ *   只重传缺失的块, 超时取自到该 DDC 的 RTT
+ * - DDC 把块写入本机暂存区, 位图定期随暂存区头保存; 中断后 (链路中断、
+ *   任一端重启) 重新上传同一数据块时只补发缺失的块
+ * - 全部收齐后 DDC 校验 CRC32, 一致才复制到目标地址, 并调用提交回调
+ *
+ * 上传 (以太网侧 TCP, 多字节字段大端):
+ *   [Magic "TPBK":4][DDC IP:4][Addr:4][Len:4][Token:16] + Len 字节数据
+ *   Top Node 回一行结果后关闭: "OK" / "BUSY" / "ERR <原因>"
+ *   Token 为 TPMESH_BULK_TOKEN (不足 16 字节补 0), 不符时不写暂存区
+ *   Addr/Len 须落在 TPMESH_BULK_REGIONS 的同一区域内 (默认: 配置区
+ *   SETTING_START_ADDR..FB_SADDR, 功能块区 FB_SADDR..EXPREGSHDR_SADDR)
+ *
+ * 报文 (隧道头之后, 多字节字段大端):
+ *   START  [0x01][Sess:1][Addr:4][Len:4][CRC32:4][Chunk:1][Token:16]
+ *                                                            Top → DDC
+ *   DATA   [0x02][Sess:1][Idx:2] + 数据                      Top → DDC
+ *          (类型 bit7 置位: 请求立即回 STATUS)
+ *   COMMIT [0x03][Sess:1]                                    Top → DDC
+ *   STATUS [0x04][Sess:1][State:1][Next:2][Map:8]            DDC → Top
+ * Next 为第一个缺失块, Map bit i (字节 i/8 的 bit i%8) 表示块 Next+i
+ * 已收到。State 见 tpmesh_bulk_state_t。DDC 只在 START 的 Token 与本机
+ * 一致时才建立会话并写暂存区。
+ *
+ * 线程: 报文处理、暂存区读写与重传在桥接任务; Top Node 的 TCP 监听在
+ * tcpip 线程, 收到的数据交给桥接任务写入暂存区后才 tcp_recved()。
+ *
+ * @version 0.8.0
+ */
+
+#ifndef TPMESH_BULK_H
+#define TPMESH_BULK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 启用批量传输 (可写配置区与功能块区, 须同时配置 TPMESH_BULK_TOKEN) */
+#ifndef TPMESH_BULK_ENABLE
+#define TPMESH_BULK_ENABLE 0
+#endif
+
+/** 共享口令 (1..16 字节; 启用时为空或超长则编译失败) */
+#ifndef TPMESH_BULK_TOKEN
+#define TPMESH_BULK_TOKEN ""
+#endif
+
+/** Top Node: 以太网侧上传端口 */
+#ifndef TPMESH_BULK_PORT
+#define TPMESH_BULK_PORT 4950
+#endif
+
+/** 暂存区在模拟 EEPROM 中的起始地址 (紧随 DDC 重新上线记录之后) */
+#ifndef TPMESH_BULK_STAGE_SADDR
+#define TPMESH_BULK_STAGE_SADDR 0xA000
+#endif
+
+/** 暂存区长度 (含 64 字节头; 须容纳功能块区) */
+#ifndef TPMESH_BULK_STAGE_LEN
+#define TPMESH_BULK_STAGE_LEN 0x6000
+#endif
+
+/** 允许写入的目标区域 {起始地址, 长度} (AppConfig.h 地址) */
+#ifndef TPMESH_BULK_REGIONS
+#define TPMESH_BULK_REGIONS                                                    \
+  {SETTING_START_ADDR, FB_SADDR - SETTING_START_ADDR},                         \
+      {FB_SADDR, EXPREGSHDR_SADDR - FB_SADDR}
+#endif
+
+/** 块大小 (字节, 不超过 TPMESH_MTU - 隧道头 - 4) */
+#ifndef TPMESH_BULK_CHUNK
+#define TPMESH_BULK_CHUNK 128
+#endif
+
+/** 发送窗口 (块, 1..64) */
+#ifndef TPMESH_BULK_WINDOW
+#define TPMESH_BULK_WINDOW 8
+#endif
+
+/** DDC: 每收到多少个新块回一次 STATUS */
+#ifndef TPMESH_BULK_ACK_EVERY
+#define TPMESH_BULK_ACK_EVERY 8
+#endif
+
+/** DDC: 每收到多少个新块保存一次位图 */
+#ifndef TPMESH_BULK_SAVE_EVERY
+#define TPMESH_BULK_SAVE_EVERY 16
+#endif
+
+/** Top Node: 尚无 RTT 样本时的重传超时 (ms) */
+#ifndef TPMESH_BULK_RTO_MS
+#define TPMESH_BULK_RTO_MS 3000
+#endif
+
+/** Top Node: 持续收不到 STATUS 多久判定失败 (ms; DDC 保留进度供续传) */
+#ifndef TPMESH_BULK_TIMEOUT_MS
+#define TPMESH_BULK_TIMEOUT_MS 60000
+#endif
+
+/** Top Node: 上传与重传轮询周期 (ms) */
+#ifndef TPMESH_BULK_POLL_MS
+#define TPMESH_BULK_POLL_MS 100
+#endif
+
+/** DDC 传输状态 (STATUS.State) */
+typedef enum {
+  TPMESH_BULK_ST_IDLE = 0x00,      /**< 无会话 */
+  TPMESH_BULK_ST_RECEIVING = 0x01, /**< 接收中, Next/Map 有效 */
+  TPMESH_BULK_ST_DONE = 0x02,      /**< 已校验并提交 */
+  TPMESH_BULK_ST_ERR_RANGE = 0x81, /**< 目标区域或参数不允许 */
+  TPMESH_BULK_ST_ERR_SESSION = 0x82, /**< 会话不存在, 需重新 START */
+  TPMESH_BULK_ST_ERR_CRC = 0x83,   /**< CRC32 不一致, 已丢弃 */
+  TPMESH_BULK_ST_ERR_WRITE = 0x84, /**< EEPROM 写入失败 */
+  TPMESH_BULK_ST_ERR_AUTH = 0x85,  /**< START 口令不符, 未建立会话 */
+} tpmesh_bulk_state_t;
+
+/**
+ * @brief DDC: 提交回调 (桥接任务, 数据已写入目标地址)
+ * @param addr 目标地址
+ * @param len 长度
+ */
+typedef void (*tpmesh_bulk_commit_cb_t)(uint32_t addr, uint32_t len);
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化 (桥接任务中, 定时轮初始化之后调用)
+ * @param is_top true=Top Node (上传端点与发送方), false=DDC (接收方)
+ * @return 0=成功 (含未启用), -1=失败
+ */
+int tpmesh_bulk_init(bool is_top);
+
+/**
+ * @brief DDC: 设置提交回调 (如重新加载功能块或安排重启)
+ *
+ * 未设置时只打印日志, 新数据在下次启动时生效。本模块不注册任何回调:
+ * 回调在桥接任务中执行, 重新加载功能块等操作须由集成方转交主任务。
+ */
+void tpmesh_bulk_set_commit_cb(tpmesh_bulk_commit_cb_t cb);
+
+/**
+ * @brief 处理 SCHC_RULE_BULK 报文 (桥接任务)
+ * @param src_mesh_id 源 Mesh ID
+ * @param data 报文 (隧道头之后)
+ * @param len 长度
+ */
+void tpmesh_bulk_mesh_input(uint16_t src_mesh_id, const uint8_t *data,
+                            uint16_t len);
+
+/**
+ * @brief 打印批量传输状态
+ */
+void tpmesh_bulk_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_BULK_H */
@@ -0,0 +1,165 @@
+/**
+ * @file tpmesh_icmp_proxy.c
+ * @brief TPMesh ICMP 回显代理实现
+ *
+ * @version 0.8.0
+ */
+
+#include "tpmesh_icmp_proxy.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+
+/* node_table.h 已通过 tpmesh_bridge.h 包含 */
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/icmp.h"
+#include "lwip/prot/ip.h"
+#include "lwip/prot/ip4.h"
+#include <string.h>
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+/** DEEP 模式计数槽 (按 Mesh ID 低位; 冲突的 DDC 共用计数, 只影响抽样位置) */
+#define DEEP_SLOTS 64
+
+static struct netif *s_eth_netif = NULL;
+static volatile uint8_t s_mode = TPMESH_ICMP_PROXY_MODE;
+static uint8_t s_deep_count[DEEP_SLOTS];
+
+/** 统计 */
+static uint32_t s_answered = 0;
+static uint32_t s_forwarded = 0;  /**< DEEP 抽样转发 */
+static uint32_t s_unhealthy = 0;  /**< 不健康, 转发 */
+static uint32_t s_send_fail = 0;
+
+/* ============================================================================
+ * 私有函数
+ * ============================================================================
+ */
+
+/**
+ * @brief 定位 ICMP 回显请求的 IP 头 (须在第一个 pbuf 内, 非分片)
+ * @return IP 头, NULL=不是
+ */
+static struct ip_hdr *echo_request_iph(struct pbuf *p) {
+  if (p->len < SIZEOF_ETH_HDR + IP_HLEN + 8) {
+    return NULL;
+  }
+
+  struct eth_hdr *eth = (struct eth_hdr *)p->payload;
+  if (eth->type != PP_HTONS(ETHTYPE_IP)) {
+    return NULL;
+  }
+
+  struct ip_hdr *iph = (struct ip_hdr *)((uint8_t *)p->payload + SIZEOF_ETH_HDR);
+  uint16_t hlen = IPH_HL_BYTES(iph);
+  if (IPH_V(iph) != 4 || IPH_PROTO(iph) != IP_PROTO_ICMP || hlen < IP_HLEN ||
+      (IPH_OFFSET(iph) & PP_HTONS(IP_OFFMASK | IP_MF)) != 0 ||
+      p->len < SIZEOF_ETH_HDR + hlen + 8) {
+    return NULL;
+  }
+
+  const uint8_t *icmp = (const uint8_t *)iph + hlen;
+  return (icmp[0] == ICMP_ECHO && icmp[1] == 0) ? iph : NULL;
+}
+
+/**
+ * @brief 以 DDC 名义回复 (MAC/IP 对调, 类型改为 ECHO_REPLY)
+ */
+static int send_echo_reply(struct pbuf *req) {
+  struct pbuf *q = pbuf_clone(PBUF_RAW, PBUF_RAM, req);
+  if (q == NULL) {
+    return -1;
+  }
+
+  struct eth_hdr *eth = (struct eth_hdr *)q->payload;
+  struct eth_addr mac = eth->dest;
+  eth->dest = eth->src;
+  eth->src = mac;
+
+  struct ip_hdr *iph = (struct ip_hdr *)((uint8_t *)q->payload + SIZEOF_ETH_HDR);
+  ip4_addr_p_t ip = iph->src;
+  iph->src = iph->dest;
+  iph->dest = ip; /* 对调不改变 IP 头校验和 */
+
+  /* 类型 8 → 0: 校验和增加 0x0800 (RFC 1624) */
+  uint8_t *icmp = (uint8_t *)iph + IPH_HL_BYTES(iph);
+  uint16_t sum = (uint16_t)((icmp[2] << 8) | icmp[3]);
+  uint32_t s = (uint32_t)sum + ((uint32_t)ICMP_ECHO << 8);
+  s = (s & 0xFFFF) + (s >> 16);
+  icmp[0] = ICMP_ER;
+  icmp[2] = (uint8_t)(s >> 8);
+  icmp[3] = (uint8_t)s;
+
+  err_t err = s_eth_netif->linkoutput(s_eth_netif, q);
+  pbuf_free(q);
+  return (err == ERR_OK) ? 0 : -1;
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_icmp_proxy_init(struct netif *eth_netif) {
+  s_eth_netif = eth_netif;
+  memset(s_deep_count, 0, sizeof(s_deep_count));
+  return 0;
+}
+
+void tpmesh_icmp_proxy_set_mode(uint8_t mode) {
+  s_mode = (mode <= TPMESH_ICMP_PROXY_DEEP) ? mode : TPMESH_ICMP_PROXY_OFF;
+}
+
+bool tpmesh_icmp_proxy_match(struct pbuf *p) {
+  return s_eth_netif != NULL && s_mode != TPMESH_ICMP_PROXY_OFF &&
+         echo_request_iph(p) != NULL;
+}
+
+bool tpmesh_icmp_proxy_input(struct pbuf *p) {
+  struct ip_hdr *iph = echo_request_iph(p);
+  if (iph == NULL || s_eth_netif == NULL) {
+    return false;
+  }
+
+  /* 目的 IP 与目的 MAC 须为同一 DDC */
+  ip4_addr_t dst;
+  ip4_addr_copy(dst, iph->dest);
+  uint16_t mesh_id = node_table_get_mesh_by_ip(&dst);
+  if (mesh_id == MESH_ADDR_INVALID ||
+      node_table_get_mesh_by_mac((uint8_t *)p->payload) != mesh_id) {
+    return false;
+  }
+
+  if (node_table_healthy_idle(mesh_id) > TPMESH_ICMP_PROXY_MAX_IDLE_MS) {
+    s_unhealthy++;
+    return false;
+  }
+
+  if (s_mode == TPMESH_ICMP_PROXY_DEEP) {
+    uint8_t *cnt = &s_deep_count[mesh_id % DEEP_SLOTS];
+    if (++(*cnt) >= TPMESH_ICMP_PROXY_DEEP_N) {
+      *cnt = 0;
+      s_forwarded++;
+      return false;
+    }
+  }
+
+  if (send_echo_reply(p) != 0) {
+    s_send_fail++;
+    return false;
+  }
+  s_answered++;
+  return true;
+}
+
+void tpmesh_icmp_proxy_dump(void) {
+  static const char *const modes[] = {"off", "answer", "deep"};
+  tpmesh_debug_printf("ICMP proxy: %s, answered %lu, forwarded %lu "
+                      "(unhealthy %lu), send fail %lu\n",
+                      modes[s_mode], (unsigned long)s_answered,
+                      (unsigned long)s_forwarded, (unsigned long)s_unhealthy,
+                      (unsigned long)s_send_fail);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file tpmesh_icmp_proxy.h
+ * @brief TPMesh ICMP 回显代理 (Top Node 代 DDC 应答 ping)
+ *
+ * 运维/监控系统每分钟 ping 所有 DDC, 每个回显请求和应答都以不压缩帧
+ * 穿越 Mesh。启用后 Top Node 对本机注册且健康 (在线、未可疑、最近
+ * TPMESH_ICMP_PROXY_MAX_IDLE_MS 内有流量, 见 node_table_healthy_idle())
+ * 的 DDC 直接以 DDC 的 MAC/IP 回复, 存活信息取自心跳与数据流量:
+ * - TPMESH_ICMP_PROXY_ANSWER: 健康即代答, 不健康时照常转发, 由 DDC 自己
+ *   应答 (离线则监控看到超时)
+ * - TPMESH_ICMP_PROXY_DEEP: 同上, 但每个 DDC 每 TPMESH_ICMP_PROXY_DEEP_N
+ *   个请求转发一个, 保留端到端检查
+ *
+ * 应答在以太网输入线程构造并直接经以太网 linkoutput 发送。
+ *
+ * @version 0.8.0
+ */
+
+#ifndef TPMESH_ICMP_PROXY_H
+#define TPMESH_ICMP_PROXY_H
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 代理模式 */
+typedef enum {
+  TPMESH_ICMP_PROXY_OFF = 0,    /**< 全部转发到 DDC */
+  TPMESH_ICMP_PROXY_ANSWER = 1, /**< 健康的 DDC 由 Top Node 代答 */
+  TPMESH_ICMP_PROXY_DEEP = 2,   /**< 代答, 每 N 个转发一个 */
+} tpmesh_icmp_proxy_mode_t;
+
+/** 默认模式 */
+#ifndef TPMESH_ICMP_PROXY_MODE
+#define TPMESH_ICMP_PROXY_MODE TPMESH_ICMP_PROXY_ANSWER
+#endif
+
+/** 代答要求的最近活跃时间 (ms): 默认两个心跳周期 */
+#ifndef TPMESH_ICMP_PROXY_MAX_IDLE_MS
+#define TPMESH_ICMP_PROXY_MAX_IDLE_MS (2 * TPMESH_HEARTBEAT_MS)
+#endif
+
+/** DEEP 模式: 每 N 个请求转发一个 */
+#ifndef TPMESH_ICMP_PROXY_DEEP_N
+#define TPMESH_ICMP_PROXY_DEEP_N 10
+#endif
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化 (Top Node)
+ * @param eth_netif 以太网 netif
+ * @return 0=成功
+ */
+int tpmesh_icmp_proxy_init(struct netif *eth_netif);
+
+/**
+ * @brief 运行中切换模式
+ * @param mode 模式 (tpmesh_icmp_proxy_mode_t)
+ */
+void tpmesh_icmp_proxy_set_mode(uint8_t mode);
+
+/**
+ * @brief 以太网帧是否为 ICMP 回显请求且代理已启用 (目的 MAC 已确认为 DDC)
+ * @param p 以太网帧
+ * @return true=交给 tpmesh_icmp_proxy_input()
+ */
+bool tpmesh_icmp_proxy_match(struct pbuf *p);
+
+/**
+ * @brief 代答回显请求 (以太网输入线程)
+ * @param p 以太网帧
+ * @return true=已代答 (调用方释放), false=按原路径转发到 Mesh
+ */
+bool tpmesh_icmp_proxy_input(struct pbuf *p);
+
+/**
+ * @brief 打印统计
+ */
+void tpmesh_icmp_proxy_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_ICMP_PROXY_H */
@@ -0,0 +1,309 @@
+/**
+ * @file tpmesh_inflight.c
+ * @brief TPMesh 在途确认请求跟踪实现
+ *
+ * @version 0.7.1
+ */
+
+#include "tpmesh_inflight.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_rtt.h"
+#include "tpmesh_timer.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include <string.h>
+
+/* ============================================================================
+ * 类型定义
+ * ============================================================================
+ */
+
+/** 在途请求条目 */
+typedef struct {
+  bool valid;
+  uint16_t mesh_id;  /**< 目标 DDC */
+  uint8_t bms_ip[4]; /**< BMS IP (网络序) */
+  uint16_t bms_port; /**< BMS UDP 端口 */
+  uint8_t invoke_id;
+  uint8_t service;
+  bool retx;         /**< 过期后再次转发 (应答时间不作 RTT 样本) */
+  uint32_t tick;     /**< 首次转发时间 */
+  uint32_t timeout;  /**< 过期时间 (ms) */
+  tpmesh_timer_t timer; /**< 过期定时器 */
+} inflight_entry_t;
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static inflight_entry_t s_entries[TPMESH_INFLIGHT_ENTRIES];
+
+static tpmesh_inflight_stats_t s_stats;
+
+static SemaphoreHandle_t s_inflight_mutex = NULL;
+
+/* ============================================================================
+ * 私有函数
+ * ============================================================================
+ */
+
+/**
+ * @brief 提取确认请求的键 (仅不分段确认请求)
+ * @return true=可跟踪
+ */
+static bool request_key(const tpmesh_bac_pkt_t *req, inflight_entry_t *key) {
+  if (req->apdu_len < 4) {
+    return false;
+  }
+
+  const uint8_t *a = req->apdu;
+  if ((a[0] & 0xF0) != TPMESH_BAC_PDU_CONFIRMED ||
+      (a[0] & TPMESH_BAC_PDU_SEG)) {
+    return false;
+  }
+
+  memcpy(key->bms_ip, req->ip + 12, 4);
+  key->bms_port = ((uint16_t)req->udp[0] << 8) | req->udp[1];
+  key->invoke_id = a[2];
+  key->service = a[3];
+  return true;
+}
+
+/**
+ * @brief 过期定时器到期: 未应答的请求允许重传再次转发
+ */
+static void entry_expired(tpmesh_timer_t *timer, void *arg) {
+  inflight_entry_t *e = (inflight_entry_t *)arg;
+
+  xSemaphoreTake(s_inflight_mutex, portMAX_DELAY);
+  if (e->valid &&
+      tpmesh_get_tick_ms() - e->tick >= e->timeout) {
+    e->valid = false;
+    s_stats.expired++;
+  } else if (e->valid) {
+    tpmesh_timer_start_at(timer, e->tick + e->timeout);
+  }
+  xSemaphoreGive(s_inflight_mutex);
+}
+
+/**
+ * @brief 结束条目 (调用方持锁)
+ */
+static void entry_close(inflight_entry_t *e) {
+  e->valid = false;
+  tpmesh_timer_stop(&e->timer);
+}
+
+static inflight_entry_t *find_entry(uint16_t mesh_id,
+                                    const inflight_entry_t *key) {
+  for (int i = 0; i < TPMESH_INFLIGHT_ENTRIES; i++) {
+    inflight_entry_t *e = &s_entries[i];
+    if (e->valid && e->mesh_id == mesh_id && e->invoke_id == key->invoke_id &&
+        e->bms_port == key->bms_port &&
+        memcmp(e->bms_ip, key->bms_ip, 4) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_inflight_init(void) {
+  memset(s_entries, 0, sizeof(s_entries));
+  memset(&s_stats, 0, sizeof(s_stats));
+
+  for (int i = 0; i < TPMESH_INFLIGHT_ENTRIES; i++) {
+    tpmesh_timer_setup(&s_entries[i].timer, entry_expired, &s_entries[i]);
+  }
+
+  if (s_inflight_mutex == NULL) {
+    s_inflight_mutex = xSemaphoreCreateMutex();
+    if (s_inflight_mutex == NULL) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int tpmesh_inflight_on_request(uint16_t mesh_id, const tpmesh_bac_pkt_t *req) {
+  inflight_entry_t key;
+
+  if (s_inflight_mutex == NULL || !request_key(req, &key)) {
+    return 0;
+  }
+
+  uint32_t now = tpmesh_get_tick_ms();
+  uint32_t timeout =
+      tpmesh_rtt_timeout(mesh_id, 2, TPMESH_INFLIGHT_TIMEOUT_MS,
+                         TPMESH_INFLIGHT_MIN_MS, TPMESH_INFLIGHT_MAX_MS);
+  int dup = 0;
+
+  xSemaphoreTake(s_inflight_mutex, portMAX_DELAY);
+
+  inflight_entry_t *e = find_entry(mesh_id, &key);
+  if (e && e->service == key.service && now - e->tick < e->timeout) {
+    /* 原请求仍在途 */
+    s_stats.duplicates++;
+    dup = 1;
+  } else {
+    /* 同一请求过期后再次转发: 应答对应哪一次无法区分 (Karn) */
+    bool retx = (e != NULL && e->service == key.service);
+
+    if (e == NULL) {
+      for (int i = 0; i < TPMESH_INFLIGHT_ENTRIES; i++) {
+        if (!s_entries[i].valid) {
+          e = &s_entries[i];
+          break;
+        }
+      }
+    }
+
+    if (e) {
+      /* 新请求, 或 Invoke ID 被复用于新服务/过期后的新请求 */
+      memcpy(e->bms_ip, key.bms_ip, 4);
+      e->bms_port = key.bms_port;
+      e->invoke_id = key.invoke_id;
+      e->service = key.service;
+      e->valid = true;
+      e->mesh_id = mesh_id;
+      e->retx = retx;
+      e->tick = now;
+      e->timeout = timeout;
+      tpmesh_timer_start(&e->timer, timeout);
+      s_stats.tracked++;
+    } else {
+      s_stats.overflows++;
+    }
+  }
+
+  xSemaphoreGive(s_inflight_mutex);
+
+  if (dup) {
+    tpmesh_debug_printf("TPMesh: Drop BMS retry invoke=%u dst=0x%04X\n",
+                        key.invoke_id, mesh_id);
+  }
+  return dup;
+}
+
+void tpmesh_inflight_cancel(uint16_t mesh_id, const tpmesh_bac_pkt_t *req) {
+  inflight_entry_t key;
+
+  if (s_inflight_mutex == NULL || !request_key(req, &key)) {
+    return;
+  }
+
+  xSemaphoreTake(s_inflight_mutex, portMAX_DELAY);
+  inflight_entry_t *e = find_entry(mesh_id, &key);
+  if (e && e->service == key.service) {
+    entry_close(e);
+    s_stats.cancelled++;
+  }
+  xSemaphoreGive(s_inflight_mutex);
+}
+
+void tpmesh_inflight_on_response(uint16_t mesh_id, const tpmesh_bac_pkt_t *pkt,
+                                 bool dst_valid) {
+  if (s_inflight_mutex == NULL || pkt->apdu_len < 2) {
+    return;
+  }
+
+  /* SimpleACK(2) / ComplexACK(3) / Error(5) / Reject(6) / Abort(7) */
+  uint8_t type = pkt->apdu[0] >> 4;
+  if (type != 2 && type != 3 && type != 5 && type != 6 && type != 7) {
+    return;
+  }
+
+  /* 应答的目的地址即原请求方 */
+  inflight_entry_t key;
+  memcpy(key.bms_ip, pkt->ip + 16, 4);
+  key.bms_port = ((uint16_t)pkt->udp[2] << 8) | pkt->udp[3];
+  key.invoke_id = pkt->apdu[1];
+  /* Reject / Abort 不含服务号; 分段 ComplexACK 的服务号在序号与窗口之后 */
+  int service = -1;
+  if (type == 3 && (pkt->apdu[0] & TPMESH_BAC_PDU_SEG)) {
+    service = (pkt->apdu_len >= 5) ? pkt->apdu[4] : -1;
+  } else if (type <= 5 && pkt->apdu_len >= 3) {
+    service = pkt->apdu[2];
+  }
+  uint32_t sample = 0;
+
+  xSemaphoreTake(s_inflight_mutex, portMAX_DELAY);
+  inflight_entry_t *e = NULL;
+  if (dst_valid) {
+    e = find_entry(mesh_id, &key);
+    if (e != NULL && service >= 0 && e->service != service) {
+      e = NULL;
+    }
+  } else {
+    /* 目的地址已被 SCHC 改写: 仅当 (DDC, Invoke ID, 服务) 唯一时结束 */
+    int matches = 0;
+    for (int i = 0; i < TPMESH_INFLIGHT_ENTRIES; i++) {
+      inflight_entry_t *c = &s_entries[i];
+      if (c->valid && c->mesh_id == mesh_id &&
+          c->invoke_id == key.invoke_id &&
+          (service < 0 || c->service == service)) {
+        e = c;
+        matches++;
+      }
+    }
+    if (matches > 1) {
+      e = NULL; /* 多个请求方复用 Invoke ID: 交给过期处理 */
+      s_stats.ambiguous++;
+    }
+  }
+  if (e != NULL) {
+    if (!e->retx) {
+      sample = tpmesh_get_tick_ms() - e->tick;
+      if (sample == 0) {
+        sample = 1;
+      }
+    }
+    entry_close(e);
+    s_stats.completed++;
+  }
+  xSemaphoreGive(s_inflight_mutex);
+
+  /* 节点表有自己的锁, 不在在途表锁内调用 */
+  if (sample != 0) {
+    tpmesh_rtt_sample(mesh_id, sample);
+  }
+}
+
+void tpmesh_inflight_get_stats(tpmesh_inflight_stats_t *stats) {
+  if (s_inflight_mutex == NULL) {
+    memset(stats, 0, sizeof(*stats));
+    return;
+  }
+
+  xSemaphoreTake(s_inflight_mutex, portMAX_DELAY);
+  memcpy(stats, &s_stats, sizeof(*stats));
+  xSemaphoreGive(s_inflight_mutex);
+}
+
+void tpmesh_inflight_dump(void) {
+  tpmesh_inflight_stats_t st;
+  tpmesh_inflight_get_stats(&st);
+
+  int used = 0;
+  for (int i = 0; i < TPMESH_INFLIGHT_ENTRIES; i++) {
+    if (s_entries[i].valid) {
+      used++;
+    }
+  }
+
+  tpmesh_debug_printf("Inflight: %d/%d, tracked %lu, dup dropped %lu\n", used,
+                      TPMESH_INFLIGHT_ENTRIES, (unsigned long)st.tracked,
+                      (unsigned long)st.duplicates);
+  tpmesh_debug_printf("  completed %lu, expired %lu, cancelled %lu, "
+                      "ambiguous %lu, overflow %lu\n",
+                      (unsigned long)st.completed, (unsigned long)st.expired,
+                      (unsigned long)st.cancelled, (unsigned long)st.ambiguous,
+                      (unsigned long)st.overflows);
+}
@@ -0,0 +1,122 @@
+/**
+ * @file tpmesh_inflight.h
+ * @brief TPMesh 在途确认请求跟踪 (Top Node, BMS 重传去重)
+ *
+ * Mesh 往返时间超过 BMS 的 APDU 超时时, BMS 会用相同 Invoke ID 重发
+ * 同一确认请求。原请求仍在途时重传被丢弃, 应答只送达 BMS 一次:
+ * - 键: (BMS IP, BMS 端口, DDC Mesh ID, Invoke ID), 并校验服务号
+ * - 结束: DDC 返回 SimpleACK / ComplexACK / Error / Reject / Abort
+ * - 过期: 超时 (按到目标 DDC 的 RTT 估计, 见 tpmesh_rtt) 后未应答,
+ *   允许重传再次转发
+ * - 未经重传的请求的应答时间作为 RTT 样本
+ *         (每个条目一个共享定时轮定时器)
+ *
+ * 应答按目的地址 (BMS IP, 端口) 与 (DDC, Invoke ID, 服务号) 结束一个
+ * 条目。SCHC 压缩的应答解压后目的地址被改写, 此时仅当 (DDC, Invoke ID,
+ * 服务号) 只有一个条目时结束; 多个 BMS 复用同一 Invoke ID 时不结束,
+ * 也不取 RTT 样本, 由过期处理。
+ *
+ * @version 0.7.1
+ */
+
+#ifndef TPMESH_INFLIGHT_H
+#define TPMESH_INFLIGHT_H
+
+#include "tpmesh_bacnet.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 在途请求表容量 */
+#ifndef TPMESH_INFLIGHT_ENTRIES
+#define TPMESH_INFLIGHT_ENTRIES 32
+#endif
+
+/** 在途请求过期时间 (ms): 无 RTT 估计时使用, 否则为 2 x RTO 限定在 MIN~MAX */
+#ifndef TPMESH_INFLIGHT_TIMEOUT_MS
+#define TPMESH_INFLIGHT_TIMEOUT_MS 10000
+#endif
+#ifndef TPMESH_INFLIGHT_MIN_MS
+#define TPMESH_INFLIGHT_MIN_MS 2000
+#endif
+#ifndef TPMESH_INFLIGHT_MAX_MS
+#define TPMESH_INFLIGHT_MAX_MS 30000
+#endif
+
+/* ============================================================================
+ * 数据结构定义
+ * ============================================================================
+ */
+
+/**
+ * @brief 在途请求统计
+ */
+typedef struct {
+  uint32_t tracked;    /**< 开始跟踪的请求 */
+  uint32_t duplicates; /**< 丢弃的重传 */
+  uint32_t completed;  /**< 收到应答结束 */
+  uint32_t expired;    /**< 超时未应答 */
+  uint32_t cancelled;  /**< 未能送入 Mesh 撤销 */
+  uint32_t ambiguous;  /**< 应答无法对应到唯一请求 */
+  uint32_t overflows;  /**< 表满未跟踪 */
+} tpmesh_inflight_stats_t;
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化在途请求表
+ * @return 0=成功, -1=互斥锁创建失败
+ */
+int tpmesh_inflight_init(void);
+
+/**
+ * @brief 处理 BMS → DDC 的报文
+ * @param mesh_id 目标 DDC Mesh ID
+ * @param req 报文解析结果
+ * @return 1=重传 (应丢弃), 0=转发
+ */
+int tpmesh_inflight_on_request(uint16_t mesh_id, const tpmesh_bac_pkt_t *req);
+
+/**
+ * @brief 请求未能送入 Mesh, 撤销跟踪
+ * @param mesh_id 目标 DDC Mesh ID
+ * @param req 报文解析结果
+ */
+void tpmesh_inflight_cancel(uint16_t mesh_id, const tpmesh_bac_pkt_t *req);
+
+/**
+ * @brief 处理 DDC → BMS 的报文, 应答结束对应在途请求
+ * @param mesh_id 源 DDC Mesh ID
+ * @param pkt 报文解析结果
+ * @param dst_valid 目的 IP/端口为原始值 (未经 SCHC 改写)
+ */
+void tpmesh_inflight_on_response(uint16_t mesh_id, const tpmesh_bac_pkt_t *pkt,
+                                 bool dst_valid);
+
+/**
+ * @brief 获取统计
+ * @param stats [out] 统计
+ */
+void tpmesh_inflight_get_stats(tpmesh_inflight_stats_t *stats);
+
+/**
+ * @brief 打印统计
+ */
+void tpmesh_inflight_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_INFLIGHT_H */
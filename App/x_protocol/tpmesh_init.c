@@ -11,9 +11,22 @@
 
 #include "tpmesh_init.h"
 #include "AppConfig.h"
+#include "Device.h"
+#include "tpmesh_arp_seed.h"
 #include "tpmesh_at.h"
 #include "tpmesh_bridge.h"
+#include "tpmesh_bulk.h"
 #include "tpmesh_debug.h"
+#include "tpmesh_icmp_proxy.h"
+#include "tpmesh_inflight.h"
+#include "tpmesh_mqtt_gw.h"
+#include "tpmesh_netif.h"
+#include "tpmesh_node_store.h"
+#include "tpmesh_route.h"
+#include "tpmesh_rp_cache.h"
+#include "tpmesh_tcp_proxy.h"
+#include "tpmesh_time.h"
+#include "tpmesh_top_sync.h"
 
 /* node_table.h 已通过 tpmesh_bridge.h 包含 */
 #include "FreeRTOS.h"
@@ -154,6 +167,13 @@ int tpmesh_module_init_ddc(void) {
   config.mesh_id = TPMESH_DDC_MESH_ID;
   config.cell_id = 0;
 
+  /* 设备实例号在 BacnetAppInit() 之后才确定, 由 tpmesh_create_tasks() 补充 */
+  config.device_instance = NODE_DEVICE_INSTANCE_NONE;
+  config.caps = 0;
+  config.max_apdu = 0;
+  config.segmentation = 0;
+  config.vendor_id = 0;
+
   /* 初始化 DDC */
   int ret = tpmesh_ddc_init(&config);
   if (ret != 0) {
@@ -161,6 +181,20 @@ int tpmesh_module_init_ddc(void) {
     return ret;
   }
 
+  /* Mesh 网卡: 沿用以太网口的子网和网关, 本机流量经 Mesh 上行 */
+  ip4_addr_t netmask, gw;
+  ip4_addr_set_zero(&netmask);
+  ip4_addr_set_zero(&gw);
+  if (netif_default != NULL) {
+    ip4_addr_copy(netmask, *netif_ip4_netmask(netif_default));
+    ip4_addr_copy(gw, *netif_ip4_gw(netif_default));
+  }
+  if (tpmesh_netif_start(config.mac_addr, &config.ip_addr, &netmask, &gw) !=
+      0) {
+    /* 注册/心跳不受影响, 本机协议栈仍只能走以太网口 */
+    tpmesh_debug_printf("TPMesh Init: mesh netif start failed\n");
+  }
+
   s_is_top_node = false;
   s_tpmesh_initialized = true;
 
@@ -185,6 +219,15 @@ void tpmesh_create_tasks(void) {
               NULL, TPMESH_BRIDGE_TASK_PRIO, &s_bridge_task_handle);
 
   if (!s_is_top_node) {
+    /* 注册帧上报的设备信息 */
+    uint8_t caps = REG_CAP_BACNET_IP;
+#ifdef MODBUSAPPLICATION
+    caps |= REG_CAP_MODBUS_TCP;
+#endif
+    tpmesh_ddc_set_device(Device_Object_Instance_Number(), caps);
+    tpmesh_ddc_set_iam_params(MAX_APDU, Device_Segmentation_Supported(),
+                              Device_Vendor_Identifier());
+
     /* DDC 心跳任务 */
     xTaskCreate(ddc_heartbeat_task, "TPMesh_HB", TPMESH_DDC_HB_TASK_STACK, NULL,
                 TPMESH_DDC_HB_TASK_PRIO, &s_heartbeat_task_handle);
@@ -212,6 +255,26 @@ bool tpmesh_eth_input_hook(struct netif *netif, struct pbuf *p) {
     tpmesh_bridge_send_proxy_arp(p);
     return true; /* 已处理 */
 
+  case BRIDGE_TOP_SYNC:
+    /* 其他 Top Node 的节点表同步 */
+    tpmesh_top_sync_input(p);
+    return true; /* 已处理 */
+
+  case BRIDGE_TCP_PROXY:
+    /* 改写为本机连接交给 LwIP; 未代理的连接按原路径转发 */
+    if (tpmesh_tcp_proxy_input(p)) {
+      return false;
+    }
+    tpmesh_bridge_forward_to_mesh(p);
+    return true; /* 已处理 */
+
+  case BRIDGE_ICMP_PROXY:
+    /* 健康的 DDC 由本机代答, 其余照常转发 */
+    if (!tpmesh_icmp_proxy_input(p)) {
+      tpmesh_bridge_forward_to_mesh(p);
+    }
+    return true; /* 已处理 */
+
   case BRIDGE_DROP:
     /* 丢弃 */
     return true; /* 已处理 (丢弃) */
@@ -243,6 +306,22 @@ void tpmesh_print_status(void) {
 
     tpmesh_debug_printf("\nNode Table:\n");
     node_table_dump();
+    tpmesh_route_dump();
+    tpmesh_tcp_proxy_dump();
+    tpmesh_arp_seed_dump();
+    tpmesh_time_dump();
+    tpmesh_mqtt_gw_dump();
+    tpmesh_bulk_dump();
+
+    if (s_is_top_node) {
+      tpmesh_rp_cache_dump();
+      tpmesh_inflight_dump();
+      tpmesh_node_store_dump();
+      tpmesh_top_sync_dump();
+      tpmesh_icmp_proxy_dump();
+    } else {
+      tpmesh_netif_dump();
+    }
   }
   tpmesh_debug_printf("=====================\n\n");
 }
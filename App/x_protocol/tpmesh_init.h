@@ -48,8 +48,10 @@ extern "C" {
 #endif
 #endif
 
-/** Top Node Mesh ID */
+/** Top Node Mesh ID (多 Top Node 时每台不同, 0xFFBE~0xFFFE) */
+#ifndef TPMESH_TOP_NODE_MESH_ID
 #define TPMESH_TOP_NODE_MESH_ID 0xFFFE
+#endif
 
 /** DDC Mesh ID (需要根据实际配置修改) */
 #define TPMESH_DDC_MESH_ID 0x0002
@@ -102,7 +104,9 @@ int tpmesh_module_init_top(struct netif *eth_netif);
 /**
  * @brief 初始化 TPMesh 模块 (DDC 模式) — 仅硬件/内存
  *
+ * 调用时机: 在 EnetInit() 之后, vTaskStartScheduler() 之前
  * 不发送任何 AT 命令 (AT 命令在 bridge_task 中执行)
+ * 添加 Mesh 网卡 (tpmesh_netif) 并设为默认网卡
  *
  * @return 0=成功
  */
@@ -0,0 +1,822 @@
+/**
+ * @file tpmesh_mqtt_gw.c
+ * @brief TPMesh MQTT-SN 式网关实现
+ *
+ * @version 0.8.0
+ */
+
+#include "tpmesh_mqtt_gw.h"
+#include "AppConfig.h"
+#include "eepromEmul.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_node_store.h"
+#include "tpmesh_rtt.h"
+#include "tpmesh_timer.h"
+
+/* node_table.h 已通过 tpmesh_bridge.h 包含 */
+#include "FreeRTOS.h"
+#include "lwip/apps/mqtt.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "task.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ============================================================================
+ * 私有常量
+ * ============================================================================
+ */
+
+/** 报文类型 (MQTT-SN 编码) */
+#define MSG_REGISTER 0x0A
+#define MSG_REGACK 0x0B
+#define MSG_PUBLISH 0x0C
+#define MSG_PUBACK 0x0D
+
+/** PUBLISH 标志 */
+#define FLAG_DUP 0x80
+#define FLAG_QOS_MASK 0x60
+#define FLAG_QOS1 0x20
+#define FLAG_RETAIN 0x10
+
+/** 返回码 */
+#define RC_ACCEPTED 0x00
+#define RC_CONGESTION 0x01
+#define RC_INVALID_TOPIC 0x02
+#define RC_NOT_SUPPORTED 0x03
+
+/** 报文头长度 */
+#define REGISTER_HDR_LEN 3
+#define ACK_LEN 6
+#define PUBLISH_HDR_LEN 6
+
+/** 报文缓冲区 (隧道头 + 最长报文) */
+#define MSG_BUF_LEN                                                            \
+  (TPMESH_TUNNEL_HDR_LEN + PUBLISH_HDR_LEN + TPMESH_MQTT_GW_PAYLOAD_LEN)
+
+/** DDC 重传检查周期 (ms) */
+#define CLIENT_POLL_MS 500
+
+/** 主题 ID = [代号:8][下标 + 1:8] */
+#define TOPIC_ID(gen, idx) ((uint16_t)(((uint16_t)(gen) << 8) | ((idx) + 1)))
+
+/** 代号记录: ['M']['G'][Gen:1][~Gen:1] */
+#define GEN_REC_LEN 4
+
+#if TPMESH_MQTT_GW_TOPICS > 255
+#error "TPMESH_MQTT_GW_TOPICS must fit in the low byte of a topic ID"
+#endif
+
+/* 重新上线记录之后的 256 字节预留区内 */
+#if TPMESH_MQTT_GW_GEN_SADDR < (TPMESH_REJOIN_SADDR + 0x20) ||                \
+    (TPMESH_MQTT_GW_GEN_SADDR + GEN_REC_LEN) > (TPMESH_REJOIN_SADDR + 0x100)
+#error "TPMESH_MQTT_GW_GEN_SADDR must lie in the area reserved after the rejoin record"
+#endif
+
+#if TPMESH_MQTT_GW_ENABLE && MSG_BUF_LEN > TPMESH_MTU
+#error "TPMESH_MQTT_GW_PAYLOAD_LEN does not fit in one mesh frame"
+#endif
+
+#if TPMESH_MQTT_GW_ENABLE && TPMESH_MQTT_GW_TOPIC_LEN + REGISTER_HDR_LEN + \
+                                 TPMESH_TUNNEL_HDR_LEN > TPMESH_MTU
+#error "TPMESH_MQTT_GW_TOPIC_LEN does not fit in one mesh frame"
+#endif
+
+/* ============================================================================
+ * 类型定义
+ * ============================================================================
+ */
+
+/** Top: 主题表项 (主题 ID 见 TOPIC_ID) */
+typedef struct {
+  bool used;
+  char name[TPMESH_MQTT_GW_TOPIC_LEN + 1];
+} gw_topic_t;
+
+/** Top: 等待 Broker 确认的 QoS 1 消息 */
+typedef struct {
+  bool used;
+  uint16_t src;
+  uint16_t msg_id;
+  uint16_t topic_id;
+} gw_pending_t;
+
+/** DDC: 本机主题与最新待发消息 */
+typedef struct {
+  bool used;
+  char name[TPMESH_MQTT_GW_TOPIC_LEN + 1];
+  uint16_t topic_id; /**< 0=未注册 */
+  uint16_t reg_msg_id;
+  bool pending;  /**< 有待发消息 */
+  bool awaiting; /**< 等待 REGACK / PUBACK */
+  uint8_t flags;
+  uint16_t msg_id;
+  uint8_t retries;
+  uint32_t due; /**< 重传时间 */
+  uint16_t len;
+  uint8_t data[TPMESH_MQTT_GW_PAYLOAD_LEN];
+} client_topic_t;
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static bool s_initialized = false;
+static bool s_is_top = false;
+
+/** Top: 主题表与 Broker 连接 (tcpip 线程) */
+static gw_topic_t s_topics[TPMESH_MQTT_GW_TOPICS];
+static uint8_t s_gen = 0; /**< 本次启动的主题 ID 代号 */
+static gw_pending_t s_pending[TPMESH_MQTT_GW_INFLIGHT];
+static mqtt_client_t *s_client = NULL;
+static volatile bool s_connected = false;
+static char s_client_id[24];
+static uint8_t s_frame[MSG_BUF_LEN];
+
+/** Top: Broker 地址 (临界区保护, tcpip 线程取用) */
+static ip_addr_t s_broker;
+static uint16_t s_broker_port = TPMESH_MQTT_GW_BROKER_PORT;
+static bool s_broker_set = false;
+
+/** DDC: 本机主题 (临界区保护) */
+static client_topic_t s_ctopics[TPMESH_MQTT_GW_CLIENT_TOPICS];
+static uint16_t s_next_msg_id = 0;
+static tpmesh_timer_t s_poll_timer;
+static uint16_t s_id_top = 0;   /**< 主题 ID 所属 Top Node */
+static uint32_t s_id_epoch = 0; /**< 主题 ID 所属注册纪元 */
+static uint32_t s_id_resets = 0;
+
+/** 统计 */
+static uint32_t s_pub_rx = 0;   /**< Top: 收到; DDC: 发出 */
+static uint32_t s_pub_fwd = 0;  /**< Top: 已交给 Broker; DDC: 已确认 */
+static uint32_t s_pub_drop = 0; /**< 丢弃 (Broker 未连接 / 重传耗尽) */
+static uint32_t s_retrans = 0;  /**< DDC: 重传 */
+
+/* ============================================================================
+ * 私有函数 - 工具
+ * ============================================================================
+ */
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static uint8_t *msg_begin(uint8_t *buf) {
+  buf[0] = 0x00; /* L2 HDR: 单播 */
+  buf[1] = 0x80; /* FRAG HDR: 单片 */
+  buf[2] = SCHC_RULE_MQTT_SN;
+  return buf + TPMESH_TUNNEL_HDR_LEN;
+}
+
+/* ============================================================================
+ * 私有函数 - Top Node (tcpip 线程)
+ * ============================================================================
+ */
+
+/* 未启用时不引用 lwIP MQTT 客户端 (工程默认不编译 mqtt.c) */
+#if TPMESH_MQTT_GW_ENABLE
+
+static void gw_send_ack(uint16_t dest, uint8_t type, uint16_t topic_id,
+                        uint16_t msg_id, uint8_t rc) {
+  uint8_t *m = msg_begin(s_frame);
+  m[0] = type;
+  put_u16(m + 1, topic_id);
+  put_u16(m + 3, msg_id);
+  m[5] = rc;
+  tpmesh_bridge_send_frame(dest, s_frame, TPMESH_TUNNEL_HDR_LEN + ACK_LEN);
+}
+
+/**
+ * @brief 查找或分配主题 ID
+ * @return 主题 ID, 0=表满
+ */
+static uint16_t gw_topic_register(const char *name, uint16_t len) {
+  int free_slot = -1;
+  for (int i = 0; i < TPMESH_MQTT_GW_TOPICS; i++) {
+    if (!s_topics[i].used) {
+      if (free_slot < 0) {
+        free_slot = i;
+      }
+    } else if (strlen(s_topics[i].name) == len &&
+               memcmp(s_topics[i].name, name, len) == 0) {
+      return TOPIC_ID(s_gen, i);
+    }
+  }
+  /* 不回收: 已分配的 ID 可能仍被 DDC 缓存, 复用会发错主题 */
+  if (free_slot < 0) {
+    return 0;
+  }
+  s_topics[free_slot].used = true;
+  memcpy(s_topics[free_slot].name, name, len);
+  s_topics[free_slot].name[len] = '\0';
+  return TOPIC_ID(s_gen, free_slot);
+}
+
+/**
+ * @brief 主题 ID → 主题 (其他启动或其他 Top Node 分配的 ID 无效)
+ */
+static const char *gw_topic_name(uint16_t topic_id) {
+  unsigned idx = (topic_id & 0xFF) - 1u;
+  if ((topic_id >> 8) != s_gen || idx >= TPMESH_MQTT_GW_TOPICS ||
+      !s_topics[idx].used) {
+    return NULL;
+  }
+  return s_topics[idx].name;
+}
+
+/**
+ * @brief Broker 断开: 未确认的 QoS 1 回复拥塞, DDC 稍后重发
+ */
+static void gw_fail_pending(void) {
+  for (int i = 0; i < TPMESH_MQTT_GW_INFLIGHT; i++) {
+    gw_pending_t *pd = &s_pending[i];
+    if (pd->used) {
+      pd->used = false;
+      gw_send_ack(pd->src, MSG_PUBACK, pd->topic_id, pd->msg_id, RC_CONGESTION);
+    }
+  }
+}
+
+static void gw_pub_cb(void *arg, err_t err) {
+  gw_pending_t *pd = (gw_pending_t *)arg;
+  if (!pd->used) {
+    return;
+  }
+  pd->used = false;
+  if (err == ERR_OK) {
+    s_pub_fwd++;
+  }
+  gw_send_ack(pd->src, MSG_PUBACK, pd->topic_id, pd->msg_id,
+              (err == ERR_OK) ? RC_ACCEPTED : RC_CONGESTION);
+}
+
+static void gw_connect(void *arg);
+
+static void gw_conn_cb(mqtt_client_t *client, void *arg,
+                       mqtt_connection_status_t status) {
+  (void)client;
+  (void)arg;
+
+  if (status == MQTT_CONNECT_ACCEPTED) {
+    s_connected = true;
+    tpmesh_debug_printf("MqttGw: connected to broker\n");
+    return;
+  }
+
+  /* lwIP 清除请求时不回调, 由本模块应答等待中的 DDC */
+  if (s_connected) {
+    tpmesh_debug_printf("MqttGw: broker disconnected, reason=%d\n",
+                        (int)status);
+  }
+  s_connected = false;
+  gw_fail_pending();
+  sys_untimeout(gw_connect, NULL);
+  sys_timeout(TPMESH_MQTT_GW_RECONNECT_MS, gw_connect, NULL);
+}
+
+static void gw_connect(void *arg) {
+  (void)arg;
+  ip_addr_t broker;
+  uint16_t port;
+  bool set;
+
+  taskENTER_CRITICAL();
+  broker = s_broker;
+  port = s_broker_port;
+  set = s_broker_set;
+  taskEXIT_CRITICAL();
+
+  if (!set || s_connected) {
+    return;
+  }
+  if (s_client == NULL) {
+    s_client = mqtt_client_new();
+    if (s_client == NULL) {
+      sys_timeout(TPMESH_MQTT_GW_RECONNECT_MS, gw_connect, NULL);
+      return;
+    }
+  }
+
+  struct mqtt_connect_client_info_t ci;
+  memset(&ci, 0, sizeof(ci));
+  ci.client_id = s_client_id;
+  ci.keep_alive = TPMESH_MQTT_GW_KEEPALIVE_S;
+
+  err_t err = mqtt_client_connect(s_client, &broker, port, gw_conn_cb, NULL,
+                                  &ci);
+  if (err != ERR_OK && err != ERR_ISCONN) {
+    sys_timeout(TPMESH_MQTT_GW_RECONNECT_MS, gw_connect, NULL);
+  }
+}
+
+/**
+ * @brief 切换 Broker: 断开现有连接后立即重连
+ */
+static void gw_apply_broker(void *arg) {
+  (void)arg;
+  if (s_client != NULL) {
+    mqtt_disconnect(s_client); /* 不回调 gw_conn_cb */
+  }
+  s_connected = false;
+  gw_fail_pending();
+  sys_untimeout(gw_connect, NULL);
+  gw_connect(NULL);
+}
+
+static void gw_handle_register(uint16_t src, const uint8_t *m, uint16_t len) {
+  uint16_t msg_id = get_u16(m + 1);
+  const char *name = (const char *)(m + REGISTER_HDR_LEN);
+  uint16_t name_len = (uint16_t)(len - REGISTER_HDR_LEN);
+
+  /* 只接受发布用的完整主题 */
+  if (name_len == 0 || name_len > TPMESH_MQTT_GW_TOPIC_LEN ||
+      memchr(name, '+', name_len) != NULL ||
+      memchr(name, '#', name_len) != NULL ||
+      memchr(name, '\0', name_len) != NULL) {
+    gw_send_ack(src, MSG_REGACK, 0, msg_id, RC_NOT_SUPPORTED);
+    return;
+  }
+
+  uint16_t topic_id = gw_topic_register(name, name_len);
+  gw_send_ack(src, MSG_REGACK, topic_id, msg_id,
+              topic_id != 0 ? RC_ACCEPTED : RC_CONGESTION);
+}
+
+static void gw_handle_publish(uint16_t src, const uint8_t *m, uint16_t len) {
+  uint8_t flags = m[1];
+  uint16_t topic_id = get_u16(m + 2);
+  uint16_t msg_id = get_u16(m + 4);
+  uint8_t qos = (flags & FLAG_QOS_MASK) >> 5;
+  const uint8_t *data = m + PUBLISH_HDR_LEN;
+  uint16_t data_len = (uint16_t)(len - PUBLISH_HDR_LEN);
+
+  s_pub_rx++;
+
+  if (qos > 1 || data_len > TPMESH_MQTT_GW_PAYLOAD_LEN) {
+    gw_send_ack(src, MSG_PUBACK, topic_id, msg_id, RC_NOT_SUPPORTED);
+    return;
+  }
+
+  /* QoS 0 同样回复, DDC 据此重新注册 */
+  const char *name = gw_topic_name(topic_id);
+  if (name == NULL) {
+    gw_send_ack(src, MSG_PUBACK, topic_id, msg_id, RC_INVALID_TOPIC);
+    return;
+  }
+
+  u8_t retain = (flags & FLAG_RETAIN) ? 1 : 0;
+
+  if (qos == 0) {
+    if (!s_connected ||
+        mqtt_publish(s_client, name, data, data_len, 0, retain, NULL, NULL) !=
+            ERR_OK) {
+      s_pub_drop++;
+      return;
+    }
+    s_pub_fwd++;
+    return;
+  }
+
+  /* QoS 1: 重发的消息仍在等待 Broker 确认, 不重复发布 */
+  gw_pending_t *pd = NULL;
+  for (int i = 0; i < TPMESH_MQTT_GW_INFLIGHT; i++) {
+    if (s_pending[i].used) {
+      if (s_pending[i].src == src && s_pending[i].msg_id == msg_id) {
+        return;
+      }
+    } else if (pd == NULL) {
+      pd = &s_pending[i];
+    }
+  }
+
+  if (!s_connected || pd == NULL) {
+    gw_send_ack(src, MSG_PUBACK, topic_id, msg_id, RC_CONGESTION);
+    return;
+  }
+
+  pd->used = true;
+  pd->src = src;
+  pd->msg_id = msg_id;
+  pd->topic_id = topic_id;
+  if (mqtt_publish(s_client, name, data, data_len, 1, retain, gw_pub_cb, pd) !=
+      ERR_OK) {
+    pd->used = false;
+    gw_send_ack(src, MSG_PUBACK, topic_id, msg_id, RC_CONGESTION);
+  }
+}
+
+/**
+ * @brief 处理 DDC 报文 (tcpip 线程), p = [Src:2] + 报文
+ */
+static void gw_input(void *arg) {
+  struct pbuf *p = (struct pbuf *)arg;
+  const uint8_t *buf = (const uint8_t *)p->payload;
+  uint16_t src = get_u16(buf);
+  const uint8_t *m = buf + 2;
+  uint16_t len = (uint16_t)(p->len - 2);
+
+  if (m[0] == MSG_REGISTER && len > REGISTER_HDR_LEN) {
+    gw_handle_register(src, m, len);
+  } else if (m[0] == MSG_PUBLISH && len >= PUBLISH_HDR_LEN) {
+    gw_handle_publish(src, m, len);
+  }
+  pbuf_free(p);
+}
+
+static void gw_start(void *arg) {
+  (void)arg;
+  gw_connect(NULL);
+}
+
+#endif /* TPMESH_MQTT_GW_ENABLE */
+
+/**
+ * @brief Top Node: 本次启动的主题 ID 代号 (上次加 1, 保存到模拟 EEPROM)
+ *
+ * 主题表不持久化; 代号保证重启前分配的 ID 不会对应到新的主题。
+ */
+static uint8_t gw_next_gen(void) {
+  uint8_t rec[GEN_REC_LEN];
+  uint8_t gen;
+
+  if (GetEEPROMStatus() == EEPROM_OK &&
+      EEPROMRead(TPMESH_MQTT_GW_GEN_SADDR, rec, sizeof(rec)) &&
+      rec[0] == 'M' && rec[1] == 'G' && (uint8_t)(rec[2] + rec[3]) == 0xFFu) {
+    gen = (uint8_t)(rec[2] + 1);
+  } else {
+    gen = (uint8_t)LWIP_RAND();
+  }
+  if (gen == 0) {
+    gen = 1;
+  }
+
+  rec[0] = 'M';
+  rec[1] = 'G';
+  rec[2] = gen;
+  rec[3] = (uint8_t)(gen ^ 0xFFu);
+  if (!EEPROMWrite(TPMESH_MQTT_GW_GEN_SADDR, rec, sizeof(rec))) {
+    tpmesh_debug_printf("MqttGw: generation record write failed\n");
+  }
+  return gen;
+}
+
+/* ============================================================================
+ * 私有函数 - DDC
+ * ============================================================================
+ */
+
+/**
+ * @brief 所属 Top Node 或注册纪元变化: 丢弃缓存的主题 ID, 重新注册
+ *        (调用方处于临界区)
+ */
+static void client_check_top(void) {
+  uint16_t top = tpmesh_ddc_top_node();
+  uint32_t epoch = tpmesh_ddc_epoch();
+  if (top == s_id_top && epoch == s_id_epoch) {
+    return;
+  }
+  s_id_top = top;
+  s_id_epoch = epoch;
+  for (int i = 0; i < TPMESH_MQTT_GW_CLIENT_TOPICS; i++) {
+    client_topic_t *t = &s_ctopics[i];
+    if (t->used && (t->topic_id != 0 || t->awaiting)) {
+      t->topic_id = 0;
+      t->awaiting = false;
+      t->retries = 0;
+      s_id_resets++;
+    }
+  }
+}
+
+static uint32_t client_rto(void) {
+  return tpmesh_rtt_timeout(tpmesh_ddc_top_node(), 2, TPMESH_MQTT_GW_RETRY_MS,
+                            1000, 30000);
+}
+
+/**
+ * @brief 按主题状态发送 REGISTER / PUBLISH (任意任务; 发送在临界区外)
+ */
+static void client_service(int idx, uint32_t now) {
+  uint8_t buf[MSG_BUF_LEN];
+  uint8_t *m = msg_begin(buf);
+  uint16_t len = 0;
+  bool retrans = false;
+
+  taskENTER_CRITICAL();
+  client_topic_t *t = &s_ctopics[idx];
+  if (t->used && t->pending &&
+      (!t->awaiting || (int32_t)(now - t->due) >= 0)) {
+    if (t->awaiting && t->retries >= TPMESH_MQTT_GW_RETRY_MAX) {
+      /* 重传耗尽: 丢弃消息, 主题状态保留 */
+      t->pending = false;
+      t->awaiting = false;
+      s_pub_drop++;
+    } else if (t->topic_id == 0) {
+      retrans = t->awaiting;
+      t->reg_msg_id = ++s_next_msg_id;
+      m[0] = MSG_REGISTER;
+      put_u16(m + 1, t->reg_msg_id);
+      len = (uint16_t)strlen(t->name);
+      memcpy(m + REGISTER_HDR_LEN, t->name, len);
+      len += REGISTER_HDR_LEN;
+    } else {
+      retrans = t->awaiting;
+      m[0] = MSG_PUBLISH;
+      m[1] = (uint8_t)(t->flags | (retrans ? FLAG_DUP : 0));
+      put_u16(m + 2, t->topic_id);
+      put_u16(m + 4, t->msg_id);
+      memcpy(m + PUBLISH_HDR_LEN, t->data, t->len);
+      len = (uint16_t)(PUBLISH_HDR_LEN + t->len);
+    }
+
+    if (len > 0) {
+      if (m[0] == MSG_PUBLISH && !(t->flags & FLAG_QOS1)) {
+        t->pending = false; /* QoS 0: 发出即完成 */
+      } else {
+        t->awaiting = true;
+        t->retries = retrans ? (uint8_t)(t->retries + 1) : 0;
+        t->due = now + client_rto();
+      }
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  if (len == 0) {
+    return;
+  }
+  if (retrans) {
+    s_retrans++;
+  } else if (m[0] == MSG_PUBLISH) {
+    s_pub_rx++;
+  }
+  /* 尚未上线或发送失败: 按重传超时重试 */
+  tpmesh_bridge_send_frame(tpmesh_ddc_top_node(), buf,
+                           (uint16_t)(TPMESH_TUNNEL_HDR_LEN + len));
+}
+
+static void client_poll_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)arg;
+  uint32_t now = tpmesh_get_tick_ms();
+  taskENTER_CRITICAL();
+  client_check_top();
+  taskEXIT_CRITICAL();
+  for (int i = 0; i < TPMESH_MQTT_GW_CLIENT_TOPICS; i++) {
+    client_service(i, now);
+  }
+  tpmesh_timer_start(timer, CLIENT_POLL_MS);
+}
+
+/**
+ * @brief 处理 Top Node 的 REGACK / PUBACK (桥接任务)
+ */
+static void client_input(uint16_t src, const uint8_t *m, uint16_t len) {
+  if (len < ACK_LEN || (m[0] != MSG_REGACK && m[0] != MSG_PUBACK)) {
+    return;
+  }
+  uint16_t topic_id = get_u16(m + 1);
+  uint16_t msg_id = get_u16(m + 3);
+  uint8_t rc = m[5];
+  int kick = -1;
+
+  taskENTER_CRITICAL();
+  client_check_top();
+  for (int i = 0; i < TPMESH_MQTT_GW_CLIENT_TOPICS && src == s_id_top; i++) {
+    client_topic_t *t = &s_ctopics[i];
+    if (!t->used) {
+      continue;
+    }
+
+    if (m[0] == MSG_REGACK) {
+      if (t->topic_id != 0 || !t->awaiting || t->reg_msg_id != msg_id) {
+        continue;
+      }
+      if (rc == RC_ACCEPTED && topic_id != 0) {
+        t->topic_id = topic_id;
+        t->awaiting = false;
+        kick = i; /* 立即发出待发消息 */
+      } else if (rc != RC_CONGESTION) {
+        t->pending = false; /* 主题被拒绝: 丢弃消息 */
+        t->awaiting = false;
+        s_pub_drop++;
+      }
+      break;
+    }
+
+    /* PUBACK */
+    if (t->topic_id != topic_id) {
+      continue;
+    }
+    if (rc == RC_INVALID_TOPIC) {
+      /* Top Node 已丢失主题表: 重新注册后重发 */
+      t->topic_id = 0;
+      if (t->pending) {
+        t->awaiting = false;
+        kick = i;
+      }
+    } else if (t->pending && t->awaiting && t->msg_id == msg_id) {
+      if (rc == RC_ACCEPTED) {
+        t->pending = false;
+        t->awaiting = false;
+        s_pub_fwd++;
+      } else if (rc != RC_CONGESTION) {
+        t->pending = false;
+        t->awaiting = false;
+        s_pub_drop++;
+      }
+      /* 拥塞: 按重传超时重发 */
+    }
+    break;
+  }
+  taskEXIT_CRITICAL();
+
+  if (kick >= 0) {
+    client_service(kick, tpmesh_get_tick_ms());
+  }
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_mqtt_gw_init(bool is_top) {
+  if (!TPMESH_MQTT_GW_ENABLE || s_initialized) {
+    return 0;
+  }
+
+  s_is_top = is_top;
+  if (is_top) {
+    memset(s_topics, 0, sizeof(s_topics));
+    memset(s_pending, 0, sizeof(s_pending));
+    s_gen = gw_next_gen();
+
+    uint8_t mac[6];
+    tpmesh_get_local_mac(mac);
+    snprintf(s_client_id, sizeof(s_client_id), "tpmesh-gw-%02X%02X%02X",
+             mac[3], mac[4], mac[5]);
+
+    ip4_addr_t ip;
+    if (TPMESH_MQTT_GW_BROKER_IP[0] != '\0' &&
+        ip4addr_aton(TPMESH_MQTT_GW_BROKER_IP, &ip)) {
+      ip_addr_copy_from_ip4(s_broker, ip);
+      s_broker_set = true;
+    }
+#if TPMESH_MQTT_GW_ENABLE
+    if (tcpip_callback(gw_start, NULL) != ERR_OK) {
+      return -1;
+    }
+#endif
+  } else {
+    memset(s_ctopics, 0, sizeof(s_ctopics));
+    s_id_top = tpmesh_ddc_top_node();
+    s_id_epoch = tpmesh_ddc_epoch();
+    s_next_msg_id = (uint16_t)LWIP_RAND();
+    tpmesh_timer_setup(&s_poll_timer, client_poll_expired, NULL);
+    tpmesh_timer_start(&s_poll_timer, CLIENT_POLL_MS);
+  }
+
+  s_initialized = true;
+  return 0;
+}
+
+void tpmesh_mqtt_gw_set_broker(const ip4_addr_t *ip, uint16_t port) {
+  if (!s_initialized || !s_is_top || ip == NULL) {
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  ip_addr_copy_from_ip4(s_broker, *ip);
+  s_broker_port = (port != 0) ? port : TPMESH_MQTT_GW_BROKER_PORT;
+  s_broker_set = true;
+  taskEXIT_CRITICAL();
+
+#if TPMESH_MQTT_GW_ENABLE
+  if (tcpip_try_callback(gw_apply_broker, NULL) != ERR_OK) {
+    tpmesh_debug_printf("MqttGw: broker change deferred (tcpip busy)\n");
+  }
+#endif
+}
+
+int tpmesh_mqtt_gw_publish(const char *topic, const uint8_t *payload,
+                           uint16_t len, uint8_t qos, bool retain) {
+  if (!s_initialized || s_is_top || topic == NULL || qos > 1 ||
+      len > TPMESH_MQTT_GW_PAYLOAD_LEN || (len > 0 && payload == NULL)) {
+    return -1;
+  }
+  size_t name_len = strlen(topic);
+  if (name_len == 0 || name_len > TPMESH_MQTT_GW_TOPIC_LEN) {
+    return -1;
+  }
+
+  int idx = -1;
+  int free_slot = -1;
+
+  taskENTER_CRITICAL();
+  client_check_top();
+  for (int i = 0; i < TPMESH_MQTT_GW_CLIENT_TOPICS; i++) {
+    if (!s_ctopics[i].used) {
+      if (free_slot < 0) {
+        free_slot = i;
+      }
+    } else if (strcmp(s_ctopics[i].name, topic) == 0) {
+      idx = i;
+      break;
+    }
+  }
+  if (idx < 0 && free_slot >= 0) {
+    idx = free_slot;
+    memset(&s_ctopics[idx], 0, sizeof(s_ctopics[idx]));
+    s_ctopics[idx].used = true;
+    memcpy(s_ctopics[idx].name, topic, name_len + 1);
+  }
+  if (idx >= 0) {
+    /* 最新值覆盖未确认的旧消息; 注册中的主题继续等待 REGACK */
+    client_topic_t *t = &s_ctopics[idx];
+    if (t->topic_id != 0) {
+      t->awaiting = false;
+    }
+    t->pending = true;
+    t->flags = (uint8_t)((qos ? FLAG_QOS1 : 0) | (retain ? FLAG_RETAIN : 0));
+    t->msg_id = ++s_next_msg_id;
+    t->len = len;
+    if (len > 0) {
+      memcpy(t->data, payload, len);
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  if (idx < 0) {
+    return -2;
+  }
+  client_service(idx, tpmesh_get_tick_ms());
+  return 0;
+}
+
+void tpmesh_mqtt_gw_mesh_input(uint16_t src_mesh_id, const uint8_t *data,
+                               uint16_t len) {
+  if (!s_initialized || len == 0) {
+    return;
+  }
+
+  if (!s_is_top) {
+    if (MESH_ADDR_IS_TOP(src_mesh_id)) {
+      client_input(src_mesh_id, data, len);
+    }
+    return;
+  }
+
+  if (!node_table_is_registered(src_mesh_id)) {
+    return;
+  }
+
+  /* 投递到 tcpip 线程: [Src:2] + 报文 */
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)(len + 2), PBUF_RAM);
+  if (p == NULL) {
+    return;
+  }
+  put_u16((uint8_t *)p->payload, src_mesh_id);
+  memcpy((uint8_t *)p->payload + 2, data, len);
+#if TPMESH_MQTT_GW_ENABLE
+  if (tcpip_try_callback(gw_input, p) == ERR_OK) {
+    return;
+  }
+#endif
+  pbuf_free(p); /* QoS 1 由 DDC 重传 */
+}
+
+void tpmesh_mqtt_gw_dump(void) {
+  if (!s_initialized) {
+    return;
+  }
+
+  if (s_is_top) {
+    int topics = 0;
+    for (int i = 0; i < TPMESH_MQTT_GW_TOPICS; i++) {
+      topics += s_topics[i].used ? 1 : 0;
+    }
+    tpmesh_debug_printf("MqttGw: broker %s, topics %d/%d (gen %u), publish rx "
+                        "%lu, forwarded %lu, dropped %lu\n",
+                        s_connected ? "connected" : "disconnected", topics,
+                        TPMESH_MQTT_GW_TOPICS, s_gen, (unsigned long)s_pub_rx,
+                        (unsigned long)s_pub_fwd, (unsigned long)s_pub_drop);
+  } else {
+    int topics = 0, registered = 0;
+    for (int i = 0; i < TPMESH_MQTT_GW_CLIENT_TOPICS; i++) {
+      topics += s_ctopics[i].used ? 1 : 0;
+      registered += s_ctopics[i].topic_id != 0 ? 1 : 0;
+    }
+    tpmesh_debug_printf("MqttGw client: topics %d (registered %d), publish %lu, "
+                        "acked %lu, retrans %lu, dropped %lu, id resets %lu\n",
+                        topics, registered, (unsigned long)s_pub_rx,
+                        (unsigned long)s_pub_fwd, (unsigned long)s_retrans,
+                        (unsigned long)s_pub_drop, (unsigned long)s_id_resets);
+  }
+}
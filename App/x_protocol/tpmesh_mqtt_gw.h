@@ -0,0 +1,167 @@
+/**
+ * @file tpmesh_mqtt_gw.h
+ * @brief TPMesh MQTT-SN 式网关 (DDC 遥测经 Top Node 汇聚到 MQTT Broker)
+ *
+ * Mesh 后的 DDC 各自运行 MQTT 客户端时, 每个 DDC 经 Mesh 保持一条到 Broker
+ * 的 TCP 连接, 保活、TCP ACK 与每次发布携带的完整主题串都占用 Mesh 带宽。
+ * 启用后:
+ * - DDC 以紧凑的 Mesh 数据报 (SCHC_RULE_MQTT_SN) 向所属 Top Node 注册主题,
+ *   取得 2 字节主题 ID, 之后发布只携带主题 ID, QoS 0/1
+ * - Top Node 保持唯一一条到 Broker 的 MQTT 连接, 把主题 ID 还原为完整
+ *   主题后发布; QoS 1 在 Broker 确认后才向 DDC 回 PUBACK
+ * - 主题 ID 高字节为 Top Node 每次启动加 1 的代号 (保存在模拟 EEPROM),
+ *   其他启动或其他 Top Node 分配的 ID 回 "主题 ID 无效", DDC 重新注册
+ *   后重发; DDC 所属 Top Node 或注册纪元变化时主动丢弃全部主题 ID
+ *
+ * 报文 (隧道头之后, 类型编码沿用 MQTT-SN):
+ *   REGISTER [0x0A][MsgId:2][Topic]             DDC → Top
+ *   REGACK   [0x0B][TopicId:2][MsgId:2][RC:1]   Top → DDC
+ *   PUBLISH  [0x0C][Flags:1][TopicId:2][MsgId:2] + 数据   DDC → Top
+ *   PUBACK   [0x0D][TopicId:2][MsgId:2][RC:1]   Top → DDC (仅 QoS 1)
+ * Flags: bit5-6 QoS, bit4 Retain; RC: 0=接受, 1=拥塞 (稍后重试),
+ * 2=主题 ID 无效, 3=不支持。
+ *
+ * DDC 端每个主题只保留最新一条待发消息 (遥测取最新值), 新消息覆盖尚未
+ * 确认的旧消息。
+ *
+ * 线程: Top Node 的网关处理在 tcpip 线程 (Mesh 输入经 tcpip_try_callback
+ * 投递, lwIP MQTT 客户端要求); DDC 的 Mesh 输入与重传在桥接任务,
+ * 发布可在任意任务调用。
+ *
+ * @version 0.8.0
+ */
+
+#ifndef TPMESH_MQTT_GW_H
+#define TPMESH_MQTT_GW_H
+
+#include "lwip/ip4_addr.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 启用 MQTT 网关 (两端均需启用; Top Node 需编译 lwIP MQTT 客户端) */
+#ifndef TPMESH_MQTT_GW_ENABLE
+#define TPMESH_MQTT_GW_ENABLE 0
+#endif
+
+/** Broker 地址 (点分十进制, 空串=运行时由 tpmesh_mqtt_gw_set_broker 设置) */
+#ifndef TPMESH_MQTT_GW_BROKER_IP
+#define TPMESH_MQTT_GW_BROKER_IP ""
+#endif
+
+/** Broker 端口 */
+#ifndef TPMESH_MQTT_GW_BROKER_PORT
+#define TPMESH_MQTT_GW_BROKER_PORT 1883
+#endif
+
+/** Broker 保活 (s) */
+#ifndef TPMESH_MQTT_GW_KEEPALIVE_S
+#define TPMESH_MQTT_GW_KEEPALIVE_S 60
+#endif
+
+/** Broker 断开后的重连间隔 (ms) */
+#ifndef TPMESH_MQTT_GW_RECONNECT_MS
+#define TPMESH_MQTT_GW_RECONNECT_MS 10000
+#endif
+
+/** 主题最大长度 (字节, 不含结尾 0) */
+#ifndef TPMESH_MQTT_GW_TOPIC_LEN
+#define TPMESH_MQTT_GW_TOPIC_LEN 48
+#endif
+
+/** 消息最大长度 (字节) */
+#ifndef TPMESH_MQTT_GW_PAYLOAD_LEN
+#define TPMESH_MQTT_GW_PAYLOAD_LEN 128
+#endif
+
+/** Top Node: 主题表大小 (全部 DDC 共用, 相同主题共用 ID; 不超过 255) */
+#ifndef TPMESH_MQTT_GW_TOPICS
+#define TPMESH_MQTT_GW_TOPICS 64
+#endif
+
+/** Top Node: 等待 Broker 确认的 QoS 1 消息数 (不超过 MQTT_REQ_MAX_IN_FLIGHT) */
+#ifndef TPMESH_MQTT_GW_INFLIGHT
+#define TPMESH_MQTT_GW_INFLIGHT 4
+#endif
+
+/** Top Node: 主题 ID 代号记录地址 (4 字节, 重新上线记录之后的预留区) */
+#ifndef TPMESH_MQTT_GW_GEN_SADDR
+#define TPMESH_MQTT_GW_GEN_SADDR (TPMESH_REJOIN_SADDR + 0x40)
+#endif
+
+/** DDC: 本机主题数 */
+#ifndef TPMESH_MQTT_GW_CLIENT_TOPICS
+#define TPMESH_MQTT_GW_CLIENT_TOPICS 8
+#endif
+
+/** DDC: 注册 / QoS 1 最大重传次数 */
+#ifndef TPMESH_MQTT_GW_RETRY_MAX
+#define TPMESH_MQTT_GW_RETRY_MAX 3
+#endif
+
+/** DDC: 尚无 RTT 样本时的重传超时 (ms) */
+#ifndef TPMESH_MQTT_GW_RETRY_MS
+#define TPMESH_MQTT_GW_RETRY_MS 5000
+#endif
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化 (桥接任务中, 定时轮初始化之后调用; 未启用时无操作)
+ * @param is_top true=Top Node (网关), false=DDC (客户端)
+ * @return 0=成功, -1=失败
+ */
+int tpmesh_mqtt_gw_init(bool is_top);
+
+/**
+ * @brief Top Node: 设置 Broker 地址 (断开现有连接后重连)
+ * @param ip Broker IP
+ * @param port Broker 端口 (0=默认)
+ */
+void tpmesh_mqtt_gw_set_broker(const ip4_addr_t *ip, uint16_t port);
+
+/**
+ * @brief DDC: 经 Top Node 发布 (任意任务)
+ *
+ * 主题首次使用时先注册, 消息在注册完成后发出。
+ *
+ * @param topic 主题
+ * @param payload 数据
+ * @param len 长度 (不超过 TPMESH_MQTT_GW_PAYLOAD_LEN)
+ * @param qos 0 或 1
+ * @param retain 保留标志
+ * @return 0=已接受, -1=参数错误或未初始化, -2=主题表满
+ */
+int tpmesh_mqtt_gw_publish(const char *topic, const uint8_t *payload,
+                           uint16_t len, uint8_t qos, bool retain);
+
+/**
+ * @brief 处理 SCHC_RULE_MQTT_SN 报文 (桥接任务)
+ * @param src_mesh_id 源 Mesh ID
+ * @param data 报文 (隧道头之后)
+ * @param len 长度
+ */
+void tpmesh_mqtt_gw_mesh_input(uint16_t src_mesh_id, const uint8_t *data,
+                               uint16_t len);
+
+/**
+ * @brief 打印网关状态
+ */
+void tpmesh_mqtt_gw_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_MQTT_GW_H */
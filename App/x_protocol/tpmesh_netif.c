@@ -0,0 +1,283 @@
+/**
+ * @file tpmesh_netif.c
+ * @brief TPMesh DDC Mesh 虚拟网卡实现
+ *
+ * @version 0.7.1
+ */
+
+#include "tpmesh_netif.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_schc.h"
+#include "lwip/etharp.h"
+#include "lwip/tcpip.h"
+#include <string.h>
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static struct netif s_mesh_netif;
+
+/** 以太网口 (添加 Mesh 网卡前的默认网卡) */
+static struct netif *s_eth_netif = NULL;
+
+static bool s_started = false;
+
+/** 网卡 MAC (init 回调中写入 hwaddr) */
+static uint8_t s_mac[6];
+
+/** 收发统计 (tx 仅 tcpip 线程写, rx 仅桥接任务写) */
+static uint32_t s_tx_frames;
+static uint32_t s_tx_drops;
+static uint32_t s_tx_direct;
+static uint32_t s_rx_frames;
+static uint32_t s_rx_drops;
+static uint32_t s_eth_routed; /**< 路由到以太网口 */
+static uint32_t s_eth_bcast;  /**< 广播/组播复制到以太网口 */
+
+/* ============================================================================
+ * 私有函数
+ * ============================================================================
+ */
+
+static bool eth_usable(void) {
+  return s_eth_netif != NULL && netif_is_up(s_eth_netif) &&
+         netif_is_link_up(s_eth_netif);
+}
+
+/**
+ * @brief IPv4 广播/组播帧复制到以太网口 (以太网口一侧的主机同样需要)
+ */
+static void copy_to_eth(struct pbuf *p) {
+  uint16_t type;
+  if (!eth_usable() ||
+      pbuf_copy_partial(p, &type, sizeof(type), 12) != sizeof(type) ||
+      type != PP_HTONS(ETHTYPE_IP)) {
+    return;
+  }
+  if (s_eth_netif->linkoutput(s_eth_netif, p) == ERR_OK) {
+    s_eth_bcast++;
+  }
+}
+
+/**
+ * @brief 以对端名义向本机协议栈投递 ARP 应答
+ */
+static int inject_arp_reply(const uint8_t *peer_mac,
+                            const ip4_addr_t *peer_ip) {
+  struct pbuf *p =
+      pbuf_alloc(PBUF_RAW, SIZEOF_ETH_HDR + SIZEOF_ETHARP_HDR, PBUF_RAM);
+  if (p == NULL) {
+    return -1;
+  }
+
+  struct eth_hdr *eth = (struct eth_hdr *)p->payload;
+  struct etharp_hdr *arp =
+      (struct etharp_hdr *)((uint8_t *)p->payload + SIZEOF_ETH_HDR);
+
+  SMEMCPY(&eth->dest, s_mac, ETH_HWADDR_LEN);
+  SMEMCPY(&eth->src, peer_mac, ETH_HWADDR_LEN);
+  eth->type = PP_HTONS(ETHTYPE_ARP);
+
+  arp->hwtype = PP_HTONS(1);
+  arp->proto = PP_HTONS(ETHTYPE_IP);
+  arp->hwlen = ETH_HWADDR_LEN;
+  arp->protolen = sizeof(ip4_addr_t);
+  arp->opcode = PP_HTONS(ARP_REPLY);
+
+  SMEMCPY(&arp->shwaddr, peer_mac, ETH_HWADDR_LEN);
+  SMEMCPY(&arp->sipaddr, peer_ip, sizeof(ip4_addr_t));
+  SMEMCPY(&arp->dhwaddr, s_mac, ETH_HWADDR_LEN);
+  SMEMCPY(&arp->dipaddr, netif_ip4_addr(&s_mesh_netif), sizeof(ip4_addr_t));
+
+  if (s_mesh_netif.input(p, &s_mesh_netif) != ERR_OK) {
+    pbuf_free(p);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief ARP 请求的目标为节点表中的对端 DDC 时本地应答
+ * @return true=已应答, 不经 Mesh 发送
+ */
+static bool answer_peer_arp(struct netif *netif, struct pbuf *p) {
+  struct eth_hdr eth;
+  struct etharp_hdr arp;
+
+  if (p->tot_len < SIZEOF_ETH_HDR + SIZEOF_ETHARP_HDR ||
+      pbuf_copy_partial(p, &eth, SIZEOF_ETH_HDR, 0) != SIZEOF_ETH_HDR ||
+      eth.type != PP_HTONS(ETHTYPE_ARP) ||
+      pbuf_copy_partial(p, &arp, SIZEOF_ETHARP_HDR, SIZEOF_ETH_HDR) !=
+          SIZEOF_ETHARP_HDR ||
+      arp.opcode != PP_HTONS(ARP_REQUEST)) {
+    return false;
+  }
+
+  ip4_addr_t target;
+  SMEMCPY(&target, &arp.dipaddr, sizeof(ip4_addr_t));
+  if (ip4_addr_cmp(&target, netif_ip4_addr(netif))) {
+    return false; /* 免费 ARP/地址冲突检测 */
+  }
+
+  uint8_t mac[6];
+  if (node_table_get_mac_by_ip(&target, mac) != 0) {
+    return false; /* 未知: 交给 Top Node 解析 */
+  }
+  return inject_arp_reply(mac, &target) == 0;
+}
+
+/**
+ * @brief linkoutput: SCHC 压缩 + 分片发送 (tcpip 线程)
+ */
+static err_t mesh_linkoutput(struct netif *netif, struct pbuf *p) {
+  /* 仅 tcpip 线程调用, 静态分配以节省该线程栈 */
+  static uint8_t tunnel[TPMESH_TUNNEL_HDR_LEN + ETH_HDR_LEN + TPMESH_NETIF_MTU];
+
+  if (p->tot_len < ETH_HDR_LEN || p->tot_len > ETH_HDR_LEN + TPMESH_NETIF_MTU) {
+    s_tx_drops++;
+    return ERR_BUF;
+  }
+
+  /* 已知对端 DDC 的地址解析不占用信道 */
+  if (answer_peer_arp(netif, p)) {
+    return ERR_OK;
+  }
+
+  /* 广播/组播交给 Top Node 转发; 单播发往对端 DDC 或 Top Node */
+  uint8_t dst[6];
+  pbuf_copy_partial(p, dst, sizeof(dst), 0);
+  bool is_broadcast = (dst[0] & 0x01) != 0;
+  if (is_broadcast) {
+    copy_to_eth(p);
+  }
+
+  uint16_t top_mesh_id = tpmesh_ddc_top_node();
+  uint16_t dest_mesh_id = top_mesh_id;
+  if (!is_broadcast) {
+    uint16_t peer = node_table_get_mesh_by_mac(dst);
+    if (peer != MESH_ADDR_INVALID) {
+      dest_mesh_id = peer;
+    }
+  }
+
+  uint16_t tunnel_len;
+  if (schc_compress_pbuf(p, tunnel, &tunnel_len, is_broadcast) != 0) {
+    s_tx_drops++;
+    return ERR_BUF;
+  }
+
+  if (tpmesh_bridge_send_tunnel(dest_mesh_id, tunnel, tunnel_len) != 0) {
+    s_tx_drops++;
+    return ERR_IF;
+  }
+  if (dest_mesh_id != top_mesh_id) {
+    s_tx_direct++;
+  }
+
+  s_tx_frames++;
+  return ERR_OK;
+}
+
+/**
+ * @brief netif_add 初始化回调
+ */
+static err_t mesh_netif_init(struct netif *netif) {
+  netif->name[0] = 'm';
+  netif->name[1] = 's';
+  netif->output = etharp_output;
+  netif->linkoutput = mesh_linkoutput;
+  netif->mtu = TPMESH_NETIF_MTU;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  memcpy(netif->hwaddr, s_mac, ETH_HWADDR_LEN);
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET;
+  return ERR_OK;
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_netif_start(const uint8_t *mac, const ip4_addr_t *ip,
+                       const ip4_addr_t *netmask, const ip4_addr_t *gw) {
+  if (s_started) {
+    return 0;
+  }
+
+  memcpy(s_mac, mac, sizeof(s_mac));
+  s_eth_netif = netif_default;
+
+  if (netif_add(&s_mesh_netif, ip, netmask, gw, NULL, mesh_netif_init,
+                tcpip_input) == NULL) {
+    tpmesh_debug_printf("TPMesh: mesh netif add failed\n");
+    return -1;
+  }
+
+#if TPMESH_NETIF_SET_DEFAULT
+  netif_set_default(&s_mesh_netif);
+#endif
+  netif_set_up(&s_mesh_netif);
+  netif_set_link_up(&s_mesh_netif);
+
+  s_started = true;
+  return 0;
+}
+
+struct netif *tpmesh_netif_get(void) {
+  return s_started ? &s_mesh_netif : NULL;
+}
+
+struct netif *tpmesh_netif_route_src(const ip4_addr_t *src,
+                                     const ip4_addr_t *dest) {
+  (void)src;
+  if (!s_started || !eth_usable() || ip4_addr_ismulticast(dest) ||
+      ip4_addr_isbroadcast(dest, s_eth_netif)) {
+    return NULL;
+  }
+
+  /* 下一跳: 子网内为目的地址, 子网外为以太网口网关 */
+  const ip4_addr_t *hop = dest;
+  if (!ip4_addr_netcmp(dest, netif_ip4_addr(s_eth_netif),
+                       netif_ip4_netmask(s_eth_netif))) {
+    hop = netif_ip4_gw(s_eth_netif);
+  }
+
+  /* 以太网口一侧的主机访问本机时已在以太网口解析过本机地址 */
+  struct eth_addr *eth_ret;
+  const ip4_addr_t *ip_ret;
+  if (etharp_find_addr(s_eth_netif, hop, &eth_ret, &ip_ret) < 0) {
+    return NULL;
+  }
+  s_eth_routed++;
+  return s_eth_netif;
+}
+
+int tpmesh_netif_input(struct pbuf *p) {
+  if (!s_started || s_mesh_netif.input(p, &s_mesh_netif) != ERR_OK) {
+    s_rx_drops++;
+    pbuf_free(p);
+    return -1;
+  }
+
+  s_rx_frames++;
+  return 0;
+}
+
+int tpmesh_netif_peer_resolved(const uint8_t *mac, const ip4_addr_t *ip) {
+  if (!s_started) {
+    return -1;
+  }
+  return inject_arp_reply(mac, ip);
+}
+
+void tpmesh_netif_dump(void) {
+  tpmesh_debug_printf("Mesh netif: %s, tx %lu (direct %lu, drop %lu), "
+                      "rx %lu (drop %lu), eth routed %lu, eth bcast %lu\n",
+                      s_started ? "up" : "down", (unsigned long)s_tx_frames,
+                      (unsigned long)s_tx_direct, (unsigned long)s_tx_drops,
+                      (unsigned long)s_rx_frames, (unsigned long)s_rx_drops,
+                      (unsigned long)s_eth_routed, (unsigned long)s_eth_bcast);
+}
@@ -0,0 +1,113 @@
+/**
+ * @file tpmesh_netif.h
+ * @brief TPMesh DDC Mesh 虚拟网卡
+ *
+ * DDC 的 lwIP 协议栈经此网卡收发 Mesh 流量:
+ * - 输出: etharp_output 组帧后由 linkoutput 直接对 pbuf 链做 SCHC 压缩和
+ *   分片, 广播及未知目的发往 Top Node (保留 L2 广播位), 目的 MAC 属于
+ *   节点表中的其他 DDC 时直接发往该 DDC
+ * - 输入: 桥接层把重组后的隧道帧直接解压到 pbuf, 经 tcpip_input 投递,
+ *   不再借用 netif_default (以太网口) 和中间缓冲区
+ * - 对端 DDC: 目标 IP 已在节点表中的 ARP 请求本地应答 (对端本地 MAC),
+ *   未知目标的 ARP 请求发往 Top Node, 由其下发对端映射
+ *
+ * 网卡与以太网口使用相同的 MAC/IP/子网, 后加入 netif_list 因而路由优先,
+ * 并设为默认网卡。以太网口仍可用:
+ * - 路由钩子 (lwipopts.h LWIP_HOOK_IP4_ROUTE_SRC): 目的地址 (子网外为以太网
+ *   口网关) 已在以太网口 ARP 表中时经以太网口发出, 其余经 Mesh
+ * - IPv4 广播/组播经 Mesh 发出的同时复制到以太网口 (如 I-Am)
+ * linkoutput 在 tcpip 线程执行, 发送期间阻塞该线程 (与 Top Node 在以太网
+ * 输入线程转发相同)。
+ *
+ * @version 0.7.1
+ */
+
+#ifndef TPMESH_NETIF_H
+#define TPMESH_NETIF_H
+
+#include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** Mesh 网卡 MTU (隧道帧分片发送, 重组缓冲区 1600 字节) */
+#ifndef TPMESH_NETIF_MTU
+#define TPMESH_NETIF_MTU 1500
+#endif
+
+/** 是否设为 lwIP 默认网卡 */
+#ifndef TPMESH_NETIF_SET_DEFAULT
+#define TPMESH_NETIF_SET_DEFAULT 1
+#endif
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 添加并启用 Mesh 网卡 (DDC)
+ *
+ * 与 EnetInit() 相同, 须在调度器启动前调用。
+ *
+ * @param mac 本机 MAC
+ * @param ip 本机 IP
+ * @param netmask 子网掩码
+ * @param gw 网关
+ * @return 0=成功, -1=添加失败
+ */
+int tpmesh_netif_start(const uint8_t *mac, const ip4_addr_t *ip,
+                       const ip4_addr_t *netmask, const ip4_addr_t *gw);
+
+/**
+ * @brief 获取 Mesh 网卡
+ * @return netif, 未启用时返回 NULL
+ */
+struct netif *tpmesh_netif_get(void);
+
+/**
+ * @brief 把来自 Mesh 的以太网帧交给协议栈
+ * @param p 以太网帧 (所有权转移, 失败时由本函数释放)
+ * @return 0=成功, -1=网卡未启用或投递失败
+ */
+int tpmesh_netif_input(struct pbuf *p);
+
+/**
+ * @brief 对端 DDC 映射已安装, 向协议栈投递其 ARP 应答 (等待中的解析立即完成)
+ * @param mac 对端本地 MAC
+ * @param ip 对端 IP
+ * @return 0=成功, -1=网卡未启用或投递失败
+ */
+int tpmesh_netif_peer_resolved(const uint8_t *mac, const ip4_addr_t *ip);
+
+/**
+ * @brief 路由钩子: 以太网口一侧的主机经以太网口发出 (tcpip 线程)
+ *
+ * 由 lwipopts.h 的 LWIP_HOOK_IP4_ROUTE_SRC 调用。
+ *
+ * @param src 源地址 (可为 NULL)
+ * @param dest 目的地址
+ * @return 以太网口; NULL=按 lwIP 默认路由 (Mesh 网卡)
+ */
+struct netif *tpmesh_netif_route_src(const ip4_addr_t *src,
+                                     const ip4_addr_t *dest);
+
+/**
+ * @brief 打印收发统计 (调试用)
+ */
+void tpmesh_netif_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_NETIF_H */
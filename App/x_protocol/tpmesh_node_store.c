@@ -0,0 +1,326 @@
+/**
+ * @file tpmesh_node_store.c
+ * @brief TPMesh 节点表快照实现
+ *
+ * @version 0.7.1
+ */
+
+#include "tpmesh_node_store.h"
+#include "AppConfig.h"
+#include "eepromEmul.h"
+#include "node_table.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_timer.h"
+#include <string.h>
+
+/* ============================================================================
+ * 常量定义
+ * ============================================================================
+ */
+
+#define STORE_MAGIC 0x544E5453UL /* "TNTS" */
+#define STORE_VERSION 2
+#define STORE_HDR_LEN 16
+#define STORE_REC_LEN 20
+#define STORE_MAX_LEN (STORE_HDR_LEN + NODE_TABLE_MAX_ENTRIES * STORE_REC_LEN)
+
+#define REJOIN_MAGIC 0x54524A32UL /* "TRJ2"; 旧版 22 字节记录为 "TRJN" */
+#define REJOIN_LEN 24
+
+#if (TPMESH_NODE_STORE_SADDR + STORE_MAX_LEN) > TPMESH_REJOIN_SADDR
+#error "node table snapshot overlaps the DDC rejoin record"
+#endif
+
+#if (TPMESH_REJOIN_SADDR + REJOIN_LEN) > BACNETOBJ_SADDR
+#error "node table snapshot overlaps BACnet object storage"
+#endif
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+/** 快照缓冲区 (头 + 记录) */
+static uint8_t s_buf[STORE_MAX_LEN];
+
+/** Top Node 注册纪元 (随快照保存) */
+static uint32_t s_epoch = 0;
+
+/** 已写入 (或启动时读到) 的快照 */
+static uint32_t s_saved_gen = 0;
+static uint16_t s_saved_crc = 0;
+static uint16_t s_saved_count = 0;
+
+/** 合并写入状态 */
+static uint32_t s_last_gen = 0;
+static bool s_dirty = false;
+static uint32_t s_dirty_since = 0;
+
+static tpmesh_timer_t s_store_timer;
+
+/** 统计 */
+static uint16_t s_restored = 0;
+static uint32_t s_writes = 0;
+static uint32_t s_skipped = 0;
+static uint32_t s_failures = 0;
+
+/* ============================================================================
+ * 私有函数
+ * ============================================================================
+ */
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * @brief 序列化一个节点 (静态节点由配置加载, 不保存)
+ */
+static bool snapshot_cb(const node_entry_t *entry, void *arg) {
+  uint16_t *count = (uint16_t *)arg;
+
+  /* 静态配置由集成方重建, 其他 Top Node 的 DDC 由同步重新获得 */
+  if (entry->source == NODE_SOURCE_STATIC ||
+      entry->source == NODE_SOURCE_SYNC) {
+    return true;
+  }
+
+  uint8_t *r = s_buf + STORE_HDR_LEN + (uint32_t)*count * STORE_REC_LEN;
+  memcpy(r, entry->mac, 6);
+  memcpy(r + 6, &entry->ip.addr, 4); /* 网络序 */
+  put_u16(r + 10, entry->mesh_id);
+  put_u32(r + 12, entry->device_instance);
+  put_u16(r + 16, entry->group);
+  r[18] = entry->caps;
+  r[19] = entry->source;
+
+  (*count)++;
+  return *count < NODE_TABLE_MAX_ENTRIES;
+}
+
+/**
+ * @brief 生成快照并写入 (内容未变时跳过)
+ */
+static int store_write(void) {
+  uint32_t gen = node_table_generation();
+  uint16_t count = 0;
+
+  node_table_foreach(snapshot_cb, &count);
+
+  uint16_t crc = tpmesh_calc_crc16(s_buf + STORE_HDR_LEN,
+                                   (uint16_t)(count * STORE_REC_LEN));
+  if (count == s_saved_count && crc == s_saved_crc) {
+    /* 变更后又恢复原状 (如节点离线后重新注册) */
+    s_saved_gen = gen;
+    s_skipped++;
+    return 0;
+  }
+
+  put_u32(s_buf, STORE_MAGIC);
+  s_buf[4] = STORE_VERSION;
+  s_buf[5] = 0;
+  put_u16(s_buf + 6, count);
+  put_u16(s_buf + 8, crc);
+  put_u16(s_buf + 10, 0);
+  put_u32(s_buf + 12, s_epoch);
+
+  if (!EEPROMWrite(TPMESH_NODE_STORE_SADDR, s_buf,
+                   STORE_HDR_LEN + (uint32_t)count * STORE_REC_LEN)) {
+    s_failures++;
+    tpmesh_debug_printf("NodeStore: EEPROM write failed\n");
+    return -1;
+  }
+
+  s_saved_gen = gen;
+  s_saved_crc = crc;
+  s_saved_count = count;
+  s_writes++;
+  tpmesh_debug_printf("NodeStore: Snapshot saved (%u nodes)\n", count);
+  return 0;
+}
+
+/**
+ * @brief 周期检查: 变更静默一个周期或累计超过最长延迟后写入
+ */
+static void store_tick(tpmesh_timer_t *timer, void *arg) {
+  uint32_t gen = node_table_generation();
+  uint32_t now = tpmesh_timer_now();
+  (void)arg;
+
+  if (gen != s_saved_gen) {
+    if (!s_dirty) {
+      s_dirty = true;
+      s_dirty_since = now;
+    }
+    if ((gen == s_last_gen ||
+         now - s_dirty_since >= TPMESH_NODE_STORE_MAX_DELAY_MS) &&
+        !EEPROMBusy()) {
+      if (store_write() == 0) {
+        s_dirty = false;
+      }
+    }
+  }
+  s_last_gen = gen;
+
+  tpmesh_timer_start(timer, TPMESH_NODE_STORE_CHECK_MS);
+}
+
+/**
+ * @brief 读取并校验快照, 逐条恢复
+ * @return 恢复的节点数
+ */
+static int store_restore(uint32_t *epoch) {
+  if (GetEEPROMStatus() != EEPROM_OK ||
+      !EEPROMRead(TPMESH_NODE_STORE_SADDR, s_buf, STORE_HDR_LEN)) {
+    return 0;
+  }
+
+  uint16_t count = get_u16(s_buf + 6);
+  uint16_t crc = get_u16(s_buf + 8);
+  if (get_u32(s_buf) != STORE_MAGIC || s_buf[4] != STORE_VERSION ||
+      count > NODE_TABLE_MAX_ENTRIES) {
+    return 0;
+  }
+
+  if (!EEPROMRead(TPMESH_NODE_STORE_SADDR + STORE_HDR_LEN,
+                  s_buf + STORE_HDR_LEN, (uint32_t)count * STORE_REC_LEN) ||
+      tpmesh_calc_crc16(s_buf + STORE_HDR_LEN,
+                        (uint16_t)(count * STORE_REC_LEN)) != crc) {
+    tpmesh_debug_printf("NodeStore: Snapshot CRC error, ignored\n");
+    return 0;
+  }
+
+  uint32_t saved_epoch = get_u32(s_buf + 12);
+  if (saved_epoch != 0) {
+    *epoch = saved_epoch;
+  }
+
+  int restored = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    const uint8_t *r = s_buf + STORE_HDR_LEN + (uint32_t)i * STORE_REC_LEN;
+    node_entry_t e;
+
+    memset(&e, 0, sizeof(e));
+    memcpy(e.mac, r, 6);
+    memcpy(&e.ip.addr, r + 6, 4);
+    e.mesh_id = get_u16(r + 10);
+    e.device_instance = get_u32(r + 12);
+    e.group = get_u16(r + 16);
+    e.caps = r[18];
+    e.source = r[19];
+    if (e.source != NODE_SOURCE_LEARNED && e.source != NODE_SOURCE_REGISTER) {
+      continue;
+    }
+
+    if (node_table_restore(&e) == 0) {
+      restored++;
+    }
+  }
+
+  /* 快照与恢复后的表一致, 无需立即回写 */
+  s_saved_crc = crc;
+  s_saved_count = count;
+  return restored;
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_node_store_init(uint32_t *epoch) {
+  s_restored = (uint16_t)store_restore(epoch);
+  s_epoch = *epoch;
+  s_saved_gen = node_table_generation();
+  s_last_gen = s_saved_gen;
+  s_dirty = false;
+
+  tpmesh_timer_setup(&s_store_timer, store_tick, NULL);
+  tpmesh_timer_start(&s_store_timer, TPMESH_NODE_STORE_CHECK_MS);
+
+  if (s_restored > 0) {
+    tpmesh_debug_printf("NodeStore: Restored %u nodes (stale until seen)\n",
+                        s_restored);
+  }
+  return s_restored;
+}
+
+int tpmesh_node_store_flush(void) {
+  if (node_table_generation() == s_saved_gen) {
+    return 0;
+  }
+  if (store_write() != 0) {
+    return -1;
+  }
+  s_dirty = false;
+  return 0;
+}
+
+int tpmesh_node_store_load_rejoin(tpmesh_rejoin_t *rec) {
+  uint8_t buf[REJOIN_LEN];
+
+  if (GetEEPROMStatus() != EEPROM_OK ||
+      !EEPROMRead(TPMESH_REJOIN_SADDR, buf, sizeof(buf)) ||
+      get_u32(buf) != REJOIN_MAGIC ||
+      tpmesh_calc_crc16(buf, REJOIN_LEN - 2) != get_u16(buf + REJOIN_LEN - 2)) {
+    return -1;
+  }
+
+  rec->epoch = get_u32(buf + 4);
+  memcpy(rec->mac, buf + 8, 6);
+  memcpy(&rec->ip.addr, buf + 14, 4);
+  rec->mesh_id = get_u16(buf + 18);
+  rec->top_id = get_u16(buf + 20);
+  return (rec->epoch != 0) ? 0 : -1;
+}
+
+int tpmesh_node_store_save_rejoin(const tpmesh_rejoin_t *rec) {
+  uint8_t buf[REJOIN_LEN];
+  uint8_t old[REJOIN_LEN];
+
+  put_u32(buf, REJOIN_MAGIC);
+  put_u32(buf + 4, rec->epoch);
+  memcpy(buf + 8, rec->mac, 6);
+  memcpy(buf + 14, &rec->ip.addr, 4);
+  put_u16(buf + 18, rec->mesh_id);
+  put_u16(buf + 20, rec->top_id);
+  put_u16(buf + REJOIN_LEN - 2, tpmesh_calc_crc16(buf, REJOIN_LEN - 2));
+
+  /* 同一 Top Node 纪元下重复注册不重复写 */
+  if (EEPROMRead(TPMESH_REJOIN_SADDR, old, sizeof(old)) &&
+      memcmp(old, buf, sizeof(buf)) == 0) {
+    return 0;
+  }
+
+  if (!EEPROMWrite(TPMESH_REJOIN_SADDR, buf, sizeof(buf))) {
+    tpmesh_debug_printf("NodeStore: Rejoin record write failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+void tpmesh_node_store_dump(void) {
+  tpmesh_debug_printf("NodeStore: restored %u, saved %u nodes\n", s_restored,
+                      s_saved_count);
+  tpmesh_debug_printf("  writes %lu, unchanged %lu, failed %lu\n",
+                      (unsigned long)s_writes, (unsigned long)s_skipped,
+                      (unsigned long)s_failures);
+}
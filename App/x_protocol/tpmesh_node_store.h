@@ -0,0 +1,118 @@
+/**
+ * @file tpmesh_node_store.h
+ * @brief TPMesh 节点表快照 (Top Node, 模拟 EEPROM 持久化)
+ *
+ * Top Node 重启或升级后节点表为空, BMS 访问 DDC 要等各 DDC 重新注册。
+ * 本模块把已注册/学习的节点保存到模拟 EEPROM, 启动时恢复:
+ * - 恢复的条目标记 stale, 保持在线可路由, 代理 ARP 立即可用
+ * - 收到该节点的数据或心跳后转为正常, 超时未确认则离线
+ * - 写入合并: 节点表变更后静默 TPMESH_NODE_STORE_CHECK_MS 或累计
+ *   TPMESH_NODE_STORE_MAX_DELAY_MS 才写一次, 内容未变 (CRC 相同) 不写
+ *
+ * 快照格式 (大端):
+ *   [Magic:4][Ver:1][Rsv:1][Count:2][CRC16:2][Rsv:2][Epoch:4]
+ *   Count x [MAC:6][IP:4][MeshID:2][Instance:4][Group:2][Caps:1][Source:1]
+ *
+ * 快照同时保存 Top Node 的注册纪元: 节点表得以恢复时沿用原纪元,
+ * DDC 缓存的纪元仍然有效, 可快速重新上线。
+ *
+ * DDC 侧保存最近一次注册的纪元、地址与所属 Top Node (快速重新上线记录):
+ *   [Magic:4][Epoch:4][MAC:6][IP:4][MeshID:2][TopID:2][CRC16:2]
+ * 不含 TopID 的旧版记录 (22 字节) 魔数不同, 读取时被忽略。
+ *
+ * @version 0.7.1
+ */
+
+#ifndef TPMESH_NODE_STORE_H
+#define TPMESH_NODE_STORE_H
+
+#include "lwip/ip4_addr.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 快照在模拟 EEPROM 中的起始地址 (位于校准数据与 BACnet 对象区之间) */
+#ifndef TPMESH_NODE_STORE_SADDR
+#define TPMESH_NODE_STORE_SADDR 0x8000
+#endif
+
+/** DDC 快速重新上线记录地址 (紧随节点表快照区) */
+#ifndef TPMESH_REJOIN_SADDR
+#define TPMESH_REJOIN_SADDR (TPMESH_NODE_STORE_SADDR + 0x1800)
+#endif
+
+/** 变更检查周期 (ms), 同时是合并写入的静默时间 */
+#ifndef TPMESH_NODE_STORE_CHECK_MS
+#define TPMESH_NODE_STORE_CHECK_MS 10000
+#endif
+
+/** 持续变更时最长延迟写入时间 (ms) */
+#ifndef TPMESH_NODE_STORE_MAX_DELAY_MS
+#define TPMESH_NODE_STORE_MAX_DELAY_MS 60000
+#endif
+
+/* ============================================================================
+ * 数据结构定义
+ * ============================================================================
+ */
+
+/**
+ * @brief DDC 快速重新上线记录
+ */
+typedef struct {
+  uint32_t epoch;   /**< Top Node 注册纪元 */
+  uint8_t mac[6];   /**< 注册时的 MAC */
+  ip4_addr_t ip;    /**< 注册时的 IP */
+  uint16_t mesh_id; /**< 注册时的 Mesh ID */
+  uint16_t top_id;  /**< 注册所在 Top Node 的 Mesh ID */
+} tpmesh_rejoin_t;
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 从快照恢复节点表并启动合并写入 (node_table_init 之后调用)
+ * @param epoch [in/out] 本次启动的注册纪元; 快照有效时替换为快照中的纪元
+ * @return 恢复的节点数, 无有效快照时为 0
+ */
+int tpmesh_node_store_init(uint32_t *epoch);
+
+/**
+ * @brief 立即写入快照 (内容未变时跳过)
+ * @return 0=成功或无需写入, -1=EEPROM 写入失败
+ */
+int tpmesh_node_store_flush(void);
+
+/**
+ * @brief 打印统计
+ */
+void tpmesh_node_store_dump(void);
+
+/**
+ * @brief DDC: 读取快速重新上线记录
+ * @param rec [out] 记录
+ * @return 0=有效, -1=无记录或校验失败
+ */
+int tpmesh_node_store_load_rejoin(tpmesh_rejoin_t *rec);
+
+/**
+ * @brief DDC: 保存快速重新上线记录 (与已保存内容相同时不写)
+ * @param rec 记录
+ * @return 0=成功, -1=EEPROM 写入失败
+ */
+int tpmesh_node_store_save_rejoin(const tpmesh_rejoin_t *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_NODE_STORE_H */
@@ -0,0 +1,522 @@
+/**
+ * @file tpmesh_route.c
+ * @brief TPMesh 路由/拓扑表实现
+ *
+ * @version 0.8.0
+ */
+
+#include "tpmesh_route.h"
+#include "tpmesh_at.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_timer.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ============================================================================
+ * 类型定义
+ * ============================================================================
+ */
+
+/** 路由表槽 */
+typedef struct {
+  tpmesh_route_t r;
+  bool valid;
+  bool seen; /**< 本轮查询中出现过 */
+} route_slot_t;
+
+/** 中继负载汇总 (仅打印时使用) */
+typedef struct {
+  uint16_t addr;   /**< 中继 Mesh ID */
+  uint16_t routes; /**< 经过该中继的主路径数 */
+  uint32_t frames; /**< 这些路径上的收发帧数 */
+} route_relay_t;
+
+/** 打印的中继数 */
+#define ROUTE_DUMP_RELAYS 8
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+/** 路由表 (AT RX 任务写, 其他任务读; 临界区保护) */
+static route_slot_t s_slots[TPMESH_ROUTE_MAX];
+
+/** 查询定时器 (桥接任务上下文) */
+static tpmesh_timer_t s_query_timer;
+
+/** 查询状态: 下一页起始序号 (1 起), 本轮开始时间, 本页行数 */
+static uint16_t s_next_start = 1;
+static uint32_t s_sweep_tick = 0;
+static volatile uint16_t s_page_lines = 0;
+static volatile bool s_querying = false;
+
+/** 上一条路径行 (PATH 折行时归属) */
+static int s_last_slot = -1;
+static uint8_t s_last_idx = 0;
+
+static bool s_initialized = false;
+
+/* ============================================================================
+ * 私有函数 - 路由表 (调用方持有临界区)
+ * ============================================================================
+ */
+
+static int route_find(uint16_t dest) {
+  for (int i = 0; i < TPMESH_ROUTE_MAX; i++) {
+    if (s_slots[i].valid && s_slots[i].r.dest == dest) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief 查找或分配条目, 满时替换最久未更新的条目
+ */
+static int route_get_or_alloc(uint16_t dest, uint32_t now) {
+  int idx = route_find(dest);
+  if (idx >= 0) {
+    return idx;
+  }
+
+  int oldest = 0;
+  for (int i = 0; i < TPMESH_ROUTE_MAX; i++) {
+    if (!s_slots[i].valid) {
+      oldest = i;
+      break;
+    }
+    if ((int32_t)(s_slots[i].r.updated - s_slots[oldest].r.updated) < 0) {
+      oldest = i;
+    }
+  }
+
+  route_slot_t *s = &s_slots[oldest];
+  memset(s, 0, sizeof(*s));
+  s->valid = true;
+  s->r.dest = dest;
+  s->r.updated = now;
+  return oldest;
+}
+
+/* ============================================================================
+ * 私有函数 - AT+DUMP=RT 解析
+ * ============================================================================
+ */
+
+/**
+ * @brief 查找 "KEY[" 字段, 返回括号内起点
+ */
+static const char *route_field(const char *line, const char *key) {
+  const char *p = strstr(line, key);
+  return p ? p + strlen(key) : NULL;
+}
+
+/**
+ * @brief 解析十六进制字段 (容忍 0x 前缀和空格)
+ */
+static uint16_t route_parse_hex(const char *p) {
+  char hex[9];
+  uint8_t n = 0;
+
+  while (*p != '\0' && *p != ']' && n < sizeof(hex) - 1) {
+    if (isxdigit((unsigned char)*p)) {
+      hex[n++] = *p;
+    }
+    p++;
+  }
+  hex[n] = '\0';
+  return (uint16_t)strtoul(hex, NULL, 16);
+}
+
+/**
+ * @brief 解析十进制字段
+ */
+static long route_parse_dec(const char *p) {
+  while (*p == ' ') p++;
+  return strtol(p, NULL, 10);
+}
+
+/**
+ * @brief 解析 PATH[CCCC-BBBB] 的途径节点
+ * @return 节点数
+ */
+static uint8_t route_parse_path(const char *p, uint16_t *path, uint8_t max) {
+  uint8_t count = 0;
+  uint32_t v = 0;
+  uint8_t digits = 0;
+
+  for (;; p++) {
+    if (isxdigit((unsigned char)*p)) {
+      v = (v << 4) | (uint32_t)(isdigit((unsigned char)*p)
+                                     ? *p - '0'
+                                     : (toupper((unsigned char)*p) - 'A' + 10));
+      digits++;
+    } else if (*p == '-' || *p == ']' || *p == '\0') {
+      if (digits > 0 && count < max) {
+        path[count++] = (uint16_t)v;
+      }
+      v = 0;
+      digits = 0;
+      if (*p != '-') {
+        break;
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief 把途径节点写入上一条路径 (调用方持有临界区)
+ */
+static void route_apply_path(int idx, uint8_t path_idx, const uint16_t *path,
+                             uint8_t n) {
+  tpmesh_route_t *r = &s_slots[idx].r;
+
+  if (path_idx == 0) {
+    r->path_len = n;
+    memcpy(r->path, path, n * sizeof(uint16_t));
+  } else if (r->alt_count > 0 && n > 0) {
+    r->alt[r->alt_count - 1].next_hop = path[0];
+  }
+}
+
+/**
+ * @brief 命令输出行 (AT RX 任务上下文)
+ *
+ * 只在本模块查询期间处理, 其他命令的输出和 AT+DUMP=OTA 的 ADDR 行
+ * (无 IDX) 忽略。
+ */
+static void route_line_cb(const char *line) {
+  if (!s_querying) {
+    return;
+  }
+
+  uint16_t path[TPMESH_ROUTE_PATH_MAX];
+
+  /* PATH 折行输出: 属于上一条路径 */
+  if (strncmp(line, "PATH[", 5) == 0) {
+    if (s_last_slot >= 0) {
+      uint8_t n = route_parse_path(line + 5, path, TPMESH_ROUTE_PATH_MAX);
+      taskENTER_CRITICAL();
+      if (s_slots[s_last_slot].valid) {
+        route_apply_path(s_last_slot, s_last_idx, path, n);
+      }
+      taskEXIT_CRITICAL();
+    }
+    return;
+  }
+
+  if (strncmp(line, "ADDR[", 5) != 0) {
+    return;
+  }
+  const char *f_idx = route_field(line, "IDX[");
+  const char *f_hop = route_field(line, "HOP[");
+  if (f_idx == NULL || f_hop == NULL) {
+    return;
+  }
+  s_page_lines++;
+
+  uint16_t dest = route_parse_hex(line + 5);
+  long path_idx = route_parse_dec(f_idx);
+  long hops = route_parse_dec(f_hop);
+  const char *f_err = route_field(line, "ERR[");
+  long err = f_err ? route_parse_dec(f_err) : 0;
+  if (hops < 1 || hops > 255 || path_idx < 0 || err < 0) {
+    return;
+  }
+  if (err > 255) {
+    err = 255;
+  }
+
+  const char *f_path = route_field(line, "PATH[");
+  uint8_t n = f_path ? route_parse_path(f_path, path, TPMESH_ROUTE_PATH_MAX) : 0;
+  uint32_t now = tpmesh_get_tick_ms();
+
+  taskENTER_CRITICAL();
+  int idx = route_get_or_alloc(dest, now);
+  route_slot_t *s = &s_slots[idx];
+  s->seen = true;
+  s->r.updated = now;
+  s_last_slot = idx;
+  s_last_idx = (uint8_t)(path_idx > 0 ? 1 : 0);
+  if (path_idx == 0) {
+    s->r.hops = (uint8_t)hops;
+    s->r.err = (uint8_t)err;
+    s->r.alt_count = 0;
+    route_apply_path(idx, 0, path, n);
+  } else if (s->r.alt_count < TPMESH_ROUTE_ALT_MAX) {
+    tpmesh_route_alt_t *a = &s->r.alt[s->r.alt_count++];
+    a->hops = (uint8_t)hops;
+    a->err = (uint8_t)err;
+    a->next_hop = (n > 0) ? path[0] : dest;
+  } else {
+    s_last_slot = -1; /* 备选路径已满, 折行的 PATH 一并忽略 */
+  }
+  taskEXIT_CRITICAL();
+}
+
+/* ============================================================================
+ * 私有函数 - 分页查询
+ * ============================================================================
+ */
+
+/**
+ * @brief 一轮查询结束: 删除模组已老化且本轮期间无事件的条目
+ */
+static void route_sweep_end(void) {
+  taskENTER_CRITICAL();
+  for (int i = 0; i < TPMESH_ROUTE_MAX; i++) {
+    route_slot_t *s = &s_slots[i];
+    if (s->valid && !s->seen &&
+        (int32_t)(s->r.updated - s_sweep_tick) < 0) {
+      s->valid = false;
+    }
+  }
+  taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief 查询定时器到期 (桥接任务): 查询一页路径
+ */
+static void route_query_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)arg;
+  char cmd[32];
+
+  if (s_next_start == 1) {
+    s_sweep_tick = tpmesh_get_tick_ms();
+    taskENTER_CRITICAL();
+    for (int i = 0; i < TPMESH_ROUTE_MAX; i++) {
+      s_slots[i].seen = false;
+    }
+    taskEXIT_CRITICAL();
+  }
+
+  snprintf(cmd, sizeof(cmd), "AT+DUMP=RT,%u,%u", (unsigned)s_next_start,
+           (unsigned)TPMESH_ROUTE_PAGE);
+  s_page_lines = 0;
+  s_last_slot = -1;
+  s_querying = true;
+  at_resp_t r = tpmesh_at_cmd(cmd, TPMESH_AT_TIMEOUT_MS);
+  s_querying = false;
+
+  if (r != AT_RESP_OK) {
+    /* 查询失败: 保留现有条目, 下一周期从头查询 */
+    s_next_start = 1;
+    tpmesh_timer_start(timer, TPMESH_ROUTE_REFRESH_MS);
+    return;
+  }
+
+  if (s_page_lines >= TPMESH_ROUTE_PAGE) {
+    s_next_start += s_page_lines;
+    tpmesh_timer_start(timer, TPMESH_ROUTE_PAGE_GAP_MS);
+    return;
+  }
+
+  route_sweep_end();
+  s_next_start = 1;
+  tpmesh_timer_start(timer, TPMESH_ROUTE_REFRESH_MS);
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_route_init(void) {
+  if (s_initialized) {
+    return 0;
+  }
+
+  memset(s_slots, 0, sizeof(s_slots));
+  s_next_start = 1;
+  tpmesh_timer_setup(&s_query_timer, route_query_expired, NULL);
+  tpmesh_at_set_line_cb(route_line_cb);
+  s_initialized = true;
+
+  tpmesh_timer_start(&s_query_timer, TPMESH_ROUTE_EVENT_DELAY_MS);
+  return 0;
+}
+
+void tpmesh_route_on_event(const char *event, uint16_t addr) {
+  if (!s_initialized || event == NULL) {
+    return;
+  }
+  while (*event == ' ') event++;
+
+  uint32_t now = tpmesh_get_tick_ms();
+
+  if (strncmp(event, "CREATE", 6) == 0) {
+    taskENTER_CRITICAL();
+    s_slots[route_get_or_alloc(addr, now)].r.updated = now;
+    taskEXIT_CRITICAL();
+    tpmesh_route_refresh();
+  } else if (strncmp(event, "DELETE", 6) == 0) {
+    taskENTER_CRITICAL();
+    int idx = route_find(addr);
+    if (idx >= 0) {
+      s_slots[idx].valid = false;
+    }
+    taskEXIT_CRITICAL();
+  }
+}
+
+void tpmesh_route_refresh(void) {
+  if (!s_initialized) {
+    return;
+  }
+
+  /* 分页查询进行中或已安排更早的查询时不推迟 */
+  uint32_t deadline = tpmesh_timer_now() + TPMESH_ROUTE_EVENT_DELAY_MS;
+  if (s_next_start == 1 &&
+      (!tpmesh_timer_active(&s_query_timer) ||
+       (int32_t)(s_query_timer.deadline - deadline) > 0)) {
+    tpmesh_timer_start_at(&s_query_timer, deadline);
+  }
+}
+
+int tpmesh_route_get(uint16_t dest, tpmesh_route_t *route) {
+  int ret = -1;
+
+  taskENTER_CRITICAL();
+  int idx = route_find(dest);
+  if (idx >= 0) {
+    *route = s_slots[idx].r;
+    ret = 0;
+  }
+  taskEXIT_CRITICAL();
+  return ret;
+}
+
+uint8_t tpmesh_route_hops(uint16_t dest) {
+  uint8_t hops = 0;
+
+  taskENTER_CRITICAL();
+  int idx = route_find(dest);
+  if (idx >= 0) {
+    hops = s_slots[idx].r.hops;
+  }
+  taskEXIT_CRITICAL();
+  return hops;
+}
+
+void tpmesh_route_account(uint16_t mesh_id, bool tx) {
+  if (!s_initialized) {
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  int idx = route_find(mesh_id);
+  if (idx >= 0) {
+    if (tx) {
+      s_slots[idx].r.tx_frames++;
+    } else {
+      s_slots[idx].r.rx_frames++;
+    }
+  }
+  taskEXIT_CRITICAL();
+}
+
+void tpmesh_route_dump(void) {
+  static route_relay_t relays[TPMESH_ROUTE_MAX];
+  uint16_t relay_count = 0;
+  uint32_t total = 0;
+  uint32_t now = tpmesh_get_tick_ms();
+
+  tpmesh_debug_printf("Routes:\n");
+  for (int i = 0; i < TPMESH_ROUTE_MAX; i++) {
+    tpmesh_route_t r;
+    bool valid;
+
+    taskENTER_CRITICAL();
+    valid = s_slots[i].valid;
+    if (valid) {
+      r = s_slots[i].r;
+    }
+    taskEXIT_CRITICAL();
+    if (!valid) {
+      continue;
+    }
+
+    uint32_t frames = r.tx_frames + r.rx_frames;
+    total += frames;
+
+    char path[TPMESH_ROUTE_PATH_MAX * 5 + 1];
+    int off = 0;
+    path[0] = '\0';
+    for (uint8_t j = 0; j < r.path_len; j++) {
+      off += snprintf(path + off, sizeof(path) - off, "%s%04X",
+                      j ? "-" : "", r.path[j]);
+    }
+
+    if (r.hops == 0) {
+      tpmesh_debug_printf("  0x%04X hop ?, tx %lu, rx %lu\n", r.dest,
+                          (unsigned long)r.tx_frames,
+                          (unsigned long)r.rx_frames);
+    } else {
+      tpmesh_debug_printf("  0x%04X hop %u via 0x%04X [%s] err %u, "
+                          "tx %lu, rx %lu, %lu ms ago\n",
+                          r.dest, r.hops,
+                          r.path_len ? r.path[0] : r.dest, path, r.err,
+                          (unsigned long)r.tx_frames,
+                          (unsigned long)r.rx_frames,
+                          (unsigned long)(now - r.updated));
+    }
+    for (uint8_t j = 0; j < r.alt_count; j++) {
+      tpmesh_debug_printf("    alt hop %u via 0x%04X err %u\n", r.alt[j].hops,
+                          r.alt[j].next_hop, r.alt[j].err);
+    }
+
+    /* 主路径途径节点承载该目的节点的全部流量 */
+    for (uint8_t j = 0; j < r.path_len; j++) {
+      uint16_t k;
+      for (k = 0; k < relay_count; k++) {
+        if (relays[k].addr == r.path[j]) {
+          break;
+        }
+      }
+      if (k == relay_count) {
+        if (relay_count >= TPMESH_ROUTE_MAX) {
+          continue;
+        }
+        relays[k].addr = r.path[j];
+        relays[k].routes = 0;
+        relays[k].frames = 0;
+        relay_count++;
+      }
+      relays[k].routes++;
+      relays[k].frames += frames;
+    }
+  }
+
+  if (relay_count == 0) {
+    return;
+  }
+
+  /* 按承载帧数降序 */
+  for (uint16_t i = 1; i < relay_count; i++) {
+    route_relay_t t = relays[i];
+    uint16_t j = i;
+    while (j > 0 && relays[j - 1].frames < t.frames) {
+      relays[j] = relays[j - 1];
+      j--;
+    }
+    relays[j] = t;
+  }
+
+  tpmesh_debug_printf("Relays (by carried frames):\n");
+  for (uint16_t i = 0; i < relay_count && i < ROUTE_DUMP_RELAYS; i++) {
+    tpmesh_debug_printf("  0x%04X: %u routes, %lu frames (%lu%%)\n",
+                        relays[i].addr, relays[i].routes,
+                        (unsigned long)relays[i].frames,
+                        total ? (unsigned long)((uint64_t)relays[i].frames *
+                                                100 / total)
+                              : 0UL);
+  }
+}
@@ -0,0 +1,164 @@
+/**
+ * @file tpmesh_route.h
+ * @brief TPMesh 路由/拓扑表 (+ROUTE 事件与模组路由查询)
+ *
+ * 模组只以 +ROUTE:CREATE / DELETE 通知路由增删, 跳数和途径节点需用
+ * 运维指令 AT+DUMP=RT 查询。这里按目的节点维护一份路由表:
+ * - CREATE 建立条目 (跳数未知) 并尽快查询, DELETE 删除条目
+ * - 桥接任务定时分页查询 AT+DUMP=RT,<START>,<CNT>, 每行一条路径:
+ *   ADDR[0xAAAA]IDX[0]HOP[3]RSSI[-1]VAL[184.00]TYPE[2]ERR[0]LT[..]PATH[CCCC-BBBB]
+ *   IDX 0 为主路径, 其余为备选路径; PATH 为途径节点, 第一个即下一跳
+ * - 一轮查询结束后, 模组已老化删除且期间无事件的条目一并删除
+ *
+ * 跳数用于尚无 RTT 样本时的超时初值和多跳路径的分片间隔; 收发帧数
+ * 按目的节点统计, 拓扑打印时按主路径汇总到途径节点, 找出承载流量
+ * 最多的中继 (瓶颈)。
+ *
+ * @version 0.8.0
+ */
+
+#ifndef TPMESH_ROUTE_H
+#define TPMESH_ROUTE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 路由表容量 (满时替换最久未更新的条目) */
+#ifndef TPMESH_ROUTE_MAX
+#define TPMESH_ROUTE_MAX 64
+#endif
+
+/** 主路径最多记录的途径节点数 */
+#ifndef TPMESH_ROUTE_PATH_MAX
+#define TPMESH_ROUTE_PATH_MAX 6
+#endif
+
+/** 每个目的节点最多记录的备选路径数 */
+#ifndef TPMESH_ROUTE_ALT_MAX
+#define TPMESH_ROUTE_ALT_MAX 2
+#endif
+
+/** 全表查询周期 (ms) */
+#ifndef TPMESH_ROUTE_REFRESH_MS
+#define TPMESH_ROUTE_REFRESH_MS 60000
+#endif
+
+/** 路由事件后到查询的延时 (ms), 合并突发事件 */
+#ifndef TPMESH_ROUTE_EVENT_DELAY_MS
+#define TPMESH_ROUTE_EVENT_DELAY_MS 2000
+#endif
+
+/** 每次查询的路径行数 (AT+DUMP=RT 的 CNT) */
+#ifndef TPMESH_ROUTE_PAGE
+#define TPMESH_ROUTE_PAGE 16
+#endif
+
+/** 分页查询间隔 (ms), 避免长时间占用 AT 口 */
+#ifndef TPMESH_ROUTE_PAGE_GAP_MS
+#define TPMESH_ROUTE_PAGE_GAP_MS 200
+#endif
+
+/** 单跳往返时延估计 (ms): 19200 bps 空口 200 字节约 150 ms/跳 (单程) */
+#ifndef TPMESH_ROUTE_HOP_RTT_MS
+#define TPMESH_ROUTE_HOP_RTT_MS 300
+#endif
+
+/** 超过该跳数的路径分片之间间隔 TPMESH_FRAG_DELAY_MS (0=不间隔) */
+#ifndef TPMESH_ROUTE_PACE_HOPS
+#define TPMESH_ROUTE_PACE_HOPS 2
+#endif
+
+/* ============================================================================
+ * 数据结构定义
+ * ============================================================================
+ */
+
+/**
+ * @brief 备选路径
+ */
+typedef struct {
+  uint8_t hops;      /**< 跳数 */
+  uint8_t err;       /**< 连续错误次数 */
+  uint16_t next_hop; /**< 下一跳 */
+} tpmesh_route_alt_t;
+
+/**
+ * @brief 到一个目的节点的路由
+ */
+typedef struct {
+  uint16_t dest;      /**< 目的 Mesh ID */
+  uint8_t hops;       /**< 主路径跳数, 0=未知 (尚未查询) */
+  uint8_t err;        /**< 主路径连续错误次数 */
+  uint8_t path_len;   /**< 已记录的途径节点数 */
+  uint8_t alt_count;  /**< 备选路径数 */
+  uint16_t path[TPMESH_ROUTE_PATH_MAX]; /**< 途径节点, path[0]=下一跳 */
+  tpmesh_route_alt_t alt[TPMESH_ROUTE_ALT_MAX]; /**< 备选路径 */
+  uint32_t tx_frames; /**< 发往该节点的 Mesh 帧 (分片) */
+  uint32_t rx_frames; /**< 来自该节点的 Mesh 帧 (分片) */
+  uint32_t updated;   /**< 最后更新时间 (ms) */
+} tpmesh_route_t;
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化并启动定时查询 (模组初始化之后, 桥接任务中调用)
+ * @return 0=成功
+ */
+int tpmesh_route_init(void);
+
+/**
+ * @brief 处理 +ROUTE 事件 (AT RX 任务上下文)
+ * @param event 事件 ("CREATE ADDR[..]" / "DELETE ADDR[..]")
+ * @param addr 目的地址
+ */
+void tpmesh_route_on_event(const char *event, uint16_t addr);
+
+/**
+ * @brief 请求尽快重新查询路由表 (不阻塞)
+ */
+void tpmesh_route_refresh(void);
+
+/**
+ * @brief 获取到目的节点的路由
+ * @param dest 目的 Mesh ID
+ * @param route [out] 路由
+ * @return 0=成功, -1=无路由
+ */
+int tpmesh_route_get(uint16_t dest, tpmesh_route_t *route);
+
+/**
+ * @brief 到目的节点的跳数
+ * @param dest 目的 Mesh ID
+ * @return 跳数, 0=未知
+ */
+uint8_t tpmesh_route_hops(uint16_t dest);
+
+/**
+ * @brief 统计一个 Mesh 帧 (仅统计已有路由的节点)
+ * @param mesh_id 对端 Mesh ID
+ * @param tx true=发送, false=接收
+ */
+void tpmesh_route_account(uint16_t mesh_id, bool tx);
+
+/**
+ * @brief 打印路由表与中继负载
+ */
+void tpmesh_route_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_ROUTE_H */
@@ -0,0 +1,645 @@
+/**
+ * @file tpmesh_rp_cache.c
+ * @brief TPMesh ReadProperty / ReadPropertyMultiple 应答缓存实现
+ *
+ * 仅处理本地网络 (无 DNET/SNET)、不分段的请求与应答;
+ * 其余报文一律透传, 不影响原有桥接行为。
+ *
+ * @version 0.7.1
+ */
+
+#include "tpmesh_rp_cache.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include <string.h>
+
+/* ============================================================================
+ * 类型定义
+ * ============================================================================
+ */
+
+/** 缓存条目 */
+typedef struct {
+  bool valid;
+  uint16_t mesh_id;
+  uint32_t object_id; /**< 对象标识 (type << 22 | instance) */
+  uint32_t property;
+  uint32_t index;     /**< 数组下标, TPMESH_BAC_ARRAY_ALL=无 */
+  uint32_t tick;      /**< 写入时间 */
+  uint8_t value_len;
+  uint8_t value[TPMESH_RP_CACHE_VALUE_MAX];
+} rp_cache_entry_t;
+
+/** 对象类型 TTL 配置 */
+typedef struct {
+  bool used;
+  uint16_t object_type;
+  uint32_t ttl_ms;
+} rp_cache_ttl_t;
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static rp_cache_entry_t s_entries[TPMESH_RP_CACHE_ENTRIES];
+
+static rp_cache_ttl_t s_ttl[TPMESH_RP_CACHE_TTL_SLOTS];
+
+static uint32_t s_default_ttl = TPMESH_RP_CACHE_TTL_MS;
+
+static tpmesh_rp_cache_stats_t s_stats;
+
+static SemaphoreHandle_t s_cache_mutex = NULL;
+
+/* ============================================================================
+ * 私有函数 - 编解码
+ * ============================================================================
+ */
+
+/**
+ * @brief 读取指定编号的上下文无符号数 (可选字段)
+ * @param buf 数据
+ * @param len 数据长度
+ * @param off [in/out] 偏移
+ * @param tag_num 上下文标签号
+ * @param value [out] 值
+ * @return 1=存在, 0=不存在, -1=格式错误
+ */
+static int take_context_unsigned(const uint8_t *buf, uint16_t len,
+                                 uint16_t *off, uint8_t tag_num,
+                                 uint32_t *value) {
+  tpmesh_bac_tag_t tag;
+
+  if (*off >= len) {
+    return 0;
+  }
+  int n = tpmesh_bac_decode_tag(buf + *off, len - *off, &tag);
+  if (n < 0) {
+    return -1;
+  }
+  if (!tag.context || tag.opening || tag.closing || tag.number != tag_num) {
+    return 0;
+  }
+  if (tag.data_len < 1 || tag.data_len > 4) {
+    return -1;
+  }
+
+  *value = tpmesh_bac_decode_unsigned(buf + *off + n, tag.data_len);
+  *off += n + tag.data_len;
+  return 1;
+}
+
+/**
+ * @brief 读取开/闭标签
+ * @return 1=匹配, 0=不匹配, -1=格式错误
+ */
+static int take_paired_tag(const uint8_t *buf, uint16_t len, uint16_t *off,
+                           uint8_t tag_num, bool opening) {
+  tpmesh_bac_tag_t tag;
+
+  if (*off >= len) {
+    return 0;
+  }
+  int n = tpmesh_bac_decode_tag(buf + *off, len - *off, &tag);
+  if (n < 0) {
+    return -1;
+  }
+  if (tag.number != tag_num ||
+      (opening ? !tag.opening : !tag.closing)) {
+    return 0;
+  }
+
+  *off += n;
+  return 1;
+}
+
+/**
+ * @brief 编码对象标识 (上下文标签, 固定 4 字节)
+ */
+static uint16_t encode_object_id(uint8_t *buf, uint8_t tag_num,
+                                 uint32_t object_id) {
+  buf[0] = (uint8_t)((tag_num << 4) | 0x08 | 4);
+  buf[1] = (uint8_t)(object_id >> 24);
+  buf[2] = (uint8_t)(object_id >> 16);
+  buf[3] = (uint8_t)(object_id >> 8);
+  buf[4] = (uint8_t)object_id;
+  return 5;
+}
+
+/* ============================================================================
+ * 私有函数 - 缓存表 (调用方持有锁)
+ * ============================================================================
+ */
+
+static uint32_t ttl_for(uint32_t object_id) {
+  uint16_t type = (uint16_t)(object_id >> 22);
+
+  for (int i = 0; i < TPMESH_RP_CACHE_TTL_SLOTS; i++) {
+    if (s_ttl[i].used && s_ttl[i].object_type == type) {
+      return s_ttl[i].ttl_ms;
+    }
+  }
+  return s_default_ttl;
+}
+
+static rp_cache_entry_t *find_entry(uint16_t mesh_id, uint32_t object_id,
+                                    uint32_t property, uint32_t index) {
+  for (int i = 0; i < TPMESH_RP_CACHE_ENTRIES; i++) {
+    rp_cache_entry_t *e = &s_entries[i];
+    if (e->valid && e->mesh_id == mesh_id && e->object_id == object_id &&
+        e->property == property && e->index == index) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief 查找未过期的条目
+ */
+static const rp_cache_entry_t *lookup_fresh(uint16_t mesh_id,
+                                            uint32_t object_id,
+                                            uint32_t property, uint32_t index) {
+  if (property == TPMESH_BAC_PROP_ALL || property == TPMESH_BAC_PROP_REQUIRED ||
+      property == TPMESH_BAC_PROP_OPTIONAL) {
+    return NULL;
+  }
+
+  rp_cache_entry_t *e = find_entry(mesh_id, object_id, property, index);
+  if (e == NULL) {
+    return NULL;
+  }
+
+  if (tpmesh_get_tick_ms() - e->tick >= ttl_for(object_id)) {
+    e->valid = false;
+    return NULL;
+  }
+  return e;
+}
+
+static void store_entry(uint16_t mesh_id, uint32_t object_id,
+                        uint32_t property, uint32_t index,
+                        const uint8_t *value, uint16_t value_len) {
+  if (value_len > TPMESH_RP_CACHE_VALUE_MAX || ttl_for(object_id) == 0) {
+    return;
+  }
+
+  rp_cache_entry_t *e = find_entry(mesh_id, object_id, property, index);
+  if (e == NULL) {
+    /* 空闲槽位, 否则替换最老的条目 */
+    uint32_t now = tpmesh_get_tick_ms();
+    uint32_t oldest_age = 0;
+    for (int i = 0; i < TPMESH_RP_CACHE_ENTRIES; i++) {
+      if (!s_entries[i].valid) {
+        e = &s_entries[i];
+        break;
+      }
+      if (now - s_entries[i].tick >= oldest_age) {
+        oldest_age = now - s_entries[i].tick;
+        e = &s_entries[i];
+      }
+    }
+  }
+
+  e->valid = true;
+  e->mesh_id = mesh_id;
+  e->object_id = object_id;
+  e->property = property;
+  e->index = index;
+  e->tick = tpmesh_get_tick_ms();
+  e->value_len = (uint8_t)value_len;
+  memcpy(e->value, value, value_len);
+  s_stats.stores++;
+}
+
+static void invalidate_object(uint16_t mesh_id, uint32_t object_id) {
+  for (int i = 0; i < TPMESH_RP_CACHE_ENTRIES; i++) {
+    rp_cache_entry_t *e = &s_entries[i];
+    if (e->valid && e->mesh_id == mesh_id && e->object_id == object_id) {
+      e->valid = false;
+      s_stats.invalidations++;
+    }
+  }
+}
+
+/* ============================================================================
+ * 私有函数 - 请求处理 (调用方持有锁)
+ * ============================================================================
+ */
+
+/**
+ * @brief 用缓存生成 ReadProperty-ACK
+ * @return ACK 参数长度, 0=未命中
+ */
+static uint16_t answer_read_property(uint16_t mesh_id, const uint8_t *args,
+                                     uint16_t len, uint8_t *out,
+                                     uint16_t out_max) {
+  uint16_t off = 0;
+  uint32_t object_id, property;
+  uint32_t index = TPMESH_BAC_ARRAY_ALL;
+
+  if (take_context_unsigned(args, len, &off, 0, &object_id) != 1 ||
+      take_context_unsigned(args, len, &off, 1, &property) != 1 ||
+      take_context_unsigned(args, len, &off, 2, &index) < 0 || off != len) {
+    return 0;
+  }
+
+  const rp_cache_entry_t *e =
+      lookup_fresh(mesh_id, object_id, property, index);
+  if (e == NULL || out_max < 5 + 5 + 5 + 2 + e->value_len) {
+    return 0;
+  }
+
+  uint16_t n = encode_object_id(out, 0, object_id);
+  n += tpmesh_bac_encode_context_unsigned(out + n, 1, property);
+  if (index != TPMESH_BAC_ARRAY_ALL) {
+    n += tpmesh_bac_encode_context_unsigned(out + n, 2, index);
+  }
+  out[n++] = 0x3E; /* [3] 开标签 */
+  memcpy(out + n, e->value, e->value_len);
+  n += e->value_len;
+  out[n++] = 0x3F; /* [3] 闭标签 */
+
+  return n;
+}
+
+/**
+ * @brief 用缓存生成 ReadPropertyMultiple-ACK (所有属性均命中才应答)
+ * @return ACK 参数长度, 0=未命中
+ */
+static uint16_t answer_read_property_multi(uint16_t mesh_id,
+                                           const uint8_t *args, uint16_t len,
+                                           uint8_t *out, uint16_t out_max) {
+  uint16_t off = 0;
+  uint16_t n = 0;
+
+  while (off < len) {
+    uint32_t object_id;
+
+    if (take_context_unsigned(args, len, &off, 0, &object_id) != 1 ||
+        take_paired_tag(args, len, &off, 1, true) != 1) {
+      return 0;
+    }
+    if (n + 6 > out_max) {
+      return 0;
+    }
+    n += encode_object_id(out + n, 0, object_id);
+    out[n++] = 0x1E; /* [1] 开标签 */
+
+    while (take_paired_tag(args, len, &off, 1, false) == 0) {
+      uint32_t property;
+      uint32_t index = TPMESH_BAC_ARRAY_ALL;
+
+      if (take_context_unsigned(args, len, &off, 0, &property) != 1 ||
+          take_context_unsigned(args, len, &off, 1, &index) < 0) {
+        return 0;
+      }
+
+      const rp_cache_entry_t *e =
+          lookup_fresh(mesh_id, object_id, property, index);
+      if (e == NULL || n + 5 + 5 + 2 + e->value_len > out_max) {
+        return 0;
+      }
+
+      n += tpmesh_bac_encode_context_unsigned(out + n, 2, property);
+      if (index != TPMESH_BAC_ARRAY_ALL) {
+        n += tpmesh_bac_encode_context_unsigned(out + n, 3, index);
+      }
+      out[n++] = 0x4E; /* [4] 开标签 */
+      memcpy(out + n, e->value, e->value_len);
+      n += e->value_len;
+      out[n++] = 0x4F; /* [4] 闭标签 */
+    }
+
+    if (n + 1 > out_max) {
+      return 0;
+    }
+    out[n++] = 0x1F; /* [1] 闭标签 */
+  }
+
+  return n;
+}
+
+/**
+ * @brief WritePropertyMultiple: 使列表中每个对象失效
+ */
+static void invalidate_write_multi(uint16_t mesh_id, const uint8_t *args,
+                                   uint16_t len) {
+  uint16_t off = 0;
+
+  while (off < len) {
+    uint32_t object_id;
+    if (take_context_unsigned(args, len, &off, 0, &object_id) != 1 ||
+        take_paired_tag(args, len, &off, 1, true) != 1) {
+      return;
+    }
+    invalidate_object(mesh_id, object_id);
+
+    int vlen = tpmesh_bac_find_closing(args + off, len - off, 1);
+    if (vlen < 0) {
+      return;
+    }
+    off += vlen;
+    if (take_paired_tag(args, len, &off, 1, false) != 1) {
+      return;
+    }
+  }
+}
+
+/* ============================================================================
+ * 私有函数 - 应答处理 (调用方持有锁)
+ * ============================================================================
+ */
+
+static void learn_read_property_ack(uint16_t mesh_id, const uint8_t *args,
+                                    uint16_t len) {
+  uint16_t off = 0;
+  uint32_t object_id, property;
+  uint32_t index = TPMESH_BAC_ARRAY_ALL;
+
+  if (take_context_unsigned(args, len, &off, 0, &object_id) != 1 ||
+      take_context_unsigned(args, len, &off, 1, &property) != 1 ||
+      take_context_unsigned(args, len, &off, 2, &index) < 0 ||
+      take_paired_tag(args, len, &off, 3, true) != 1) {
+    return;
+  }
+
+  int vlen = tpmesh_bac_find_closing(args + off, len - off, 3);
+  if (vlen > 0) {
+    store_entry(mesh_id, object_id, property, index, args + off,
+                (uint16_t)vlen);
+  }
+}
+
+static void learn_read_property_multi_ack(uint16_t mesh_id,
+                                          const uint8_t *args, uint16_t len) {
+  uint16_t off = 0;
+
+  while (off < len) {
+    uint32_t object_id;
+
+    if (take_context_unsigned(args, len, &off, 0, &object_id) != 1 ||
+        take_paired_tag(args, len, &off, 1, true) != 1) {
+      return;
+    }
+
+    while (take_paired_tag(args, len, &off, 1, false) == 0) {
+      uint32_t property;
+      uint32_t index = TPMESH_BAC_ARRAY_ALL;
+
+      if (take_context_unsigned(args, len, &off, 2, &property) != 1 ||
+          take_context_unsigned(args, len, &off, 3, &index) < 0) {
+        return;
+      }
+
+      /* [4] 属性值 或 [5] 错误 (不缓存) */
+      uint8_t result_tag = 4;
+      int r = take_paired_tag(args, len, &off, 4, true);
+      if (r == 0) {
+        result_tag = 5;
+        r = take_paired_tag(args, len, &off, 5, true);
+      }
+      if (r != 1) {
+        return;
+      }
+
+      int vlen = tpmesh_bac_find_closing(args + off, len - off, result_tag);
+      if (vlen < 0) {
+        return;
+      }
+      if (result_tag == 4 && vlen > 0) {
+        store_entry(mesh_id, object_id, property, index, args + off,
+                    (uint16_t)vlen);
+      }
+      off += vlen;
+      if (take_paired_tag(args, len, &off, result_tag, false) != 1) {
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * @brief COV 通知: [0] 进程号 [1] 发起设备 [2] 被监视对象 ...
+ */
+static void invalidate_cov(uint16_t mesh_id, const uint8_t *args,
+                           uint16_t len) {
+  uint16_t off = 0;
+  uint32_t pid, device_id, object_id;
+
+  if (take_context_unsigned(args, len, &off, 0, &pid) == 1 &&
+      take_context_unsigned(args, len, &off, 1, &device_id) == 1 &&
+      take_context_unsigned(args, len, &off, 2, &object_id) == 1) {
+    invalidate_object(mesh_id, object_id);
+  }
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_rp_cache_init(void) {
+  memset(s_entries, 0, sizeof(s_entries));
+  memset(s_ttl, 0, sizeof(s_ttl));
+  memset(&s_stats, 0, sizeof(s_stats));
+
+  if (s_cache_mutex == NULL) {
+    s_cache_mutex = xSemaphoreCreateMutex();
+    if (s_cache_mutex == NULL) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int tpmesh_rp_cache_set_ttl(uint16_t object_type, uint32_t ttl_ms) {
+  int ret = -1;
+
+  if (s_cache_mutex == NULL) {
+    return -1;
+  }
+
+  xSemaphoreTake(s_cache_mutex, portMAX_DELAY);
+
+  if (object_type == TPMESH_RP_CACHE_TYPE_DEFAULT) {
+    s_default_ttl = ttl_ms;
+    ret = 0;
+  } else {
+    rp_cache_ttl_t *slot = NULL;
+    for (int i = 0; i < TPMESH_RP_CACHE_TTL_SLOTS; i++) {
+      if (s_ttl[i].used && s_ttl[i].object_type == object_type) {
+        slot = &s_ttl[i];
+        break;
+      }
+      if (!s_ttl[i].used && slot == NULL) {
+        slot = &s_ttl[i];
+      }
+    }
+    if (slot) {
+      slot->used = true;
+      slot->object_type = object_type;
+      slot->ttl_ms = ttl_ms;
+      ret = 0;
+    }
+  }
+
+  xSemaphoreGive(s_cache_mutex);
+  return ret;
+}
+
+int tpmesh_rp_cache_on_request(uint16_t mesh_id, const tpmesh_bac_pkt_t *req,
+                               uint8_t *apdu, uint16_t apdu_max,
+                               uint16_t *apdu_len) {
+  if (s_cache_mutex == NULL || req->apdu_len < 4) {
+    return 0;
+  }
+
+  /* 仅处理本地网络的不分段确认请求 */
+  const uint8_t *a = req->apdu;
+  if ((a[0] & 0xF0) != TPMESH_BAC_PDU_CONFIRMED ||
+      (a[0] & TPMESH_BAC_PDU_SEG) ||
+      (req->npdu_ctrl & (TPMESH_BAC_NPDU_DNET | TPMESH_BAC_NPDU_SNET))) {
+    return 0;
+  }
+
+  uint8_t invoke_id = a[2];
+  uint8_t service = a[3];
+  const uint8_t *args = a + 4;
+  uint16_t args_len = req->apdu_len - 4;
+  uint16_t limit = tpmesh_bac_max_apdu_accepted(a[1]);
+  if (limit > apdu_max) {
+    limit = apdu_max;
+  }
+
+  uint16_t n = 0;
+  int hit = 0;
+
+  xSemaphoreTake(s_cache_mutex, portMAX_DELAY);
+
+  switch (service) {
+  case TPMESH_BAC_SERVICE_READ_PROP:
+    n = answer_read_property(mesh_id, args, args_len, apdu + 3, limit - 3);
+    break;
+
+  case TPMESH_BAC_SERVICE_READ_PROP_MULTI:
+    n = answer_read_property_multi(mesh_id, args, args_len, apdu + 3,
+                                   limit - 3);
+    break;
+
+  case TPMESH_BAC_SERVICE_WRITE_PROP: {
+    uint16_t off = 0;
+    uint32_t object_id;
+    if (take_context_unsigned(args, args_len, &off, 0, &object_id) == 1) {
+      invalidate_object(mesh_id, object_id);
+    }
+    xSemaphoreGive(s_cache_mutex);
+    return 0;
+  }
+
+  case TPMESH_BAC_SERVICE_WRITE_PROP_MULTI:
+    invalidate_write_multi(mesh_id, args, args_len);
+    xSemaphoreGive(s_cache_mutex);
+    return 0;
+
+  default:
+    xSemaphoreGive(s_cache_mutex);
+    return 0;
+  }
+
+  if (n > 0) {
+    apdu[0] = TPMESH_BAC_PDU_COMPLEX_ACK;
+    apdu[1] = invoke_id;
+    apdu[2] = service;
+    *apdu_len = n + 3;
+    s_stats.hits++;
+    hit = 1;
+  } else {
+    s_stats.misses++;
+  }
+
+  xSemaphoreGive(s_cache_mutex);
+  return hit;
+}
+
+void tpmesh_rp_cache_on_response(uint16_t mesh_id, const tpmesh_bac_pkt_t *pkt) {
+  if (s_cache_mutex == NULL || pkt->apdu_len < 2 ||
+      (pkt->npdu_ctrl & (TPMESH_BAC_NPDU_DNET | TPMESH_BAC_NPDU_SNET))) {
+    return;
+  }
+
+  const uint8_t *a = pkt->apdu;
+  uint8_t type = a[0] & 0xF0;
+
+  xSemaphoreTake(s_cache_mutex, portMAX_DELAY);
+
+  if (type == TPMESH_BAC_PDU_COMPLEX_ACK && !(a[0] & TPMESH_BAC_PDU_SEG) &&
+      pkt->apdu_len >= 3) {
+    if (a[2] == TPMESH_BAC_SERVICE_READ_PROP) {
+      learn_read_property_ack(mesh_id, a + 3, pkt->apdu_len - 3);
+    } else if (a[2] == TPMESH_BAC_SERVICE_READ_PROP_MULTI) {
+      learn_read_property_multi_ack(mesh_id, a + 3, pkt->apdu_len - 3);
+    }
+  } else if (type == TPMESH_BAC_PDU_CONFIRMED && pkt->apdu_len >= 4 &&
+             !(a[0] & TPMESH_BAC_PDU_SEG) &&
+             a[3] == TPMESH_BAC_SERVICE_CONF_COV_NOTIFY) {
+    invalidate_cov(mesh_id, a + 4, pkt->apdu_len - 4);
+  } else if (type == TPMESH_BAC_PDU_UNCONFIRMED &&
+             a[1] == TPMESH_BAC_SERVICE_UNCONF_COV_NOTIFY) {
+    invalidate_cov(mesh_id, a + 2, pkt->apdu_len - 2);
+  }
+
+  xSemaphoreGive(s_cache_mutex);
+}
+
+void tpmesh_rp_cache_invalidate_node(uint16_t mesh_id) {
+  if (s_cache_mutex == NULL) {
+    return;
+  }
+
+  xSemaphoreTake(s_cache_mutex, portMAX_DELAY);
+  for (int i = 0; i < TPMESH_RP_CACHE_ENTRIES; i++) {
+    if (s_entries[i].valid && s_entries[i].mesh_id == mesh_id) {
+      s_entries[i].valid = false;
+      s_stats.invalidations++;
+    }
+  }
+  xSemaphoreGive(s_cache_mutex);
+}
+
+void tpmesh_rp_cache_get_stats(tpmesh_rp_cache_stats_t *stats) {
+  if (s_cache_mutex == NULL) {
+    memset(stats, 0, sizeof(*stats));
+    return;
+  }
+
+  xSemaphoreTake(s_cache_mutex, portMAX_DELAY);
+  memcpy(stats, &s_stats, sizeof(*stats));
+  xSemaphoreGive(s_cache_mutex);
+}
+
+void tpmesh_rp_cache_dump(void) {
+  tpmesh_rp_cache_stats_t st;
+  tpmesh_rp_cache_get_stats(&st);
+
+  int used = 0;
+  for (int i = 0; i < TPMESH_RP_CACHE_ENTRIES; i++) {
+    if (s_entries[i].valid) {
+      used++;
+    }
+  }
+
+  uint32_t total = st.hits + st.misses;
+  tpmesh_debug_printf("RP Cache: %d/%d entries, hit %lu miss %lu (%lu%%)\n",
+                      used, TPMESH_RP_CACHE_ENTRIES, (unsigned long)st.hits,
+                      (unsigned long)st.misses,
+                      (unsigned long)(total ? st.hits * 100 / total : 0));
+  tpmesh_debug_printf("  stores %lu, invalidations %lu, default TTL %lu ms\n",
+                      (unsigned long)st.stores,
+                      (unsigned long)st.invalidations,
+                      (unsigned long)s_default_ttl);
+}
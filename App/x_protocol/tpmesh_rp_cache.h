@@ -0,0 +1,135 @@
+/**
+ * @file tpmesh_rp_cache.h
+ * @brief TPMesh ReadProperty / ReadPropertyMultiple 应答缓存 (Top Node)
+ *
+ * 多个 BMS 客户端轮询同一 DDC 的同一属性时, 由 Top Node 直接用缓存
+ * 的属性值应答, 避免每次请求都穿越 Mesh:
+ * - 缓存键: (DDC Mesh ID, 对象标识, 属性, 数组下标)
+ * - 缓存值: RP-ACK / RPM-ACK 中的属性值编码 (原样保存)
+ * - 应答使用请求方的 Invoke ID 重新编码
+ * - TTL 可按对象类型配置
+ * - 经过 Top Node 的 WriteProperty / WPM / COV 通知使对应对象失效
+ *
+ * @version 0.7.1
+ */
+
+#ifndef TPMESH_RP_CACHE_H
+#define TPMESH_RP_CACHE_H
+
+#include "tpmesh_bacnet.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 缓存条目数 */
+#ifndef TPMESH_RP_CACHE_ENTRIES
+#define TPMESH_RP_CACHE_ENTRIES 32
+#endif
+
+/** 单个属性值最大编码长度 (超过不缓存) */
+#ifndef TPMESH_RP_CACHE_VALUE_MAX
+#define TPMESH_RP_CACHE_VALUE_MAX 32
+#endif
+
+/** 默认 TTL (ms), 0=不缓存 */
+#ifndef TPMESH_RP_CACHE_TTL_MS
+#define TPMESH_RP_CACHE_TTL_MS 3000
+#endif
+
+/** 按对象类型配置 TTL 的槽位数 */
+#define TPMESH_RP_CACHE_TTL_SLOTS 8
+
+/** 设置默认 TTL 时使用的对象类型 */
+#define TPMESH_RP_CACHE_TYPE_DEFAULT 0xFFFF
+
+/* ============================================================================
+ * 数据结构定义
+ * ============================================================================
+ */
+
+/**
+ * @brief 缓存统计
+ */
+typedef struct {
+  uint32_t hits;          /**< 命中 (本地应答) */
+  uint32_t misses;        /**< 未命中 (转发到 Mesh) */
+  uint32_t stores;        /**< 从 ACK 写入的属性值 */
+  uint32_t invalidations; /**< 因 WP/WPM/COV 失效的条目 */
+} tpmesh_rp_cache_stats_t;
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化缓存
+ * @return 0=成功, -1=互斥锁创建失败
+ */
+int tpmesh_rp_cache_init(void);
+
+/**
+ * @brief 设置对象类型的 TTL
+ * @param object_type BACnet 对象类型, TPMESH_RP_CACHE_TYPE_DEFAULT=默认值
+ * @param ttl_ms TTL (ms), 0=该类型不缓存
+ * @return 0=成功, -1=槽位已满
+ */
+int tpmesh_rp_cache_set_ttl(uint16_t object_type, uint32_t ttl_ms);
+
+/**
+ * @brief 处理 BMS → DDC 的请求
+ *
+ * RP/RPM 全部命中时生成 ComplexACK APDU (使用请求的 Invoke ID);
+ * WP/WPM 请求使目标对象的缓存失效。
+ *
+ * @param mesh_id 目标 DDC Mesh ID
+ * @param req 请求解析结果
+ * @param apdu [out] 应答 APDU
+ * @param apdu_max 输出缓冲区大小
+ * @param apdu_len [out] 应答 APDU 长度
+ * @return 1=命中 (已生成应答), 0=需转发到 Mesh
+ */
+int tpmesh_rp_cache_on_request(uint16_t mesh_id, const tpmesh_bac_pkt_t *req,
+                               uint8_t *apdu, uint16_t apdu_max,
+                               uint16_t *apdu_len);
+
+/**
+ * @brief 处理 DDC → BMS 的报文
+ *
+ * RP-ACK / RPM-ACK 写入缓存, COV 通知使被监视对象失效。
+ *
+ * @param mesh_id 源 DDC Mesh ID
+ * @param pkt 报文解析结果
+ */
+void tpmesh_rp_cache_on_response(uint16_t mesh_id, const tpmesh_bac_pkt_t *pkt);
+
+/**
+ * @brief 使某个 DDC 的全部缓存失效 (节点重新注册/移除时)
+ * @param mesh_id DDC Mesh ID
+ */
+void tpmesh_rp_cache_invalidate_node(uint16_t mesh_id);
+
+/**
+ * @brief 获取统计
+ * @param stats [out] 统计
+ */
+void tpmesh_rp_cache_get_stats(tpmesh_rp_cache_stats_t *stats);
+
+/**
+ * @brief 打印缓存统计
+ */
+void tpmesh_rp_cache_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_RP_CACHE_H */
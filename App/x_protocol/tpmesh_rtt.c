@@ -0,0 +1,113 @@
+/**
+ * @file tpmesh_rtt.c
+ * @brief TPMesh 往返时延估计实现
+ *
+ * @version 0.7.1
+ */
+
+#include "tpmesh_rtt.h"
+#include "node_table.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_route.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+/** DDC: 到 Top Node 的估计 (桥接任务写, 心跳任务读) */
+static tpmesh_rtt_t s_top_rtt;
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+void tpmesh_rtt_update(tpmesh_rtt_t *rtt, uint32_t sample_ms) {
+  if (sample_ms > 0xFFFF) {
+    sample_ms = 0xFFFF;
+  }
+  if (sample_ms == 0) {
+    sample_ms = 1; /* srtt=0 保留为 "无样本" */
+  }
+
+  if (rtt->srtt == 0) {
+    rtt->srtt = (uint16_t)sample_ms;
+    rtt->rttvar = (uint16_t)(sample_ms / 2);
+    return;
+  }
+
+  int32_t err = (int32_t)sample_ms - rtt->srtt;
+  uint32_t abs_err = (err < 0) ? (uint32_t)-err : (uint32_t)err;
+
+  rtt->rttvar = (uint16_t)((3u * rtt->rttvar + abs_err) / 4);
+  rtt->srtt = (uint16_t)((7u * rtt->srtt + sample_ms) / 8);
+  if (rtt->srtt == 0) {
+    rtt->srtt = 1;
+  }
+}
+
+uint32_t tpmesh_rtt_rto(const tpmesh_rtt_t *rtt) {
+  if (rtt->srtt == 0) {
+    return 0;
+  }
+
+  uint32_t var = 4u * rtt->rttvar;
+  if (var < TPMESH_RTT_RTO_MIN_MS) {
+    var = TPMESH_RTT_RTO_MIN_MS;
+  }
+  return rtt->srtt + var;
+}
+
+void tpmesh_rtt_sample(uint16_t mesh_id, uint32_t sample_ms) {
+  if (sample_ms > TPMESH_RTT_SAMPLE_MAX_MS) {
+    return;
+  }
+
+  if (MESH_ADDR_IS_TOP(mesh_id)) {
+    taskENTER_CRITICAL();
+    tpmesh_rtt_update(&s_top_rtt, sample_ms);
+    taskEXIT_CRITICAL();
+  } else {
+    node_table_rtt_sample(mesh_id, sample_ms);
+  }
+}
+
+int tpmesh_rtt_get(uint16_t mesh_id, tpmesh_rtt_t *rtt) {
+  if (MESH_ADDR_IS_TOP(mesh_id)) {
+    taskENTER_CRITICAL();
+    *rtt = s_top_rtt;
+    taskEXIT_CRITICAL();
+  } else if (node_table_get_rtt(mesh_id, rtt) != 0) {
+    return -1;
+  }
+  return (rtt->srtt != 0) ? 0 : -1;
+}
+
+uint32_t tpmesh_rtt_timeout(uint16_t mesh_id, uint8_t mult, uint32_t dflt_ms,
+                            uint32_t min_ms, uint32_t max_ms) {
+  tpmesh_rtt_t rtt;
+
+  if (tpmesh_rtt_get(mesh_id, &rtt) != 0) {
+    /* 尚无样本: 已知跳数时按 RFC 6298 初值 (SRTT=R, RTTVAR=R/2) 估计 */
+    uint8_t hops = tpmesh_route_hops(mesh_id);
+    if (hops == 0) {
+      return dflt_ms;
+    }
+    uint32_t r = (uint32_t)hops * TPMESH_ROUTE_HOP_RTT_MS;
+    rtt.srtt = (uint16_t)(r < TPMESH_RTT_SAMPLE_MAX_MS ? r
+                                                        : TPMESH_RTT_SAMPLE_MAX_MS);
+    rtt.rttvar = rtt.srtt / 2;
+  }
+
+  uint32_t t = tpmesh_rtt_rto(&rtt) * mult;
+  if (t < min_ms) {
+    t = min_ms;
+  }
+  if (t > max_ms) {
+    t = max_ms;
+  }
+  return t;
+}
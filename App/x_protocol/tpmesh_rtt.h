@@ -0,0 +1,107 @@
+/**
+ * @file tpmesh_rtt.h
+ * @brief TPMesh 往返时延估计与自适应超时
+ *
+ * 一跳与六跳 DDC 的往返时延相差数倍, 固定超时对近节点太长、对远节点
+ * 太短。这里按目的节点维护 TCP 风格的平滑估计 (RFC 6298):
+ *   SRTT   = 7/8 SRTT + 1/8 R
+ *   RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|
+ *   RTO    = SRTT + 4 RTTVAR
+ *
+ * 样本来源:
+ * - 注册/心跳帧及其 ACK 携带 REG_TLV_TIMESTAMP, 回显时扣除本端持有时间
+ * - Top Node 转发的 BACnet 确认请求到应答的时间 (tpmesh_inflight)
+ *
+ * Top Node 的估计保存在节点表条目中, DDC 只维护到 Top Node 的一份。
+ * 尚无样本时按路由跳数估计 (tpmesh_route), 跳数未知才回退为原固定常量。
+ *
+ * @version 0.7.1
+ */
+
+#ifndef TPMESH_RTT_H
+#define TPMESH_RTT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 超过该值的样本视为无效 (时钟回绕或回显错误) */
+#ifndef TPMESH_RTT_SAMPLE_MAX_MS
+#define TPMESH_RTT_SAMPLE_MAX_MS 30000
+#endif
+
+/** RTO 下限 (ms), 即 RFC 6298 的时钟粒度项 G */
+#ifndef TPMESH_RTT_RTO_MIN_MS
+#define TPMESH_RTT_RTO_MIN_MS 200
+#endif
+
+/* ============================================================================
+ * 数据结构定义
+ * ============================================================================
+ */
+
+/**
+ * @brief RTT 估计 (srtt=0 表示尚无样本)
+ */
+typedef struct {
+  uint16_t srtt;   /**< 平滑 RTT (ms) */
+  uint16_t rttvar; /**< RTT 平均偏差 (ms) */
+} tpmesh_rtt_t;
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 用一个样本更新估计
+ * @param rtt 估计
+ * @param sample_ms 样本 (ms)
+ */
+void tpmesh_rtt_update(tpmesh_rtt_t *rtt, uint32_t sample_ms);
+
+/**
+ * @brief 计算 RTO
+ * @return RTO (ms), 尚无样本返回 0
+ */
+uint32_t tpmesh_rtt_rto(const tpmesh_rtt_t *rtt);
+
+/**
+ * @brief 记录到某节点的 RTT 样本
+ * @param mesh_id 对端 Mesh ID (Top Node 地址=DDC 到所属 Top Node)
+ * @param sample_ms 样本 (ms), 超过 TPMESH_RTT_SAMPLE_MAX_MS 时丢弃
+ */
+void tpmesh_rtt_sample(uint16_t mesh_id, uint32_t sample_ms);
+
+/**
+ * @brief 获取到某节点的 RTT 估计
+ * @param mesh_id 对端 Mesh ID
+ * @param rtt [out] 估计
+ * @return 0=有样本, -1=无
+ */
+int tpmesh_rtt_get(uint16_t mesh_id, tpmesh_rtt_t *rtt);
+
+/**
+ * @brief 按 RTO 推导超时
+ * @param mesh_id 对端 Mesh ID
+ * @param mult RTO 倍数
+ * @param dflt_ms 尚无样本且跳数未知时的超时
+ * @param min_ms 下限
+ * @param max_ms 上限
+ * @return 超时 (ms)
+ */
+uint32_t tpmesh_rtt_timeout(uint16_t mesh_id, uint8_t mult, uint32_t dflt_ms,
+                            uint32_t min_ms, uint32_t max_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_RTT_H */
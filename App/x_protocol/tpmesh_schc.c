@@ -11,6 +11,7 @@
 #include "lwip/ip.h"
 #include "lwip/udp.h"
 #include "lwip/inet_chksum.h"
+#include "lwip/pbuf.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -194,6 +195,53 @@ int schc_compress(const uint8_t *eth_frame, uint16_t eth_len,
     return 0;
 }
 
+int schc_compress_pbuf(const struct pbuf *p, uint8_t *out_data,
+                       uint16_t *out_len, bool is_broadcast)
+{
+    uint8_t hdr[ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN];
+    uint16_t eth_len = p->tot_len;
+
+    if (eth_len < ETH_HDR_LEN) {
+        return -1;
+    }
+
+    /* 规则判断只读取前 42 字节, 其余长度检查按 tot_len */
+    pbuf_copy_partial(p, hdr, sizeof(hdr), 0);
+    uint8_t rule_id = schc_get_rule(hdr, eth_len);
+
+    out_data[0] = is_broadcast ? 0x80 : 0x00;  /* L2 HDR */
+    out_data[1] = 0x80;  /* FRAG HDR: 单片,seq=0 */
+    out_data[2] = rule_id;
+
+    uint8_t *payload = out_data + TPMESH_TUNNEL_HDR_LEN;
+    uint16_t skip;
+
+    memcpy(payload, hdr + 6, 6);  /* SRC_MAC */
+    payload += 6;
+
+    switch (rule_id) {
+        case SCHC_RULE_BACNET_IP:
+            skip = ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN;
+            break;
+        case SCHC_RULE_IP_ONLY:
+            skip = ETH_HDR_LEN + IP_HDR_LEN;
+            break;
+        case SCHC_RULE_NO_COMPRESS:
+        default:
+            /* [DST_MAC:6][EtherType:2][Data:N] */
+            memcpy(payload, hdr, 6);
+            payload += 6;
+            skip = 12;
+            break;
+    }
+
+    uint16_t rest = (eth_len > skip) ? eth_len - skip : 0;
+    pbuf_copy_partial(p, payload, rest, skip);
+
+    *out_len = (uint16_t)(payload - out_data) + rest;
+    return 0;
+}
+
 int schc_decompress(const uint8_t *mesh_data, uint16_t mesh_len,
                     uint8_t *out_frame, uint16_t *out_len,
                     uint16_t src_mesh_id, uint16_t dst_mesh_id)
@@ -207,9 +255,11 @@ int schc_decompress(const uint8_t *mesh_data, uint16_t mesh_len,
     uint8_t frag_hdr = mesh_data[1];
     uint8_t rule_id = mesh_data[2];
     
-    (void)l2_hdr;
     (void)frag_hdr;
 
+    /* L2 广播位: 原始帧为以太网广播 (如 Who-Is / I-Am) */
+    bool is_broadcast = (l2_hdr & 0x80) != 0;
+
     const uint8_t *payload = mesh_data + TPMESH_TUNNEL_HDR_LEN;
     uint16_t payload_len = mesh_len - TPMESH_TUNNEL_HDR_LEN;
 
@@ -230,7 +280,7 @@ int schc_decompress(const uint8_t *mesh_data, uint16_t mesh_len,
             /* 恢复完整以太网帧 */
             /* 目标 MAC: 从节点表获取或广播 */
             uint8_t dst_mac[6];
-            if (dst_mesh_id == MESH_ADDR_BROADCAST) {
+            if (is_broadcast || dst_mesh_id == MESH_ADDR_BROADCAST) {
                 memcpy(dst_mac, BROADCAST_MAC, 6);
             } else {
                 if (node_table_get_mac_by_mesh(dst_mesh_id, dst_mac) != 0) {
@@ -261,7 +311,9 @@ int schc_decompress(const uint8_t *mesh_data, uint16_t mesh_len,
             if (node_table_get_ip_by_mesh(src_mesh_id, &src_ip) != 0) {
                 IP4_ADDR(&src_ip, 192, 168, 10, 100);  /* 默认 */
             }
-            if (node_table_get_ip_by_mesh(dst_mesh_id, &dst_ip) != 0) {
+            if (is_broadcast) {
+                ip4_addr_set_u32(&dst_ip, IPADDR_BROADCAST);  /* 受限广播 */
+            } else if (node_table_get_ip_by_mesh(dst_mesh_id, &dst_ip) != 0) {
                 IP4_ADDR(&dst_ip, 192, 168, 10, 1);  /* 默认 Top Node */
             }
             write_be32(eth + 12, ip4_addr_get_u32(&src_ip));
@@ -291,7 +343,7 @@ int schc_decompress(const uint8_t *mesh_data, uint16_t mesh_len,
         case SCHC_RULE_IP_ONLY: {
             /* 恢复 IP 头 */
             uint8_t dst_mac[6];
-            if (dst_mesh_id == MESH_ADDR_BROADCAST) {
+            if (is_broadcast || dst_mesh_id == MESH_ADDR_BROADCAST) {
                 memcpy(dst_mac, BROADCAST_MAC, 6);
             } else {
                 if (node_table_get_mac_by_mesh(dst_mesh_id, dst_mac) != 0) {
@@ -320,7 +372,9 @@ int schc_decompress(const uint8_t *mesh_data, uint16_t mesh_len,
             if (node_table_get_ip_by_mesh(src_mesh_id, &src_ip) != 0) {
                 IP4_ADDR(&src_ip, 192, 168, 10, 100);
             }
-            if (node_table_get_ip_by_mesh(dst_mesh_id, &dst_ip) != 0) {
+            if (is_broadcast) {
+                ip4_addr_set_u32(&dst_ip, IPADDR_BROADCAST);
+            } else if (node_table_get_ip_by_mesh(dst_mesh_id, &dst_ip) != 0) {
                 IP4_ADDR(&dst_ip, 192, 168, 10, 1);
             }
             write_be32(eth + 12, ip4_addr_get_u32(&src_ip));
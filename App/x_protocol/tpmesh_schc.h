@@ -47,6 +47,14 @@ extern "C" {
 #define ETHERTYPE_IP 0x0800
 #define ETHERTYPE_ARP 0x0806
 
+/**
+ * 解压后以太网帧相对隧道帧的最大增长 (BACnet/IP 规则恢复 ETH+IP+UDP 头,
+ * 减去隧道头与 SRC_MAC 后不超过该值), 用于按隧道帧长度预分配输出缓冲
+ */
+#define SCHC_DECOMPRESS_GROWTH (ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN)
+
+struct pbuf;
+
 /* ============================================================================
  * 压缩上下文结构
  * ============================================================================
@@ -100,6 +108,21 @@ typedef struct {
 int schc_compress(const uint8_t *eth_frame, uint16_t eth_len, uint8_t *out_data,
                   uint16_t *out_len, bool is_broadcast);
 
+/**
+ * @brief 压缩 pbuf 链中的以太网帧为 Mesh 隧道帧
+ *
+ * 与 schc_compress() 输出相同, 但直接从 pbuf 链读取 (不要求连续),
+ * 头部只窥视前 42 字节, 载荷从链中一次复制到输出缓冲区。
+ *
+ * @param p 以太网帧 (可为 pbuf 链)
+ * @param out_data 输出缓冲区 (至少 p->tot_len + TPMESH_TUNNEL_HDR_LEN)
+ * @param out_len [out] 输出长度
+ * @param is_broadcast 是否广播
+ * @return 0=成功
+ */
+int schc_compress_pbuf(const struct pbuf *p, uint8_t *out_data,
+                       uint16_t *out_len, bool is_broadcast);
+
 /**
  * @brief 解压 Mesh 隧道帧为以太网帧
  *
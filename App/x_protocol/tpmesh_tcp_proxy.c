@@ -0,0 +1,1057 @@
+/**
+ * @file tpmesh_tcp_proxy.c
+ * @brief TPMesh TCP 分段代理实现
+ *
+ * @version 0.8.0
+ */
+
+#include "tpmesh_tcp_proxy.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_rtt.h"
+
+/* node_table.h 已通过 tpmesh_bridge.h 包含 */
+#include "FreeRTOS.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "task.h"
+#include <string.h>
+
+#if TPMESH_TCP_PROXY_ENABLE && !LWIP_NETIF_LOOPBACK
+#error "TPMESH_TCP_PROXY_ENABLE requires LWIP_NETIF_LOOPBACK (DDC 经环回连接本机服务)"
+#endif
+
+/* ============================================================================
+ * 类型定义
+ * ============================================================================
+ */
+
+/** 连接状态 */
+typedef enum {
+  CONN_FREE = 0,
+  CONN_SYN,     /**< Top: 已改写 SYN, 等待本机 accept */
+  CONN_OPENING, /**< Top: 等待 OPEN_ACK; DDC: 正在连接本机服务 */
+  CONN_OPEN,    /**< 双向转发 */
+  CONN_LINGER,  /**< Top: 已关闭, 保留地址改写直到本机完成挥手 */
+} conn_state_t;
+
+/** 代理连接 */
+typedef struct {
+  conn_state_t state;
+  bool top;            /**< 本端为 Top Node */
+  uint8_t id;          /**< 连接号 (Top Node 分配) */
+  uint8_t svc;         /**< 代理端口序号 */
+  uint16_t peer;       /**< 对端 Mesh ID */
+  uint16_t port;       /**< DDC 服务端口 */
+  struct tcp_pcb *pcb; /**< 本地 TCP */
+  uint32_t state_tick; /**< 进入 SYN/LINGER 的时间 */
+
+  /* 地址改写 (Top) */
+  ip4_addr_t client_ip;
+  uint16_t client_port;
+  ip4_addr_t ddc_ip;
+  uint8_t ddc_mac[6];
+
+  /* 发送: txq 为本地 TCP 收到、对端尚未确认的数据 */
+  struct pbuf *txq;
+  uint16_t snd_una; /**< 最早未确认段 */
+  uint16_t snd_nxt; /**< 下一个发送段 (超时回退到 snd_una) */
+  uint16_t snd_max; /**< 已分配的段序号上界 */
+  uint8_t lens[TPMESH_STREAM_WND]; /**< 在途段长度 (重传保持不变) */
+  uint8_t peer_wnd;
+  bool fin_pending; /**< 本地 TCP 已结束发送 */
+  bool fin_sent;
+  uint16_t fin_seq;
+  uint8_t retries;
+  uint8_t backoff;
+  bool rto_armed;
+  uint32_t rto_deadline;
+  bool rtt_timing;
+  uint16_t rtt_seq;
+  uint32_t rtt_tick;
+  uint8_t open_tries;
+  uint32_t open_deadline;
+  bool open_ack; /**< DDC: 待发送 OPEN_ACK */
+
+  /* 接收 */
+  uint16_t rcv_nxt;
+  bool fin_rcvd;
+  uint8_t ack_owed; /**< 尚未确认的段数 */
+  bool ack_now;
+  uint32_t ack_deadline;
+  uint8_t wnd_sent; /**< 最近通告的窗口 */
+  uint32_t last_rx;
+
+  bool reset; /**< 待向对端发送 RST 并释放 (在定时处理中执行) */
+} proxy_conn_t;
+
+/** 统计 */
+typedef struct {
+  uint32_t opened;
+  uint32_t resets;
+  uint32_t retrans;
+  uint32_t tx_segs;
+  uint32_t rx_segs;
+} proxy_stats_t;
+
+/** 代理端口数 */
+#define PROXY_SVC_COUNT (sizeof(s_ports) / sizeof(s_ports[0]))
+
+/** SYN 未被 accept / 关闭后保留改写的时间 (ms) */
+#define PROXY_SYN_TIMEOUT_MS 10000
+#define PROXY_LINGER_MS 10000
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static const uint16_t s_ports[] = TPMESH_TCP_PROXY_PORTS;
+
+/** 连接表: 改写字段由以太网输入线程与 tcpip 线程共享 (临界区保护),
+ *  其余字段只在 tcpip 线程访问 */
+static proxy_conn_t s_conns[TPMESH_TCP_PROXY_CONNS];
+
+static struct netif *s_eth_netif = NULL;
+static netif_linkoutput_fn s_eth_linkoutput = NULL;
+static ip4_addr_t s_local_ip;
+
+static uint8_t s_next_id = 0;
+static bool s_tick_active = false;
+static volatile bool s_ready = false;
+static bool s_initialized = false;
+
+static proxy_stats_t s_stats;
+
+/** 发送缓冲 (tcpip 线程) */
+static uint8_t s_frame[TPMESH_MTU];
+
+/* ============================================================================
+ * 私有函数 - 工具
+ * ============================================================================
+ */
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static int svc_by_port(uint16_t port) {
+  for (unsigned i = 0; i < PROXY_SVC_COUNT; i++) {
+    if (s_ports[i] == port) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief 增量更新校验和 (RFC 1624: HC' = ~(~HC + ~m + m'))
+ */
+static uint16_t csum_update16(uint16_t sum, uint16_t old, uint16_t val) {
+  uint32_t s = (uint16_t)~sum + (uint32_t)(uint16_t)~old + val;
+  s = (s & 0xFFFF) + (s >> 16);
+  s = (s & 0xFFFF) + (s >> 16);
+  return (uint16_t)~s;
+}
+
+/**
+ * @brief 改写 16 位字段并更新 IP / TCP 校验和 (csum 可为 NULL)
+ *
+ * 校验和由硬件生成时发送方向的值会被覆盖, 增量更新无害。
+ */
+static void rewrite_u16(uint8_t *field, uint16_t val, uint8_t *ip_csum,
+                        uint8_t *tcp_csum) {
+  uint16_t old = get_u16(field);
+  put_u16(field, val);
+  if (ip_csum) {
+    put_u16(ip_csum, csum_update16(get_u16(ip_csum), old, val));
+  }
+  put_u16(tcp_csum, csum_update16(get_u16(tcp_csum), old, val));
+}
+
+static void rewrite_ip(uint8_t *field, const ip4_addr_t *ip, uint8_t *ip_csum,
+                       uint8_t *tcp_csum) {
+  const uint8_t *b = (const uint8_t *)&ip->addr;
+  rewrite_u16(field, get_u16(b), ip_csum, tcp_csum);
+  rewrite_u16(field + 2, get_u16(b + 2), ip_csum, tcp_csum);
+}
+
+/**
+ * @brief 定位以太网帧中的 IPv4/TCP 头 (须在第一个 pbuf 内, 非分片)
+ * @return 帧起点, NULL=不是可改写的 TCP 帧
+ */
+static uint8_t *tcp_frame(struct pbuf *p, uint8_t **iph, uint8_t **tcph) {
+  uint8_t *f = (uint8_t *)p->payload;
+
+  if (p->len < SIZEOF_ETH_HDR + 20 + 20 ||
+      get_u16(f + 12) != ETHTYPE_IP) {
+    return NULL;
+  }
+  uint8_t *ip = f + SIZEOF_ETH_HDR;
+  uint16_t ihl = (uint16_t)((ip[0] & 0x0F) * 4);
+  if ((ip[0] >> 4) != 4 || ihl < 20 || ip[9] != IP_PROTO_TCP ||
+      (get_u16(ip + 6) & 0x3FFF) != 0 ||
+      p->len < SIZEOF_ETH_HDR + ihl + 20) {
+    return NULL;
+  }
+  *iph = ip;
+  *tcph = ip + ihl;
+  return f;
+}
+
+static uint32_t conn_rto(const proxy_conn_t *c) {
+  uint32_t rto = tpmesh_rtt_timeout(c->peer, 2, TPMESH_STREAM_RTO_MS,
+                                    TPMESH_STREAM_RTO_MIN_MS,
+                                    TPMESH_STREAM_RTO_MAX_MS)
+                 << c->backoff;
+  return rto > TPMESH_STREAM_RTO_MAX_MS ? TPMESH_STREAM_RTO_MAX_MS : rto;
+}
+
+/**
+ * @brief 本端还能接受的段数 (受本地 TCP 发送缓冲限制)
+ */
+static uint8_t conn_rcv_wnd(const proxy_conn_t *c) {
+  if (c->pcb == NULL || c->fin_rcvd ||
+      tcp_sndqueuelen(c->pcb) >= TCP_SND_QUEUELEN - 1) {
+    return 0;
+  }
+  uint32_t n = tcp_sndbuf(c->pcb) / TPMESH_STREAM_SEG_MAX;
+  return (uint8_t)(n > TPMESH_STREAM_WND ? TPMESH_STREAM_WND : n);
+}
+
+/* ============================================================================
+ * 私有函数 - 地址改写表 (调用方持有临界区)
+ * ============================================================================
+ */
+
+static proxy_conn_t *nat_find(const ip4_addr_t *client_ip, uint16_t client_port,
+                              uint8_t svc) {
+  for (int i = 0; i < TPMESH_TCP_PROXY_CONNS; i++) {
+    proxy_conn_t *c = &s_conns[i];
+    if (c->top && c->state != CONN_FREE && c->svc == svc &&
+        c->client_port == client_port && ip4_addr_cmp(&c->client_ip, client_ip)) {
+      return c;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief 分配连接: 空闲、SYN 超时或改写保留期满的条目
+ */
+static proxy_conn_t *conn_alloc(uint32_t now) {
+  for (int i = 0; i < TPMESH_TCP_PROXY_CONNS; i++) {
+    proxy_conn_t *c = &s_conns[i];
+    if (c->state == CONN_FREE ||
+        (c->state == CONN_SYN && now - c->state_tick > PROXY_SYN_TIMEOUT_MS) ||
+        (c->state == CONN_LINGER && now - c->state_tick > PROXY_LINGER_MS)) {
+      memset(c, 0, sizeof(*c));
+      if (++s_next_id == 0) {
+        s_next_id = 1;
+      }
+      c->id = s_next_id;
+      c->peer_wnd = TPMESH_STREAM_WND;
+      c->last_rx = now;
+      return c;
+    }
+  }
+  return NULL;
+}
+
+/* ============================================================================
+ * 私有函数 - Mesh 流帧发送 (tcpip 线程)
+ * ============================================================================
+ */
+
+static void stream_send(uint16_t peer, uint8_t type, uint8_t id, uint16_t seq,
+                        uint16_t ack, uint8_t wnd, const proxy_conn_t *c,
+                        uint16_t off, uint8_t len) {
+  uint8_t *h = s_frame + TPMESH_TUNNEL_HDR_LEN;
+
+  s_frame[0] = 0x00; /* L2 HDR: 单播 */
+  s_frame[1] = 0x80; /* FRAG HDR: 单片 */
+  s_frame[2] = SCHC_RULE_STREAM;
+  h[0] = type;
+  h[1] = id;
+  put_u16(h + 2, seq);
+  put_u16(h + 4, ack);
+  h[6] = wnd;
+  if (len > 0) {
+    pbuf_copy_partial(c->txq, h + TPMESH_STREAM_HDR_LEN, len, off);
+  }
+  tpmesh_bridge_send_frame(peer, s_frame,
+                           TPMESH_TUNNEL_HDR_LEN + TPMESH_STREAM_HDR_LEN + len);
+}
+
+/**
+ * @brief 发送控制帧 (携带当前确认与窗口)
+ */
+static void conn_send_ctrl(proxy_conn_t *c, uint8_t type) {
+  uint8_t wnd = conn_rcv_wnd(c);
+
+  if (type == STREAM_OPEN) {
+    /* OPEN 数据: 服务端口, 借用发送缓冲 */
+    uint8_t *h = s_frame + TPMESH_TUNNEL_HDR_LEN;
+    s_frame[0] = 0x00;
+    s_frame[1] = 0x80;
+    s_frame[2] = SCHC_RULE_STREAM;
+    h[0] = STREAM_OPEN;
+    h[1] = c->id;
+    put_u16(h + 2, 0);
+    put_u16(h + 4, 0);
+    h[6] = wnd;
+    put_u16(h + TPMESH_STREAM_HDR_LEN, c->port);
+    tpmesh_bridge_send_frame(c->peer, s_frame,
+                             TPMESH_TUNNEL_HDR_LEN + TPMESH_STREAM_HDR_LEN + 2);
+    return;
+  }
+
+  stream_send(c->peer, type, c->id, c->snd_nxt, c->rcv_nxt, wnd, c, 0, 0);
+  c->ack_owed = 0;
+  c->ack_now = false;
+  c->wnd_sent = wnd;
+}
+
+/* ============================================================================
+ * 私有函数 - 连接
+ * ============================================================================
+ */
+
+static err_t proxy_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                        err_t err);
+static err_t proxy_sent(void *arg, struct tcp_pcb *pcb, u16_t len);
+static void proxy_err(void *arg, err_t err);
+static void conn_service(proxy_conn_t *c, bool may_free);
+
+static void conn_attach(proxy_conn_t *c, struct tcp_pcb *pcb) {
+  c->pcb = pcb;
+  tcp_arg(pcb, c);
+  tcp_recv(pcb, proxy_recv);
+  tcp_sent(pcb, proxy_sent);
+  tcp_err(pcb, proxy_err);
+  tcp_nagle_disable(pcb);
+}
+
+/**
+ * @brief 释放连接 (Top Node 保留地址改写一段时间)
+ * @param abort true=复位本地 TCP, false=正常关闭
+ */
+static void conn_free(proxy_conn_t *c, bool abort) {
+  if (c->pcb != NULL) {
+    struct tcp_pcb *pcb = c->pcb;
+    c->pcb = NULL;
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_err(pcb, NULL);
+    if (abort || tcp_close(pcb) != ERR_OK) {
+      tcp_abort(pcb);
+    }
+  }
+  if (c->txq != NULL) {
+    pbuf_free(c->txq);
+    c->txq = NULL;
+  }
+
+  taskENTER_CRITICAL();
+  if (c->top) {
+    c->state = CONN_LINGER;
+    c->state_tick = tpmesh_get_tick_ms();
+  } else {
+    c->state = CONN_FREE;
+  }
+  taskEXIT_CRITICAL();
+}
+
+static void proxy_tick(void *arg);
+
+static void proxy_tick_start(void) {
+  if (!s_tick_active) {
+    s_tick_active = true;
+    sys_timeout(TPMESH_STREAM_TICK_MS, proxy_tick, NULL);
+  }
+}
+
+/**
+ * @brief 处理确认: 释放已确认数据并打开本地 TCP 接收窗口
+ */
+static void conn_on_ack(proxy_conn_t *c, uint16_t ack, uint8_t wnd) {
+  c->peer_wnd = wnd;
+  c->retries = 0;
+
+  uint16_t acked = (uint16_t)(ack - c->snd_una);
+  if (acked == 0 || acked > (uint16_t)(c->snd_max - c->snd_una)) {
+    return;
+  }
+
+  uint32_t now = tpmesh_get_tick_ms();
+  uint16_t bytes = 0;
+  for (uint16_t i = 0; i < acked; i++) {
+    bytes += c->lens[(uint16_t)(c->snd_una + i) % TPMESH_STREAM_WND];
+  }
+
+  /* Karn: 只对未重传过的计时段采样 */
+  if (c->rtt_timing && (uint16_t)(c->rtt_seq - c->snd_una) < acked) {
+    tpmesh_rtt_sample(c->peer, now - c->rtt_tick);
+    c->rtt_timing = false;
+  }
+
+  c->snd_una = ack;
+  if ((int16_t)(c->snd_nxt - ack) < 0) {
+    c->snd_nxt = ack;
+  }
+  c->backoff = 0;
+  if (bytes > 0) {
+    c->txq = pbuf_free_header(c->txq, bytes);
+    if (c->pcb != NULL) {
+      tcp_recved(c->pcb, bytes);
+    }
+  }
+
+  if (c->snd_una == c->snd_max) {
+    c->rto_armed = false;
+  } else {
+    c->rto_armed = true;
+    c->rto_deadline = now + conn_rto(c);
+  }
+}
+
+static void conn_on_data(proxy_conn_t *c, uint16_t seq, const uint8_t *data,
+                         uint16_t len, bool fin) {
+  if (seq != c->rcv_nxt || c->fin_rcvd || c->pcb == NULL) {
+    /* 重复或乱序: 立即确认, 对端按确认重传 */
+    c->ack_owed = 1;
+    c->ack_now = true;
+    return;
+  }
+
+  if (fin) {
+    c->fin_rcvd = true;
+    tcp_shutdown(c->pcb, 0, 1);
+    c->ack_now = true;
+  } else if (len > 0) {
+    if (len > tcp_sndbuf(c->pcb) ||
+        tcp_write(c->pcb, data, len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+      c->ack_owed = 1;
+      c->ack_now = true;
+      return;
+    }
+    tcp_output(c->pcb);
+  }
+
+  c->rcv_nxt++;
+  if (c->ack_owed++ == 0) {
+    c->ack_deadline = tpmesh_get_tick_ms() + TPMESH_STREAM_ACK_DELAY_MS;
+  }
+  if (c->ack_owed >= 2) {
+    c->ack_now = true;
+  }
+}
+
+/**
+ * @brief 发送窗口内的段、到期的确认, 处理超时与关闭
+ * @param may_free false=在 lwIP 回调中, 复位/关闭推迟到定时处理
+ */
+static void conn_service(proxy_conn_t *c, bool may_free) {
+  uint32_t now = tpmesh_get_tick_ms();
+
+  if (c->state != CONN_OPENING && c->state != CONN_OPEN) {
+    return;
+  }
+
+  if (now - c->last_rx > TPMESH_STREAM_IDLE_MS) {
+    c->reset = true;
+  }
+  if (c->reset) {
+    if (may_free) {
+      stream_send(c->peer, STREAM_RST, c->id, 0, 0, 0, c, 0, 0);
+      s_stats.resets++;
+      conn_free(c, true);
+    }
+    return;
+  }
+
+  if (c->state == CONN_OPENING) {
+    /* Top: 重发 OPEN 直到 OPEN_ACK; DDC: 等待本机连接完成 */
+    if (c->top && (int32_t)(now - c->open_deadline) >= 0) {
+      if (c->open_tries >= TPMESH_STREAM_MAX_RETRIES) {
+        c->reset = true;
+        return;
+      }
+      conn_send_ctrl(c, STREAM_OPEN);
+      c->open_tries++;
+      c->open_deadline = now + (conn_rto(c) << (c->open_tries > 3 ? 3
+                                                                 : c->open_tries));
+    }
+    return;
+  }
+
+  if (c->open_ack) {
+    c->open_ack = false;
+    conn_send_ctrl(c, STREAM_OPEN_ACK);
+  }
+
+  /* 超时: 回退重传全部在途段, 丢包多为链路原因, 不缩小窗口 */
+  if (c->rto_armed && (int32_t)(now - c->rto_deadline) >= 0) {
+    if (++c->retries > TPMESH_STREAM_MAX_RETRIES) {
+      c->reset = true;
+      return;
+    }
+    c->snd_nxt = c->snd_una;
+    c->rtt_timing = false;
+    if (c->backoff < 3) {
+      c->backoff++;
+    }
+    c->rto_armed = false;
+    s_stats.retrans++;
+  }
+
+  /* 对端窗口为 0 时仍允许一段作为探测 */
+  uint16_t lim = c->peer_wnd ? c->peer_wnd : 1;
+  if (lim > TPMESH_STREAM_WND) {
+    lim = TPMESH_STREAM_WND;
+  }
+  uint16_t queued = c->txq ? c->txq->tot_len : 0;
+
+  while ((uint16_t)(c->snd_nxt - c->snd_una) < lim) {
+    uint16_t off = 0;
+    for (uint16_t s = c->snd_una; s != c->snd_nxt; s++) {
+      off += c->lens[s % TPMESH_STREAM_WND];
+    }
+
+    uint8_t len;
+    bool fin;
+    if (c->snd_nxt != c->snd_max) {
+      /* 重传: 段边界不变 */
+      len = c->lens[c->snd_nxt % TPMESH_STREAM_WND];
+      fin = c->fin_sent && c->snd_nxt == c->fin_seq;
+    } else if (queued > off) {
+      len = (uint8_t)((queued - off) > TPMESH_STREAM_SEG_MAX
+                          ? TPMESH_STREAM_SEG_MAX
+                          : (queued - off));
+      fin = false;
+    } else if (c->fin_pending && !c->fin_sent) {
+      len = 0;
+      fin = true;
+      c->fin_sent = true;
+      c->fin_seq = c->snd_nxt;
+    } else {
+      break;
+    }
+
+    if (c->snd_nxt == c->snd_max) {
+      c->lens[c->snd_nxt % TPMESH_STREAM_WND] = len;
+      c->snd_max++;
+      if (!c->rtt_timing) {
+        c->rtt_timing = true;
+        c->rtt_seq = c->snd_nxt;
+        c->rtt_tick = now;
+      }
+    }
+
+    uint8_t wnd = conn_rcv_wnd(c);
+    stream_send(c->peer, fin ? STREAM_FIN : STREAM_DATA, c->id, c->snd_nxt,
+                c->rcv_nxt, wnd, c, off, len);
+    c->ack_owed = 0;
+    c->ack_now = false;
+    c->wnd_sent = wnd;
+    c->snd_nxt++;
+    s_stats.tx_segs++;
+    if (!c->rto_armed) {
+      c->rto_armed = true;
+      c->rto_deadline = now + conn_rto(c);
+    }
+  }
+
+  if (c->ack_owed > 0 &&
+      (c->ack_now || (int32_t)(now - c->ack_deadline) >= 0)) {
+    conn_send_ctrl(c, STREAM_ACK);
+  }
+
+  /* 双向结束且本端数据全部确认 */
+  if (may_free && c->fin_rcvd && c->fin_sent && c->snd_una == c->snd_max) {
+    conn_free(c, false);
+  }
+}
+
+static void proxy_tick(void *arg) {
+  (void)arg;
+  bool active = false;
+
+  for (int i = 0; i < TPMESH_TCP_PROXY_CONNS; i++) {
+    proxy_conn_t *c = &s_conns[i];
+    conn_service(c, true);
+    if (c->state == CONN_OPENING || c->state == CONN_OPEN) {
+      active = true;
+    }
+  }
+
+  if (active) {
+    sys_timeout(TPMESH_STREAM_TICK_MS, proxy_tick, NULL);
+  } else {
+    s_tick_active = false;
+  }
+}
+
+/* ============================================================================
+ * 私有函数 - lwIP 回调 (tcpip 线程)
+ * ============================================================================
+ */
+
+static err_t proxy_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                        err_t err) {
+  proxy_conn_t *c = (proxy_conn_t *)arg;
+  (void)pcb;
+  (void)err;
+
+  if (c == NULL) {
+    if (p != NULL) {
+      pbuf_free(p);
+    }
+    return ERR_OK;
+  }
+
+  if (p == NULL) {
+    c->fin_pending = true;
+  } else if (c->fin_pending) {
+    pbuf_free(p);
+  } else if (c->txq == NULL) {
+    c->txq = p;
+  } else {
+    pbuf_cat(c->txq, p);
+  }
+
+  /* 对端确认后才 tcp_recved(), 本地窗口随 Mesh 进度开合 */
+  conn_service(c, false);
+  return ERR_OK;
+}
+
+static err_t proxy_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
+  proxy_conn_t *c = (proxy_conn_t *)arg;
+  (void)pcb;
+  (void)len;
+
+  /* 本地发送缓冲腾出空间: 通告更大的窗口 */
+  if (c != NULL && c->state == CONN_OPEN && conn_rcv_wnd(c) > c->wnd_sent) {
+    c->ack_owed = 1;
+    c->ack_now = true;
+    conn_service(c, false);
+  }
+  return ERR_OK;
+}
+
+static void proxy_err(void *arg, err_t err) {
+  proxy_conn_t *c = (proxy_conn_t *)arg;
+  (void)err;
+
+  /* pcb 已由 lwIP 释放 */
+  if (c != NULL) {
+    c->pcb = NULL;
+    c->reset = true;
+  }
+}
+
+static err_t proxy_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
+  uint8_t svc = (uint8_t)(uintptr_t)arg;
+  proxy_conn_t *c;
+
+  if (err != ERR_OK || newpcb == NULL) {
+    return ERR_VAL;
+  }
+
+  taskENTER_CRITICAL();
+  c = nat_find(ip_2_ip4(&newpcb->remote_ip), newpcb->remote_port, svc);
+  if (c != NULL && c->state == CONN_SYN) {
+    c->state = CONN_OPENING;
+  } else {
+    c = NULL;
+  }
+  taskEXIT_CRITICAL();
+
+  if (c == NULL) {
+    tcp_abort(newpcb);
+    return ERR_ABRT;
+  }
+
+  conn_attach(c, newpcb);
+  c->open_deadline = tpmesh_get_tick_ms();
+  s_stats.opened++;
+  proxy_tick_start();
+  conn_service(c, false);
+  return ERR_OK;
+}
+
+static err_t proxy_connected(void *arg, struct tcp_pcb *pcb, err_t err) {
+  proxy_conn_t *c = (proxy_conn_t *)arg;
+  (void)pcb;
+  (void)err;
+
+  if (c != NULL && c->state == CONN_OPENING) {
+    c->state = CONN_OPEN;
+    c->open_ack = true;
+    conn_service(c, false);
+  }
+  return ERR_OK;
+}
+
+/**
+ * @brief DDC: 收到 OPEN, 经环回连接本机服务
+ */
+static void conn_open_local(uint16_t peer, uint8_t id, uint16_t port) {
+  proxy_conn_t *c;
+
+  taskENTER_CRITICAL();
+  c = conn_alloc(tpmesh_get_tick_ms());
+  if (c != NULL) {
+    c->state = CONN_OPENING;
+  }
+  taskEXIT_CRITICAL();
+
+  struct tcp_pcb *pcb = c ? tcp_new() : NULL;
+  if (pcb == NULL) {
+    if (c != NULL) {
+      c->state = CONN_FREE;
+    }
+    stream_send(peer, STREAM_RST, id, 0, 0, 0, NULL, 0, 0);
+    return;
+  }
+
+  c->top = false;
+  c->id = id;
+  c->peer = peer;
+  c->port = port;
+  conn_attach(c, pcb);
+  s_stats.opened++;
+  if (tcp_connect(pcb, &s_local_ip, port, proxy_connected) != ERR_OK) {
+    c->reset = true;
+  }
+  proxy_tick_start();
+}
+
+static proxy_conn_t *conn_by_id(uint16_t peer, uint8_t id) {
+  for (int i = 0; i < TPMESH_TCP_PROXY_CONNS; i++) {
+    proxy_conn_t *c = &s_conns[i];
+    if ((c->state == CONN_OPENING || c->state == CONN_OPEN) &&
+        c->peer == peer && c->id == id) {
+      return c;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Mesh 流帧 (tcpip 线程)
+ */
+static void stream_input(void *ctx) {
+  struct pbuf *p = (struct pbuf *)ctx;
+  const uint8_t *d = (const uint8_t *)p->payload;
+  uint16_t src = get_u16(d);
+  uint16_t len = p->len - 2;
+  d += 2;
+
+  uint8_t type = d[0];
+  uint8_t id = d[1];
+  uint16_t seq = get_u16(d + 2);
+  uint16_t ack = get_u16(d + 4);
+  uint8_t wnd = d[6];
+  const uint8_t *data = d + TPMESH_STREAM_HDR_LEN;
+  uint16_t dlen = len - TPMESH_STREAM_HDR_LEN;
+
+  proxy_conn_t *c = conn_by_id(src, id);
+  s_stats.rx_segs++;
+
+  if (type == STREAM_OPEN) {
+    if (s_eth_netif == NULL && dlen >= 2) {
+      if (c == NULL) {
+        conn_open_local(src, id, get_u16(data));
+      } else if (c->state == CONN_OPEN) {
+        c->open_ack = true; /* OPEN_ACK 丢失, 重发 */
+      }
+    }
+  } else if (c == NULL) {
+    if (type != STREAM_RST) {
+      stream_send(src, STREAM_RST, id, 0, 0, 0, NULL, 0, 0);
+    }
+  } else {
+    c->last_rx = tpmesh_get_tick_ms();
+    switch (type) {
+    case STREAM_RST:
+      s_stats.resets++;
+      conn_free(c, true);
+      c = NULL;
+      break;
+
+    case STREAM_OPEN_ACK:
+    case STREAM_DATA:
+    case STREAM_FIN:
+    case STREAM_ACK:
+      /* OPEN_ACK 丢失时以对端的数据帧确认建立 */
+      if (c->top && c->state == CONN_OPENING) {
+        c->state = CONN_OPEN;
+        c->peer_wnd = wnd;
+      }
+      if (c->state != CONN_OPEN || type == STREAM_OPEN_ACK) {
+        break;
+      }
+      conn_on_ack(c, ack, wnd);
+      if (type == STREAM_DATA || type == STREAM_FIN) {
+        conn_on_data(c, seq, data, dlen, type == STREAM_FIN);
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  pbuf_free(p);
+  if (c != NULL) {
+    conn_service(c, true);
+  }
+}
+
+/* ============================================================================
+ * 私有函数 - Top Node 以太网输出改写 (tcpip 线程 / 桥接转发)
+ * ============================================================================
+ */
+
+/**
+ * @brief 本机代理连接的输出改写回 DDC 的 MAC/IP/端口
+ *
+ * lwIP 重传时复用同一 pbuf, 因此改写副本而不动原帧。
+ */
+static err_t proxy_linkoutput(struct netif *netif, struct pbuf *p) {
+  uint8_t *ip, *tcp;
+  uint8_t *f = tcp_frame(p, &ip, &tcp);
+
+  if (f != NULL && s_ready) {
+    uint16_t sport = get_u16(tcp);
+    if (sport >= TPMESH_TCP_PROXY_LISTEN_BASE &&
+        sport < TPMESH_TCP_PROXY_LISTEN_BASE + PROXY_SVC_COUNT &&
+        memcmp(ip + 12, &netif_ip4_addr(netif)->addr, 4) == 0) {
+      ip4_addr_t client;
+      ip4_addr_t ddc_ip;
+      uint8_t ddc_mac[6];
+      uint16_t port = 0;
+      memcpy(&client.addr, ip + 16, 4);
+
+      taskENTER_CRITICAL();
+      proxy_conn_t *c =
+          nat_find(&client, get_u16(tcp + 2),
+                   (uint8_t)(sport - TPMESH_TCP_PROXY_LISTEN_BASE));
+      if (c != NULL) {
+        ddc_ip = c->ddc_ip;
+        memcpy(ddc_mac, c->ddc_mac, 6);
+        port = c->port;
+      }
+      taskEXIT_CRITICAL();
+
+      if (port != 0) {
+        struct pbuf *q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+        if (q == NULL) {
+          return ERR_MEM;
+        }
+        f = tcp_frame(q, &ip, &tcp);
+        memcpy(f + 6, ddc_mac, 6);
+        rewrite_ip(ip + 12, &ddc_ip, ip + 10, tcp + 16);
+        rewrite_u16(tcp, port, NULL, tcp + 16);
+        err_t err = s_eth_linkoutput(netif, q);
+        pbuf_free(q);
+        return err;
+      }
+    }
+  }
+  return s_eth_linkoutput(netif, p);
+}
+
+/**
+ * @brief Top Node: 接管以太网输出并建立监听 (tcpip 线程)
+ */
+static void proxy_start_top(void *arg) {
+  (void)arg;
+
+  s_eth_linkoutput = s_eth_netif->linkoutput;
+  s_eth_netif->linkoutput = proxy_linkoutput;
+
+  for (unsigned i = 0; i < PROXY_SVC_COUNT; i++) {
+    struct tcp_pcb *pcb = tcp_new();
+    if (pcb == NULL ||
+        tcp_bind(pcb, IP_ADDR_ANY, TPMESH_TCP_PROXY_LISTEN_BASE + i) != ERR_OK) {
+      tpmesh_debug_printf("TcpProxy: listen %u failed\n",
+                          (unsigned)(TPMESH_TCP_PROXY_LISTEN_BASE + i));
+      if (pcb != NULL) {
+        tcp_abort(pcb);
+      }
+      continue;
+    }
+    struct tcp_pcb *lpcb = tcp_listen(pcb);
+    if (lpcb == NULL) {
+      tcp_abort(pcb);
+      continue;
+    }
+    tcp_arg(lpcb, (void *)(uintptr_t)i);
+    tcp_accept(lpcb, proxy_accept);
+  }
+  s_ready = true;
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_tcp_proxy_init(struct netif *eth_netif,
+                          const ip4_addr_t *local_ip) {
+  if (!TPMESH_TCP_PROXY_ENABLE || s_initialized) {
+    return 0;
+  }
+
+  memset(s_conns, 0, sizeof(s_conns));
+  s_eth_netif = eth_netif;
+  if (local_ip != NULL) {
+    ip4_addr_copy(s_local_ip, *local_ip);
+  }
+
+  if (eth_netif != NULL) {
+    if (tcpip_callback(proxy_start_top, NULL) != ERR_OK) {
+      return -1;
+    }
+  } else {
+    s_ready = true;
+  }
+
+  s_initialized = true;
+  return 0;
+}
+
+bool tpmesh_tcp_proxy_match(struct pbuf *p) {
+  uint8_t *ip, *tcp;
+
+  if (!s_ready || s_eth_netif == NULL || tcp_frame(p, &ip, &tcp) == NULL ||
+      svc_by_port(get_u16(tcp + 2)) < 0) {
+    return false;
+  }
+
+  ip4_addr_t dst;
+  memcpy(&dst.addr, ip + 16, 4);
+  uint16_t mesh_id = node_table_get_mesh_by_ip(&dst);
+  return mesh_id != MESH_ADDR_INVALID && !node_table_is_remote(mesh_id);
+}
+
+bool tpmesh_tcp_proxy_input(struct pbuf *p) {
+  uint8_t *ip, *tcp;
+  uint8_t *f = tcp_frame(p, &ip, &tcp);
+  if (f == NULL) {
+    return false;
+  }
+
+  int svc = svc_by_port(get_u16(tcp + 2));
+  if (svc < 0) {
+    return false;
+  }
+
+  ip4_addr_t client, ddc_ip;
+  memcpy(&client.addr, ip + 12, 4);
+  memcpy(&ddc_ip.addr, ip + 16, 4);
+  uint16_t client_port = get_u16(tcp);
+  uint8_t flags = tcp[13];
+  bool syn = (flags & TCP_SYN) && !(flags & TCP_ACK);
+  uint32_t now = tpmesh_get_tick_ms();
+  uint16_t peer = node_table_get_mesh_by_ip(&ddc_ip);
+
+  taskENTER_CRITICAL();
+  proxy_conn_t *c = nat_find(&client, client_port, (uint8_t)svc);
+  if (c != NULL && !ip4_addr_cmp(&c->ddc_ip, &ddc_ip)) {
+    c = NULL; /* 同一客户端端口同时连接另一 DDC: 不代理 */
+  } else if (syn && (c == NULL || c->state == CONN_LINGER)) {
+    if (c != NULL) {
+      c->state = CONN_FREE;
+    }
+    c = (peer != MESH_ADDR_INVALID) ? conn_alloc(now) : NULL;
+    if (c != NULL) {
+      c->state = CONN_SYN;
+      c->state_tick = now;
+      c->top = true;
+      c->svc = (uint8_t)svc;
+      c->peer = peer;
+      c->port = s_ports[svc];
+      c->client_ip = client;
+      c->client_port = client_port;
+      c->ddc_ip = ddc_ip;
+      memcpy(c->ddc_mac, f, 6);
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  if (c == NULL) {
+    return false;
+  }
+
+  /* 目的改为本机监听端口 */
+  memcpy(f, s_eth_netif->hwaddr, ETH_HWADDR_LEN);
+  rewrite_ip(ip + 16, netif_ip4_addr(s_eth_netif), ip + 10, tcp + 16);
+  rewrite_u16(tcp + 2, (uint16_t)(TPMESH_TCP_PROXY_LISTEN_BASE + svc), NULL,
+              tcp + 16);
+  return true;
+}
+
+void tpmesh_tcp_proxy_mesh_input(uint16_t src_mesh_id, const uint8_t *data,
+                                 uint16_t len) {
+  if (!s_ready || len < TPMESH_STREAM_HDR_LEN) {
+    return;
+  }
+
+  /* 投递到 tcpip 线程: [Src:2] + 流帧 */
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)(len + 2), PBUF_RAM);
+  if (p == NULL) {
+    return;
+  }
+  put_u16((uint8_t *)p->payload, src_mesh_id);
+  memcpy((uint8_t *)p->payload + 2, data, len);
+  if (tcpip_try_callback(stream_input, p) != ERR_OK) {
+    pbuf_free(p); /* 对端超时重传 */
+  }
+}
+
+void tpmesh_tcp_proxy_dump(void) {
+  if (!s_initialized) {
+    return;
+  }
+
+  static const char *const names[] = {"free", "syn", "opening", "open",
+                                      "linger"};
+  tpmesh_debug_printf("TcpProxy: opened %lu, reset %lu, seg tx %lu / rx %lu, "
+                      "retrans %lu\n",
+                      (unsigned long)s_stats.opened,
+                      (unsigned long)s_stats.resets,
+                      (unsigned long)s_stats.tx_segs,
+                      (unsigned long)s_stats.rx_segs,
+                      (unsigned long)s_stats.retrans);
+
+  for (int i = 0; i < TPMESH_TCP_PROXY_CONNS; i++) {
+    proxy_conn_t c;
+    taskENTER_CRITICAL();
+    c = s_conns[i];
+    taskEXIT_CRITICAL();
+    if (c.state == CONN_FREE) {
+      continue;
+    }
+    tpmesh_debug_printf("  #%u %s peer 0x%04X port %u", c.id, names[c.state],
+                        c.peer, c.port);
+    if (c.top) {
+      tpmesh_debug_printf(" client %s:%u", ip4addr_ntoa(&c.client_ip),
+                          c.client_port);
+    }
+    tpmesh_debug_printf(" una %u nxt %u max %u rcv %u queued %u retry %u\n",
+                        c.snd_una, c.snd_nxt, c.snd_max, c.rcv_nxt,
+                        c.txq ? c.txq->tot_len : 0, c.retries);
+  }
+}
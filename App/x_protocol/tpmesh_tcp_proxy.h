@@ -0,0 +1,171 @@
+/**
+ * @file tpmesh_tcp_proxy.h
+ * @brief TPMesh TCP 分段代理 (split TCP, Top Node 终结 / DDC 重新发起)
+ *
+ * BMS 到 DDC 的 Modbus TCP / HTTP 会话端到端经过 Mesh 时, RTT 达数秒且
+ * 丢包成串, 以太网侧 TCP 不断 RTO 退避、窗口很小, 吞吐崩溃。启用后:
+ * - Top Node 在以太网输入钩子中拦截发往本机注册 DDC 代理端口的 TCP,
+ *   改写为本机监听端口 (TPMESH_TCP_PROXY_LISTEN_BASE + 序号) 交给本机
+ *   lwIP, 应答在 linkoutput 中改写回 DDC 的 MAC/IP/端口, BMS 看到的是
+ *   局域网内的 TCP
+ * - 字节流经 Mesh 可靠流 (SCHC_RULE_STREAM) 中继: 按段编号, 累积确认,
+ *   固定小窗口, RTO 取自该 DDC 的 RTT 估计 (tpmesh_rtt), 丢包不缩窗口
+ * - DDC 收到 OPEN 后经环回连接本机服务端口, 双向转发
+ * - 本地 TCP 收到的数据在对端确认后才 tcp_recved(), 以太网侧窗口随
+ *   Mesh 进度开合, 不在 Top Node 堆积
+ *
+ * 流帧 (隧道头之后, TPMESH_STREAM_HDR_LEN 字节):
+ *   [Type:1][Conn:1][Seq:2 BE][Ack:2 BE][Wnd:1] + 数据
+ * Conn 由 Top Node 分配; Seq 为段序号 (DATA/FIN 各占一个), Ack 为期望
+ * 的下一段, Wnd 为接收方还能接受的段数。OPEN 数据为 [Port:2 BE]。
+ *
+ * 线程: 协议处理均在 tcpip 线程 (Mesh 输入经 tcpip_try_callback 投递),
+ * 发送期间阻塞该线程 (与 DDC Mesh 网卡相同)。DDC 侧需要
+ * LWIP_NETIF_LOOPBACK。
+ *
+ * @version 0.8.0
+ */
+
+#ifndef TPMESH_TCP_PROXY_H
+#define TPMESH_TCP_PROXY_H
+
+#include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 启用 TCP 代理 (两端均需启用) */
+#ifndef TPMESH_TCP_PROXY_ENABLE
+#define TPMESH_TCP_PROXY_ENABLE 0
+#endif
+
+/** 代理的 DDC 服务端口 (Modbus TCP, HTTP) */
+#ifndef TPMESH_TCP_PROXY_PORTS
+#define TPMESH_TCP_PROXY_PORTS {502, 80}
+#endif
+
+/** Top Node 本机监听端口起始值 (每个代理端口一个, 不与本机服务冲突) */
+#ifndef TPMESH_TCP_PROXY_LISTEN_BASE
+#define TPMESH_TCP_PROXY_LISTEN_BASE 0xF100
+#endif
+
+/** 同时代理的连接数 (占用 lwIP TCP PCB) */
+#ifndef TPMESH_TCP_PROXY_CONNS
+#define TPMESH_TCP_PROXY_CONNS 4
+#endif
+
+/** 流窗口 (在途段数) */
+#ifndef TPMESH_STREAM_WND
+#define TPMESH_STREAM_WND 4
+#endif
+
+/** 流帧头长度 */
+#define TPMESH_STREAM_HDR_LEN 7
+
+/** 单段最大数据长度 */
+#define TPMESH_STREAM_SEG_MAX                                                  \
+  (TPMESH_MTU - TPMESH_TUNNEL_HDR_LEN - TPMESH_STREAM_HDR_LEN)
+
+/** RTO: 尚无 RTT 估计时 / 下限 / 上限 (ms) */
+#ifndef TPMESH_STREAM_RTO_MS
+#define TPMESH_STREAM_RTO_MS 3000
+#endif
+#ifndef TPMESH_STREAM_RTO_MIN_MS
+#define TPMESH_STREAM_RTO_MIN_MS 1000
+#endif
+#ifndef TPMESH_STREAM_RTO_MAX_MS
+#define TPMESH_STREAM_RTO_MAX_MS 20000
+#endif
+
+/** 连续超时重传次数上限, 超过后复位连接 */
+#ifndef TPMESH_STREAM_MAX_RETRIES
+#define TPMESH_STREAM_MAX_RETRIES 8
+#endif
+
+/** 延迟确认 (ms) */
+#ifndef TPMESH_STREAM_ACK_DELAY_MS
+#define TPMESH_STREAM_ACK_DELAY_MS 100
+#endif
+
+/** 连接空闲超时 (ms): 期间未收到对端任何流帧则复位 */
+#ifndef TPMESH_STREAM_IDLE_MS
+#define TPMESH_STREAM_IDLE_MS 600000
+#endif
+
+/** 处理周期 (ms), 有连接时运行 */
+#define TPMESH_STREAM_TICK_MS 50
+
+/** 流帧类型 */
+typedef enum {
+  STREAM_OPEN = 0x01,     /**< 建立连接 (Top → DDC) */
+  STREAM_OPEN_ACK = 0x02, /**< 已连接本机服务 (DDC → Top) */
+  STREAM_DATA = 0x03,     /**< 数据 */
+  STREAM_ACK = 0x04,      /**< 确认 / 窗口更新 */
+  STREAM_FIN = 0x05,      /**< 本端数据结束 */
+  STREAM_RST = 0x06,      /**< 复位 */
+} stream_type_t;
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化 (TPMESH_TCP_PROXY_ENABLE=0 时无操作)
+ *
+ * Top Node 传入以太网 netif (接管其 linkoutput, 建立监听);
+ * DDC 传入 NULL 和本机 IP。
+ *
+ * @param eth_netif Top Node 以太网 netif, DDC 为 NULL
+ * @param local_ip DDC 本机 IP (Top Node 忽略)
+ * @return 0=成功, -1=失败
+ */
+int tpmesh_tcp_proxy_init(struct netif *eth_netif,
+                          const ip4_addr_t *local_ip);
+
+/**
+ * @brief 以太网帧是否为代理端口的 TCP (Top Node, 目的 MAC 已确认为 DDC)
+ * @param p 以太网帧
+ * @return true=交给 tpmesh_tcp_proxy_input()
+ */
+bool tpmesh_tcp_proxy_match(struct pbuf *p);
+
+/**
+ * @brief 把代理端口的 TCP 改写为本机连接 (以太网输入线程)
+ *
+ * 新连接 (SYN) 分配代理表项; 代理表满或代理启用前已建立的连接不改写。
+ *
+ * @param p 以太网帧 (原地改写)
+ * @return true=已改写, 交给本机 lwIP; false=按原路径转发到 Mesh
+ */
+bool tpmesh_tcp_proxy_input(struct pbuf *p);
+
+/**
+ * @brief 处理 Mesh 流帧 (桥接任务, 投递到 tcpip 线程)
+ * @param src_mesh_id 源 Mesh ID
+ * @param data 流帧 (隧道头之后)
+ * @param len 长度
+ */
+void tpmesh_tcp_proxy_mesh_input(uint16_t src_mesh_id, const uint8_t *data,
+                                 uint16_t len);
+
+/**
+ * @brief 打印连接状态
+ */
+void tpmesh_tcp_proxy_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_TCP_PROXY_H */
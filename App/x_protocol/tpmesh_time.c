@@ -0,0 +1,425 @@
+/**
+ * @file tpmesh_time.c
+ * @brief TPMesh 授时实现
+ *
+ * @version 0.8.0
+ */
+
+#include "tpmesh_time.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_rtt.h"
+#include "tpmesh_timer.h"
+#include "tpmesh_top_sync.h"
+
+#include "FreeRTOS.h"
+#include "PCF8563.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "task.h"
+
+/* ============================================================================
+ * 私有常量
+ * ============================================================================
+ */
+
+/** 捕捉秒跳变的最长时间 (ms): RTC 未走时则放弃 */
+#define EDGE_SCAN_MAX_MS 1500
+
+/** Top Node 本机时间无效时的重试周期 (ms) */
+#define INVALID_RETRY_MS 60000
+
+/** RTC 可表示的最后一年 (秒数以 2000 年为起点) */
+#define RTC_MAX_YEAR 2099
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static bool s_initialized = false;
+static bool s_is_top = false;
+
+/** Top: 锚点 (tcpip 线程写, 临界区保护) */
+static bool s_anchor_valid = false;
+static uint32_t s_anchor_secs = 0;
+static uint32_t s_anchor_tick = 0;
+
+/** Top: 秒跳变捕捉 (tcpip 线程) */
+static volatile bool s_scan_active = false;
+static uint16_t s_scan_sec = 0;
+static uint32_t s_scan_start = 0;
+
+/** Top: 信标定时器; 已为本次广播捕捉过 */
+static tpmesh_timer_t s_beacon_timer;
+static bool s_scan_retry = false;
+
+/** DDC: 下一个秒跳变的目标时间 (临界区保护) */
+static uint32_t s_step_secs = 0;
+static uint32_t s_step_tick = 0;
+
+/** 统计 */
+static uint32_t s_beacons = 0;     /**< Top: 已广播; DDC: 已接收 */
+static uint32_t s_scan_fail = 0;   /**< Top: RTC 未走时或未校准 */
+static uint32_t s_steps = 0;       /**< DDC: 写入 RTC 次数 */
+static int32_t s_last_offset = 0;  /**< DDC: 最近一次偏差 (s, 信标 - 本机) */
+static uint16_t s_last_delay = 0;  /**< DDC: 最近一次链路时延 (ms) */
+
+static const uint8_t s_month_days[12] = {31, 28, 31, 30, 31, 30,
+                                         31, 31, 30, 31, 30, 31};
+
+/* ============================================================================
+ * 私有函数 - 日历
+ * ============================================================================
+ */
+
+static bool is_leap(uint16_t year) {
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static uint8_t month_days(uint16_t year, uint8_t month) {
+  return (month == 2 && is_leap(year)) ? 29 : s_month_days[month - 1];
+}
+
+/**
+ * @brief 读本机 RTC, 换算为 2000 年起的秒数
+ * @param min_year 年份下限
+ * @return true=有效
+ */
+static bool rtc_read_secs(uint16_t min_year, uint32_t *secs) {
+  uint16_t year, month, day, hour, min, sec;
+
+  taskENTER_CRITICAL();
+  year = RtcYear;
+  month = RtcMonth;
+  day = RtcDay;
+  hour = RtcHour;
+  min = RtcMin;
+  sec = RtcSecond;
+  taskEXIT_CRITICAL();
+
+  if (year < min_year || year > RTC_MAX_YEAR || month < 1 || month > 12 ||
+      day < 1 || day > month_days(year, (uint8_t)month) || hour > 23 ||
+      min > 59 || sec > 59) {
+    return false;
+  }
+
+  uint32_t days = 0;
+  for (uint16_t y = 2000; y < year; y++) {
+    days += is_leap(y) ? 366 : 365;
+  }
+  for (uint8_t m = 1; m < month; m++) {
+    days += month_days(year, m);
+  }
+  days += day - 1;
+
+  *secs = ((days * 24 + hour) * 60 + min) * 60 + sec;
+  return true;
+}
+
+/**
+ * @brief 写本机 RTC, 由 RTCObj() 写入 PCF8563 (同 ntp_task)
+ */
+static void rtc_write_secs(uint32_t secs) {
+  uint32_t days = secs / 86400;
+  uint32_t rem = secs % 86400;
+  uint16_t year = 2000;
+  uint8_t month = 1;
+
+  /* 2000-01-01 为星期六 (0=星期日) */
+  uint16_t weekday = (uint16_t)((days + 6) % 7);
+
+  while (days >= (is_leap(year) ? 366u : 365u)) {
+    days -= is_leap(year) ? 366 : 365;
+    year++;
+  }
+  while (days >= month_days(year, month)) {
+    days -= month_days(year, month);
+    month++;
+  }
+
+  taskENTER_CRITICAL();
+  RtcYear = year;
+  RtcMonth = month;
+  RtcDay = (uint16_t)(days + 1);
+  RtcHour = (uint16_t)(rem / 3600);
+  RtcMin = (uint16_t)(rem / 60 % 60);
+  RtcSecond = (uint16_t)(rem % 60);
+  RtcWeekday = weekday;
+  RTCState |= RTC_CHANGE;
+  taskEXIT_CRITICAL();
+}
+
+/* ============================================================================
+ * 私有函数 - Top Node
+ * ============================================================================
+ */
+
+/**
+ * @brief 轮询 RTC 秒值, 跳变时记录锚点 (tcpip 线程)
+ */
+static void top_scan_poll(void *arg) {
+  (void)arg;
+  uint32_t now = tpmesh_get_tick_ms();
+
+  if (RtcSecond != s_scan_sec) {
+    uint32_t secs;
+    if (rtc_read_secs(TPMESH_TIME_MIN_YEAR, &secs)) {
+      taskENTER_CRITICAL();
+      s_anchor_secs = secs;
+      s_anchor_tick = now;
+      s_anchor_valid = true;
+      taskEXIT_CRITICAL();
+    } else {
+      s_scan_fail++;
+    }
+    s_scan_active = false;
+    return;
+  }
+
+  if (now - s_scan_start > EDGE_SCAN_MAX_MS) {
+    s_scan_fail++;
+    s_scan_active = false;
+    return;
+  }
+  sys_timeout(TPMESH_TIME_EDGE_POLL_MS, top_scan_poll, NULL);
+}
+
+static void top_scan_start(void *arg) {
+  (void)arg;
+  s_scan_sec = RtcSecond;
+  s_scan_start = tpmesh_get_tick_ms();
+  sys_timeout(TPMESH_TIME_EDGE_POLL_MS, top_scan_poll, NULL);
+}
+
+static void top_kick_scan(void) {
+  if (s_scan_active) {
+    return;
+  }
+  s_scan_active = true;
+  if (tcpip_try_callback(top_scan_start, NULL) != ERR_OK) {
+    s_scan_active = false;
+  }
+}
+
+/**
+ * @brief 当前时间 = 锚点 + 经过的节拍
+ * @param max_age 锚点最长使用时间 (ms)
+ * @return true=有效
+ */
+static bool top_now(uint32_t max_age, uint32_t *secs, uint16_t *ms) {
+  uint32_t now = tpmesh_get_tick_ms();
+  bool valid;
+  uint32_t base, elapsed;
+
+  taskENTER_CRITICAL();
+  valid = s_anchor_valid;
+  base = s_anchor_secs;
+  elapsed = now - s_anchor_tick;
+  taskEXIT_CRITICAL();
+
+  if (!valid || elapsed > max_age) {
+    return false;
+  }
+  *secs = base + elapsed / 1000;
+  *ms = (uint16_t)(elapsed % 1000);
+  return true;
+}
+
+static void put_time(uint8_t *v, uint32_t secs, uint16_t ms) {
+  v[0] = (uint8_t)(secs >> 24);
+  v[1] = (uint8_t)(secs >> 16);
+  v[2] = (uint8_t)(secs >> 8);
+  v[3] = (uint8_t)secs;
+  v[4] = (uint8_t)(ms >> 8);
+  v[5] = (uint8_t)ms;
+}
+
+/**
+ * @brief 信标定时器: 先捕捉秒跳变, 锚点新鲜时广播
+ */
+static void top_beacon_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)arg;
+  uint32_t secs;
+  uint16_t ms;
+
+  if (!top_now(TPMESH_TIME_RETRY_MS, &secs, &ms)) {
+    /* 锚点过旧: 重新捕捉, 稍后广播; 捕捉后仍无效则按未校准处理 */
+    if (s_scan_retry) {
+      s_scan_retry = false;
+      tpmesh_timer_start(timer, INVALID_RETRY_MS);
+      return;
+    }
+    s_scan_retry = true;
+    top_kick_scan();
+    tpmesh_timer_start(timer, TPMESH_TIME_RETRY_MS);
+    return;
+  }
+  s_scan_retry = false;
+  tpmesh_timer_start(timer, TPMESH_TIME_BEACON_MS);
+
+  /* 多 Top Node: 同一以太网段, 只由指定转发者广播 */
+  if (!tpmesh_top_sync_is_designated()) {
+    return;
+  }
+
+  uint8_t tlv[2 + REG_TLV_TIME_LEN];
+  tlv[0] = REG_TLV_TIME;
+  tlv[1] = REG_TLV_TIME_LEN;
+  put_time(&tlv[2], secs, ms);
+  if (tpmesh_top_send_reg(MESH_ADDR_BROADCAST, REG_FRAME_TIME, tlv,
+                          sizeof(tlv)) != 0) {
+    tpmesh_debug_printf("TPMesh Top: time beacon broadcast failed\n");
+    return;
+  }
+  s_beacons++;
+}
+
+/* ============================================================================
+ * 私有函数 - DDC
+ * ============================================================================
+ */
+
+/**
+ * @brief 秒跳变时刻: 比较并写 RTC (tcpip 线程)
+ */
+static void ddc_step(void *arg) {
+  (void)arg;
+  uint32_t target, local;
+
+  taskENTER_CRITICAL();
+  target = s_step_secs;
+  taskEXIT_CRITICAL();
+
+  /* 本机 RTC 无效 (未设置过) 时直接写入 */
+  if (rtc_read_secs(2000, &local)) {
+    int32_t offset = (int32_t)(target - local);
+    s_last_offset = offset;
+    if (offset < TPMESH_TIME_STEP_S && offset > -TPMESH_TIME_STEP_S) {
+      return;
+    }
+  }
+
+  rtc_write_secs(target);
+  s_steps++;
+  tpmesh_debug_printf("TPMesh DDC: RTC set from time beacon, offset %ld s\n",
+                      (long)s_last_offset);
+}
+
+/**
+ * @brief 在下一个秒跳变时刻执行 ddc_step (tcpip 线程)
+ */
+static void ddc_schedule_step(void *arg) {
+  (void)arg;
+  uint32_t now = tpmesh_get_tick_ms();
+  int32_t wait;
+
+  taskENTER_CRITICAL();
+  wait = (int32_t)(s_step_tick - now);
+  if (wait < 0) {
+    /* 回调排队期间已越过跳变: 顺延整秒 */
+    uint32_t late = (uint32_t)(-wait) / 1000 + 1;
+    s_step_secs += late;
+    s_step_tick += late * 1000;
+    wait = (int32_t)(s_step_tick - now);
+  }
+  taskEXIT_CRITICAL();
+
+  sys_untimeout(ddc_step, NULL);
+  sys_timeout((u32_t)wait, ddc_step, NULL);
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_time_init(bool is_top) {
+  if (!TPMESH_TIME_ENABLE || s_initialized) {
+    return 0;
+  }
+
+  s_is_top = is_top;
+  s_anchor_valid = false;
+  s_anchor_tick = 0;
+  if (is_top) {
+    tpmesh_timer_setup(&s_beacon_timer, top_beacon_expired, NULL);
+    /* 尽早取得锚点, 供注册 ACK 使用 */
+    tpmesh_timer_start(&s_beacon_timer, TPMESH_TIME_RETRY_MS);
+  }
+
+  s_initialized = true;
+  return 0;
+}
+
+uint16_t tpmesh_time_put_tlv(uint8_t *tlv, uint16_t off) {
+  uint32_t secs;
+  uint16_t ms;
+
+  if (!s_initialized || !s_is_top ||
+      !top_now(2 * TPMESH_TIME_BEACON_MS, &secs, &ms)) {
+    return off;
+  }
+  tlv[off] = REG_TLV_TIME;
+  tlv[off + 1] = REG_TLV_TIME_LEN;
+  put_time(&tlv[off + 2], secs, ms);
+  return off + 2 + REG_TLV_TIME_LEN;
+}
+
+void tpmesh_time_apply(uint16_t src, const uint8_t *v, uint8_t len) {
+  if (!s_initialized || s_is_top || len < REG_TLV_TIME_LEN) {
+    return;
+  }
+
+  uint32_t secs = ((uint32_t)v[0] << 24) | ((uint32_t)v[1] << 16) |
+                  ((uint32_t)v[2] << 8) | v[3];
+  uint32_t ms = ((uint32_t)v[4] << 8) | v[5];
+  if (ms >= 1000) {
+    return;
+  }
+
+  /* 单向时延取平滑 RTT 的一半 */
+  tpmesh_rtt_t rtt;
+  uint32_t delay = TPMESH_TIME_DEFAULT_DELAY_MS;
+  if (tpmesh_rtt_get(src, &rtt) == 0 && rtt.srtt != 0) {
+    delay = rtt.srtt / 2;
+  }
+  if (delay > TPMESH_TIME_MAX_DELAY_MS) {
+    delay = TPMESH_TIME_MAX_DELAY_MS;
+  }
+
+  /* 接收时刻 = 信标时间 + 时延; 下一个秒跳变在 1000 - 毫秒部分之后 */
+  uint32_t total = ms + delay;
+  uint32_t now = tpmesh_get_tick_ms();
+
+  taskENTER_CRITICAL();
+  s_step_secs = secs + total / 1000 + 1;
+  s_step_tick = now + 1000 - total % 1000;
+  taskEXIT_CRITICAL();
+
+  s_beacons++;
+  s_last_delay = (uint16_t)delay;
+  if (tcpip_try_callback(ddc_schedule_step, NULL) != ERR_OK) {
+    tpmesh_debug_printf("TPMesh DDC: time beacon dropped (tcpip busy)\n");
+  }
+}
+
+void tpmesh_time_dump(void) {
+  if (!s_initialized) {
+    return;
+  }
+
+  if (s_is_top) {
+    uint32_t secs;
+    uint16_t ms;
+    bool valid = top_now(2 * TPMESH_TIME_BEACON_MS, &secs, &ms);
+    tpmesh_debug_printf("Time source: %s, beacons %lu, scan fail %lu\n",
+                        valid ? "valid" : "not synced",
+                        (unsigned long)s_beacons, (unsigned long)s_scan_fail);
+  } else {
+    tpmesh_debug_printf("Time: beacons %lu, RTC set %lu, last offset %ld s, "
+                        "delay %u ms\n",
+                        (unsigned long)s_beacons, (unsigned long)s_steps,
+                        (long)s_last_offset, (unsigned)s_last_delay);
+  }
+}
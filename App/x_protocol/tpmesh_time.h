@@ -0,0 +1,114 @@
+/**
+ * @file tpmesh_time.h
+ * @brief TPMesh 授时 (Top Node 时间信标 → DDC RTC)
+ *
+ * 每个 DDC 各自运行 ntp_task() 经 Mesh 访问以太网侧 NTP 服务器, 每个同步
+ * 周期 N 对请求/应答, 且数百 ms 的往返时延直接计入误差。启用后:
+ * - Top Node 照常经以太网 NTP 校准本机 RTC, 并作为时间源: 在 tcpip 线程
+ *   捕捉 RTC 秒跳变, 以 (秒值, 系统节拍) 作为锚点, 之后任一时刻的时间为
+ *   锚点 + 经过的节拍
+ * - 指定转发者每 TPMESH_TIME_BEACON_MS 广播时间信标 (REG_FRAME_TIME +
+ *   REG_TLV_TIME), 注册 ACK 也携带信标, 新加入的 DDC 立即校时
+ * - DDC 以信标时间 + 链路时延 (到发送方的平滑 RTT / 2) 推算本机时间,
+ *   在下一个秒跳变时刻比较 RTC, 偏差达到 TPMESH_TIME_STEP_S 时写入
+ *   RTC (PCF8563), 不再运行 ntp_task()
+ *
+ * 信标: [Secs:4 BE][Ms:2 BE], Secs 为 2000-01-01 00:00:00 起的秒数, 与
+ * RTC 相同的时区 (Top Node 的 RTC 墙钟)。
+ *
+ * @version 0.8.0
+ */
+
+#ifndef TPMESH_TIME_H
+#define TPMESH_TIME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 启用 Mesh 授时 (DDC 不再创建 ntp_task) */
+#ifndef TPMESH_TIME_ENABLE
+#define TPMESH_TIME_ENABLE 1
+#endif
+
+/** 信标广播周期 (ms) */
+#ifndef TPMESH_TIME_BEACON_MS
+#define TPMESH_TIME_BEACON_MS 600000UL
+#endif
+
+/** Top Node: 捕捉秒跳变后多久内广播 (ms), 超过则重新捕捉 */
+#ifndef TPMESH_TIME_RETRY_MS
+#define TPMESH_TIME_RETRY_MS 2000
+#endif
+
+/** 捕捉秒跳变的轮询间隔 (ms, tcpip 线程) */
+#ifndef TPMESH_TIME_EDGE_POLL_MS
+#define TPMESH_TIME_EDGE_POLL_MS 5
+#endif
+
+/** Top Node: RTC 年份下限, 之前视为未校准, 不发信标 */
+#ifndef TPMESH_TIME_MIN_YEAR
+#define TPMESH_TIME_MIN_YEAR 2024
+#endif
+
+/** DDC: 尚无 RTT 样本时的链路时延 (ms) */
+#ifndef TPMESH_TIME_DEFAULT_DELAY_MS
+#define TPMESH_TIME_DEFAULT_DELAY_MS 200
+#endif
+
+/** DDC: 链路时延上限 (ms) */
+#ifndef TPMESH_TIME_MAX_DELAY_MS
+#define TPMESH_TIME_MAX_DELAY_MS 5000
+#endif
+
+/** DDC: 偏差达到该秒数才写 RTC */
+#ifndef TPMESH_TIME_STEP_S
+#define TPMESH_TIME_STEP_S 1
+#endif
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化 (桥接任务中, 定时轮初始化之后调用)
+ * @param is_top true=Top Node (时间源), false=DDC
+ * @return 0=成功
+ */
+int tpmesh_time_init(bool is_top);
+
+/**
+ * @brief Top Node: 追加信标 REG_TLV_TIME (注册 ACK)
+ * @param tlv TLV 缓冲区, 须能容纳 2 + REG_TLV_TIME_LEN
+ * @param off 当前 TLV 长度
+ * @return 追加后的 TLV 长度 (本机时间无效时不追加)
+ */
+uint16_t tpmesh_time_put_tlv(uint8_t *tlv, uint16_t off);
+
+/**
+ * @brief DDC: 按信标校时
+ * @param src 信标发送方 Mesh ID (用于估计链路时延)
+ * @param v REG_TLV_TIME 的值
+ * @param len 长度
+ */
+void tpmesh_time_apply(uint16_t src, const uint8_t *v, uint8_t len);
+
+/**
+ * @brief 打印授时状态
+ */
+void tpmesh_time_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_TIME_H */
@@ -0,0 +1,184 @@
+/**
+ * @file tpmesh_timer.c
+ * @brief TPMesh 共享定时轮实现
+ *
+ * @version 0.7.1
+ */
+
+#include "tpmesh_timer.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+#include <string.h>
+
+#if (TPMESH_TIMER_SLOTS & (TPMESH_TIMER_SLOTS - 1)) != 0
+#error "TPMESH_TIMER_SLOTS must be a power of 2"
+#endif
+
+#define TIMER_SLOT_MASK (TPMESH_TIMER_SLOTS - 1u)
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+/** 槽链表头 */
+static tpmesh_timer_t *s_slots[TPMESH_TIMER_SLOTS];
+
+/** 已处理到的 tick 序号 */
+static uint32_t s_proc_tick = 0;
+
+/** 已处理到的时间 (ms) */
+static uint32_t s_proc_ms = 0;
+
+static SemaphoreHandle_t s_timer_mutex = NULL;
+
+/* ============================================================================
+ * 私有函数
+ * ============================================================================
+ */
+
+static void slot_unlink(tpmesh_timer_t *t, uint32_t slot) {
+  if (t->prev) {
+    t->prev->next = t->next;
+  } else {
+    s_slots[slot] = t->next;
+  }
+  if (t->next) {
+    t->next->prev = t->prev;
+  }
+  t->next = NULL;
+  t->prev = NULL;
+}
+
+/**
+ * @brief 定时器所在槽 (由到期时间相对已处理时间计算, 回绕安全)
+ */
+static uint32_t slot_of(uint32_t deadline) {
+  int32_t delta = (int32_t)(deadline - s_proc_ms);
+  uint32_t ahead = 1;
+
+  if (delta > 0) {
+    ahead = ((uint32_t)delta + TPMESH_TIMER_TICK_MS - 1) / TPMESH_TIMER_TICK_MS;
+  }
+  return (s_proc_tick + ahead) & TIMER_SLOT_MASK;
+}
+
+/**
+ * @brief 停止定时器 (调用方持锁)
+ */
+static void timer_remove_locked(tpmesh_timer_t *t) {
+  if (t->active) {
+    slot_unlink(t, t->slot);
+    t->active = false;
+  }
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_timer_init(void) {
+  if (s_timer_mutex != NULL) {
+    return 0;
+  }
+
+  memset(s_slots, 0, sizeof(s_slots));
+  s_proc_tick = 0;
+  s_proc_ms = tpmesh_timer_now();
+
+  s_timer_mutex = xSemaphoreCreateMutex();
+  return (s_timer_mutex != NULL) ? 0 : -1;
+}
+
+void tpmesh_timer_setup(tpmesh_timer_t *timer, tpmesh_timer_cb_t cb,
+                        void *arg) {
+  memset(timer, 0, sizeof(*timer));
+  timer->cb = cb;
+  timer->arg = arg;
+}
+
+void tpmesh_timer_start(tpmesh_timer_t *timer, uint32_t delay_ms) {
+  tpmesh_timer_start_at(timer, tpmesh_timer_now() + delay_ms);
+}
+
+void tpmesh_timer_start_at(tpmesh_timer_t *timer, uint32_t deadline) {
+  if (s_timer_mutex == NULL) {
+    return;
+  }
+
+  xSemaphoreTake(s_timer_mutex, portMAX_DELAY);
+
+  timer_remove_locked(timer);
+
+  uint32_t slot = slot_of(deadline);
+  timer->deadline = deadline;
+  timer->slot = (uint16_t)slot;
+  timer->prev = NULL;
+  timer->next = s_slots[slot];
+  if (timer->next) {
+    timer->next->prev = timer;
+  }
+  s_slots[slot] = timer;
+  timer->active = true;
+
+  xSemaphoreGive(s_timer_mutex);
+}
+
+void tpmesh_timer_stop(tpmesh_timer_t *timer) {
+  if (s_timer_mutex == NULL) {
+    return;
+  }
+
+  xSemaphoreTake(s_timer_mutex, portMAX_DELAY);
+  timer_remove_locked(timer);
+  xSemaphoreGive(s_timer_mutex);
+}
+
+bool tpmesh_timer_active(const tpmesh_timer_t *timer) { return timer->active; }
+
+uint32_t tpmesh_timer_now(void) {
+  return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+void tpmesh_timer_poll(void) {
+  if (s_timer_mutex == NULL) {
+    return;
+  }
+
+  uint32_t now = tpmesh_timer_now();
+
+  while ((int32_t)(now - (s_proc_ms + TPMESH_TIMER_TICK_MS)) >= 0) {
+    xSemaphoreTake(s_timer_mutex, portMAX_DELAY);
+    s_proc_ms += TPMESH_TIMER_TICK_MS;
+    s_proc_tick++;
+    uint32_t slot = s_proc_tick & TIMER_SLOT_MASK;
+    xSemaphoreGive(s_timer_mutex);
+
+    /* 逐个取出到期定时器, 不持锁执行回调 (回调可重新启动定时器) */
+    for (;;) {
+      xSemaphoreTake(s_timer_mutex, portMAX_DELAY);
+
+      tpmesh_timer_t *t = s_slots[slot];
+      while (t && (int32_t)(t->deadline - s_proc_ms) > 0) {
+        t = t->next; /* 后续轮次 */
+      }
+      if (t == NULL) {
+        xSemaphoreGive(s_timer_mutex);
+        break;
+      }
+
+      slot_unlink(t, slot);
+      t->active = false;
+      tpmesh_timer_cb_t cb = t->cb;
+      void *arg = t->arg;
+
+      xSemaphoreGive(s_timer_mutex);
+
+      if (cb) {
+        cb(t, arg);
+      }
+    }
+  }
+}
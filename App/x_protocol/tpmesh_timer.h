@@ -0,0 +1,128 @@
+/**
+ * @file tpmesh_timer.h
+ * @brief TPMesh 共享定时轮 (节点存活 / 分片重组 / 在途请求 / 应答错峰)
+ *
+ * 哈希定时轮: TPMESH_TIMER_SLOTS 个槽, 每槽 TPMESH_TIMER_TICK_MS。
+ * 定时器按到期 tick 挂入槽链表, 超过一圈的定时器留在槽内等待后续轮次,
+ * 每个 tick 只处理一个槽, 开销与到期数量 (加同槽未到期数量) 成正比,
+ * 与定时器总数无关。
+ *
+ * - 定时器结构由调用方持有 (静态存储, 地址不可移动)
+ * - tpmesh_timer_poll() 由桥接任务周期调用, 回调在其上下文执行
+ * - 回调执行时不持有定时轮锁, 可在回调中重新启动定时器
+ *
+ * @version 0.7.1
+ */
+
+#ifndef TPMESH_TIMER_H
+#define TPMESH_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 定时轮精度 (ms) */
+#ifndef TPMESH_TIMER_TICK_MS
+#define TPMESH_TIMER_TICK_MS 100
+#endif
+
+/** 定时轮槽数 (2 的幂) */
+#ifndef TPMESH_TIMER_SLOTS
+#define TPMESH_TIMER_SLOTS 256
+#endif
+
+/* ============================================================================
+ * 数据结构定义
+ * ============================================================================
+ */
+
+struct tpmesh_timer;
+
+/**
+ * @brief 定时器回调
+ * @param timer 到期的定时器 (已停止)
+ * @param arg 用户参数
+ */
+typedef void (*tpmesh_timer_cb_t)(struct tpmesh_timer *timer, void *arg);
+
+/**
+ * @brief 定时器 (调用方持有)
+ */
+typedef struct tpmesh_timer {
+  struct tpmesh_timer *next; /**< 槽链表 */
+  struct tpmesh_timer *prev;
+  uint32_t deadline;         /**< 到期时间 (ms) */
+  uint16_t slot;             /**< 所在槽 */
+  tpmesh_timer_cb_t cb;      /**< 回调 */
+  void *arg;                 /**< 回调参数 */
+  bool active;               /**< 已启动 */
+} tpmesh_timer_t;
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化定时轮 (重复调用无副作用)
+ * @return 0=成功, -1=互斥锁创建失败
+ */
+int tpmesh_timer_init(void);
+
+/**
+ * @brief 初始化定时器
+ * @param timer 定时器
+ * @param cb 回调
+ * @param arg 回调参数
+ */
+void tpmesh_timer_setup(tpmesh_timer_t *timer, tpmesh_timer_cb_t cb,
+                        void *arg);
+
+/**
+ * @brief 启动定时器 (已启动则重新设置到期时间)
+ * @param timer 定时器
+ * @param delay_ms 延时 (ms)
+ */
+void tpmesh_timer_start(tpmesh_timer_t *timer, uint32_t delay_ms);
+
+/**
+ * @brief 按绝对时间启动定时器
+ * @param timer 定时器
+ * @param deadline 到期时间 (ms, 与 tpmesh_timer_now() 同一时基)
+ */
+void tpmesh_timer_start_at(tpmesh_timer_t *timer, uint32_t deadline);
+
+/**
+ * @brief 停止定时器 (未启动时无操作)
+ * @param timer 定时器
+ */
+void tpmesh_timer_stop(tpmesh_timer_t *timer);
+
+/**
+ * @brief 定时器是否已启动
+ */
+bool tpmesh_timer_active(const tpmesh_timer_t *timer);
+
+/**
+ * @brief 当前时间 (ms)
+ */
+uint32_t tpmesh_timer_now(void);
+
+/**
+ * @brief 处理到期定时器 (桥接任务周期调用)
+ */
+void tpmesh_timer_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_TIMER_H */
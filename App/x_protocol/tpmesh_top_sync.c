@@ -0,0 +1,383 @@
+/**
+ * @file tpmesh_top_sync.c
+ * @brief TPMesh 多 Top Node 节点表同步实现
+ *
+ * @version 0.8.0
+ */
+
+#include "tpmesh_top_sync.h"
+#include "tpmesh_bridge.h"
+#include "tpmesh_debug.h"
+#include "tpmesh_timer.h"
+
+/* node_table.h 已通过 tpmesh_bridge.h 包含 */
+#include "FreeRTOS.h"
+#include "lwip/prot/ethernet.h"
+#include "task.h"
+#include <string.h>
+
+/* ============================================================================
+ * 类型定义
+ * ============================================================================
+ */
+
+/** 对端 Top Node */
+typedef struct {
+  bool valid;
+  uint16_t mesh_id;   /**< Mesh ID */
+  uint8_t mac[6];     /**< 以太网 MAC */
+  uint32_t last_tick; /**< 最后收到通告的时间 */
+  uint16_t nodes;     /**< 最近一次通告的记录数 */
+} top_peer_t;
+
+/** 通告帧构建上下文 */
+typedef struct {
+  struct pbuf *p;  /**< 当前帧, NULL=尚未分配 */
+  uint8_t count;   /**< 当前帧记录数 */
+  uint16_t frames; /**< 已发出的帧数 */
+  uint16_t only;   /**< 只通告该 Mesh ID, MESH_ADDR_INVALID=全部 */
+  uint32_t now;
+} sync_tx_t;
+
+/** 帧最大长度 */
+#define SYNC_FRAME_MAX                                                         \
+  (SIZEOF_ETH_HDR + TPMESH_TOP_SYNC_HDR_LEN +                                 \
+   TPMESH_TOP_SYNC_BATCH * TPMESH_TOP_SYNC_REC_LEN)
+
+/** Idle 字段单位 (ms) */
+#define SYNC_IDLE_UNIT_MS 100
+
+/* ============================================================================
+ * 私有变量
+ * ============================================================================
+ */
+
+static struct netif *s_eth_netif = NULL;
+
+/** 本机 Mesh ID / Cell ID */
+static uint16_t s_mesh_id = MESH_ADDR_TOP_NODE;
+static uint8_t s_cell_id = 0;
+
+/** 对端 Top Node (以太网输入线程写, 桥接任务读; 临界区保护) */
+static top_peer_t s_peers[TPMESH_TOP_SYNC_PEERS_MAX];
+
+static tpmesh_top_sync_stats_t s_stats;
+
+/** 周期通告定时器 (桥接任务上下文) */
+static tpmesh_timer_t s_sync_timer;
+
+static bool s_initialized = false;
+
+/* ============================================================================
+ * 私有函数
+ * ============================================================================
+ */
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+  return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * @brief 分配并填写帧头
+ * @return 0=成功, -1=内存不足
+ */
+static int tx_begin(sync_tx_t *tx) {
+  tx->p = pbuf_alloc(PBUF_RAW, SYNC_FRAME_MAX, PBUF_RAM);
+  if (tx->p == NULL) {
+    return -1;
+  }
+
+  uint8_t *f = (uint8_t *)tx->p->payload;
+  memset(f, 0xFF, ETH_HWADDR_LEN);
+  memcpy(f + ETH_HWADDR_LEN, s_eth_netif->hwaddr, ETH_HWADDR_LEN);
+  put_u16(f + 2 * ETH_HWADDR_LEN, TPMESH_TOP_SYNC_ETHTYPE);
+
+  uint8_t *h = f + SIZEOF_ETH_HDR;
+  h[0] = TPMESH_TOP_SYNC_VERSION;
+  h[1] = s_cell_id;
+  put_u16(h + 2, s_mesh_id);
+  h[4] = 0;
+  tx->count = 0;
+  return 0;
+}
+
+/**
+ * @brief 发送当前帧
+ */
+static void tx_flush(sync_tx_t *tx) {
+  if (tx->p == NULL) {
+    return;
+  }
+
+  uint8_t *h = (uint8_t *)tx->p->payload + SIZEOF_ETH_HDR;
+  h[4] = tx->count;
+  pbuf_realloc(tx->p, SIZEOF_ETH_HDR + TPMESH_TOP_SYNC_HDR_LEN +
+                          tx->count * TPMESH_TOP_SYNC_REC_LEN);
+  if (s_eth_netif->linkoutput(s_eth_netif, tx->p) == ERR_OK) {
+    s_stats.tx_frames++;
+  }
+  tx->frames++;
+
+  pbuf_free(tx->p);
+  tx->p = NULL;
+}
+
+/**
+ * @brief 节点表遍历回调: 追加本机注册的在线 DDC
+ *
+ * 在节点表锁内执行, 帧满时直接发送 (以太网发送不阻塞, 查询为无锁读)。
+ */
+static bool sync_tx_cb(const node_entry_t *entry, void *arg) {
+  sync_tx_t *tx = (sync_tx_t *)arg;
+
+  if (tx->only != MESH_ADDR_INVALID && entry->mesh_id != tx->only) {
+    return true;
+  }
+  /* 只通告本机确认过的节点: 同步来的归其他 Top Node, 快照恢复的尚未确认 */
+  if ((entry->source != NODE_SOURCE_REGISTER &&
+       entry->source != NODE_SOURCE_LEARNED) ||
+      !entry->online || entry->stale) {
+    return tx->only == MESH_ADDR_INVALID;
+  }
+
+  if (tx->p == NULL && tx_begin(tx) != 0) {
+    return false;
+  }
+
+  uint32_t idle = (tx->now - entry->last_seen) / SYNC_IDLE_UNIT_MS;
+  uint8_t *r = (uint8_t *)tx->p->payload + SIZEOF_ETH_HDR +
+               TPMESH_TOP_SYNC_HDR_LEN + tx->count * TPMESH_TOP_SYNC_REC_LEN;
+  put_u16(r, entry->mesh_id);
+  memcpy(r + 2, entry->mac, 6);
+  memcpy(r + 8, &entry->ip.addr, 4);
+  put_u32(r + 12, entry->device_instance);
+  r[16] = entry->caps;
+  put_u16(r + 17, entry->group);
+  put_u16(r + 19, (uint16_t)((idle > 0xFFFF) ? 0xFFFF : idle));
+
+  if (++tx->count >= TPMESH_TOP_SYNC_BATCH) {
+    tx_flush(tx);
+  }
+  return tx->only == MESH_ADDR_INVALID;
+}
+
+/**
+ * @brief 通告本机 DDC
+ * @param only 只通告该 Mesh ID, MESH_ADDR_INVALID=全部
+ * @param keepalive 无记录时发送空帧 (对端据此参与指定转发者选择)
+ */
+static void sync_send(uint16_t only, bool keepalive) {
+  sync_tx_t tx = {NULL, 0, 0, only, tpmesh_get_tick_ms()};
+
+  node_table_foreach(sync_tx_cb, &tx);
+  if (keepalive && tx.frames == 0 && tx.p == NULL) {
+    tx_begin(&tx);
+  }
+  tx_flush(&tx);
+}
+
+/**
+ * @brief 周期全量通告 (同时作为本机 Top Node 的存活通告)
+ */
+static void sync_expired(tpmesh_timer_t *timer, void *arg) {
+  (void)arg;
+
+  sync_send(MESH_ADDR_INVALID, true);
+  tpmesh_timer_start(timer, TPMESH_TOP_SYNC_INTERVAL_MS);
+}
+
+/**
+ * @brief 记录对端 Top Node (调用方在临界区内)
+ */
+static void peer_seen(uint16_t mesh_id, const uint8_t *mac, uint16_t nodes,
+                      uint32_t now) {
+  top_peer_t *slot = NULL;
+
+  for (int i = 0; i < TPMESH_TOP_SYNC_PEERS_MAX; i++) {
+    top_peer_t *pr = &s_peers[i];
+    if (pr->valid && pr->mesh_id == mesh_id) {
+      slot = pr;
+      break;
+    }
+    /* 空位或已超时的对端可复用 */
+    if (slot == NULL &&
+        (!pr->valid ||
+         now - pr->last_tick > TPMESH_TOP_SYNC_PEER_TIMEOUT_MS)) {
+      slot = pr;
+    }
+  }
+  if (slot == NULL) {
+    return;
+  }
+
+  slot->valid = true;
+  slot->mesh_id = mesh_id;
+  memcpy(slot->mac, mac, 6);
+  slot->last_tick = now;
+  slot->nodes = nodes;
+}
+
+/* ============================================================================
+ * 公共函数
+ * ============================================================================
+ */
+
+int tpmesh_top_sync_init(struct netif *eth_netif, uint16_t mesh_id,
+                         uint8_t cell_id) {
+  if (eth_netif == NULL || !MESH_ADDR_IS_TOP(mesh_id)) {
+    return -1;
+  }
+
+  s_eth_netif = eth_netif;
+  s_mesh_id = mesh_id;
+  s_cell_id = cell_id;
+  memset(s_peers, 0, sizeof(s_peers));
+  memset(&s_stats, 0, sizeof(s_stats));
+
+  tpmesh_timer_setup(&s_sync_timer, sync_expired, NULL);
+  tpmesh_timer_start(&s_sync_timer, TPMESH_TOP_SYNC_INTERVAL_MS);
+  s_initialized = true;
+  return 0;
+}
+
+bool tpmesh_top_sync_input(struct pbuf *p) {
+  if (p->len < SIZEOF_ETH_HDR + TPMESH_TOP_SYNC_HDR_LEN) {
+    return false;
+  }
+
+  const uint8_t *f = (const uint8_t *)p->payload;
+  if (get_u16(f + 2 * ETH_HWADDR_LEN) != TPMESH_TOP_SYNC_ETHTYPE) {
+    return false;
+  }
+  if (!s_initialized) {
+    return true;
+  }
+
+  const uint8_t *h = f + SIZEOF_ETH_HDR;
+  uint16_t top = get_u16(h + 2);
+  uint8_t count = h[4];
+
+  if (h[0] != TPMESH_TOP_SYNC_VERSION || h[1] != s_cell_id ||
+      !MESH_ADDR_IS_TOP(top) ||
+      p->len < SIZEOF_ETH_HDR + TPMESH_TOP_SYNC_HDR_LEN +
+                   (uint16_t)count * TPMESH_TOP_SYNC_REC_LEN) {
+    return true;
+  }
+  if (top == s_mesh_id) {
+    tpmesh_debug_printf("TopSync: Duplicate Top Node Mesh ID 0x%04X\n", top);
+    return true;
+  }
+
+  uint32_t now = tpmesh_get_tick_ms();
+  taskENTER_CRITICAL();
+  peer_seen(top, f + ETH_HWADDR_LEN, count, now);
+  s_stats.rx_frames++;
+  taskEXIT_CRITICAL();
+
+  const uint8_t *r = h + TPMESH_TOP_SYNC_HDR_LEN;
+  for (uint8_t i = 0; i < count; i++, r += TPMESH_TOP_SYNC_REC_LEN) {
+    node_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.mesh_id = get_u16(r);
+    if (e.mesh_id == MESH_ADDR_BROADCAST || e.mesh_id >= MESH_ADDR_GROUP_FIRST) {
+      continue;
+    }
+    memcpy(e.mac, r + 2, 6);
+    memcpy(&e.ip.addr, r + 8, 4);
+    e.device_instance = get_u32(r + 12);
+    e.caps = r[16];
+    e.group = get_u16(r + 17);
+
+    int ret = node_table_sync(&e, top, (uint32_t)get_u16(r + 19) *
+                                           SYNC_IDLE_UNIT_MS);
+    if (ret == 0) {
+      s_stats.applied++;
+    } else if (ret == 1) {
+      s_stats.kept++;
+    } else if (ret == -2) {
+      s_stats.conflicts++;
+    }
+  }
+  return true;
+}
+
+void tpmesh_top_sync_announce(uint16_t mesh_id) {
+  if (!s_initialized) {
+    return;
+  }
+  sync_send(mesh_id, false);
+}
+
+bool tpmesh_top_sync_is_designated(void) {
+  bool designated = true;
+  uint32_t now = tpmesh_get_tick_ms();
+
+  taskENTER_CRITICAL();
+  for (int i = 0; i < TPMESH_TOP_SYNC_PEERS_MAX; i++) {
+    const top_peer_t *pr = &s_peers[i];
+    if (pr->valid && pr->mesh_id > s_mesh_id &&
+        now - pr->last_tick <= TPMESH_TOP_SYNC_PEER_TIMEOUT_MS) {
+      designated = false;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  return designated;
+}
+
+void tpmesh_top_sync_get_stats(tpmesh_top_sync_stats_t *stats) {
+  taskENTER_CRITICAL();
+  memcpy(stats, &s_stats, sizeof(*stats));
+  taskEXIT_CRITICAL();
+}
+
+void tpmesh_top_sync_dump(void) {
+  tpmesh_top_sync_stats_t st;
+  top_peer_t peers[TPMESH_TOP_SYNC_PEERS_MAX];
+  uint32_t now = tpmesh_get_tick_ms();
+
+  tpmesh_top_sync_get_stats(&st);
+  taskENTER_CRITICAL();
+  memcpy(peers, s_peers, sizeof(peers));
+  taskEXIT_CRITICAL();
+
+  tpmesh_debug_printf("TopSync: 0x%04X %s, tx %lu, rx %lu\n", s_mesh_id,
+                      tpmesh_top_sync_is_designated() ? "designated" : "member",
+                      (unsigned long)st.tx_frames, (unsigned long)st.rx_frames);
+  tpmesh_debug_printf("  applied %lu, kept %lu, conflict %lu\n",
+                      (unsigned long)st.applied, (unsigned long)st.kept,
+                      (unsigned long)st.conflicts);
+  for (int i = 0; i < TPMESH_TOP_SYNC_PEERS_MAX; i++) {
+    if (!peers[i].valid) {
+      continue;
+    }
+    tpmesh_debug_printf("  peer 0x%04X %02X:%02X:%02X:%02X:%02X:%02X "
+                        "%u nodes, %lu ms ago%s\n",
+                        peers[i].mesh_id, peers[i].mac[0], peers[i].mac[1],
+                        peers[i].mac[2], peers[i].mac[3], peers[i].mac[4],
+                        peers[i].mac[5], peers[i].nodes,
+                        (unsigned long)(now - peers[i].last_tick),
+                        (now - peers[i].last_tick >
+                         TPMESH_TOP_SYNC_PEER_TIMEOUT_MS)
+                            ? " (lost)"
+                            : "");
+  }
+}
@@ -0,0 +1,144 @@
+/**
+ * @file tpmesh_top_sync.h
+ * @brief TPMesh 多 Top Node 节点表同步 (以太网侧)
+ *
+ * 同一以太网段上可部署多个 Top Node (Mesh ID 0xFFBE~0xFFFE), DDC 向
+ * 跳数最少的 Top Node 注册 (注册帧发往任意中心节点 0xFFFF, 由模组选路),
+ * 上下行容量随 Top Node 数量增加:
+ * - 各 Top Node 周期以以太网广播 (TPMESH_TOP_SYNC_ETHTYPE) 通告本机
+ *   注册的在线 DDC, 新注册立即单独通告
+ * - 收到的通告以 NODE_SOURCE_SYNC 存入节点表, 记录所属 Top Node;
+ *   代理 ARP 和以太网单播只由所属 Top Node 处理, 不重复应答
+ * - 同一 DDC 由最近收到它的 Top Node 所有: DDC 转向其他 Top Node 注册后,
+ *   原 Top Node 收到更新的通告即让出
+ * - 以太网广播 (Who-Is 等) 带范围时各 Top Node 只定向发给本机的 DDC,
+ *   需全网泛洪时只由 Mesh ID 最大的在线 Top Node (指定转发者) 发送
+ *
+ * 同步帧: 以太网广播, 载荷
+ *   [Ver:1][Cell:1][Top Mesh ID:2 BE][Count:1] + Count x 记录
+ * 记录 (TPMESH_TOP_SYNC_REC_LEN 字节):
+ *   [Mesh:2 BE][MAC:6][IP:4][Instance:4 BE][Caps:1][Group:2 BE][Idle:2 BE]
+ * Idle 为所属 Top Node 最后收到该 DDC 距今的时间 (100 ms 单位, 饱和)。
+ *
+ * @version 0.8.0
+ */
+
+#ifndef TPMESH_TOP_SYNC_H
+#define TPMESH_TOP_SYNC_H
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * 配置常量
+ * ============================================================================
+ */
+
+/** 同步帧 EtherType (IEEE 802 本地实验用) */
+#ifndef TPMESH_TOP_SYNC_ETHTYPE
+#define TPMESH_TOP_SYNC_ETHTYPE 0x88B5
+#endif
+
+/** 协议版本 */
+#define TPMESH_TOP_SYNC_VERSION 1
+
+/** 全量通告间隔 (ms), 须明显小于 NODE_TABLE_TIMEOUT_MS */
+#ifndef TPMESH_TOP_SYNC_INTERVAL_MS
+#define TPMESH_TOP_SYNC_INTERVAL_MS 10000
+#endif
+
+/** 对端 Top Node 超时 (ms): 超时后不再参与指定转发者选择 */
+#ifndef TPMESH_TOP_SYNC_PEER_TIMEOUT_MS
+#define TPMESH_TOP_SYNC_PEER_TIMEOUT_MS (3 * TPMESH_TOP_SYNC_INTERVAL_MS)
+#endif
+
+/** 最多跟踪的对端 Top Node 数 */
+#ifndef TPMESH_TOP_SYNC_PEERS_MAX
+#define TPMESH_TOP_SYNC_PEERS_MAX 4
+#endif
+
+/** 单帧最多记录数 (载荷不超过以太网 MTU) */
+#define TPMESH_TOP_SYNC_BATCH 64
+
+/** 同步帧头长度 */
+#define TPMESH_TOP_SYNC_HDR_LEN 5
+
+/** 单条记录长度 */
+#define TPMESH_TOP_SYNC_REC_LEN 21
+
+/* ============================================================================
+ * 数据结构定义
+ * ============================================================================
+ */
+
+/**
+ * @brief 同步统计
+ */
+typedef struct {
+  uint32_t tx_frames; /**< 发出的同步帧 */
+  uint32_t rx_frames; /**< 收到的同步帧 */
+  uint32_t applied;   /**< 接受的记录 */
+  uint32_t kept;      /**< 本机更近期收到而保留的记录 */
+  uint32_t conflicts; /**< MAC/IP 与其他节点冲突的记录 */
+} tpmesh_top_sync_stats_t;
+
+/* ============================================================================
+ * 公共 API
+ * ============================================================================
+ */
+
+/**
+ * @brief 初始化并启动周期通告 (Top Node)
+ * @param eth_netif 以太网 netif
+ * @param mesh_id 本机 Mesh ID
+ * @param cell_id 本机 Cell ID (不同 Cell 的通告互相忽略)
+ * @return 0=成功, -1=参数错误
+ */
+int tpmesh_top_sync_init(struct netif *eth_netif, uint16_t mesh_id,
+                         uint8_t cell_id);
+
+/**
+ * @brief 处理以太网输入的同步帧 (以太网输入线程)
+ * @param p 以太网帧
+ * @return true=同步帧 (已处理), false=其他帧
+ */
+bool tpmesh_top_sync_input(struct pbuf *p);
+
+/**
+ * @brief 立即通告一个本机注册的 DDC (注册成功后调用)
+ * @param mesh_id DDC Mesh ID
+ */
+void tpmesh_top_sync_announce(uint16_t mesh_id);
+
+/**
+ * @brief 本机是否为指定转发者 (无 Mesh ID 更大的在线对端 Top Node)
+ *
+ * 需要在 Mesh 上泛洪的以太网广播只由指定转发者发送, 避免 DDC 收到
+ * 多份。
+ *
+ * @return true=本机转发
+ */
+bool tpmesh_top_sync_is_designated(void);
+
+/**
+ * @brief 获取统计
+ * @param stats [out] 统计
+ */
+void tpmesh_top_sync_get_stats(tpmesh_top_sync_stats_t *stats);
+
+/**
+ * @brief 打印对端 Top Node 与统计
+ */
+void tpmesh_top_sync_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TPMESH_TOP_SYNC_H */
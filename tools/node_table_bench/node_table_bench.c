@@ -0,0 +1,239 @@
+/**
+ * @file node_table_bench.c
+ * @brief 节点映射表查询基准 (主机运行)
+ *
+ * 对比哈希索引 node_table 与原线性扫描在 16/64/256 个节点时的查询开销,
+ * 并在随机增删后校验三个索引与影子表一致。
+ *
+ * 编译 (仓库根目录):
+ *   gcc -O2 -Itools/node_table_bench/stubs -IApp/x_protocol \
+ *       tools/node_table_bench/node_table_bench.c App/x_protocol/node_table.c \
+ *       App/x_protocol/tpmesh_timer.c -o node_table_bench
+ *
+ * 逐帧查询按 Top Node 转发路径计: get_mesh_by_mac + 2 x get_ip_by_mesh +
+ * get_mac_by_mesh (SCHC 解压)。
+ */
+
+#include "FreeRTOS.h"
+#include "node_table.h"
+#include "tpmesh_timer.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define LOOKUP_ROUNDS 2000000
+#define CHURN_ROUNDS 200000
+
+/* ============================================================================
+ * 桩
+ * ============================================================================
+ */
+
+TickType_t xTaskGetTickCount(void) { return 0; }
+
+int tpmesh_debug_printf(const char *fmt, ...) {
+  (void)fmt;
+  return 0;
+}
+
+void tpmesh_rtt_update(tpmesh_rtt_t *rtt, uint32_t sample_ms) {
+  (void)rtt;
+  (void)sample_ms;
+}
+
+/* ============================================================================
+ * 原线性扫描实现 (对照组)
+ * ============================================================================
+ */
+
+static node_entry_t s_linear[NODE_TABLE_MAX_ENTRIES];
+static int s_linear_count;
+
+static int linear_by_mesh(uint16_t mesh_id) {
+  for (int i = 0; i < s_linear_count; i++) {
+    if (s_linear[i].valid && s_linear[i].mesh_id == mesh_id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static int linear_by_mac(const uint8_t *mac) {
+  for (int i = 0; i < s_linear_count; i++) {
+    if (s_linear[i].valid && memcmp(s_linear[i].mac, mac, 6) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* ============================================================================
+ * 工具函数
+ * ============================================================================
+ */
+
+static uint32_t s_rng = 0x12345678u;
+
+static uint32_t rng(void) {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 17;
+  s_rng ^= s_rng << 5;
+  return s_rng;
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void make_node(uint16_t mesh_id, uint8_t *mac, ip4_addr_t *ip) {
+  /* 同一批 DDC: OUI 相同, 低 3 字节递增 */
+  mac[0] = 0x02;
+  mac[1] = 0x00;
+  mac[2] = 0x5E;
+  mac[3] = 0x10;
+  mac[4] = (uint8_t)(mesh_id >> 8);
+  mac[5] = (uint8_t)mesh_id;
+  ip4_addr_set_u32(ip, (uint32_t)(192 | (168 << 8) | ((10 + (mesh_id >> 8)) << 16) |
+                                  ((uint32_t)(mesh_id & 0xFF) << 24)));
+}
+
+static bool copy_cb(const node_entry_t *entry, void *arg) {
+  (void)arg;
+  s_linear[s_linear_count++] = *entry;
+  return true;
+}
+
+/* ============================================================================
+ * 基准
+ * ============================================================================
+ */
+
+static volatile uint32_t s_sink;
+
+static void bench(int nodes) {
+  uint8_t mac[6];
+  ip4_addr_t ip;
+
+  node_table_clear();
+  for (int i = 1; i <= nodes; i++) {
+    make_node((uint16_t)i, mac, &ip);
+    node_table_register(mac, &ip, (uint16_t)i);
+  }
+
+  s_linear_count = 0;
+  node_table_foreach(copy_cb, NULL);
+
+  /* 预生成查询序列 */
+  static uint16_t ids[4096];
+  for (int i = 0; i < 4096; i++) {
+    ids[i] = (uint16_t)(1 + rng() % nodes);
+  }
+
+  double t0 = now_ns();
+  for (int r = 0; r < LOOKUP_ROUNDS; r++) {
+    uint16_t id = ids[r & 4095];
+    make_node(id, mac, &ip);
+    ip4_addr_t a;
+    uint8_t m[6];
+    s_sink += node_table_get_mesh_by_mac(mac);
+    node_table_get_ip_by_mesh(id, &a);
+    node_table_get_ip_by_mesh(id, &a);
+    node_table_get_mac_by_mesh(id, m);
+    s_sink += a.addr + m[5];
+  }
+  double hashed = (now_ns() - t0) / LOOKUP_ROUNDS;
+
+  t0 = now_ns();
+  for (int r = 0; r < LOOKUP_ROUNDS; r++) {
+    uint16_t id = ids[r & 4095];
+    make_node(id, mac, &ip);
+    int i = linear_by_mac(mac);
+    s_sink += (i >= 0) ? s_linear[i].mesh_id : 0;
+    i = linear_by_mesh(id);
+    s_sink += (i >= 0) ? s_linear[i].ip.addr : 0;
+    i = linear_by_mesh(id);
+    s_sink += (i >= 0) ? s_linear[i].ip.addr : 0;
+    i = linear_by_mesh(id);
+    s_sink += (i >= 0) ? s_linear[i].mac[5] : 0;
+  }
+  double linear = (now_ns() - t0) / LOOKUP_ROUNDS;
+
+  printf("%5d nodes: hash %7.1f ns/frame, linear %7.1f ns/frame (x%.1f)\n",
+         nodes, hashed, linear, linear / hashed);
+}
+
+/* ============================================================================
+ * 一致性校验: 随机注册/删除/改 MAC 后逐一查询
+ * ============================================================================
+ */
+
+static int churn_check(void) {
+  static bool present[NODE_TABLE_MAX_ENTRIES + 1];
+  static uint8_t mac_tail[NODE_TABLE_MAX_ENTRIES + 1];
+  uint8_t mac[6];
+  ip4_addr_t ip;
+
+  node_table_clear();
+  memset(present, 0, sizeof(present));
+
+  for (int r = 0; r < CHURN_ROUNDS; r++) {
+    uint16_t id = (uint16_t)(1 + rng() % NODE_TABLE_MAX_ENTRIES);
+    switch (rng() % 3) {
+    case 0:
+      make_node(id, mac, &ip);
+      mac[3] = mac_tail[id];
+      if (node_table_register(mac, &ip, id) == 0) {
+        present[id] = true;
+      }
+      break;
+    case 1:
+      node_table_remove(id);
+      present[id] = false;
+      break;
+    default:
+      if (present[id]) {
+        make_node(id, mac, &ip);
+        mac_tail[id] = (uint8_t)rng();
+        mac[3] = mac_tail[id];
+        node_table_learn_by_mesh(id, mac);
+      }
+      break;
+    }
+  }
+
+  int errors = 0;
+  uint16_t expect = 0;
+  for (uint16_t id = 1; id <= NODE_TABLE_MAX_ENTRIES; id++) {
+    make_node(id, mac, &ip);
+    mac[3] = mac_tail[id];
+    bool by_mac = node_table_get_mesh_by_mac(mac) == id;
+    bool by_ip = node_table_get_mesh_by_ip(&ip) == id;
+    bool by_id = node_table_get_entry(id) != NULL;
+    if (by_mac != present[id] || by_ip != present[id] || by_id != present[id]) {
+      errors++;
+    }
+    expect += present[id];
+  }
+  if (node_table_count() != expect) {
+    errors++;
+  }
+
+  printf("churn check: %d nodes present, %d errors\n", expect, errors);
+  return errors;
+}
+
+int main(void) {
+  tpmesh_timer_init();
+  node_table_init();
+
+  printf("node table capacity %d, hash buckets %u\n", NODE_TABLE_MAX_ENTRIES,
+         1u << NODE_TABLE_HASH_BITS);
+
+  bench(16);
+  bench(64);
+  bench(256);
+
+  return churn_check() == 0 ? 0 : 1;
+}
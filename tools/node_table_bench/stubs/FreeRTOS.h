@@ -0,0 +1,20 @@
+/**
+ * @file FreeRTOS.h
+ * @brief 主机基准测试用 FreeRTOS 桩 (单线程, 无实际互斥)
+ */
+
+#ifndef BENCH_FREERTOS_H
+#define BENCH_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef void *SemaphoreHandle_t;
+
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS 1
+#define portMEMORY_BARRIER() __asm volatile("" ::: "memory")
+
+TickType_t xTaskGetTickCount(void);
+
+#endif /* BENCH_FREERTOS_H */
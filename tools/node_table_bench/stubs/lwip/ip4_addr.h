@@ -0,0 +1,24 @@
+/**
+ * @file ip4_addr.h
+ * @brief 主机基准测试用 lwIP ip4_addr 桩 (仅 node_table 用到的宏)
+ */
+
+#ifndef BENCH_LWIP_IP4_ADDR_H
+#define BENCH_LWIP_IP4_ADDR_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t addr; /**< 网络字节序 */
+} ip4_addr_t;
+
+#define ip4_addr_get_u32(a) ((a)->addr)
+#define ip4_addr_set_u32(a, v) ((a)->addr = (v))
+#define ip4_addr_copy(d, s) ((d).addr = (s).addr)
+#define ip4_addr_cmp(a, b) ((a)->addr == (b)->addr)
+#define ip4_addr1(a) (((const uint8_t *)(&(a)->addr))[0])
+#define ip4_addr2(a) (((const uint8_t *)(&(a)->addr))[1])
+#define ip4_addr3(a) (((const uint8_t *)(&(a)->addr))[2])
+#define ip4_addr4(a) (((const uint8_t *)(&(a)->addr))[3])
+
+#endif /* BENCH_LWIP_IP4_ADDR_H */
@@ -0,0 +1,26 @@
+/**
+ * @file semphr.h
+ * @brief 主机基准测试用信号量桩
+ */
+
+#ifndef BENCH_SEMPHR_H
+#define BENCH_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return (SemaphoreHandle_t)1;
+}
+
+static inline int xSemaphoreTake(SemaphoreHandle_t m, TickType_t t) {
+  (void)m;
+  (void)t;
+  return 1;
+}
+
+static inline int xSemaphoreGive(SemaphoreHandle_t m) {
+  (void)m;
+  return 1;
+}
+
+#endif /* BENCH_SEMPHR_H */
@@ -0,0 +1,11 @@
+/**
+ * @file task.h
+ * @brief 主机基准测试用 FreeRTOS 任务桩 (xTaskGetTickCount 见 FreeRTOS.h)
+ */
+
+#ifndef BENCH_TASK_H
+#define BENCH_TASK_H
+
+#include "FreeRTOS.h"
+
+#endif /* BENCH_TASK_H */
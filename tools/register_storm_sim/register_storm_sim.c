@@ -0,0 +1,356 @@
+/**
+ * @file register_storm_sim.c
+ * @brief 注册风暴仿真 (主机运行)
+ *
+ * 整层楼同时上电, N 个 DDC 向同一个 Top Node 注册, 统计全部上线所需时间。
+ * 对比三种策略:
+ * - legacy:  固定 TPMESH_REGISTER_RETRY_MS 重试 (原实现)
+ * - backoff: 随机启动延时 + 指数退避抖动 (tpmesh_backoff_delay)
+ * - busy:    backoff + Top Node 队列接近溢出时 "忙, N ms 后重试" 应答
+ *            (tpmesh_admit_check)
+ *
+ * Top Node 处理耗时可在编译时调整, 如 -DTOP_PROC_MS=600。
+ *
+ * 编译 (仓库根目录):
+ *   gcc -O2 -IApp/x_protocol tools/register_storm_sim/register_storm_sim.c \
+ *       App/x_protocol/tpmesh_backoff.c -o register_storm_sim
+ *
+ * 信道模型: 单一共享信道, 载波侦听 (信道忙则随机退让, 不计重试);
+ * 侦听窗口 CS_MS 内同时起发的帧相互碰撞, 两帧都丢失。不建模多跳与模组
+ * 内部的重传。Top Node 消息队列与固件一致 (深度 20), 每个注册处理耗时
+ * 约 TOP_PROC_MS (节点表 + GARP + 经 AT 模组发送 ACK), 应答帧同样占用信道。
+ * DDC 心跳任务每 POLL_MS 检查一次, 每次发送经 AT 模组耗时 AT_SEND_MS 内的
+ * 随机值, 任务相位随之漂移。DDC 重试 TPMESH_REGISTER_MAX_RETRIES 次仍未成功则
+ * 复位模组 (MODULE_RESET_MS) 后重新开始。
+ */
+
+#include "tpmesh_backoff.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 与 tpmesh_bridge.h 一致 */
+#define TPMESH_REGISTER_RETRY_MS 5000
+#define TPMESH_REGISTER_BACKOFF_MAX_MS 60000
+#define TPMESH_REGISTER_START_JITTER_MS 5000
+#define TPMESH_REGISTER_MAX_RETRIES 10
+
+#define TICK_MS 10
+#define FRAME_AIR_MS 80     /* 注册帧/应答帧空中时间 (含 Mesh 开销) */
+#define POLL_MS 100         /* DDC 心跳任务周期 */
+#define AT_SEND_MS 60        /* DDC 经 AT 模组发送一帧的耗时上限 */
+#define CS_MS 20            /* 载波侦听窗口 (收发转换) */
+#define CS_DEFER_MS 200     /* 信道忙时的随机退让上限 */
+#ifndef TOP_PROC_MS
+#define TOP_PROC_MS 250     /* Top Node 处理一个注册 (含 AT 发送往返), 均值 */
+#endif
+#define TOP_QUEUE_DEPTH 20  /* Top Node 消息队列 */
+#define BOOT_SPREAD_MS 1000 /* 上电到 Top Node 发现的离散度 */
+#define MODULE_RESET_MS 10000
+#define SIM_LIMIT_MS (30 * 60 * 1000)
+
+#define MAX_DDC 1024
+#define MAX_AIR 4096
+#define SEEDS 5
+
+enum { POLICY_LEGACY, POLICY_BACKOFF, POLICY_BUSY, POLICY_COUNT };
+
+static const char *const s_policy_name[POLICY_COUNT] = {"legacy", "backoff",
+                                                        "busy"};
+
+enum { FR_REGISTER, FR_ACK, FR_BUSY };
+
+typedef struct {
+  uint32_t start;
+  uint32_t end;
+  uint16_t ddc;
+  uint8_t type;
+  uint16_t retry_after;
+  bool collided;
+} air_frame_t;
+
+typedef struct {
+  bool online;
+  uint32_t next;       /* 下次发送时间 */
+  uint8_t retry;       /* 已发送次数 */
+  uint32_t online_at;
+  uint32_t phase;      /* 心跳任务相位 */
+} ddc_t;
+
+typedef struct {
+  uint32_t all_online_ms;
+  uint32_t p50_ms;
+  uint32_t p95_ms;
+  uint32_t uplink;
+  uint32_t collided;
+  uint32_t busy;
+  uint32_t queue_drops;
+  uint32_t resets;
+} result_t;
+
+/* ============================================================================
+ * 仿真状态
+ * ============================================================================
+ */
+
+static uint32_t s_rng;
+
+static ddc_t s_ddc[MAX_DDC];
+static air_frame_t s_air[MAX_AIR];
+static int s_air_count;
+
+static uint16_t s_queue[TOP_QUEUE_DEPTH];
+static int s_q_head, s_q_count;
+static uint32_t s_top_busy_until;
+static uint32_t s_top_tx_until;
+
+static uint32_t rnd(void) {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 17;
+  s_rng ^= s_rng << 5;
+  return s_rng;
+}
+
+static void air_send(uint32_t now, uint16_t ddc, uint8_t type,
+                     uint16_t retry_after, result_t *r) {
+  if (s_air_count >= MAX_AIR) {
+    return;
+  }
+
+  air_frame_t *f = &s_air[s_air_count++];
+  f->start = now;
+  f->end = now + FRAME_AIR_MS;
+  f->ddc = ddc;
+  f->type = type;
+  f->retry_after = retry_after;
+  f->collided = false;
+
+  /* 与仍在空中的帧重叠 (只可能是侦听窗口内起发的帧) */
+  for (int i = 0; i < s_air_count - 1; i++) {
+    if (s_air[i].end > now) {
+      s_air[i].collided = true;
+      f->collided = true;
+    }
+  }
+
+  if (type == FR_REGISTER) {
+    r->uplink++;
+  }
+}
+
+static bool channel_busy(uint32_t now) {
+  for (int i = 0; i < s_air_count; i++) {
+    if (s_air[i].end > now && now - s_air[i].start >= CS_MS) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void ddc_arm(ddc_t *d, uint32_t now, int policy) {
+  if (policy == POLICY_LEGACY) {
+    d->next = now + TPMESH_REGISTER_RETRY_MS;
+  } else {
+    d->next = now + tpmesh_backoff_delay(d->retry, TPMESH_REGISTER_RETRY_MS,
+                                         TPMESH_REGISTER_BACKOFF_MAX_MS, rnd());
+  }
+  d->retry++;
+}
+
+static void ddc_start(ddc_t *d, uint32_t now, int policy) {
+  d->retry = 0;
+  d->next = now;
+  if (policy != POLICY_LEGACY) {
+    d->next += rnd() % TPMESH_REGISTER_START_JITTER_MS;
+  }
+}
+
+static void deliver(const air_frame_t *f, uint32_t now, result_t *r) {
+  if (f->collided) {
+    if (f->type == FR_REGISTER) {
+      r->collided++;
+    }
+    return;
+  }
+
+  ddc_t *d = &s_ddc[f->ddc];
+  switch (f->type) {
+  case FR_REGISTER:
+    if (s_q_count >= TOP_QUEUE_DEPTH) {
+      r->queue_drops++;
+      return;
+    }
+    s_queue[(s_q_head + s_q_count) % TOP_QUEUE_DEPTH] = f->ddc;
+    s_q_count++;
+    break;
+
+  case FR_ACK:
+    if (!d->online) {
+      d->online = true;
+      d->online_at = now;
+    }
+    break;
+
+  case FR_BUSY:
+    if (!d->online) {
+      /* 与 tpmesh_bridge.c 一致: 不计入重试次数, 至少等待建议时间 */
+      if (d->retry > 0) {
+        d->retry--;
+      }
+      uint32_t wait = f->retry_after + rnd() % (f->retry_after + 1u);
+      uint32_t backoff =
+          tpmesh_backoff_delay(d->retry, TPMESH_REGISTER_RETRY_MS,
+                               TPMESH_REGISTER_BACKOFF_MAX_MS, rnd());
+      d->next = now + ((wait > backoff) ? wait : backoff);
+    }
+    break;
+  }
+}
+
+static int cmp_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void run(int n, int policy, uint32_t seed, result_t *r) {
+  static uint32_t times[MAX_DDC];
+
+  memset(r, 0, sizeof(*r));
+  memset(s_ddc, 0, sizeof(s_ddc));
+  s_rng = seed;
+  s_air_count = 0;
+  s_q_head = s_q_count = 0;
+  s_top_busy_until = s_top_tx_until = 0;
+
+  for (int i = 0; i < n; i++) {
+    s_ddc[i].phase = (rnd() % POLL_MS) / TICK_MS * TICK_MS;
+    ddc_start(&s_ddc[i], rnd() % BOOT_SPREAD_MS, policy);
+  }
+
+  int online = 0;
+  uint32_t now;
+  uint32_t top_pending = 0; /* 待发应答: 0=无, 否则 ddc+1 */
+  uint8_t top_type = FR_ACK;
+  uint32_t top_wait = 0;
+  for (now = 0; now < SIM_LIMIT_MS && online < n; now += TICK_MS) {
+    /* 空中帧结束 */
+    int w = 0;
+    for (int i = 0; i < s_air_count; i++) {
+      if (s_air[i].end <= now) {
+        deliver(&s_air[i], now, r);
+      } else {
+        s_air[w++] = s_air[i];
+      }
+    }
+    s_air_count = w;
+
+    /* Top Node 处理队列 (一个注册处理完并发出应答才取下一个) */
+    if (top_pending == 0 && s_q_count > 0) {
+      uint16_t id = s_queue[s_q_head];
+      s_q_head = (s_q_head + 1) % TOP_QUEUE_DEPTH;
+      s_q_count--;
+
+      top_wait = 0;
+      if (policy == POLICY_BUSY) {
+        top_wait = tpmesh_admit_check((uint16_t)s_q_count);
+      }
+      top_type = (top_wait != 0) ? FR_BUSY : FR_ACK;
+      s_top_busy_until =
+          now + ((top_wait != 0) ? TICK_MS
+                                 : TOP_PROC_MS / 2 + rnd() % TOP_PROC_MS);
+      top_pending = (uint32_t)id + 1;
+    }
+    if (top_pending != 0 && now >= s_top_busy_until &&
+        now >= s_top_tx_until) {
+      if (channel_busy(now)) {
+        s_top_tx_until = now + rnd() % CS_DEFER_MS;
+      } else {
+        air_send(now, (uint16_t)(top_pending - 1), top_type,
+                 (uint16_t)top_wait, r);
+        if (top_type == FR_BUSY) {
+          r->busy++;
+        }
+        top_pending = 0;
+      }
+    }
+
+    /* DDC 发送 */
+    online = 0;
+    for (int i = 0; i < n; i++) {
+      ddc_t *d = &s_ddc[i];
+      if (d->online) {
+        online++;
+        continue;
+      }
+      if ((now - d->phase) % POLL_MS != 0 || (int32_t)(now - d->next) < 0) {
+        continue;
+      }
+      if (d->retry >= TPMESH_REGISTER_MAX_RETRIES) {
+        r->resets++;
+        ddc_start(d, now + MODULE_RESET_MS, policy);
+        continue;
+      }
+      if (channel_busy(now)) {
+        d->next = now + rnd() % CS_DEFER_MS;
+        continue;
+      }
+      air_send(now, (uint16_t)i, FR_REGISTER, 0, r);
+      d->phase = (now + rnd() % AT_SEND_MS) % POLL_MS / TICK_MS * TICK_MS;
+      ddc_arm(d, now, policy);
+    }
+  }
+
+  for (int i = 0; i < n; i++) {
+    times[i] = s_ddc[i].online ? s_ddc[i].online_at : SIM_LIMIT_MS;
+  }
+  qsort(times, (size_t)n, sizeof(times[0]), cmp_u32);
+  r->all_online_ms = (online < n) ? SIM_LIMIT_MS : times[n - 1];
+  r->p50_ms = times[n / 2];
+  r->p95_ms = times[(n * 95) / 100];
+}
+
+int main(void) {
+  static const int sizes[] = {50, 100, 200, 400};
+
+  printf("Register storm: CSMA channel, %d ms airtime, %d ms per register, "
+         "%d seeds each\n",
+         FRAME_AIR_MS, TOP_PROC_MS, SEEDS);
+  printf("%5s %-8s %9s %8s %8s %8s %7s %6s %6s %6s\n", "DDCs", "policy",
+         "all(s)", "p50(s)", "p95(s)", "uplink", "coll%", "busy", "qdrop",
+         "reset");
+
+  for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+    for (int p = 0; p < POLICY_COUNT; p++) {
+      result_t sum;
+      memset(&sum, 0, sizeof(sum));
+      uint32_t worst = 0;
+
+      for (int s = 0; s < SEEDS; s++) {
+        result_t r;
+        run(sizes[k], p, 0x9E3779B9u * (uint32_t)(s + 1), &r);
+        sum.all_online_ms += r.all_online_ms;
+        sum.p50_ms += r.p50_ms;
+        sum.p95_ms += r.p95_ms;
+        sum.uplink += r.uplink;
+        sum.collided += r.collided;
+        sum.busy += r.busy;
+        sum.queue_drops += r.queue_drops;
+        sum.resets += r.resets;
+        if (r.all_online_ms > worst) {
+          worst = r.all_online_ms;
+        }
+      }
+
+      printf("%5d %-8s %4.0f/%-4.0f %8.1f %8.1f %8u %6.1f%% %6u %6u %6u\n",
+             sizes[k], s_policy_name[p], sum.all_online_ms / 1000.0 / SEEDS,
+             worst / 1000.0, sum.p50_ms / 1000.0 / SEEDS,
+             sum.p95_ms / 1000.0 / SEEDS, sum.uplink / SEEDS,
+             sum.uplink ? 100.0 * sum.collided / sum.uplink : 0.0,
+             sum.busy / SEEDS, sum.queue_drops / SEEDS, sum.resets / SEEDS);
+    }
+  }
+  printf("all(s) = mean/worst time until every DDC is online\n");
+  return 0;
+}